@@ -0,0 +1,153 @@
+#include "Arena.h"
+
+#include <stdio.h>
+#include <string.h>
+
+Arena::Arena()
+{
+    base = NULL;
+    size = 0;
+    used = 0;
+    peak = 0;
+    last = 0;
+}
+
+void Arena::init(uint8_t* buffer, size_t buffer_size)
+{
+    base = buffer;
+    size = buffer_size;
+    used = 0;
+    peak = 0;
+    last = 0;
+}
+
+void* Arena::alloc(size_t bytes)
+{
+    size_t start = (used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if(base == NULL || start > size || bytes > size - start)
+        return NULL;
+
+    used = start + bytes;
+    if(used > peak)
+        peak = used;
+
+    last = start;
+
+    return base + start;
+}
+
+bool Arena::resize(void* block, size_t bytes)
+{
+    if(block == NULL || (uint8_t*)block != base + last || bytes > size - last)
+        return false;
+
+    used = last + bytes;
+    if(used > peak)
+        peak = used;
+
+    return true;
+}
+
+#define ARENA_TEXT_START        256                 // First size of a text, doubled as it grows
+
+ArenaText::ArenaText(Arena &text_arena) : arena(text_arena)
+{
+    len = 0;
+    cut = false;
+    size = ARENA_TEXT_START;
+    buf = arena.alloc_array<char>(size);
+
+    if(buf == NULL)
+    {
+        size = 0;
+        cut = true;
+    }
+    else
+        buf[0] = '\0';
+}
+
+bool ArenaText::reserve(size_t bytes)
+{
+    if(cut)
+        return false;
+
+    if(len + bytes < size)
+        return true;
+
+    size_t new_size = size * 2 > len + bytes + 1 ? size * 2 : len + bytes + 1;
+
+    // Takes what is left of the arena if the doubled size does not fit
+    if(!arena.resize(buf, new_size))
+    {
+        new_size = len + bytes + 1;
+        if(!arena.resize(buf, new_size))
+        {
+            cut = true;
+            return false;
+        }
+    }
+
+    size = new_size;
+
+    return true;
+}
+
+void ArenaText::add(const char* str)
+{
+    size_t bytes = strlen(str);
+
+    if(!reserve(bytes))
+        return;
+
+    memcpy(buf + len, str, bytes + 1);
+    len += bytes;
+}
+
+char* ArenaText::add_space(size_t bytes)
+{
+    if(!reserve(bytes))
+        return NULL;
+
+    char* start = buf + len;
+    len += bytes;
+    buf[len] = '\0';
+
+    return start;
+}
+
+void ArenaText::addf(const char* format, ...)
+{
+    va_list args;
+
+    if(cut)
+        return;
+
+    va_start(args, format);
+    int bytes = vsnprintf(buf + len, size - len, format, args);
+    va_end(args);
+
+    if(bytes < 0)
+    {
+        buf[len] = '\0';
+        return;
+    }
+
+    if(len + bytes < size)
+    {
+        len += bytes;
+        return;
+    }
+
+    // Did not fit, written again once there is room
+    buf[len] = '\0';
+
+    if(!reserve(bytes))
+        return;
+
+    va_start(args, format);
+    vsnprintf(buf + len, size - len, format, args);
+    va_end(args);
+
+    len += bytes;
+}
@@ -0,0 +1,76 @@
+#ifndef __UNIVERSALREMOTE_ARENA__
+#define __UNIVERSALREMOTE_ARENA__
+
+// Bump allocator over a fixed buffer. Allocations are never freed one by one, the whole arena is reset at once.
+// Kept free of Arduino headers, so that it can be compiled and checked on the host.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#define ARENA_ALIGN             4
+
+class Arena
+{
+private:
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    size_t peak;
+    size_t last;                                    // Offset of the last allocation
+
+public:
+    Arena();
+
+    // Uses the buffer, which has to stay valid while the arena is used, and resets the arena
+    void init(uint8_t* buffer, size_t buffer_size);
+
+    // Returns size bytes aligned to ARENA_ALIGN, or NULL if they do not fit
+    void* alloc(size_t bytes);
+
+    // Same as alloc, for count elements of type T
+    template<typename T> T* alloc_array(size_t count) { return (T*)alloc(count * sizeof(T)); }
+
+    // Resizes the last allocation in place to bytes. Returns false if block is not the last allocation, or if it does not fit
+    bool resize(void* block, size_t bytes);
+
+    // Frees everything allocated so far
+    void reset() { used = 0; last = 0; }
+
+    size_t get_size() { return size; }
+    size_t get_used() { return used; }
+
+    // Highest use since init
+    size_t get_peak() { return peak; }
+};
+
+// Text built in pieces in an arena, for responses. The text is the last allocation of the arena while it grows,
+// so that it takes no more than its length. Text that does not fit in the arena is cut, and is_cut() tells so.
+class ArenaText
+{
+private:
+    Arena &arena;
+    char* buf;
+    size_t size;
+    size_t len;
+    bool cut;
+
+    // Makes room for bytes more, with the null termination. Returns false if the arena is full
+    bool reserve(size_t bytes);
+
+public:
+    ArenaText(Arena &text_arena);
+
+    void add(const char* str);
+    void addf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Adds bytes characters written by the caller, who gets where they go with room for a null termination after them.
+    // Returns NULL if they do not fit
+    char* add_space(size_t bytes);
+
+    const char* c_str() { return buf != NULL ? buf : ""; }
+    size_t length() { return len; }
+    bool is_cut() { return cut; }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "Benchmark.h"
+
+#include "TaskConfig.h"
+#include "BinLog.h"
+
+#define TAG "bench"
+
+// NEC frame used for the test
+static const uint16_t kBenchHeader[] = {9000, 4500};
+static const uint16_t kBenchMark = 560;
+static const uint16_t kBenchZero = 560;
+static const uint16_t kBenchOne = 1690;
+static const uint32_t kBenchData = 0x20DF10EF;
+static const uint16_t kBenchLength = 2 + 2 * 32 + 1;
+
+// Fills timings with the test frame
+static void bench_frame(uint16_t* timings)
+{
+    uint16_t n = 0;
+
+    timings[n++] = kBenchHeader[0];
+    timings[n++] = kBenchHeader[1];
+
+    for(int8_t bit = 31; bit >= 0; bit--)
+    {
+        timings[n++] = kBenchMark;
+        timings[n++] = (kBenchData >> bit) & 1 ? kBenchOne : kBenchZero;
+    }
+
+    timings[n++] = kBenchMark;
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts the values and appends <p50>,<p99>,<max>
+static void append_percentiles(ArenaText &text, uint32_t* values, uint16_t count)
+{
+    if(count == 0)
+    {
+        text.add("0,0,0");
+        return;
+    }
+
+    qsort(values, count, sizeof(uint32_t), compare_u32);
+
+    text.addf("%u,%u,%u", values[(count - 1) * 50 / 100], values[(count - 1) * 99 / 100], values[count - 1]);
+}
+
+void IRBenchmark::bench_task(void* param)
+{
+    IRBenchmark* bench = (IRBenchmark*)param;
+
+    for(;;)
+    {
+        // Notified by start for each run
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint16_t timings[kBenchLength];
+        bench_frame(timings);
+
+        uint32_t frame_us = 0;
+        String message = String(kBenchLength) + ":";
+        for(uint16_t i = 0; i < kBenchLength; i++)
+        {
+            frame_us += timings[i];
+            message += String(timings[i]) + ",";
+        }
+
+        for(uint16_t frame = 0; frame < bench->frames; frame++)
+        {
+            decode_results results;
+            capture_request_t request;
+            int64_t elapsed_us = 0;
+
+            // Start listening before the frame goes out
+            bench->receiver->start_receive(&request, &results, 1000);
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+
+            if(bench->emitters->send_raw_timed(0, message.c_str(), &elapsed_us) == ESP_OK)
+                bench->emit_errors[bench->emit_count++] = abs((int32_t)(elapsed_us - frame_us));
+
+            if(bench->receiver->wait_receive(&request) && results.rawlen - 1 == kBenchLength)
+            {
+                bench->received++;
+
+                for(uint16_t i = 0; i < kBenchLength; i++)
+                {
+                    int32_t captured = results.rawbuf[i + 1] * kRawTick;
+                    bench->capture_errors[bench->capture_count++] = abs(captured - timings[i]);
+                }
+            }
+
+            vTaskDelay(BENCH_FRAME_GAP / portTICK_PERIOD_MS);
+        }
+
+        BLOGI("Benchmark done, %d of %d frames received", bench->received, bench->frames);
+
+        bench->running = false;
+    }
+}
+
+IRBenchmark::IRBenchmark(EmitterChannels* send, ReceiveHandler* recv)
+{
+    emitters    = send;
+    receiver    = recv;
+    benchTask_h = NULL;
+    running     = false;
+    frames      = 0;
+    received    = 0;
+
+    emit_count      = 0;
+    capture_count   = 0;
+    emit_errors     = NULL;
+    capture_errors  = NULL;
+}
+
+esp_err_t IRBenchmark::start(uint16_t num_frames)
+{
+    if(running || num_frames == 0)
+        return ESP_FAIL;
+
+    if(num_frames > BENCH_MAX_FRAMES)
+        num_frames = BENCH_MAX_FRAMES;
+
+    free(emit_errors);
+    free(capture_errors);
+
+    // The report of the previous run goes with its arrays
+    emit_count      = 0;
+    capture_count   = 0;
+
+    emit_errors = (uint32_t*)malloc(num_frames * sizeof(uint32_t));
+    capture_errors = (uint32_t*)malloc(num_frames * kBenchLength * sizeof(uint32_t));
+
+    if(emit_errors == NULL || capture_errors == NULL)
+    {
+        free(emit_errors);
+        free(capture_errors);
+        emit_errors = NULL;
+        capture_errors = NULL;
+
+        return ESP_ERR_NO_MEM;
+    }
+
+    frames          = num_frames;
+    received        = 0;
+    emit_count      = 0;
+    capture_count   = 0;
+    running         = true;
+
+    // The task is created with the first run, and waits for the next one after each
+    if(benchTask_h == NULL)
+        benchTask_h = static_task_create(task_storage, bench_task, "IR benchmark", this, SERVER_TASK_PRIO, SERVER_TASK_CORE);
+
+    if(benchTask_h == NULL)
+    {
+        running = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    xTaskNotifyGive(benchTask_h);
+
+    return ESP_OK;
+}
+
+void IRBenchmark::get_report(ArenaText &text)
+{
+    if(running)
+    {
+        text.add("running");
+        return;
+    }
+
+    text.addf("frames=%u,received=%u;emit_us=", frames, received);
+    append_percentiles(text, emit_errors, emit_count);
+    text.add(";capture_us=");
+    append_percentiles(text, capture_errors, capture_count);
+}
@@ -0,0 +1,52 @@
+#ifndef __UNIVERSALREMOTE_BENCHMARK__
+#define __UNIVERSALREMOTE_BENCHMARK__
+
+#include <Arduino.h>
+
+#include "IRHandlers.h"
+#include "IRChannels.h"
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
+#define BENCH_MAX_FRAMES        100
+#define BENCH_FRAME_GAP         100                 // Time between test frames in milliseconds
+
+// Measures IR timing accuracy by sending a test frame on emitter channel 0 and capturing it with the receiver.
+// The emitter has to be pointed at the receiver. Meant to be run while the server is under load.
+// - emit error     - Difference between the time taken to transmit a frame and the requested frame length
+// - capture error  - Difference between each captured mark/space and the requested one
+// Enabled by building with IR_BENCHMARK
+class IRBenchmark
+{
+private:
+    EmitterChannels* emitters;
+    ReceiveHandler* receiver;
+
+    TaskHandle_t benchTask_h;
+    static_task_t<BENCH_TASK_STACK> task_storage;
+
+    volatile bool running;
+    uint16_t frames;
+    uint16_t received;
+
+    uint16_t emit_count;
+    uint16_t capture_count;
+    uint32_t* emit_errors;
+    uint32_t* capture_errors;
+
+    static void bench_task(void* param);
+
+public:
+    IRBenchmark(EmitterChannels* send, ReceiveHandler* recv);
+
+    // Starts a run of num_frames test frames in the background. Returns ESP_FAIL if a run is in progress,
+    // and ESP_ERR_NO_MEM if the run cannot be allocated
+    esp_err_t start(uint16_t num_frames);
+
+    // Puts the result of the last run into the passed string
+    // Format : frames=<sent>,received=<received>;emit_us=<p50>,<p99>,<max>;capture_us=<p50>,<p99>,<max>
+    // Returns "running" while a run is in progress
+    void get_report(ArenaText &text);
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "BinLog.h"
+
+#include <mbedtls/base64.h>
+
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
+static uint32_t ring_buffer[BINLOG_RING_SIZE / 4];
+static BinLogRing ring(ring_buffer, sizeof(ring_buffer));
+static static_task_t<LOG_TASK_STACK> drain_task_storage;
+
+// Prints the records as base64 lines, and the number of records dropped since the last time
+static void drain_task(void* param)
+{
+    uint32_t record[BINLOG_MAX_RECORD / 4];
+    unsigned char line[(BINLOG_MAX_RECORD + 2) / 3 * 4 + 1];
+    uint32_t reported = 0;
+
+    for(;;)
+    {
+        size_t len;
+
+        while((len = ring.pop(record, sizeof(record))) > 0)
+        {
+            size_t line_len;
+
+            if(mbedtls_base64_encode(line, sizeof(line), &line_len, (const unsigned char*)record, len) == 0)
+                printf(BINLOG_LINE_PREFIX "%s\n", line);
+        }
+
+        uint32_t dropped = ring.get_dropped();
+        if(dropped != reported)
+        {
+            printf("binlog : %u records dropped\n", dropped - reported);
+            reported = dropped;
+        }
+
+        vTaskDelay(BINLOG_DRAIN_PERIOD_MS / portTICK_PERIOD_MS);
+    }
+}
+
+void binlog_begin()
+{
+    static_task_create(drain_task_storage, drain_task, "binlog", NULL, LOG_TASK_PRIO, LOG_TASK_CORE);
+}
+
+bool binlog_allow(binlog_site_t &site)
+{
+    if(site.rate == 0)
+        return true;
+
+    uint32_t now = millis();
+
+    if(now - site.period_start >= BINLOG_RATE_PERIOD_MS)
+    {
+        site.period_start = now;
+        site.count = 0;
+    }
+
+    if(site.count >= site.rate)
+    {
+        if(site.suppressed < 0xFFFF)
+            site.suppressed++;
+        return false;
+    }
+
+    site.count++;
+
+    return true;
+}
+
+void binlog_start(binlog_record_t &record, binlog_site_t &site, uint8_t count)
+{
+    record.args = count < BINLOG_MAX_ARGS ? count : BINLOG_MAX_ARGS;
+    record.next = 0;
+
+    record.words[2] = millis();
+    record.words[3] = site.suppressed;
+    site.suppressed = 0;
+
+    record.types = (uint8_t*)&record.words[BINLOG_HEADER_WORDS];
+    memset(record.types, BINLOG_ARG_NONE, (record.args + 3) & ~3);
+
+    record.len = BINLOG_HEADER_WORDS * 4 + ((record.args + 3) & ~3);
+}
+
+void binlog_finish(binlog_record_t &record, binlog_site_t &site)
+{
+    record.words[0] = record.len | (site.level << 16) | (record.args << 19);
+    record.words[1] = (uint32_t)(uintptr_t)site.format;
+
+    ring.push(record.words);
+}
+
+// Reserves room for the next argument. Returns NULL if it does not fit, and it is then left out
+static uint8_t* add_arg(binlog_record_t &record, binlog_arg_t type, size_t size)
+{
+    size_t padded = (size + 3) & ~3;
+
+    if(record.next >= record.args)
+        return NULL;
+
+    uint8_t index = record.next++;
+
+    if(record.len + padded > BINLOG_MAX_RECORD)
+        return NULL;
+
+    uint8_t* out = (uint8_t*)record.words + record.len;
+
+    record.types[index] = type;
+    record.len += padded;
+
+    return out;
+}
+
+void binlog_put(binlog_record_t &record, int value)
+{
+    uint8_t* out = add_arg(record, BINLOG_ARG_INT, sizeof(int32_t));
+    if(out != NULL)
+        *(int32_t*)out = value;
+}
+
+void binlog_put(binlog_record_t &record, unsigned int value)
+{
+    uint8_t* out = add_arg(record, BINLOG_ARG_UINT, sizeof(uint32_t));
+    if(out != NULL)
+        *(uint32_t*)out = value;
+}
+
+void binlog_put(binlog_record_t &record, long value)
+{
+    if(sizeof(long) > sizeof(int32_t))
+        binlog_put(record, (long long)value);
+    else
+        binlog_put(record, (int)value);
+}
+
+void binlog_put(binlog_record_t &record, unsigned long value)
+{
+    if(sizeof(unsigned long) > sizeof(uint32_t))
+        binlog_put(record, (unsigned long long)value);
+    else
+        binlog_put(record, (unsigned int)value);
+}
+
+void binlog_put(binlog_record_t &record, long long value)
+{
+    uint8_t* out = add_arg(record, BINLOG_ARG_INT64, sizeof(int64_t));
+    if(out != NULL)
+        memcpy(out, &value, sizeof(int64_t));
+}
+
+void binlog_put(binlog_record_t &record, unsigned long long value)
+{
+    uint8_t* out = add_arg(record, BINLOG_ARG_UINT64, sizeof(uint64_t));
+    if(out != NULL)
+        memcpy(out, &value, sizeof(uint64_t));
+}
+
+void binlog_put(binlog_record_t &record, double value)
+{
+    uint8_t* out = add_arg(record, BINLOG_ARG_DOUBLE, sizeof(double));
+    if(out != NULL)
+        memcpy(out, &value, sizeof(double));
+}
+
+void binlog_put(binlog_record_t &record, const char* value)
+{
+    if(value == NULL)
+        value = "(null)";
+
+    size_t len = strnlen(value, BINLOG_MAX_STR);
+
+    uint8_t* out = add_arg(record, BINLOG_ARG_STR, 1 + len);
+    if(out != NULL)
+    {
+        out[0] = len;
+        memcpy(out + 1, value, len);
+    }
+}
+
+void binlog_put(binlog_record_t &record, const void* value)
+{
+    binlog_put(record, (unsigned int)(uintptr_t)value);
+}
@@ -0,0 +1,153 @@
+#ifndef __UNIVERSALREMOTE_BINLOG__
+#define __UNIVERSALREMOTE_BINLOG__
+
+// Deferred logging. A log call stores the address of its format string and its arguments in binary in a ring buffer,
+// and a low priority task prints the records later, so that requests and IR tasks do not wait for the UART.
+// The records are printed as BINLOG_LINE_PREFIX followed by base64, and are turned back into text on the computer
+// with tools/binlog_decode.py, which reads the format strings from the firmware ELF.
+//
+// - BLOGE, BLOGW, BLOGI and BLOGD take a printf format and arguments, like ESP_LOGx. The file has to define TAG as
+//   a string literal.
+// - Calls above BINLOG_LEVEL are removed at compile time, with their format strings. Their arguments are not evaluated.
+// - Each call site logs at most BINLOG_DEFAULT_RATE records per BINLOG_RATE_PERIOD_MS, or the rate given to BLOG_RATE
+//   (0 for no limit). The records left out are counted, and the count is printed with the next record of the site.
+// - String arguments are copied, up to BINLOG_MAX_STR characters. Records that find the ring buffer full are dropped,
+//   and the number dropped is printed in text.
+
+#include <Arduino.h>
+
+#include "BinLogRing.h"
+
+#define BINLOG_LEVEL_NONE       0
+#define BINLOG_LEVEL_ERROR      1
+#define BINLOG_LEVEL_WARN       2
+#define BINLOG_LEVEL_INFO       3
+#define BINLOG_LEVEL_DEBUG      4
+
+#ifndef BINLOG_LEVEL
+#define BINLOG_LEVEL            BINLOG_LEVEL_INFO
+#endif
+
+#ifndef BINLOG_RING_SIZE
+#define BINLOG_RING_SIZE        4096                // Bytes, a power of 2
+#endif
+
+#define BINLOG_DEFAULT_RATE     10
+#define BINLOG_RATE_PERIOD_MS   1000
+#define BINLOG_MAX_RECORD       128                 // Bytes, arguments beyond it are left out
+#define BINLOG_MAX_STR          48
+#define BINLOG_DRAIN_PERIOD_MS  50
+#define BINLOG_LINE_PREFIX      "~L"
+
+// Record layout, in little endian 32 bit words :
+// - word 0 : length in bytes (bits 0-15), level (bits 16-18), number of arguments (bits 19-23)
+// - word 1 : address of the format string
+// - word 2 : time in milliseconds since boot
+// - word 3 : records of the site left out by its rate limit since its last record (bits 0-15)
+// - one binlog_arg_t byte per argument, padded to a word
+// - the arguments, each padded to a word. Strings are a length byte followed by the characters
+#define BINLOG_HEADER_WORDS     4
+#define BINLOG_MAX_ARGS         31
+
+enum binlog_arg_t
+{
+    BINLOG_ARG_NONE     = 0,                        // Did not fit in the record
+    BINLOG_ARG_INT      = 1,
+    BINLOG_ARG_UINT     = 2,
+    BINLOG_ARG_INT64    = 3,
+    BINLOG_ARG_UINT64   = 4,
+    BINLOG_ARG_DOUBLE   = 5,
+    BINLOG_ARG_STR      = 6
+};
+
+// State of a log call site, in a static variable at the site
+struct binlog_site_t
+{
+    const char* format;
+    uint8_t level;
+    uint16_t rate;
+    uint16_t count;                                 // Records in the current period
+    uint16_t suppressed;
+    uint32_t period_start;
+};
+
+// A record being built, on the stack of the caller
+struct binlog_record_t
+{
+    uint32_t words[BINLOG_MAX_RECORD / 4];
+    uint8_t* types;
+    uint8_t args;                                   // Number of arguments, as in word 0
+    uint8_t next;                                   // Index of the next argument
+    uint16_t len;
+};
+
+// Starts the task that prints the records. Records logged before are kept, up to the ring buffer size
+void binlog_begin();
+
+// Checks the rate limit of the site. Updates to its state from several tasks may race,
+// which can only let a few more records through
+bool binlog_allow(binlog_site_t &site);
+
+void binlog_start(binlog_record_t &record, binlog_site_t &site, uint8_t count);
+void binlog_finish(binlog_record_t &record, binlog_site_t &site);
+
+void binlog_put(binlog_record_t &record, int value);
+void binlog_put(binlog_record_t &record, unsigned int value);
+void binlog_put(binlog_record_t &record, long value);
+void binlog_put(binlog_record_t &record, unsigned long value);
+void binlog_put(binlog_record_t &record, long long value);
+void binlog_put(binlog_record_t &record, unsigned long long value);
+void binlog_put(binlog_record_t &record, double value);
+void binlog_put(binlog_record_t &record, const char* value);
+void binlog_put(binlog_record_t &record, const void* value);
+
+template<typename... Args> void binlog_write(binlog_site_t &site, Args... args)
+{
+    if(!binlog_allow(site))
+        return;
+
+    binlog_record_t record;
+    binlog_start(record, site, sizeof...(Args));
+
+    int expand[] = {0, (binlog_put(record, args), 0)...};
+    (void)expand;
+
+    binlog_finish(record, site);
+}
+
+#define BLOG_RATE(level, rate, format, ...) \
+    do \
+    { \
+        if((level) <= BINLOG_LEVEL) \
+        { \
+            static binlog_site_t binlog_site = {TAG ": " format, level, rate, 0, 0, 0}; \
+            binlog_write(binlog_site, ##__VA_ARGS__); \
+        } \
+    } \
+    while(0)
+
+#if BINLOG_LEVEL >= BINLOG_LEVEL_ERROR
+#define BLOGE(format, ...)      BLOG_RATE(BINLOG_LEVEL_ERROR, BINLOG_DEFAULT_RATE, format, ##__VA_ARGS__)
+#else
+#define BLOGE(format, ...)      do {} while(0)
+#endif
+
+#if BINLOG_LEVEL >= BINLOG_LEVEL_WARN
+#define BLOGW(format, ...)      BLOG_RATE(BINLOG_LEVEL_WARN, BINLOG_DEFAULT_RATE, format, ##__VA_ARGS__)
+#else
+#define BLOGW(format, ...)      do {} while(0)
+#endif
+
+#if BINLOG_LEVEL >= BINLOG_LEVEL_INFO
+#define BLOGI(format, ...)      BLOG_RATE(BINLOG_LEVEL_INFO, BINLOG_DEFAULT_RATE, format, ##__VA_ARGS__)
+#else
+#define BLOGI(format, ...)      do {} while(0)
+#endif
+
+#if BINLOG_LEVEL >= BINLOG_LEVEL_DEBUG
+#define BLOGD(format, ...)      BLOG_RATE(BINLOG_LEVEL_DEBUG, BINLOG_DEFAULT_RATE, format, ##__VA_ARGS__)
+#else
+#define BLOGD(format, ...)      do {} while(0)
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#include "BinLogRing.h"
+
+bool BinLogRing::push(const uint32_t* record)
+{
+    uint32_t len = ((record[0] & BINLOG_RING_LEN_MASK) + 3) & ~3u;
+    uint32_t head = __atomic_load_n(&reserve, __ATOMIC_RELAXED);
+
+    if(len == 0)
+        return false;
+
+    do
+    {
+        if(head + len - __atomic_load_n(&read, __ATOMIC_ACQUIRE) > (mask + 1) * 4)
+        {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    }
+    while(!__atomic_compare_exchange_n(&reserve, &head, head + len, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    uint32_t first = head / 4;
+
+    for(uint32_t i = 1; i < len / 4; i++)
+        words[(first + i) & mask] = record[i];
+
+    // Publishes the record
+    __atomic_store_n(&words[first & mask], record[0], __ATOMIC_RELEASE);
+
+    return true;
+}
+
+size_t BinLogRing::pop(uint32_t* out, size_t max_len)
+{
+    uint32_t first = read / 4;
+    uint32_t header = __atomic_load_n(&words[first & mask], __ATOMIC_ACQUIRE);
+
+    if(header == 0)
+        return 0;
+
+    uint32_t len = ((header & BINLOG_RING_LEN_MASK) + 3) & ~3u;
+    bool fits = len <= max_len;
+
+    for(uint32_t i = 0; i < len / 4; i++)
+    {
+        if(fits)
+            out[i] = words[(first + i) & mask];
+        words[(first + i) & mask] = 0;
+    }
+
+    // Hands the space back to the writers
+    __atomic_store_n(&read, read + len, __ATOMIC_RELEASE);
+
+    if(!fits)
+    {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    return len;
+}
+
+uint32_t BinLogRing::get_used()
+{
+    return __atomic_load_n(&reserve, __ATOMIC_RELAXED) - __atomic_load_n(&read, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,48 @@
+#ifndef __UNIVERSALREMOTE_BINLOG_RING__
+#define __UNIVERSALREMOTE_BINLOG_RING__
+
+// Ring buffer of variable length records, written by any number of tasks and read by one, without locks.
+// Kept free of Arduino headers, so that it can be compiled and checked on the host.
+//
+// Records are whole 32 bit words. Their first word holds their length in bytes in its low 16 bits and must not be 0.
+// A writer reserves space by moving the reserve counter forward, copies the rest of the record, and writes the
+// first word last, which publishes the record. The reader waits at a record whose first word is still 0, and
+// clears each record after reading it, so that the space can be reserved again.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BINLOG_RING_LEN_MASK    0xFFFF
+
+class BinLogRing
+{
+private:
+    uint32_t* words;
+    uint32_t mask;                                  // Capacity in words, minus 1
+
+    // Free running byte counters. Only reserve is written by several tasks
+    uint32_t reserve;
+    uint32_t read;
+
+    uint32_t dropped;
+
+public:
+    // Uses the buffer, whose size in bytes has to be a power of 2 and at least 8, and which has to be zeroed.
+    // The constructor is constexpr, so that a global ring can be used before the constructors run
+    constexpr BinLogRing(uint32_t* buffer, size_t size) :
+        words(buffer), mask(size / 4 - 1), reserve(0), read(0), dropped(0) {}
+
+    // Adds a record. Returns false, and counts it as dropped, if the ring is full
+    bool push(const uint32_t* record);
+
+    // Copies the oldest record to out and removes it. Returns its length in bytes, or 0 if there is no complete
+    // record, or if it is longer than max_len (it is then dropped)
+    size_t pop(uint32_t* out, size_t max_len);
+
+    uint32_t get_dropped() { return __atomic_load_n(&dropped, __ATOMIC_RELAXED); }
+
+    // Bytes reserved and not read yet
+    uint32_t get_used();
+};
+
+#endif
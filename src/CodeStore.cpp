@@ -0,0 +1,134 @@
+#include "CodeStore.h"
+
+#include "IRCompress.h"
+#include "BinLog.h"
+
+#define TAG "codes"
+
+bool CodeStore::valid_name(const char* name)
+{
+    size_t len = strlen(name);
+
+    return len > 0 && len <= CODE_NAME_MAX_LEN && name[0] != '_' && strchr(name, '$') == NULL;
+}
+
+esp_err_t CodeStore::begin()
+{
+    return nvs_open(NVS_CODES_NAMESPACE, NVS_READWRITE, &nvs_codes);
+}
+
+esp_err_t CodeStore::save(const char* name, const uint16_t* timings, uint16_t len)
+{
+    uint8_t* packed = (uint8_t*)malloc(CODE_MAX_PACKED_SIZE);
+    if(packed == NULL)
+        return ESP_ERR_NO_MEM;
+
+    size_t size = irpack_encode(timings, len, packed, CODE_MAX_PACKED_SIZE);
+
+    esp_err_t ret = size ? save_packed(name, packed, size) : ESP_FAIL;
+
+    BLOGI("Stored %s, %d timings in %d bytes", name, len, size);
+
+    free(packed);
+
+    return ret;
+}
+
+esp_err_t CodeStore::save_packed(const char* name, const uint8_t* data, size_t size)
+{
+    if(!valid_name(name) || size < 4 || data[0] != IRPACK_VERSION)
+        return ESP_FAIL;
+
+    bool existing = nvs_get_blob(nvs_codes, name, NULL, NULL) == ESP_OK;
+
+    esp_err_t ret = nvs_set_blob(nvs_codes, name, data, size);
+    if(ret != ESP_OK)
+        return ret;
+
+    if(!existing)
+    {
+        String index;
+        read_index(index);
+        index += String(name) + "$";
+        nvs_set_str(nvs_codes, NVS_CODES_INDEX_KEY, index.c_str());
+    }
+
+    return nvs_commit(nvs_codes);
+}
+
+esp_err_t CodeStore::load(const char* name, uint16_t* timings, uint16_t max_len, uint16_t &len)
+{
+    if(!valid_name(name))
+        return ESP_ERR_NOT_FOUND;
+
+    size_t size = 0;
+    if(nvs_get_blob(nvs_codes, name, NULL, &size) != ESP_OK)
+        return ESP_ERR_NOT_FOUND;
+
+    uint8_t* packed = (uint8_t*)malloc(size);
+    if(packed == NULL)
+        return ESP_ERR_NO_MEM;
+
+    nvs_get_blob(nvs_codes, name, packed, &size);
+
+    int decoded = irpack_decode(packed, size, timings, max_len);
+
+    free(packed);
+
+    if(decoded < 0)
+        return ESP_FAIL;
+
+    len = decoded;
+
+    return ESP_OK;
+}
+
+esp_err_t CodeStore::remove(const char* name)
+{
+    if(!valid_name(name) || nvs_erase_key(nvs_codes, name) != ESP_OK)
+        return ESP_ERR_NOT_FOUND;
+
+    String index;
+    read_index(index);
+
+    String entry = String(name) + "$";
+    int pos = index.startsWith(entry) ? 0 : index.indexOf("$" + entry);
+    if(pos > 0)
+        pos++;
+    if(pos >= 0)
+        index.remove(pos, entry.length());
+
+    nvs_set_str(nvs_codes, NVS_CODES_INDEX_KEY, index.c_str());
+
+    return nvs_commit(nvs_codes);
+}
+
+void CodeStore::read_index(String &str)
+{
+    size_t len = 0;
+
+    if(nvs_get_str(nvs_codes, NVS_CODES_INDEX_KEY, NULL, &len) != ESP_OK || len == 0)
+        return;
+
+    char* index = (char*)malloc(len);
+    if(index == NULL)
+        return;
+
+    nvs_get_str(nvs_codes, NVS_CODES_INDEX_KEY, index, &len);
+    str += index;
+
+    free(index);
+}
+
+void CodeStore::list(ArenaText &text)
+{
+    size_t len = 0;
+
+    if(nvs_get_str(nvs_codes, NVS_CODES_INDEX_KEY, NULL, &len) != ESP_OK || len <= 1)
+        return;
+
+    // len counts the null termination
+    char* index = text.add_space(len - 1);
+    if(index != NULL)
+        nvs_get_str(nvs_codes, NVS_CODES_INDEX_KEY, index, &len);
+}
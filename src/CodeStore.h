@@ -0,0 +1,50 @@
+#ifndef __UNIVERSALREMOTE_CODE_STORE__
+#define __UNIVERSALREMOTE_CODE_STORE__
+
+#include <Arduino.h>
+
+#include <nvs.h>
+
+#include "Arena.h"
+
+// NVS namespace for stored codes. Each code is a blob in the format of irpack_encode, keyed by its name
+#define NVS_CODES_NAMESPACE     "irCodes"
+#define NVS_CODES_INDEX_KEY     "_index"            // Names of the stored codes, each followed by '$'
+
+#define CODE_NAME_MAX_LEN       15                  // Limited by the NVS key length
+#define CODE_MAX_PACKED_SIZE    1024
+
+// Stores named IR codes in flash, compressed with irpack_encode
+class CodeStore
+{
+private:
+    nvs_handle nvs_codes;
+
+    // Checks that the name can be used as an NVS key and does not clash with the index
+    static bool valid_name(const char* name);
+
+    // Reads the index, to be changed and saved back
+    void read_index(String &str);
+
+public:
+    // Opens the NVS namespace. Must be called after nvs_flash_init
+    esp_err_t begin();
+
+    // Compresses and stores the timing list (in microseconds, starting with a mark) under the name.
+    // Returns ESP_FAIL if the name is invalid
+    esp_err_t save(const char* name, const uint16_t* timings, uint16_t len);
+
+    // Stores an already compressed frame. Returns ESP_FAIL if the name or the data is invalid
+    esp_err_t save_packed(const char* name, const uint8_t* data, size_t size);
+
+    // Loads and decompresses a code. Returns ESP_ERR_NOT_FOUND if there is no code with the name
+    esp_err_t load(const char* name, uint16_t* timings, uint16_t max_len, uint16_t &len);
+
+    // Deletes a code
+    esp_err_t remove(const char* name);
+
+    // Puts the names of the stored codes into the passed text, each followed by '$'
+    void list(ArenaText &text);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "Corpus.h"
+
+#include <string.h>
+
+static void put_u16(uint8_t* out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static uint16_t get_u16(const uint8_t* in)
+{
+    return in[0] | (in[1] << 8);
+}
+
+size_t corpus_write_header(uint8_t* out, uint8_t tick_us)
+{
+    memcpy(out, CORPUS_MAGIC, 4);
+    out[4] = CORPUS_VERSION;
+    out[5] = tick_us;
+    out[6] = 0;
+    out[7] = 0;
+
+    return CORPUS_HEADER_SIZE;
+}
+
+size_t corpus_read_header(const uint8_t* data, size_t size, uint8_t* tick_us)
+{
+    if(size < CORPUS_HEADER_SIZE || memcmp(data, CORPUS_MAGIC, 4) != 0 || data[4] != CORPUS_VERSION || data[5] == 0)
+        return 0;
+
+    *tick_us = data[5];
+
+    return CORPUS_HEADER_SIZE;
+}
+
+size_t corpus_append(uint8_t* data, size_t size, size_t pos, const volatile uint16_t* rawbuf, uint16_t rawlen)
+{
+    if(pos + 2 + 2 * (size_t)rawlen > size)
+        return 0;
+
+    put_u16(data + pos, rawlen);
+    pos += 2;
+
+    for(uint16_t i = 0; i < rawlen; i++)
+    {
+        put_u16(data + pos, rawbuf[i]);
+        pos += 2;
+    }
+
+    return pos;
+}
+
+int corpus_next(const uint8_t* data, size_t size, size_t* pos, uint16_t* rawbuf, uint16_t max_len)
+{
+    if(*pos == size)
+        return 0;
+
+    if(*pos + 2 > size)
+        return -1;
+
+    uint16_t rawlen = get_u16(data + *pos);
+
+    if(rawlen > max_len || *pos + 2 + 2 * (size_t)rawlen > size)
+        return -1;
+
+    for(uint16_t i = 0; i < rawlen; i++)
+        rawbuf[i] = get_u16(data + *pos + 2 + 2 * i);
+
+    *pos += 2 + 2 * (size_t)rawlen;
+
+    return rawlen;
+}
@@ -0,0 +1,34 @@
+#ifndef __UNIVERSALREMOTE_CORPUS__
+#define __UNIVERSALREMOTE_CORPUS__
+
+// File format of capture corpora, recorded on the device and replayed by the host tool in src/host.
+// Kept free of Arduino headers, so that both sides use the same code.
+//
+// Format, little endian :
+// - 4 bytes        : CORPUS_MAGIC
+// - byte 4         : CORPUS_VERSION
+// - byte 5         : duration of a rawbuf tick in microseconds
+// - 2 bytes        : reserved, 0
+// - for each frame : rawlen (2 bytes), then rawlen rawbuf entries (2 bytes each), rawbuf[0] included
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CORPUS_MAGIC            "IRCP"
+#define CORPUS_VERSION          1
+#define CORPUS_HEADER_SIZE      8
+
+// Writes the header into out, which must hold CORPUS_HEADER_SIZE bytes. Returns CORPUS_HEADER_SIZE
+size_t corpus_write_header(uint8_t* out, uint8_t tick_us);
+
+// Checks the header and sets tick_us. Returns the position of the first frame, or 0 if the header is invalid
+size_t corpus_read_header(const uint8_t* data, size_t size, uint8_t* tick_us);
+
+// Appends a frame at position pos of a buffer of size bytes. Returns the new end, or 0 if it does not fit
+size_t corpus_append(uint8_t* data, size_t size, size_t pos, const volatile uint16_t* rawbuf, uint16_t rawlen);
+
+// Reads the frame at *pos into rawbuf, and moves *pos to the next one.
+// Returns rawlen, 0 at the end of the data, or -1 if the frame is truncated or longer than max_len
+int corpus_next(const uint8_t* data, size_t size, size_t* pos, uint16_t* rawbuf, uint16_t max_len);
+
+#endif
@@ -0,0 +1,85 @@
+#include "CorpusRecorder.h"
+#include "BinLog.h"
+
+#define TAG "corpus"
+
+// Appends each frame to the corpus, and stops once the target is reached or it is full
+void CorpusRecorder::on_capture(const decode_results *results, int64_t received_us, void* ctx)
+{
+    CorpusRecorder* recorder = (CorpusRecorder*)ctx;
+
+    if(!recorder->recording)
+        return;
+
+    size_t end = corpus_append(recorder->data, CORPUS_MAX_SIZE, recorder->used, results->rawbuf, results->rawlen);
+
+    if(end != 0)
+    {
+        recorder->used = end;
+        recorder->frames++;
+    }
+
+    if(end == 0 || recorder->frames == recorder->target)
+        recorder->stop();
+}
+
+CorpusRecorder::CorpusRecorder(ReceiveHandler* recv)
+{
+    receiver    = recv;
+
+    data        = NULL;
+    used        = 0;
+
+    recording   = false;
+    frames      = 0;
+    target      = 0;
+}
+
+esp_err_t CorpusRecorder::start(uint16_t num_frames)
+{
+    if(recording || num_frames == 0)
+        return ESP_FAIL;
+
+    if(num_frames > CORPUS_MAX_FRAMES)
+        num_frames = CORPUS_MAX_FRAMES;
+
+    if(data == NULL)
+        data = (uint8_t*)malloc(CORPUS_MAX_SIZE);
+
+    if(data == NULL)
+        return ESP_ERR_NO_MEM;
+
+    used = corpus_write_header(data, kRawTick);
+    frames = 0;
+    target = num_frames;
+    recording = true;
+
+    if(receiver->add_listener(on_capture, this) != ESP_OK)
+    {
+        recording = false;
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+void CorpusRecorder::stop()
+{
+    if(!recording)
+        return;
+
+    recording = false;
+    receiver->remove_listener(on_capture, this);
+
+    BLOGI("Recorded %d frames in %d bytes", frames, used);
+}
+
+const uint8_t* CorpusRecorder::get(size_t &size)
+{
+    if(recording || data == NULL)
+        return NULL;
+
+    size = used;
+
+    return data;
+}
@@ -0,0 +1,43 @@
+#ifndef __UNIVERSALREMOTE_CORPUS_RECORDER__
+#define __UNIVERSALREMOTE_CORPUS_RECORDER__
+
+#include <Arduino.h>
+
+#include "IRHandlers.h"
+#include "Corpus.h"
+
+#define CORPUS_MAX_SIZE         32768               // Recording stops when the corpus reaches this size
+#define CORPUS_MAX_FRAMES       500
+
+// Records received frames, as IRrecv rawbuf arrays, into a corpus that can be downloaded and replayed on the host
+class CorpusRecorder
+{
+private:
+    ReceiveHandler* receiver;
+
+    uint8_t* data;
+    size_t used;
+
+    volatile bool recording;
+    uint16_t frames;
+    uint16_t target;
+
+    static void on_capture(const decode_results *results, int64_t received_us, void* ctx);
+
+public:
+    CorpusRecorder(ReceiveHandler* recv);
+
+    // Starts recording the next num_frames frames received. The previous corpus is discarded.
+    // Returns ESP_FAIL if a recording is in progress
+    esp_err_t start(uint16_t num_frames);
+
+    // Stops recording, keeping the frames recorded so far
+    void stop();
+
+    bool is_recording() { return recording; }
+
+    // Returns the corpus and sets size, or NULL if there is none or a recording is in progress
+    const uint8_t* get(size_t &size);
+};
+
+#endif
@@ -1,9 +1,11 @@
 #include "Arduino.h"
 
 #include "IOHandlers.h"
+#include "TaskConfig.h"
 
 #include "nvs_flash.h"
 #include "esp32-hal-gpio.h"
+#include "BinLog.h"
 
 #define TAG "gpio"
 
@@ -11,7 +13,7 @@
 void blink_led_task(void* param)
 {
     int pin = *((int*)param);
-    ESP_LOGI("t", "blink %d", pin);
+    BLOGD("blink %d", pin);
     vTaskSuspend(NULL);
 
     for(;;)
@@ -67,16 +69,16 @@ LedHandler::LedHandler(int pin_num, const char* blink_task_name, const char* bli
     pin = pin_num;
     pinMode(pin, OUTPUT);
 
-    ESP_LOGI("t", "Set up led blinking for pin %d", pin);
+    BLOGD("Set up led blinking for pin %d", pin);
     
-    xTaskCreate(blink_led_task, blink_task_name, 1024, (void*)&pin, 5, &blinkTask_h);
-    xTaskCreate(blink_led_once_task, blink_once_task_name, 1024, (void*)&pin, 5, &blinkOnceTask_h);
+    blinkTask_h = static_task_create(blink_task_storage, blink_led_task, blink_task_name, (void*)&pin, LED_TASK_PRIO, LED_TASK_CORE);
+    blinkOnceTask_h = static_task_create(blink_once_task_storage, blink_led_once_task, blink_once_task_name, (void*)&pin, LED_TASK_PRIO, LED_TASK_CORE);
 }
 
 // Starts blinking
 void LedHandler::start_blinking()
 {
-    ESP_LOGI("test", "START %d", pin);
+    BLOGD("START %d", pin);
     
     vTaskResume(blinkTask_h);
 }
@@ -86,7 +88,7 @@ void LedHandler::stop_blinking()
 {
     vTaskSuspend(blinkTask_h);
     
-    ESP_LOGI("test", "STOP %d", pin);
+    BLOGD("STOP %d", pin);
     
     digitalWrite(pin, LOW);
 }
@@ -94,14 +96,14 @@ void LedHandler::stop_blinking()
 // Blink once
 void LedHandler::blink_once()
 {
-    ESP_LOGI("test", "BLINK ONCE %d", pin);
+    BLOGD("BLINK ONCE %d", pin);
     vTaskResume(blinkOnceTask_h);
 }
 
 // Turn on
 void LedHandler::on()
 {
-    ESP_LOGI("test", "ON %d", pin);
+    BLOGD("ON %d", pin);
 
     digitalWrite(pin, HIGH);
 }
@@ -109,7 +111,7 @@ void LedHandler::on()
 // Turn off
 void LedHandler::off()
 {
-    ESP_LOGI("test", "OFF %d", pin);
+    BLOGD("OFF %d", pin);
     
     digitalWrite(pin, LOW);
 }
@@ -120,9 +122,9 @@ ResetHandler::ResetHandler(int pin_num)
 {
     pinMode(pin_num, INPUT);
 
-    ESP_LOGI("test", "BUTTON %d", pin_num);
+    BLOGD("BUTTON %d", pin_num);
 
-    xTaskCreate(button_read_task, "config reset", 1024, (void *)0, 5, &buttonListenTask_h);
+    buttonListenTask_h = static_task_create(button_task_storage, button_read_task, "config reset", (void *)0, RESET_TASK_PRIO, RESET_TASK_CORE);
 }
 
 // Start reset task
@@ -3,6 +3,9 @@
 
 #include "Arduino.h"
 
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
 #define SHORT_BLINK_PER     100                                         // Time period for continuous blinking
 #define SHORT_BLINK_TICKS   SHORT_BLINK_PER / portTICK_PERIOD_MS
 #define LONG_BLINK_PER      500                                         // Time period for blinking once
@@ -22,6 +25,8 @@ class LedHandler
 private:
     TaskHandle_t blinkOnceTask_h;
     TaskHandle_t blinkTask_h;
+    static_task_t<LED_TASK_STACK> blink_once_task_storage;
+    static_task_t<LED_TASK_STACK> blink_task_storage;
 
     int pin;
 
@@ -50,6 +55,7 @@ class ResetHandler
 {
 private:
     TaskHandle_t buttonListenTask_h;
+    static_task_t<RESET_TASK_STACK> button_task_storage;
 
 public:
     // @param pin_num   Number of pin connected to button
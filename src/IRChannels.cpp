@@ -0,0 +1,391 @@
+#include "IRChannels.h"
+#include "BinLog.h"
+
+#include <new>
+
+#define TAG "channels"
+
+// Processes the jobs queued on one channel
+void EmitterChannels::channel_task(void* param)
+{
+    ir_channel_t* channel = (ir_channel_t*)param;
+    ir_job_t job;
+
+    for(;;)
+    {
+        xQueueReceive(channel->queue, &job, portMAX_DELAY);
+
+        if(job.type == IR_JOB_REPIN)
+        {
+            // The old sender releases its RMT channel before the new one takes it
+            if(channel->sender != NULL)
+                channel->sender->~SendHandler();
+
+            channel->sender = new(channel->sender_storage) SendHandler(job.pin, channel->index);
+            channel->pin = job.pin;
+
+            BLOGI("Channel %d moved to pin %d", channel->index, job.pin);
+            continue;
+        }
+
+        if(!channel->enabled)
+        {
+            channel->dropped++;
+            release(job.shared);
+            if(job.done != NULL)
+                xSemaphoreGive(job.done);
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+
+        esp_err_t ret;
+        if(job.type == IR_JOB_RAW)
+            ret = channel->sender->send_raw(job.payload);
+        else if(job.type == IR_JOB_AC)
+            ret = channel->sender->send_ac(job.payload);
+        else
+            ret = channel->sender->send_timings(job.timings, job.len, job.khz);
+
+        int64_t elapsed = esp_timer_get_time() - start;
+        channel->busy_us += elapsed;
+
+        if(job.elapsed_us != NULL)
+            *job.elapsed_us = elapsed;
+        if(job.done != NULL)
+            xSemaphoreGive(job.done);
+
+        if(ret == ESP_OK)
+            channel->sent++;
+        else
+            channel->failed++;
+
+        release(job.shared);
+    }
+}
+
+ir_shared_t* EmitterChannels::share(const void* data, size_t size, uint32_t refs)
+{
+    ir_shared_t* shared = (ir_shared_t*)malloc(sizeof(ir_shared_t) + size);
+    if(shared == NULL)
+        return NULL;
+
+    shared->refs = refs;
+    memcpy(shared->data, data, size);
+
+    return shared;
+}
+
+void EmitterChannels::release(ir_shared_t* shared)
+{
+    if(shared != NULL && __atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        free(shared);
+}
+
+EmitterChannels::EmitterChannels(int pin_num)
+{
+    count = 0;
+    reserved_pins = 0;
+    lock = static_mutex_create(lock_storage);
+
+    create_channel(pin_num);
+}
+
+void EmitterChannels::reserve_pin(int pin)
+{
+    reserved_pins |= 1ULL << pin;
+}
+
+// Sets up the next channel with its queue and task. The sender is created by the channel task
+esp_err_t EmitterChannels::create_channel(int pin)
+{
+    if(count == IR_MAX_CHANNELS)
+        return ESP_FAIL;
+
+    ir_channel_t* channel = &channels[count];
+
+    channel->index      = count;
+    channel->pin        = pin;
+    channel->enabled    = true;
+    channel->sent       = 0;
+    channel->failed     = 0;
+    channel->dropped    = 0;
+    channel->busy_us    = 0;
+
+    channel->queue = static_queue_create(channel->queue_storage);
+    channel->sender = NULL;
+
+    char name[16];
+    snprintf(name, sizeof(name), "IR channel %d", count);
+    channel->task_h = static_task_create(channel->task_storage, channel_task, name, channel, IR_SEND_TASK_PRIO, IR_SEND_TASK_CORE);
+
+    ir_job_t job = {IR_JOB_REPIN, NULL, pin};
+    xQueueSend(channel->queue, &job, portMAX_DELAY);
+
+    count++;
+
+    return ESP_OK;
+}
+
+esp_err_t EmitterChannels::begin()
+{
+    nvs_open(NVS_IR_NAMESPACE, NVS_READWRITE, &nvs_ir);
+
+    char pins[64];
+    size_t len = sizeof(pins);
+
+    if(nvs_get_str(nvs_ir, NVS_EMITTERS_KEY, pins, &len) != ESP_OK)
+        return ESP_OK;
+
+    BLOGI("Emitter configuration : %s", pins);
+
+    return configure(pins);
+}
+
+esp_err_t EmitterChannels::configure(const char* str)
+{
+    int pins[IR_MAX_CHANNELS];
+    uint8_t n = 0;
+
+    // Reserved pins count as used
+    uint64_t used = reserved_pins;
+
+    const char* next = str;
+    while(*next != '\0')
+    {
+        char* end;
+        long pin = strtol(next, &end, 10);
+
+        if(end == next || n == IR_MAX_CHANNELS || !GPIO_IS_VALID_OUTPUT_GPIO(pin) || (used & (1ULL << pin)))
+        {
+            BLOGW("Invalid emitter pin list : %s", str);
+            return ESP_FAIL;
+        }
+
+        used |= 1ULL << pin;
+        pins[n++] = pin;
+
+        next = end;
+        if(*next == ',')
+            next++;
+    }
+
+    if(n == 0)
+        return ESP_FAIL;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    for(uint8_t i = 0; i < n; i++)
+    {
+        if(i == count)
+        {
+            create_channel(pins[i]);
+            continue;
+        }
+
+        channels[i].enabled = true;
+
+        if(channels[i].pin != pins[i])
+        {
+            ir_job_t job = {IR_JOB_REPIN, NULL, pins[i]};
+            xQueueSend(channels[i].queue, &job, portMAX_DELAY);
+        }
+    }
+
+    for(uint8_t i = n; i < count; i++)
+        channels[i].enabled = false;
+
+    xSemaphoreGive(lock);
+
+    nvs_set_str(nvs_ir, NVS_EMITTERS_KEY, str);
+    nvs_commit(nvs_ir);
+
+    return ESP_OK;
+}
+
+uint8_t EmitterChannels::parse_mask(const char* str)
+{
+    if(strcmp(str, "all") == 0)
+        return IR_ALL_CHANNELS;
+
+    uint8_t mask = 0;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    const char* next = str;
+    while(*next != '\0')
+    {
+        char* end;
+        long channel = strtol(next, &end, 10);
+
+        if(end == next || channel < 0 || channel >= count || !channels[channel].enabled)
+        {
+            mask = 0;
+            break;
+        }
+
+        mask |= 1 << channel;
+
+        next = end;
+        if(*next == ',')
+            next++;
+    }
+
+    xSemaphoreGive(lock);
+
+    return mask;
+}
+
+// Queues the job on each selected channel, with one copy of its payload or timings shared by all of them. The queues
+// are checked for space before any job is queued, so that a message is sent on all selected channels or on none
+esp_err_t EmitterChannels::submit(uint8_t mask, ir_job_t &job)
+{
+    uint8_t selected = 0;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    // Channel tasks only take jobs off their queues, so the space found here is still there when queueing
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(!(mask & (1 << i)) || !channels[i].enabled)
+            continue;
+
+        if(uxQueueSpacesAvailable(channels[i].queue) == 0)
+        {
+            channels[i].dropped++;
+            xSemaphoreGive(lock);
+            return ESP_ERR_TIMEOUT;
+        }
+
+        selected |= 1 << i;
+    }
+
+    uint8_t refs = __builtin_popcount(selected);
+    if(refs == 0)
+    {
+        xSemaphoreGive(lock);
+        return ESP_OK;
+    }
+
+    ir_job_t copy = job;
+
+    if(job.payload != NULL)
+    {
+        copy.shared = share(job.payload, strlen(job.payload) + 1, refs);
+        copy.payload = copy.shared != NULL ? (char*)copy.shared->data : NULL;
+    }
+    else
+    {
+        copy.shared = share(job.timings, job.len * sizeof(uint16_t), refs);
+        copy.timings = copy.shared != NULL ? (uint16_t*)copy.shared->data : NULL;
+    }
+
+    if(copy.shared == NULL)
+    {
+        xSemaphoreGive(lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(!(selected & (1 << i)))
+            continue;
+
+        copy.pin = channels[i].pin;
+        xQueueSend(channels[i].queue, &copy, 0);
+    }
+
+    xSemaphoreGive(lock);
+
+    return ESP_OK;
+}
+
+esp_err_t EmitterChannels::submit_raw(uint8_t mask, const char* str)
+{
+    // The count comes first, so the timings can be parsed into a list of their own size
+    long rawlen = strtol(str, NULL, 10);
+    if(rawlen <= 0 || rawlen > kCaptureBufferSize)
+        return ESP_FAIL;
+
+    uint16_t* timings = (uint16_t*)malloc(rawlen * sizeof(uint16_t));
+    if(timings == NULL)
+        return ESP_ERR_NO_MEM;
+
+    uint16_t len;
+    esp_err_t ret = SendHandler::parse_raw(str, timings, rawlen, len);
+
+    // Sent with the carrier of SendHandler::send_raw
+    if(ret == ESP_OK)
+        ret = submit_timings(mask, timings, len, kRawCarrierKhz);
+
+    free(timings);
+
+    return ret;
+}
+
+esp_err_t EmitterChannels::submit_ac(uint8_t mask, const char* str)
+{
+    // Same check as SendHandler::send_ac
+    if(strchr(str, ',') == NULL)
+        return ESP_FAIL;
+
+    // AC protocols can be left out of the build, see IRProtocols.h
+    if(!IRac::isProtocolSupported((decode_type_t)atoi(str)))
+        return ESP_FAIL;
+
+    ir_job_t job = {IR_JOB_AC, (char*)str};
+
+    return submit(mask, job);
+}
+
+esp_err_t EmitterChannels::submit_timings(uint8_t mask, const uint16_t* timings, uint16_t len, uint32_t khz)
+{
+    if(len == 0)
+        return ESP_FAIL;
+
+    ir_job_t job = {IR_JOB_TIMINGS};
+    job.timings = (uint16_t*)timings;
+    job.len     = len;
+    job.khz     = khz;
+
+    return submit(mask, job);
+}
+
+esp_err_t EmitterChannels::send_raw_timed(uint8_t channel, const char* str, int64_t* elapsed_us)
+{
+    if(channel >= count || !channels[channel].enabled)
+        return ESP_FAIL;
+
+    ir_shared_t* shared = share(str, strlen(str) + 1, 1);
+    if(shared == NULL)
+        return ESP_ERR_NO_MEM;
+
+    StaticSemaphore_t done;
+    ir_job_t job = {IR_JOB_RAW, (char*)shared->data, channels[channel].pin, static_binary_create(done), elapsed_us};
+    job.shared = shared;
+
+    // Queued under the lock, as submit counts on the space it finds in the queues
+    xSemaphoreTake(lock, portMAX_DELAY);
+    xQueueSend(channels[channel].queue, &job, portMAX_DELAY);
+    xSemaphoreGive(lock);
+
+    xSemaphoreTake(job.done, portMAX_DELAY);
+
+    vSemaphoreDelete(job.done);
+
+    return ESP_OK;
+}
+
+void EmitterChannels::get_stats(ArenaText &text)
+{
+    for(uint8_t i = 0; i < count; i++)
+    {
+        ir_channel_t* channel = &channels[i];
+        uint32_t done = channel->sent + channel->failed;
+
+        text.addf("%d,%d,%d,%d,%u,%u,%u,%u\n",
+                  i, channel->pin, channel->enabled, uxQueueMessagesWaiting(channel->queue),
+                  channel->sent, channel->failed, channel->dropped,
+                  done ? (uint32_t)(channel->busy_us / done) : 0);
+    }
+}
@@ -0,0 +1,147 @@
+#ifndef __UNIVERSALREMOTE_CHANNELS__
+#define __UNIVERSALREMOTE_CHANNELS__
+
+#include <Arduino.h>
+
+#include <nvs.h>
+
+#include "IRHandlers.h"
+#include "Arena.h"
+
+// NVS namespace and key for the emitter pin list
+#define NVS_IR_NAMESPACE        "irConfig"
+#define NVS_EMITTERS_KEY        "emitters"
+
+#define IR_MAX_CHANNELS         4                   // One RMT transmit channel each
+#define IR_CHANNEL_QUEUE_LEN    8                   // Jobs that can wait on a channel
+#define IR_ALL_CHANNELS         0xFF                // Channel mask for all enabled channels
+
+// Types of jobs processed by the channel tasks
+enum ir_job_type_t
+{
+    IR_JOB_RAW,                                     // payload is in the format of SendHandler::send_raw
+    IR_JOB_AC,                                      // payload is in the format of SendHandler::send_ac
+    IR_JOB_TIMINGS,                                 // timings, len and khz are set
+    IR_JOB_REPIN                                    // Move the channel to another pin
+};
+
+// Payload or timings of a message, shared by the jobs queued for it on several channels.
+// The last channel task done with it frees it
+struct ir_shared_t
+{
+    volatile uint32_t refs;
+    uint32_t data[];                                // Word aligned for timings
+};
+
+struct ir_job_t
+{
+    ir_job_type_t type;
+    char* payload;                                  // In shared
+    int pin;
+
+    // Optional, for callers waiting for the transmission
+    SemaphoreHandle_t done;                         // Given when the job is done
+    int64_t* elapsed_us;                            // Set to the transmit time
+
+    // For IR_JOB_TIMINGS
+    uint16_t* timings;                              // In shared
+    uint16_t len;
+    uint32_t khz;                                   // In kHz, or in Hz if above 1000
+
+    ir_shared_t* shared;                            // Holds payload or timings, released by the channel task
+};
+
+// An emitter with its own transmit queue and task. The storage of all IR_MAX_CHANNELS channels is reserved
+// at build time, so that adding emitters at run time cannot run out of memory
+struct ir_channel_t
+{
+    uint8_t index;
+    int pin;
+    bool enabled;
+
+    SendHandler* sender;                            // Constructed in sender_storage
+    QueueHandle_t queue;
+    TaskHandle_t task_h;
+
+    alignas(SendHandler) uint8_t sender_storage[sizeof(SendHandler)];
+    static_queue_t<ir_job_t, IR_CHANNEL_QUEUE_LEN> queue_storage;
+    static_task_t<IR_SEND_TASK_STACK> task_storage;
+
+    // Statistics
+    volatile uint32_t sent;
+    volatile uint32_t failed;
+    volatile uint32_t dropped;
+    volatile uint64_t busy_us;                      // Total time spent transmitting
+};
+
+// Runs several IR emitters concurrently. Channel 0 is created on the pin passed to the constructor,
+// and the pin list stored in NVS is applied by begin().
+class EmitterChannels
+{
+private:
+    ir_channel_t channels[IR_MAX_CHANNELS];
+    uint8_t count;
+
+    // Held while channels are configured, selected or queued on, so that a selection cannot change under a submit
+    SemaphoreHandle_t lock;
+    StaticSemaphore_t lock_storage;
+
+    uint64_t reserved_pins;                         // Pins used by other parts, as a mask of GPIO numbers
+
+    nvs_handle nvs_ir;
+
+    static void channel_task(void* param);
+
+    esp_err_t create_channel(int pin);
+
+    // Copies size bytes of data for refs jobs. Returns NULL if out of memory
+    static ir_shared_t* share(const void* data, size_t size, uint32_t refs);
+    static void release(ir_shared_t* shared);
+    esp_err_t submit(uint8_t mask, ir_job_t &job);
+
+public:
+    // @param pin_num   The pin connected to the LED driver of channel 0
+    EmitterChannels(int pin_num);
+
+    // Keeps the pin out of the emitter configuration. Must be called before begin
+    void reserve_pin(int pin);
+
+    // Loads the emitter configuration from NVS. Must be called after nvs_flash_init
+    esp_err_t begin();
+
+    // Sets the emitter pins and saves them to NVS. Takes effect without a restart.
+    // Channels are moved to the new pins in order, and channels left over are disabled.
+    // Format : <pin of channel 0>,<pin of channel 1>,...
+    // Sample : 14,27,26
+    // Returns ESP_FAIL if a pin is listed twice, reserved, or cannot drive an output
+    esp_err_t configure(const char* str);
+
+    // Parses a channel selection. Returns 0 if invalid
+    // Format : "all" or channel numbers seperated by comma
+    // Sample : 0,2
+    uint8_t parse_mask(const char* str);
+
+    // Queues a raw message on the selected channels. The format is that of SendHandler::send_raw, and the message is
+    // parsed before it is queued. Returns ESP_FAIL if the format is invalid and ESP_ERR_TIMEOUT if a channel queue is full.
+    esp_err_t submit_raw(uint8_t mask, const char* str);
+
+    // Queues an AC message on the selected channels. The format is that of SendHandler::send_ac.
+    // Returns ESP_FAIL if the format is invalid or the protocol is not in the build, and ESP_ERR_TIMEOUT if a channel queue is full.
+    esp_err_t submit_ac(uint8_t mask, const char* str);
+
+    // Queues a timing list (in microseconds, starting with a mark) on the selected channels, with the given carrier frequency.
+    // Returns ESP_ERR_TIMEOUT if a channel queue is full.
+    // For all submit functions, the message is queued on all selected channels or on none of them.
+    esp_err_t submit_timings(uint8_t mask, const uint16_t* timings, uint16_t len, uint32_t khz);
+
+    // Queues a raw message on one channel and waits until it has been sent. 
+    // elapsed_us is set to the time taken by the transmission itself.
+    // Returns ESP_ERR_NO_MEM if the message cannot be copied for the channel task.
+    esp_err_t send_raw_timed(uint8_t channel, const char* str, int64_t* elapsed_us);
+
+    // Puts per channel statistics into the passed string, one line per channel
+    // Format : <channel>,<pin>,<enabled>,<queue depth>,<sent>,<failed>,<dropped>,<average transmit time in us>
+    void get_stats(ArenaText &text);
+};
+
+#endif
@@ -0,0 +1,317 @@
+#include "IRCompress.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define IRPACK_MAX_SYMBOLS      255
+
+static int compare_u16(const void* a, const void* b)
+{
+    return (int)*(const uint16_t*)a - (int)*(const uint16_t*)b;
+}
+
+// Writes bits to a byte buffer, low bits first
+struct bit_writer_t
+{
+    uint8_t* out;
+    size_t size;
+    size_t pos;
+    uint32_t acc;
+    uint8_t count;
+};
+
+static bool put_byte(bit_writer_t* w, uint8_t value)
+{
+    if(w->pos == w->size)
+        return false;
+
+    w->out[w->pos++] = value;
+    return true;
+}
+
+static bool put_varint(bit_writer_t* w, uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        if(!put_byte(w, (value & 0x7F) | 0x80))
+            return false;
+        value >>= 7;
+    }
+    return put_byte(w, value);
+}
+
+static bool put_bits(bit_writer_t* w, uint32_t value, uint8_t bits)
+{
+    w->acc |= value << w->count;
+    w->count += bits;
+
+    while(w->count >= 8)
+    {
+        if(!put_byte(w, w->acc & 0xFF))
+            return false;
+        w->acc >>= 8;
+        w->count -= 8;
+    }
+    return true;
+}
+
+static bool flush_bits(bit_writer_t* w)
+{
+    bool ok = true;
+
+    if(w->count > 0)
+        ok = put_byte(w, w->acc & 0xFF);
+
+    w->acc = 0;
+    w->count = 0;
+    return ok;
+}
+
+static uint8_t bits_for(uint16_t symbols)
+{
+    uint8_t bits = 1;
+    while((1u << bits) < symbols)
+        bits++;
+    return bits;
+}
+
+// Builds the symbol table from the durations. Returns the number of symbols, or 0 if there are too many
+static uint16_t build_symbols(const uint16_t* timings, uint16_t len, uint16_t* symbols, uint16_t* sorted)
+{
+    memcpy(sorted, timings, len * sizeof(uint16_t));
+    qsort(sorted, len, sizeof(uint16_t), compare_u16);
+
+    uint16_t count = 0;
+    uint16_t start = 0;
+
+    while(start < len)
+    {
+        uint32_t limit = (uint32_t)sorted[start] * (100 + IRPACK_CLUSTER_PERCENT) / 100;
+        uint16_t end = start + 1;
+        while(end < len && sorted[end] <= limit)
+            end++;
+
+        if(count == IRPACK_MAX_SYMBOLS)
+            return 0;
+
+        // The median keeps the symbol on the most common duration of the cluster
+        symbols[count++] = sorted[(start + end - 1) / 2];
+        start = end;
+    }
+
+    return count;
+}
+
+// Returns the index of the symbol closest to the duration
+static uint8_t find_symbol(const uint16_t* symbols, uint16_t count, uint16_t duration)
+{
+    uint8_t best = 0;
+    uint32_t best_diff = UINT32_MAX;
+
+    for(uint16_t i = 0; i < count; i++)
+    {
+        uint32_t diff = abs((int32_t)symbols[i] - duration);
+        if(diff < best_diff)
+        {
+            best_diff = diff;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+static bool put_literal(bit_writer_t* w, const uint8_t* indices, uint16_t start, uint16_t end, uint8_t bits)
+{
+    if(end == start)
+        return true;
+
+    if(!put_varint(w, (uint32_t)(end - start) << 1))
+        return false;
+
+    for(uint16_t i = start; i < end; i++)
+        if(!put_bits(w, indices[i], bits))
+            return false;
+
+    return flush_bits(w);
+}
+
+// Encodes with the given scratch buffers. Returns the encoded size, or 0 on failure
+static size_t encode_frame(const uint16_t* timings, uint16_t len, uint8_t* out, size_t out_size,
+                           uint16_t* sorted, uint8_t* indices)
+{
+    uint16_t symbols[IRPACK_MAX_SYMBOLS];
+    bit_writer_t w = {out, out_size, 0, 0, 0};
+
+    uint16_t nsyms = len ? build_symbols(timings, len, symbols, sorted) : 0;
+    if(len && nsyms == 0)
+        return 0;
+
+    uint8_t bits = bits_for(nsyms);
+
+    for(uint16_t i = 0; i < len; i++)
+        indices[i] = find_symbol(symbols, nsyms, timings[i]);
+
+    if(!put_byte(&w, IRPACK_VERSION) || !put_byte(&w, nsyms))
+        return 0;
+
+    for(uint16_t i = 0; i < nsyms; i++)
+        if(!put_byte(&w, symbols[i] & 0xFF) || !put_byte(&w, symbols[i] >> 8))
+            return 0;
+
+    if(!put_byte(&w, len & 0xFF) || !put_byte(&w, len >> 8))
+        return 0;
+
+    // Greedy search for the longest earlier match at each position
+    uint16_t literal_start = 0;
+    uint16_t i = 0;
+
+    while(i < len)
+    {
+        uint16_t best_len = 0;
+        uint16_t best_dist = 0;
+
+        for(uint16_t j = 0; j < i; j++)
+        {
+            uint16_t n = 0;
+            while(i + n < len && indices[j + n] == indices[i + n])
+                n++;
+
+            if(n > best_len)
+            {
+                best_len = n;
+                best_dist = i - j;
+            }
+        }
+
+        if(best_len < IRPACK_MIN_COPY)
+        {
+            i++;
+            continue;
+        }
+
+        if(!put_literal(&w, indices, literal_start, i, bits) ||
+           !put_varint(&w, ((uint32_t)best_len << 1) | 1) ||
+           !put_varint(&w, best_dist))
+            return 0;
+
+        i += best_len;
+        literal_start = i;
+    }
+
+    if(!put_literal(&w, indices, literal_start, len, bits))
+        return 0;
+
+    return w.pos;
+}
+
+size_t irpack_encode(const uint16_t* timings, uint16_t len, uint8_t* out, size_t out_size)
+{
+    uint16_t* sorted = (uint16_t*)malloc(len * sizeof(uint16_t) + 1);
+    uint8_t* indices = (uint8_t*)malloc(len + 1);
+    size_t result = 0;
+
+    if(sorted != NULL && indices != NULL)
+        result = encode_frame(timings, len, out, out_size, sorted, indices);
+
+    free(sorted);
+    free(indices);
+
+    return result;
+}
+
+// Reads a varint. Returns false if the data ends first
+static bool get_varint(const uint8_t* in, size_t in_size, size_t* pos, uint32_t* value)
+{
+    *value = 0;
+
+    for(uint8_t shift = 0; shift < 32; shift += 7)
+    {
+        if(*pos == in_size)
+            return false;
+
+        uint8_t byte = in[(*pos)++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+
+        if(!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+int irpack_decode(const uint8_t* in, size_t in_size, uint16_t* timings, uint16_t max_len)
+{
+    if(in_size < 4 || in[0] != IRPACK_VERSION)
+        return -1;
+
+    uint8_t nsyms = in[1];
+    size_t pos = 2;
+
+    if(in_size < pos + 2 * nsyms + 2)
+        return -1;
+
+    const uint8_t* symbols = in + pos;
+    pos += 2 * nsyms;
+
+    uint16_t len = in[pos] | (in[pos + 1] << 8);
+    pos += 2;
+
+    if(len > max_len || (len > 0 && nsyms == 0))
+        return -1;
+
+    uint8_t bits = bits_for(nsyms);
+    uint16_t n = 0;
+
+    // Indices are decoded in place, and replaced by durations at the end
+    while(n < len)
+    {
+        uint32_t h;
+        if(!get_varint(in, in_size, &pos, &h))
+            return -1;
+
+        uint32_t count = h >> 1;
+        if(count == 0 || count > (uint32_t)(len - n))
+            return -1;
+
+        if(h & 1)
+        {
+            uint32_t dist;
+            if(!get_varint(in, in_size, &pos, &dist) || dist == 0 || dist > n)
+                return -1;
+
+            for(uint32_t i = 0; i < count; i++, n++)
+                timings[n] = timings[n - dist];
+        }
+        else
+        {
+            uint32_t acc = 0;
+            uint8_t have = 0;
+
+            for(uint32_t i = 0; i < count; i++, n++)
+            {
+                while(have < bits)
+                {
+                    if(pos == in_size)
+                        return -1;
+                    acc |= (uint32_t)in[pos++] << have;
+                    have += 8;
+                }
+
+                uint16_t index = acc & ((1u << bits) - 1);
+                acc >>= bits;
+                have -= bits;
+
+                if(index >= nsyms)
+                    return -1;
+
+                timings[n] = index;
+            }
+        }
+    }
+
+    for(uint16_t i = 0; i < len; i++)
+        timings[i] = symbols[2 * timings[i]] | (symbols[2 * timings[i] + 1] << 8);
+
+    return len;
+}
@@ -0,0 +1,33 @@
+#ifndef __UNIVERSALREMOTE_COMPRESS__
+#define __UNIVERSALREMOTE_COMPRESS__
+
+// Compact encoding of raw timing lists, used on the wire and for stored codes.
+// Kept free of Arduino headers, so that it can be compiled and checked on the host.
+//
+// Durations are clustered into a symbol table, and the frame is stored as packed symbol indices,
+// with back references for repeated sections. Clustering is lossy, within IRPACK_CLUSTER_PERCENT.
+//
+// Format :
+// - byte 0         : IRPACK_VERSION
+// - byte 1         : number of symbols (1-255)
+// - 2 bytes each   : symbol durations in microseconds, little endian
+// - 2 bytes        : number of timings, little endian
+// - tokens until all timings are decoded, each starting with a varint h (7 bits per byte, low bits first)
+//   - h even       : literal, (h >> 1) symbol indices follow, packed low bits first, padded to a byte
+//   - h odd        : copy, (h >> 1) indices are copied from a varint distance back. Copies may overlap
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define IRPACK_VERSION          1
+#define IRPACK_CLUSTER_PERCENT  15                  // Durations within this percentage of each other share a symbol
+#define IRPACK_MIN_COPY         6                   // Shortest repeated section encoded as a copy
+
+// Encodes the timing list into out. Returns the encoded size, or 0 if out_size is not enough
+size_t irpack_encode(const uint16_t* timings, uint16_t len, uint8_t* out, size_t out_size);
+
+// Decodes a frame encoded by irpack_encode. Returns the number of timings, or -1 if the data is malformed
+// or has more than max_len timings
+int irpack_decode(const uint8_t* in, size_t in_size, uint16_t* timings, uint16_t max_len);
+
+#endif
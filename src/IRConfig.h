@@ -0,0 +1,13 @@
+#ifndef __UNIVERSALREMOTE_IR_CONFIG__
+#define __UNIVERSALREMOTE_IR_CONFIG__
+
+// IR capture parameters. Kept free of Arduino headers, so that the host replay tool decodes with the same settings
+
+#include <IRrecv.h>
+
+const uint16_t kCaptureBufferSize = 1024;
+const uint8_t kTimeout = 50;
+const uint16_t kMinUnknownSize = 12;
+const uint8_t kTolerancePercentage = kTolerance;
+
+#endif
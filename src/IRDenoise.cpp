@@ -0,0 +1,205 @@
+#include "IRDenoise.h"
+
+#include <stdlib.h>
+
+static int compare_u16(const void* a, const void* b)
+{
+    return (int)*(const uint16_t*)a - (int)*(const uint16_t*)b;
+}
+
+// Returns the median of the values, which get sorted
+static uint16_t median(uint16_t* values, uint16_t count)
+{
+    qsort(values, count, sizeof(uint16_t), compare_u16);
+
+    if(count % 2)
+        return values[count / 2];
+
+    return ((uint32_t)values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+// Snaps the slots starting at first, with a step of 2 (all marks, or all spaces), to the medians of their clusters
+static void snap_clusters(uint16_t* frame, uint16_t len, uint16_t first)
+{
+    uint16_t count = (len - first + 1) / 2;
+    if(count == 0)
+        return;
+
+    uint16_t* sorted = (uint16_t*)malloc(count * sizeof(uint16_t));
+    if(sorted == NULL)
+        return;
+
+    for(uint16_t i = 0; i < count; i++)
+        sorted[i] = frame[first + 2 * i];
+
+    qsort(sorted, count, sizeof(uint16_t), compare_u16);
+
+    uint16_t start = 0;
+    while(start < count)
+    {
+        // A cluster spans the values within DENOISE_CLUSTER_PERCENT of its smallest value
+        uint32_t limit = (uint32_t)sorted[start] * (100 + DENOISE_CLUSTER_PERCENT) / 100;
+        uint16_t end = start + 1;
+        while(end < count && sorted[end] <= limit)
+            end++;
+
+        uint16_t low = sorted[start];
+        uint16_t high = sorted[end - 1];
+        uint16_t center = sorted[(start + end - 1) / 2];
+
+        for(uint16_t i = first; i < len; i += 2)
+            if(frame[i] >= low && frame[i] <= high)
+                frame[i] = center;
+
+        start = end;
+    }
+
+    free(sorted);
+}
+
+// Number of units closest to value16, 0 if it is not within DENOISE_GRID_PERCENT of a unit from a multiple
+// up to DENOISE_GRID_MAX_UNITS. Durations are in 1/16 us
+static uint32_t grid_units(int32_t value16, uint32_t unit16)
+{
+    if(value16 <= 0)
+        return 0;
+
+    uint32_t units = (value16 + unit16 / 2) / unit16;
+    if(units == 0 || units > DENOISE_GRID_MAX_UNITS)
+        return 0;
+
+    int32_t error = value16 - (int32_t)(units * unit16);
+    if(error < 0)
+        error = -error;
+
+    return (uint32_t)error * 100 <= unit16 * DENOISE_GRID_PERCENT ? units : 0;
+}
+
+// Puts the durations of the frame, already snapped to their cluster medians, on the grid of the protocol
+static void snap_grid(uint16_t* frame, uint16_t len)
+{
+    // Zero length slots stand for splits of long durations, and are kept as is
+    uint32_t shortest[2] = {UINT16_MAX, UINT16_MAX};
+    for(uint16_t i = 0; i < len; i++)
+        if(frame[i] != 0 && frame[i] < shortest[i % 2])
+            shortest[i % 2] = frame[i];
+
+    if(shortest[0] == UINT16_MAX || shortest[1] == UINT16_MAX)
+        return;
+
+    // The shortest mark and the shortest space are one unit each. Receivers lengthen the marks and shorten the
+    // spaces by about the same time, which is taken off before putting them on the grid
+    uint32_t unit16 = (shortest[0] + shortest[1]) * 8;
+    int32_t bias16 = ((int32_t)shortest[0] - (int32_t)shortest[1]) * 8;
+
+    // More than that, they are not the same unit
+    if((uint32_t)(bias16 < 0 ? -bias16 : bias16) * 4 > unit16)
+        return;
+
+    // Least squares unit over the durations on the grid, so that long ones such as headers are not off by many
+    // times the error of the shortest ones
+    uint64_t sum_value_units = 0;
+    uint64_t sum_units_units = 0;
+    uint16_t single = 0;
+    for(uint16_t i = 0; i < len; i++)
+    {
+        int32_t value16 = frame[i] * 16 + (i % 2 == 0 ? -bias16 : bias16);
+        uint32_t units = frame[i] != 0 ? grid_units(value16, unit16) : 0;
+
+        sum_value_units += (uint64_t)value16 * units;
+        sum_units_units += (uint64_t)units * units;
+
+        if(units == 1)
+            single++;
+    }
+
+    // A unit is used throughout a frame. A short duration seen in a few slots is a glitch, and any grid built on it
+    // would be fine enough to move all the others
+    if(single < len / 8 || sum_units_units == 0)
+        return;
+
+    unit16 = (sum_value_units + sum_units_units / 2) / sum_units_units;
+
+    for(uint16_t i = 0; i < len; i++)
+    {
+        if(frame[i] == 0)
+            continue;
+
+        uint32_t units = grid_units(frame[i] * 16 + (i % 2 == 0 ? -bias16 : bias16), unit16);
+        if(units != 0)
+            frame[i] = (units * unit16 + 8) / 16;
+    }
+}
+
+int denoise_frames(const uint16_t* const* captures, const uint16_t* lengths, uint8_t count,
+                   uint16_t* out, uint16_t* out_len)
+{
+    if(count == 0)
+        return -1;
+
+    if(count > DENOISE_MAX_CAPTURES)
+        count = DENOISE_MAX_CAPTURES;
+
+    // Most common length
+    uint16_t len = 0;
+    uint8_t best = 0;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        uint8_t same = 0;
+        for(uint8_t j = 0; j < count; j++)
+            if(lengths[j] == lengths[i])
+                same++;
+
+        if(same > best || (same == best && lengths[i] < len))
+        {
+            best = same;
+            len = lengths[i];
+        }
+    }
+
+    // Captures that can be aligned to it
+    const uint16_t* used[DENOISE_MAX_CAPTURES];
+    uint8_t used_count = 0;
+    for(uint8_t i = 0; i < count; i++)
+        if(lengths[i] >= len)
+            used[used_count++] = captures[i];
+
+    // Median of each slot, and its spread
+    uint16_t slot[DENOISE_MAX_CAPTURES];
+    uint32_t spread_permille = 0;
+
+    for(uint16_t i = 0; i < len; i++)
+    {
+        uint16_t low = UINT16_MAX;
+        uint16_t high = 0;
+
+        for(uint8_t j = 0; j < used_count; j++)
+        {
+            slot[j] = used[j][i];
+            if(slot[j] < low) low = slot[j];
+            if(slot[j] > high) high = slot[j];
+        }
+
+        out[i] = median(slot, used_count);
+
+        if(out[i] != 0)
+            spread_permille += (uint32_t)(high - low) * 1000 / out[i];
+    }
+
+    *out_len = len;
+
+    if(len == 0)
+        return 0;
+
+    snap_clusters(out, len, 0);
+    snap_clusters(out, len, 1);
+    snap_grid(out, len);
+
+    // Full confidence when all captures were used and each slot varies by less than the tolerance.
+    // Drops to zero as the average spread reaches 4 times DENOISE_CLUSTER_PERCENT
+    uint32_t spread = spread_permille / len;
+    uint32_t limit = 40 * DENOISE_CLUSTER_PERCENT;
+    uint32_t quality = spread >= limit ? 0 : 100 - spread * 100 / limit;
+
+    return quality * used_count / count;
+}
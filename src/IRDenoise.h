@@ -0,0 +1,29 @@
+#ifndef __UNIVERSALREMOTE_DENOISE__
+#define __UNIVERSALREMOTE_DENOISE__
+
+// Combines several captures of the same button into one canonical frame.
+// Kept free of Arduino headers, so that it can be compiled and checked on the host.
+
+#include <stdint.h>
+
+#define DENOISE_MAX_CAPTURES    8
+#define DENOISE_CLUSTER_PERCENT 20                  // Durations within this percentage of each other are snapped together
+#define DENOISE_GRID_PERCENT    15                  // Durations within this percentage of a unit from a multiple of it are put on it
+#define DENOISE_GRID_MAX_UNITS  32                  // Longer durations (gaps between frames) are left off the grid
+
+// Builds a canonical frame from count captures. Timings are in microseconds, starting with a mark.
+// - The captures are aligned to the most common length. Longer captures (with repeats) are truncated to it,
+//   and shorter ones are left out.
+// - Each mark/space slot is set to the median of the aligned captures.
+// - Mark durations and space durations are clustered, and each slot is snapped to the median of its cluster.
+// - The clusters are then put on the grid of the protocol. Most protocols build their marks and spaces from
+//   multiples of one unit (562.5 us for NEC, 600 us for Sony, 889 us for RC5), taken from the shortest mark and
+//   the shortest space, then refined over all the durations close to a multiple of it. The receiver lengthens marks
+//   and shortens spaces by about the same time, which is evened out. Durations within DENOISE_GRID_PERCENT of a unit
+//   from a multiple are set to it; the others, and those beyond DENOISE_GRID_MAX_UNITS, keep their median.
+// Returns a confidence between 0 and 100, based on how many captures were used and how much they spread,
+// or -1 if there were no captures. The frame is written to out, which must hold the longest capture.
+int denoise_frames(const uint16_t* const* captures, const uint16_t* lengths, uint8_t count,
+                   uint16_t* out, uint16_t* out_len);
+
+#endif
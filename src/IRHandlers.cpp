@@ -1,75 +1,752 @@
 #include "IRHandlers.h"
+#include "IRDenoise.h"
+#include "RawFormat.h"
+#include "BinLog.h"
+
+#define TAG "ir"
+
+// Capture state of IRrecv. With IR_RECV_RMT, params is filled from the RMT ring buffer before decoding
+namespace _IRrecv { extern volatile irparams_t params; }
 
 ReceiveHandler::ReceiveHandler(int pin_num) : receiver(pin_num, kCaptureBufferSize, kTimeout, true)
 {
+    pin = pin_num;
+
     receiver.setUnknownThreshold(kMinUnknownSize);
     receiver.setTolerance(kTolerancePercentage);
+
+    decoded = 0;
+    decode_us = 0;
+
+    memset(learned_gap, 0, sizeof(learned_gap));
+    last_protocol = decode_type_t::UNKNOWN;
+    current_gap = kTimeout;
+
+    listener_count = 0;
+    listeners_mux = portMUX_INITIALIZER_UNLOCKED;
+
+    requests = static_queue_create(requests_storage);
+    captureTask_h = static_task_create(capture_task_storage, capture_task, "IR capture", this, IR_RECV_TASK_PRIO, IR_RECV_TASK_CORE);
 }
 
-// Listens to the IR receiver pin, gets raw data and puts it into the passed string. 
-// Returns ESP_FAIL if no signal is received.
-esp_err_t ReceiveHandler::get_raw(String &str)
+// Serves capture requests one at a time. While listeners are added, captures continuously between requests
+// and passes the frames to them
+void ReceiveHandler::capture_task(void* param)
+{
+    ReceiveHandler* handler = (ReceiveHandler*)param;
+    capture_request_t* request;
+
+    handler->setup_capture();
+
+    capture_params_t listen_params;
+    default_params(listen_params);
+    listen_params.timeout_ms = kListenSlice;
+
+    bool active = false;
+
+    for(;;)
+    {
+        bool listening = handler->listener_count > 0;
+
+        if(!listening && active)
+        {
+            handler->stop_capture();
+            active = false;
+        }
+
+        if(xQueueReceive(handler->requests, &request, listening ? 0 : portMAX_DELAY) == pdTRUE)
+        {
+            // Requests want a new press, so anything captured before is dropped
+            if(active)
+                handler->stop_capture();
+            handler->start_capture();
+            active = true;
+
+            int64_t received_us;
+            request->received = handler->capture(request->results, request->params, &received_us);
+
+            xTaskNotifyGive(request->waiter);
+            continue;
+        }
+
+        if(!active)
+        {
+            handler->start_capture();
+            active = true;
+        }
+
+        decode_results results;
+        int64_t received_us;
+
+        if(!handler->capture(&results, listen_params, &received_us))
+            continue;
+
+        capture_listener_t listeners[RECV_MAX_LISTENERS];
+        void* contexts[RECV_MAX_LISTENERS];
+
+        portENTER_CRITICAL(&handler->listeners_mux);
+        uint8_t count = handler->listener_count;
+        memcpy(listeners, handler->listeners, count * sizeof(capture_listener_t));
+        memcpy(contexts, handler->listener_ctx, count * sizeof(void*));
+        portEXIT_CRITICAL(&handler->listeners_mux);
+
+        for(uint8_t i = 0; i < count; i++)
+            listeners[i](&results, received_us, contexts[i]);
+    }
+}
+
+esp_err_t ReceiveHandler::add_listener(capture_listener_t listener, void* ctx)
+{
+    esp_err_t ret = ESP_FAIL;
+
+    portENTER_CRITICAL(&listeners_mux);
+    if(listener_count < RECV_MAX_LISTENERS)
+    {
+        listeners[listener_count] = listener;
+        listener_ctx[listener_count] = ctx;
+        listener_count++;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&listeners_mux);
+
+    return ret;
+}
+
+void ReceiveHandler::remove_listener(capture_listener_t listener, void* ctx)
 {
+    portENTER_CRITICAL(&listeners_mux);
+    for(uint8_t i = 0; i < listener_count; i++)
+    {
+        if(listeners[i] != listener || listener_ctx[i] != ctx)
+            continue;
+
+        listener_count--;
+        listeners[i] = listeners[listener_count];
+        listener_ctx[i] = listener_ctx[listener_count];
+        break;
+    }
+    portEXIT_CRITICAL(&listeners_mux);
+}
+
+void ReceiveHandler::default_params(capture_params_t &params)
+{
+    params.timeout_ms   = kTimeoutReceive;
+    params.buffer_size  = kCaptureBufferSize;
+    params.min_unknown  = kMinUnknownSize;
+    params.gap_ms       = kTimeout;
+    params.adaptive     = false;
+    params.protocol     = decode_type_t::UNKNOWN;
+    params.frames       = 1;
+}
+
+void ReceiveHandler::clamp_params(capture_params_t &params)
+{
+    if(params.timeout_ms > kCaptureMaxTimeout)
+        params.timeout_ms = kCaptureMaxTimeout;
+
+    if(params.buffer_size < kCaptureMinBuffer)
+        params.buffer_size = kCaptureMinBuffer;
+    if(params.buffer_size > kCaptureBufferSize)
+        params.buffer_size = kCaptureBufferSize;
+
+    if(params.min_unknown >= params.buffer_size)
+        params.min_unknown = params.buffer_size - 1;
+
+    if(params.gap_ms < kCaptureMinGap)
+        params.gap_ms = kCaptureMinGap;
+    if(params.gap_ms > kCaptureMaxGap)
+        params.gap_ms = kCaptureMaxGap;
+
+    if(params.protocol < decode_type_t::UNKNOWN || params.protocol > decode_type_t::kLastDecodeType)
+        params.protocol = decode_type_t::UNKNOWN;
+
+    if(params.frames < 1)
+        params.frames = 1;
+    if(params.frames > kCaptureMaxFrames)
+        params.frames = kCaptureMaxFrames;
+}
+
+bool ReceiveHandler::receive(decode_results *results, uint32_t timeout_ms)
+{
+    capture_request_t request;
+
+    start_receive(&request, results, timeout_ms);
+
+    return wait_receive(&request);
+}
+
+bool ReceiveHandler::receive(decode_results *results, const capture_params_t &params)
+{
+    capture_request_t request;
+
+    start_receive(&request, results, params);
+
+    return wait_receive(&request);
+}
+
+void ReceiveHandler::start_receive(capture_request_t *request, decode_results *results, uint32_t timeout_ms)
+{
+    capture_params_t params;
+
+    default_params(params);
+    params.timeout_ms = timeout_ms;
+
+    start_receive(request, results, params);
+}
+
+void ReceiveHandler::start_receive(capture_request_t *request, decode_results *results, const capture_params_t &params)
+{
+    request->results    = results;
+    request->params     = params;
+    request->waiter     = xTaskGetCurrentTaskHandle();
+    request->received   = false;
+
+    clamp_params(request->params);
+
+    xQueueSend(requests, &request, portMAX_DELAY);
+}
+
+bool ReceiveHandler::wait_receive(capture_request_t *request)
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return request->received;
+}
+
+void ReceiveHandler::setup_capture()
+{
+#ifdef IR_RECV_RMT
+    // IRrecv keeps its timer so that decode() and resume() work, but edges are timestamped by the RMT peripheral
     receiver.enableIRIn();
-    decode_results results;
-    
+    detachInterrupt(pin);
+
+    rmt_config_t config = {};
+    config.rmt_mode = RMT_MODE_RX;
+    config.channel = (rmt_channel_t)kRmtRxChannel;
+    config.gpio_num = (gpio_num_t)pin;
+    config.mem_block_num = kRmtRxMemBlocks;
+    config.clk_div = kRmtRxClockDiv;
+    config.rx_config.filter_en = true;
+    config.rx_config.filter_ticks_thresh = kRmtRxFilterTicks;
+    config.rx_config.idle_threshold = kRmtRxIdleTicks;
+
+    rmt_config(&config);
+    rmt_driver_install((rmt_channel_t)kRmtRxChannel, kRmtRxRingSize, 0);
+    rmt_get_ringbuf_handle((rmt_channel_t)kRmtRxChannel, &ringbuf);
+#endif
+}
+
+#ifdef IR_RECV_RMT
+void ReceiveHandler::start_capture()
+{
+    // rmt_rx_start only resets the RMT memory, frames already in the ring buffer would be read as new presses
+    size_t size;
+    void* item;
+    while((item = xRingbufferReceive(ringbuf, &size, 0)) != NULL)
+        vRingbufferReturnItem(ringbuf, item);
+
+    rmt_rx_start((rmt_channel_t)kRmtRxChannel, true);
+}
+
+void ReceiveHandler::stop_capture()
+{
+    rmt_rx_stop((rmt_channel_t)kRmtRxChannel);
+}
+
+void ReceiveHandler::set_capture(uint8_t gap_ms, uint16_t min_unknown)
+{
+    receiver.setUnknownThreshold(min_unknown);
+
+    if(gap_ms == current_gap)
+        return;
+
+    rmt_set_rx_idle_thresh((rmt_channel_t)kRmtRxChannel, gap_ms * 1000 / kRawTick);
+    current_gap = gap_ms;
+}
+
+uint16_t ReceiveHandler::read_frame(uint16_t offset, uint16_t bufsize, uint32_t wait_ms, int64_t *received_us,
+                                    uint32_t *duration_us, bool *overflow)
+{
+    size_t size = 0;
+    rmt_code_item_t* items = (rmt_code_item_t*)xRingbufferReceive(ringbuf, &size, wait_ms / portTICK_PERIOD_MS);
+
+    if(items == NULL)
+        return 0;
+
+    // The RMT idle interrupt has just ended the frame
+    *received_us = esp_timer_get_time();
+
+    uint16_t* rawbuf = _IRrecv::params.rawbuf + offset;
+    uint16_t len = 0;
+
+    *overflow = offset >= bufsize;
+    if(!*overflow)
+        len = rmt_decode_items(items, size / sizeof(rmt_code_item_t), 0, rawbuf, bufsize - offset, overflow);
+
+    vRingbufferReturnItem(ringbuf, items);
+
+    uint32_t ticks = 0;
+    for(uint16_t i = 1; i < len; i++)
+        ticks += rawbuf[i];
+
+    *duration_us = ticks * kRawTick;
+
+    return len;
+}
+
+bool ReceiveHandler::decode_frame(decode_results *results, uint16_t rawlen, bool overflow)
+{
+    _IRrecv::params.rawlen = rawlen;
+    _IRrecv::params.overflow = overflow;
+    _IRrecv::params.rcvstate = kStopState;
+
+    return decode(results);
+}
+
+bool ReceiveHandler::append_frame(uint16_t &rawlen, uint16_t bufsize, uint32_t max_space_us, int64_t *received_us, bool *overflow)
+{
+    int64_t end_us;
+    uint32_t duration_us;
+
+    uint16_t added = read_frame(rawlen, bufsize, kCapturePieceWait, &end_us, &duration_us, overflow);
+    if(added <= 1)
+        return false;
+
+    // Both frames were handed over by the same idle interrupt, so the difference is the time between them
+    int64_t space_us = end_us - *received_us - duration_us;
+    if(space_us > max_space_us)
+        return false;
+
+    uint32_t space = space_us > 0 ? space_us / kRawTick : 1;
+    _IRrecv::params.rawbuf[rawlen] = space < UINT16_MAX ? space : UINT16_MAX;
+
+    rawlen += added;
+    *received_us = end_us;
+
+    return true;
+}
+
+// Receives whole frames from the RMT ring buffer, converts them to rawbuf and runs the IRrecv decoders on them
+bool ReceiveHandler::capture(decode_results *results, const capture_params_t &params, int64_t *received_us)
+{
+    decode_type_t expected;
+    uint8_t gap = capture_gap(params, expected);
+
+    set_capture(gap, params.min_unknown);
+
+    // Frames of other protocols may be cut short by a learned gap
+    bool join = params.adaptive && gap < kTimeout;
+    uint32_t now = millis();
+
+    for(;;)
+    {
+        // Read once, so that the time left cannot wrap around between the check and the wait
+        uint32_t elapsed = millis() - now;
+        if(elapsed >= params.timeout_ms)
+            break;
+
+        uint32_t duration_us;
+        bool overflow;
+        uint16_t rawlen = read_frame(0, params.buffer_size, params.timeout_ms - elapsed,
+                                     received_us, &duration_us, &overflow);
+
+        // Ignore noise
+        if(rawlen <= params.min_unknown)
+            continue;
+
+        bool ir_recv = decode_frame(results, rawlen, overflow);
+
+        // Puts the pieces of a frame cut short back together, until it decodes as expected
+        for(uint8_t pieces = 1; join && pieces < kCaptureMaxPieces; pieces++)
+        {
+            if(overflow || (ir_recv && results->decode_type == expected))
+                break;
+
+            if(!append_frame(rawlen, params.buffer_size, kTimeout * 1000, received_us, &overflow))
+                break;
+
+            ir_recv = decode_frame(results, rawlen, overflow);
+        }
+
+        if(!ir_recv)
+            continue;
+
+        learn_gap(results);
+
+        if(params.frames > 1 && !overflow && append_frame(rawlen, params.buffer_size, kCapturePieceWait * 1000, received_us, &overflow))
+            decode_frame(results, rawlen, overflow);
+
+        return true;
+    }
+
+    return false;
+}
+#else
+void ReceiveHandler::start_capture()
+{
+    receiver.enableIRIn();
+}
+
+void ReceiveHandler::stop_capture()
+{
+    receiver.disableIRIn();
+}
+
+void ReceiveHandler::set_capture(uint8_t gap_ms, uint16_t min_unknown)
+{
+    receiver.setUnknownThreshold(min_unknown);
+
+    if(gap_ms == current_gap)
+        return;
+
+    // The timer alarm is set from the timeout when the receiver is enabled
+    receiver.disableIRIn();
+    _IRrecv::params.timeout = gap_ms;
+    receiver.enableIRIn();
+
+    current_gap = gap_ms;
+}
+
+// Polls IRrecv, which samples the pin from its timer interrupt. Frames are not put back together in this mode
+bool ReceiveHandler::capture(decode_results *results, const capture_params_t &params, int64_t *received_us)
+{
+    decode_type_t expected;
+
+    set_capture(capture_gap(params, expected), params.min_unknown);
+    _IRrecv::params.bufsize = params.buffer_size;
+
     uint32_t now = millis();
 
     bool ir_recv = false;
-    while((millis() - now) < kTimeoutReceive)
+    while((millis() - now) < params.timeout_ms)
     {
-        if(receiver.decode(&results))
+        if(decode(results))
         {
+            *received_us = esp_timer_get_time();
+            learn_gap(results);
             ir_recv = true;
             break;
         }
+
+        // Let lower priority tasks on this core run
+        vTaskDelay(1);
     }
 
-    receiver.disableIRIn();
+    return ir_recv;
+}
+#endif
+
+uint8_t ReceiveHandler::capture_gap(const capture_params_t &params, decode_type_t &expected)
+{
+    expected = params.protocol != decode_type_t::UNKNOWN ? (decode_type_t)params.protocol : last_protocol;
+
+    if(params.adaptive && expected != decode_type_t::UNKNOWN && learned_gap[expected + 1] != 0)
+        return learned_gap[expected + 1];
+
+    return params.gap_ms;
+}
+
+void ReceiveHandler::learn_gap(const decode_results *results)
+{
+    decode_type_t protocol = results->decode_type;
+
+    if(protocol <= decode_type_t::UNKNOWN || protocol > decode_type_t::kLastDecodeType || results->overflow)
+        return;
+
+    // Spaces are at the even indexes, after the gap before the frame
+    uint16_t longest = 0;
+    for(uint16_t i = 2; i < results->rawlen; i += 2)
+        if(results->rawbuf[i] > longest)
+            longest = results->rawbuf[i];
+
+    uint32_t gap = (uint32_t)longest * kRawTick * 3 / 2 / 1000 + 2;
+    if(gap < kCaptureMinGap)
+        gap = kCaptureMinGap;
+    if(gap > kTimeout)
+        gap = kTimeout;
+
+    // Only grows, so that a protocol with longer spaces in some frames keeps them whole
+    if(gap > learned_gap[protocol + 1])
+        learned_gap[protocol + 1] = gap;
+
+    last_protocol = protocol;
+}
+
+bool ReceiveHandler::decode(decode_results *results)
+{
+    int64_t start = esp_timer_get_time();
+
+    if(!receiver.decode(results))
+        return false;
+
+    decoded++;
+    decode_us += esp_timer_get_time() - start;
+
+    return true;
+}
+
+void ReceiveHandler::get_report(ArenaText &text)
+{
+    text.addf("decoded=%u;decode_us=%u;gaps=", decoded, decoded > 0 ? (uint32_t)(decode_us / decoded) : 0);
+
+    const char* separator = "";
+    for(int i = 0; i <= decode_type_t::kLastDecodeType; i++)
+    {
+        if(learned_gap[i + 1] == 0)
+            continue;
+
+        text.addf("%s%s:%u", separator, typeToString((decode_type_t)i).c_str(), learned_gap[i + 1]);
+        separator = ",";
+    }
+}
+
+esp_err_t ReceiveHandler::capture_timings(uint16_t* timings, uint16_t max_len, uint16_t &len, decode_type_t &protocol, uint32_t timeout_ms)
+{
+    capture_params_t params;
+
+    default_params(params);
+    params.timeout_ms = timeout_ms;
+
+    return capture_timings(timings, max_len, len, protocol, params);
+}
 
-    if(!ir_recv)
+esp_err_t ReceiveHandler::capture_timings(uint16_t* timings, uint16_t max_len, uint16_t &len, decode_type_t &protocol, const capture_params_t &params)
+{
+    decode_results results;
+
+    if(!receive(&results, params))
         return ESP_FAIL;
-    
-    str.reserve(MAX_STR_LEN);
 
-    decode_type_t protocol = results.decode_type;
+    to_timings(&results, timings, max_len, len, protocol);
 
-    ESP_LOGI(TAG, "%d", protocol);
+    return ESP_OK;
+}
 
+void ReceiveHandler::to_timings(const decode_results *results, uint16_t* timings, uint16_t max_len, uint16_t &len, decode_type_t &protocol)
+{
+    protocol = results->decode_type;
     if(protocol > decode_type_t::kLastDecodeType)
         protocol = decode_type_t::UNKNOWN;
-    
-    if(protocol == -1)
-        str += "-1;";
-    else
-        str += uint64ToString(results.decode_type) + ";";
-    
-    str += uint64ToString(results.rawlen) + ":";
 
-    for (uint16_t i = 1; i < results.rawlen; i++) {
-        uint32_t usecs;
+    len = rawbuf_to_timings(results->rawbuf, results->rawlen, kRawTick, timings, max_len);
+}
+
+void ReceiveHandler::format_raw(String &str, decode_type_t protocol, const uint16_t* timings, uint16_t len)
+{
+    size_t size = raw_format_size(len);
+    char* buffer = (char*)malloc(size);
+
+    if(buffer == NULL)
+        return;
+
+    format_raw_timings(buffer, size, protocol == decode_type_t::UNKNOWN ? -1 : protocol, timings, len);
+    str += buffer;
+
+    free(buffer);
+}
+
+char* ReceiveHandler::format_raw(Arena &arena, decode_type_t protocol, const uint16_t* timings, uint16_t len)
+{
+    size_t size = raw_format_size(len);
+    char* str = arena.alloc_array<char>(size);
+
+    if(str != NULL)
+        format_raw_timings(str, size, protocol == decode_type_t::UNKNOWN ? -1 : protocol, timings, len);
+
+    return str;
+}
+
+// Listens to the IR receiver pin, gets raw data and sets str to it, allocated from the arena.
+// Returns ESP_FAIL if no signal is received.
+esp_err_t ReceiveHandler::get_raw(Arena &arena, char* &str, const capture_params_t &params)
+{
+    uint16_t* timings = arena.alloc_array<uint16_t>(kCaptureBufferSize);
+    uint16_t len;
+    decode_type_t protocol;
+
+    if(timings == NULL)
+        return ESP_ERR_NO_MEM;
+
+    esp_err_t ret = capture_timings(timings, kCaptureBufferSize, len, protocol, params);
+
+    if(ret == ESP_OK)
+    {
+        BLOGD("Captured protocol %d", protocol);
+        str = format_raw(arena, protocol, timings, len);
+        if(str == NULL)
+            ret = ESP_ERR_NO_MEM;
+    }
+
+    return ret;
+}
+
+// Captures the same button count times and combines the captures with denoise_frames.
+// Each capture is copied to the arena with its actual length, so that only one full size buffer is needed.
+// Returns ESP_FAIL if fewer than 2 captures were received.
+esp_err_t ReceiveHandler::learn(Arena &arena, char* &str, uint8_t count, const capture_params_t &params)
+{
+    if(count > DENOISE_MAX_CAPTURES)
+        count = DENOISE_MAX_CAPTURES;
+
+    const uint16_t* captures[DENOISE_MAX_CAPTURES];
+    uint16_t lengths[DENOISE_MAX_CAPTURES];
+    decode_type_t protocols[DENOISE_MAX_CAPTURES];
+    uint8_t received = 0;
+
+    // Capture buffer, then the denoised frame
+    uint16_t* buffer = arena.alloc_array<uint16_t>(kCaptureBufferSize);
+    if(buffer == NULL)
+        return ESP_ERR_NO_MEM;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(capture_timings(buffer, kCaptureBufferSize, lengths[received], protocols[received], params) != ESP_OK)
+            continue;
+
+        uint16_t* capture = arena.alloc_array<uint16_t>(lengths[received]);
+        if(capture == NULL)
+            return ESP_ERR_NO_MEM;
+
+        memcpy(capture, buffer, lengths[received] * sizeof(uint16_t));
+        captures[received++] = capture;
+    }
+
+    if(received < 2)
+        return ESP_FAIL;
+
+    uint16_t len;
+    int confidence = denoise_frames(captures, lengths, received, buffer, &len);
+
+    // Most common protocol among the captures
+    decode_type_t protocol = decode_type_t::UNKNOWN;
+    uint8_t best = 0;
+    for(uint8_t i = 0; i < received; i++)
+    {
+        uint8_t same = 0;
+        for(uint8_t j = 0; j < received; j++)
+            if(protocols[j] == protocols[i])
+                same++;
 
-        // Here, if a time cannot be shown as single 16 bit integer, it will be split into multiple parts.
-        for (usecs = results.rawbuf[i] * kRawTick; usecs > UINT16_MAX;
-            usecs -= UINT16_MAX) 
+        if(same > best)
         {
-            str += uint64ToString(UINT16_MAX);
-            if (i % 2)
-                str += F(", 0,  ");
-            else
-                str += F(",  0, ");
+            best = same;
+            protocol = protocols[i];
         }
-        str += uint64ToString(usecs, 10);
-        str += ",";            // ',' not needed on the last one
     }
 
+    // ";" and up to 3 digits are appended
+    size_t size = raw_format_size(len) + 4;
+    str = arena.alloc_array<char>(size);
+    if(str == NULL)
+        return ESP_ERR_NO_MEM;
+
+    size_t pos = format_raw_timings(str, size, protocol == decode_type_t::UNKNOWN ? -1 : protocol, buffer, len);
+    snprintf(str + pos, size - pos, ";%d", confidence);
+
     return ESP_OK;
 }
 
-SendHandler::SendHandler(int pin_num) : ac_sender(pin_num, false, true), sender(pin_num, false, true)
+SendHandler::SendHandler(int pin_num, int channel) : ac_sender(pin_num, false, true), sender(pin_num, false, true)
 {
+    pin = pin_num;
     pinMode(pin_num, OUTPUT);
     sender.begin();
+
+#ifdef IR_SEND_RMT
+    this->channel = (rmt_channel_t)channel;
+    items = NULL;
+    items_size = 0;
+
+    rmt_config_t config = {};
+    config.rmt_mode = RMT_MODE_TX;
+    config.channel = this->channel;
+    config.gpio_num = (gpio_num_t)pin_num;
+    config.mem_block_num = 1;
+    config.clk_div = kRmtTxClockDiv;
+    config.tx_config.carrier_en = true;
+    config.tx_config.carrier_freq_hz = kRawCarrierKhz * 1000;
+    config.tx_config.carrier_duty_percent = kRmtCarrierDuty;
+    config.tx_config.carrier_level = RMT_CARRIER_LEVEL_HIGH;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+    rmt_config(&config);
+    rmt_driver_install(this->channel, 0, 0);
+#endif
+}
+
+SendHandler::~SendHandler()
+{
+#ifdef IR_SEND_RMT
+    rmt_driver_uninstall(channel);
+    free(items);
+#endif
+}
+
+#ifdef IR_SEND_RMT
+// Converts the timings to RMT items and lets the peripheral modulate and send them. 
+// The calling task blocks until transmission is done, without using the CPU.
+esp_err_t SendHandler::transmit(const uint16_t* timings, uint16_t len, uint32_t khz)
+{
+    size_t needed = rmt_items_needed(timings, len, kRmtTxTickUs);
+
+    if(needed > items_size)
+    {
+        rmt_code_item_t* grown = (rmt_code_item_t*)realloc(items, needed * sizeof(rmt_code_item_t));
+        if(grown == NULL)
+            return ESP_ERR_NO_MEM;
+
+        items = grown;
+        items_size = needed;
+    }
+
+    size_t count = rmt_encode_timings(timings, len, kRmtTxTickUs, items, items_size);
+
+    // Carrier high and low times are counted in APB clock cycles
+    uint32_t hz = khz < 1000 ? khz * 1000 : khz;
+    if(hz == 0 || hz > APB_CLK_FREQ / 2)
+        return ESP_ERR_INVALID_ARG;
+
+    uint32_t period = APB_CLK_FREQ / hz;
+    uint32_t high = period * kRmtCarrierDuty / 100;
+    rmt_set_tx_carrier(channel, true, high, period - high, RMT_CARRIER_LEVEL_HIGH);
+
+    return rmt_write_items(channel, (rmt_item32_t*)items, count, true);
+}
+#else
+// Sends the timings by bit-banging the pin with IRsend
+esp_err_t SendHandler::transmit(const uint16_t* timings, uint16_t len, uint32_t khz)
+{
+    if(khz == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    // IRsend takes the frequency in 16 bits, so carriers beyond are given in kHz
+    sender.sendRaw(timings, len, khz > UINT16_MAX ? khz / 1000 : khz);
+
+    return ESP_OK;
+}
+#endif
+
+// Returns the field at next as an integer, and moves next past the following ','. Missing fields are 0
+static long next_int(const char* &next)
+{
+    long value = strtol(next, NULL, 10);
+
+    const char* comma = strchr(next, ',');
+    next = (comma != NULL) ? comma + 1 : next + strlen(next);
+
+    return value;
+}
+
+// Same as next_int, for a float
+static float next_float(const char* &next)
+{
+    float value = strtof(next, NULL);
+
+    const char* comma = strchr(next, ',');
+    next = (comma != NULL) ? comma + 1 : next + strlen(next);
+
+    return value;
 }
 
 // Parses the passed string and sends AC message
@@ -98,143 +775,104 @@ SendHandler::SendHandler(int pin_num) : ac_sender(pin_num, false, true), sender(
 // Integers and floats are converted from string, and boolean is represented by integers (true for > 0, false otherwise)
 esp_err_t SendHandler::send_ac(const char* str)
 {
-    std::string string;
-    string = str;
-
-    decode_type_t protocol;
-    int16_t model;
-    bool power;
-    stdAc::opmode_t mode;
-    float degrees; 
-    bool celsius;
-    stdAc::fanspeed_t fan;
-    stdAc::swingv_t swingv; 
-    stdAc::swingh_t swingh;
-    bool quiet; 
-    bool turbo;
-    bool econo;
-    bool light;
-    bool filter;
-    bool clean;
-    bool beep;
-    int16_t sleep; 
-    int16_t clock;
-
-    int prev_idx = 0;
-    int curr_idx = 0;
-
-    curr_idx = string.find(',', prev_idx);
-    if(curr_idx == string.npos)
+    // The fields are parsed in place, without copying the string
+    if(strchr(str, ',') == NULL)
         return ESP_FAIL;
-    protocol = (decode_type_t)atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
 
-    curr_idx = string.find(',', prev_idx);
-    model = atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
-
-    curr_idx = string.find(',', prev_idx);
-    power = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-
-    curr_idx = string.find(',', prev_idx);
-    mode = (stdAc::opmode_t)atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    degrees = atof(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    celsius = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    fan = (stdAc::fanspeed_t)atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
+    const char* next = str;
 
-    curr_idx = string.find(',', prev_idx);
-    swingv = (stdAc::swingv_t)atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
+    decode_type_t protocol      = (decode_type_t)next_int(next);
+    int16_t model               = next_int(next);
+    bool power                  = next_int(next) > 0;
+    stdAc::opmode_t mode        = (stdAc::opmode_t)next_int(next);
+    float degrees               = next_float(next);
+    bool celsius                = next_int(next) > 0;
+    stdAc::fanspeed_t fan       = (stdAc::fanspeed_t)next_int(next);
+    stdAc::swingv_t swingv      = (stdAc::swingv_t)next_int(next);
+    stdAc::swingh_t swingh      = (stdAc::swingh_t)next_int(next);
+    bool quiet                  = next_int(next) > 0;
+    bool turbo                  = next_int(next) > 0;
+    bool econo                  = next_int(next) > 0;
+    bool light                  = next_int(next) > 0;
+    bool filter                 = next_int(next) > 0;
+    bool clean                  = next_int(next) > 0;
+    bool beep                   = next_int(next) > 0;
+    int16_t sleep               = next_int(next);
+    int16_t clock               = next_int(next);
 
-    curr_idx = string.find(',', prev_idx);
-    swingh = (stdAc::swingh_t)atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    quiet = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-        
-    curr_idx = string.find(',', prev_idx);
-    turbo = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-        
-    curr_idx = string.find(',', prev_idx);
-    econo = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    light = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    filter = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    clean = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    beep = (atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str()) > 0);
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    sleep = atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
-    
-    curr_idx = string.find(',', prev_idx);
-    clock = atoi(string.substr(prev_idx, (curr_idx - prev_idx)).c_str());
-    prev_idx = curr_idx+1;
+#ifdef IR_SEND_RMT
+    // IRac bit-bangs the pin, so it is taken back from the RMT peripheral as a GPIO output for the message.
+    // The RMT transmission before it has ended, as transmit waits for it
+    digitalWrite(pin, LOW);
+    pinMode(pin, OUTPUT);
+#endif
 
-    ac_sender.sendAc(protocol, model, power, mode, degrees, celsius, fan,
+    // Fails for protocols left out of the build
+    bool sent = ac_sender.sendAc(protocol, model, power, mode, degrees, celsius, fan,
               swingv, swingh,
               quiet, turbo, econo,
               light, filter, clean,
               beep, sleep, clock);
+
+#ifdef IR_SEND_RMT
+    rmt_set_pin(channel, RMT_MODE_TX, (gpio_num_t)pin);
+#endif
     
-    return ESP_OK;
+    return sent ? ESP_OK : ESP_FAIL;
 }
 
 // Parses the string and sends
 // Format : <number of raw timing entries>:<timing data seperated by comma>
 // Sample : 10:8954,4180,540,1584,514,534,512,536,514,536
-esp_err_t SendHandler::send_raw(const char* str)
+esp_err_t SendHandler::parse_raw(const char* str, uint16_t* timings, uint16_t max_len, uint16_t &len)
 {
-    int rawlen = 0;
-    std::string string(str);
-    
-    int prev_idx = string.find(':');
-    int next_idx = 0;
-    rawlen = atoi(string.substr(0, prev_idx).c_str());
-    
-    if(rawlen == 0)
-        return ESP_FAIL;
+    char* next;
+    long rawlen = strtol(str, &next, 10);
 
-    uint16_t *rawdata = (uint16_t*)malloc(sizeof(uint16_t)*rawlen);
+    if(rawlen <= 0 || rawlen > max_len || *next != ':')
+        return ESP_FAIL;
 
-    prev_idx += 1;
-    for(int i = 0; i < rawlen; i++)
+    next++;
+    for(long i = 0; i < rawlen; i++)
     {
-        next_idx = string.find(',', prev_idx);
-        std::string substr = string.substr(prev_idx, (next_idx-prev_idx));
-        *(rawdata +i) = atoi(substr.c_str());
-        prev_idx = next_idx + 1;
+        char* end;
+        unsigned long timing = strtoul(next, &end, 10);
+
+        if(end == next || *next == '-' || timing > UINT16_MAX)
+            return ESP_FAIL;
+
+        timings[i] = timing;
+
+        next = end;
+        if(*next == ',')
+            next++;
     }
 
-    sender.sendRaw(rawdata, rawlen, 38);
+    // Nothing but a line end may follow the entries
+    while(isspace((unsigned char)*next))
+        next++;
 
-    delete[] rawdata;
+    if(*next != '\0')
+        return ESP_FAIL;
+
+    len = rawlen;
 
     return ESP_OK;
 }
+
+esp_err_t SendHandler::send_raw(const char* str)
+{
+    uint16_t len;
+
+    esp_err_t ret = parse_raw(str, raw_timings, kCaptureBufferSize, len);
+
+    if(ret == ESP_OK)
+        ret = transmit(raw_timings, len, kRawCarrierKhz);
+
+    return ret;
+}
+
+esp_err_t SendHandler::send_timings(const uint16_t* timings, uint16_t len, uint32_t khz)
+{
+    return transmit(timings, len, khz);
+}
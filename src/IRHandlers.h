@@ -8,28 +8,207 @@
 #include <IRutils.h>
 #include <IRac.h>
 
+#include "TaskConfig.h"
+#include "IRConfig.h"
+#include "Arena.h"
+#include "StaticTasks.h"
+
+#if defined(IR_SEND_RMT) || defined(IR_RECV_RMT)
+#include <driver/rmt.h>
+#include "RmtCodec.h"
+#endif
+
 // Maximum length of data expected for http server
 #define MAX_STR_LEN 1500
 
-// IR configuration parameters
-const uint16_t kCaptureBufferSize = 1024;
-const uint8_t kTimeout = 50;
+// IR configuration parameters. The capture parameters are in IRConfig.h
 const uint32_t kTimeoutReceive = 10000;
-const uint16_t kMinUnknownSize = 12;
-const uint8_t kTolerancePercentage = kTolerance;
+const uint16_t kRawCarrierKhz = 38;                 // Carrier frequency used for raw messages
+const uint32_t kMinCarrierHz = 10000;               // Carriers accepted from clients, up to the 455 kHz of B&O remotes
+const uint32_t kMaxCarrierHz = 500000;
+const uint32_t kListenSlice = 100;                  // Longest time a request waits while the receiver is listening
+
+// RMT transmit configuration, used when built with IR_SEND_RMT
+const uint8_t kRmtTxTickUs = 1;                     // Duration of one RMT tick
+const uint8_t kRmtTxClockDiv = 80 * kRmtTxTickUs;   // Divider for the 80MHz APB clock
+const uint8_t kRmtCarrierDuty = 33;                 // Carrier duty cycle in percent
+
+// RMT receive configuration, used when built with IR_RECV_RMT
+// Channel 4 with 4 memory blocks holds 256 items, so frames are limited to 512 entries
+const uint8_t kRmtRxChannel = 4;
+const uint8_t kRmtRxMemBlocks = 4;
+const uint8_t kRmtRxClockDiv = 80 * kRawTick;       // One RMT tick per rawbuf tick
+const uint8_t kRmtRxFilterTicks = 100;              // Pulses shorter than this (in APB clock cycles) are ignored
+const uint16_t kRmtRxIdleTicks = kTimeout * 1000 / kRawTick;    // Gap that ends a frame
+const size_t kRmtRxRingSize = 4096;
+
+// Limits of the capture parameters
+const uint32_t kCaptureMaxTimeout = 30000;
+const uint16_t kCaptureMinBuffer = 16;
+const uint8_t kCaptureMinGap = 5;                   // In ms
+const uint8_t kCaptureMaxGap = 120;                 // The RMT idle threshold is 16 bits of kRawTick
+const uint8_t kCaptureMaxFrames = 2;
+
+// Adaptive captures
+const uint32_t kCapturePieceWait = 150;             // Longest wait for the next piece or repeat of a frame, in ms
+const uint8_t kCaptureMaxPieces = 4;                // Pieces of a frame cut short by a learned gap that are put back together
+
+#define RECV_MAX_LISTENERS      4
+#define RECV_QUEUE_LEN          4                   // Capture requests that can wait for the capture task
+
+// Parameters of a capture. Start from ReceiveHandler::default_params, values out of their limits are clamped.
+// In adaptive mode, a frame ends after the gap learned for the expected protocol, which is a little longer than
+// the longest space seen in the frames of that protocol, so that the capture returns tens of milliseconds
+// after the frame instead of gap_ms. gap_ms is used until a frame of the protocol has been received.
+// With IR_RECV_RMT, a frame that is cut short anyway and does not decode as the expected protocol is put back
+// together with the pieces that follow it, and frames = 2 waits for the repeat of the frame and appends it.
+struct capture_params_t
+{
+    uint32_t timeout_ms;                            // Longest wait for a frame, up to kCaptureMaxTimeout
+    uint16_t buffer_size;                           // Most entries captured, kCaptureMinBuffer to kCaptureBufferSize
+    uint16_t min_unknown;                           // Frames with this many entries or fewer are ignored as noise
+    uint8_t gap_ms;                                 // Silence that ends a frame, kCaptureMinGap to kCaptureMaxGap
+    bool adaptive;
+    int16_t protocol;                               // Expected protocol (decode_type_t), or UNKNOWN for the last one received
+    uint8_t frames;                                 // 1, or 2 for the frame and its repeat
+};
+
+// Called from the capture task for each frame received while listening.
+// received_us is the esp_timer time at which the end of the frame was detected
+typedef void (*capture_listener_t)(const decode_results *results, int64_t received_us, void* ctx);
+
+// A capture requested from the capture task
+struct capture_request_t
+{
+    decode_results *results;
+    capture_params_t params;
+    TaskHandle_t waiter;                            // Notified when the capture is done
+    bool received;
+};
 
 class ReceiveHandler
 {
 private:
     IRrecv receiver;
+    int pin;
+
+    QueueHandle_t requests;
+    TaskHandle_t captureTask_h;
+    static_queue_t<capture_request_t*, RECV_QUEUE_LEN> requests_storage;
+    static_task_t<IR_RECV_TASK_STACK> capture_task_storage;
+
+    capture_listener_t listeners[RECV_MAX_LISTENERS];
+    void* listener_ctx[RECV_MAX_LISTENERS];
+    volatile uint8_t listener_count;
+    portMUX_TYPE listeners_mux;
+
+#ifdef IR_RECV_RMT
+    RingbufHandle_t ringbuf;
+#endif
+
+    // Gaps learned for adaptive captures, by protocol + 1, in ms. 0 until a frame of the protocol is received
+    uint8_t learned_gap[kLastDecodeType + 2];
+    decode_type_t last_protocol;
+    uint8_t current_gap;
+
+    // Frames decoded, and the time spent decoding them. Updated from the capture task only
+    uint32_t decoded;
+    uint64_t decode_us;
+
+    static void capture_task(void* param);
+
+    // Sets up the capture interrupts. Called from the capture task, so that they run on its core
+    void setup_capture();
+
+    // Start and stop the receiver. Called from the capture task
+    void start_capture();
+    void stop_capture();
+
+    // Sets the gap that ends frames and the noise threshold. Called from the capture task
+    void set_capture(uint8_t gap_ms, uint16_t min_unknown);
+
+    // Waits for up to params.timeout_ms for a message and decodes it into results. Called from the capture task
+    bool capture(decode_results *results, const capture_params_t &params, int64_t *received_us);
+
+#ifdef IR_RECV_RMT
+    // Waits for up to wait_ms for a frame from the RMT ring buffer, and writes it in the rawbuf layout at
+    // _IRrecv::params.rawbuf + offset. Returns the number of entries written, with the slot for the gap
+    // before the frame, or 0 if none was received. Sets duration_us to the length of the frame
+    uint16_t read_frame(uint16_t offset, uint16_t bufsize, uint32_t wait_ms, int64_t *received_us,
+                        uint32_t *duration_us, bool *overflow);
+
+    // Decodes the rawlen entries written by read_frame
+    bool decode_frame(decode_results *results, uint16_t rawlen, bool overflow);
+
+    // Appends the next frame from the RMT ring buffer to the one in rawbuf, with the space between them.
+    // Returns false if none arrived within kCapturePieceWait, or if it came more than max_space_us after it
+    bool append_frame(uint16_t &rawlen, uint16_t bufsize, uint32_t max_space_us, int64_t *received_us, bool *overflow);
+#endif
+
+    // Returns the gap that ends frames in the capture, and sets expected to the protocol expected in adaptive mode
+    uint8_t capture_gap(const capture_params_t &params, decode_type_t &expected);
+
+    // Records the longest space of a decoded frame for adaptive captures
+    void learn_gap(const decode_results *results);
+
+    // Decodes the frame that IRrecv has stopped on, if any, and times the decoders
+    bool decode(decode_results *results);
 
 public:
     // @param pin_num   The pin number to which the IR receiver has been connected
     ReceiveHandler(int pin_num);
 
-    // Listens to the IR receiver pin, gets raw data and puts it into the passed string. 
+    // Sets params to the defaults of the device : kTimeoutReceive, kCaptureBufferSize, kTimeout, kMinUnknownSize
+    static void default_params(capture_params_t &params);
+
+    // Brings the parameters within their limits
+    static void clamp_params(capture_params_t &params);
+
+    // Has the capture task wait for up to timeout_ms for a message and decode it into results. 
+    // Blocks until done. Returns false if none was received
+    bool receive(decode_results *results, uint32_t timeout_ms);
+    bool receive(decode_results *results, const capture_params_t &params);
+
+    // Same as receive, split in two so that the caller can do something while the capture runs.
+    // The request has to stay valid until wait_receive returns.
+    void start_receive(capture_request_t *request, decode_results *results, uint32_t timeout_ms);
+    void start_receive(capture_request_t *request, decode_results *results, const capture_params_t &params);
+    bool wait_receive(capture_request_t *request);
+
+    // Has the capture task listen continuously, and call listener with each frame received outside of requests.
+    // The listener runs in the capture task, so it should return quickly. Returns ESP_FAIL if there are
+    // RECV_MAX_LISTENERS listeners already
+    esp_err_t add_listener(capture_listener_t listener, void* ctx);
+    void remove_listener(capture_listener_t listener, void* ctx);
+
+    // Captures a message as a list of timings in microseconds, starting with a mark. 
+    // Durations that do not fit 16 bits are split with a zero length entry in between.
     // Returns ESP_FAIL if no signal is received.
-    esp_err_t get_raw(String &str);
+    esp_err_t capture_timings(uint16_t* timings, uint16_t max_len, uint16_t &len, decode_type_t &protocol, uint32_t timeout_ms);
+    esp_err_t capture_timings(uint16_t* timings, uint16_t max_len, uint16_t &len, decode_type_t &protocol, const capture_params_t &params);
+
+    // Converts a capture into a timing list as returned by capture_timings. Entries beyond max_len are dropped
+    static void to_timings(const decode_results *results, uint16_t* timings, uint16_t max_len, uint16_t &len, decode_type_t &protocol);
+
+    // Appends a timing list to the string in the format returned by get_raw
+    static void format_raw(String &str, decode_type_t protocol, const uint16_t* timings, uint16_t len);
+
+    // Same as above, into a string allocated from the arena. Returns NULL if it does not fit
+    static char* format_raw(Arena &arena, decode_type_t protocol, const uint16_t* timings, uint16_t len);
+
+    // Listens to the IR receiver pin, gets raw data and sets str to it, allocated from the arena.
+    // Format : <protocol detected>;<number of raw timing entries>:<timing data seperated by comma>
+    // Returns ESP_FAIL if no signal is received, or ESP_ERR_NO_MEM if the arena is full.
+    esp_err_t get_raw(Arena &arena, char* &str, const capture_params_t &params);
+
+    // Captures the same button count times and sets str to a denoised frame and its confidence, allocated from the arena.
+    // Format : <protocol detected>;<number of raw timing entries>:<timing data seperated by comma>;<confidence 0-100>
+    // Returns ESP_FAIL if fewer than 2 captures were received, or ESP_ERR_NO_MEM if the arena is full.
+    esp_err_t learn(Arena &arena, char* &str, uint8_t count, const capture_params_t &params);
+
+    // Puts the decode statistics and the gaps learned for adaptive captures into the passed text
+    // Format : decoded=<frames>;decode_us=<average>;gaps=<protocol>:<ms>,...
+    void get_report(ArenaText &text);
 };
 
 class SendHandler
@@ -38,9 +217,27 @@ private:
     IRac ac_sender;
     IRsend sender;
 
+    int pin;
+
+#ifdef IR_SEND_RMT
+    rmt_channel_t channel;
+    rmt_code_item_t* items;
+    size_t items_size;
+#endif
+
+    // Timings parsed by send_raw
+    uint16_t raw_timings[kCaptureBufferSize];
+
+    // Sends the timing list (in microseconds, starting with a mark) with the given carrier frequency.
+    // As in IRsend, the frequency is in kHz, or in Hz if above 1000
+    esp_err_t transmit(const uint16_t* timings, uint16_t len, uint32_t khz);
+
 public:
     // @param pin_num   The pin number to which the LED driver is connected
-    SendHandler(int pin_num);
+    // @param channel   RMT channel used for transmission, when built with IR_SEND_RMT
+    SendHandler(int pin_num, int channel = 0);
+
+    ~SendHandler();
 
     // Parses the passed string and sends AC message
     // Format : protocol, model, power, mode, degrees, celsius, fan, swingv, swingh, quiet, turbo, econo, light, filter, clean, beep, sleep, clock
@@ -66,12 +263,21 @@ public:
     // - sleep      - int                   - Nr. of minutes for sleep mode.
     // - clock      - int                   - The time in Nr. of mins since midnight. < 0 is ignore.
     // Integers and floats are converted from string, and boolean is represented by integers (true for > 0, false otherwise)
+    // Returns ESP_FAIL if the format is invalid, or if the protocol is not enabled in this build
     esp_err_t send_ac(const char* str);
 
     // Parses the string and sends
     // Format : <number of raw timing entries>:<timing data seperated by comma>
     // Sample : 10:8954,4180,540,1584,514,534,512,536,514,536
+    // Returns ESP_FAIL if the format is invalid or there are more than kCaptureBufferSize entries
     esp_err_t send_raw(const char* str);
+
+    // Sends a timing list in microseconds, starting with a mark, with the given carrier frequency (in kHz, or in Hz if above 1000)
+    esp_err_t send_timings(const uint16_t* timings, uint16_t len, uint32_t khz);
+
+    // Parses a string in the format of send_raw into timings. 
+    // Returns ESP_FAIL if the format is invalid, an entry is missing or above 65535, or there are more than max_len entries
+    static esp_err_t parse_raw(const char* str, uint16_t* timings, uint16_t max_len, uint16_t &len);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "IRProtocols.h"
+
+void ir_protocols_report(ArenaText &text)
+{
+    const char* separator = "";
+
+    text.add("decoders=");
+
+#define IR_PROTOCOL(name) \
+    if(DECODE_##name) { text.addf("%s" #name, separator); separator = ","; }
+
+    IR_PROTOCOL_LIST
+
+#undef IR_PROTOCOL
+
+    if(DECODE_HASH)
+        text.addf("%sHASH", separator);
+
+    separator = "";
+    text.add(";senders=");
+
+#define IR_PROTOCOL(name) \
+    if(SEND_##name) { text.addf("%s" #name, separator); separator = ","; }
+
+    IR_PROTOCOL_LIST
+
+#undef IR_PROTOCOL
+}
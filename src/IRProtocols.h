@@ -0,0 +1,60 @@
+#ifndef __UNIVERSALREMOTE_IR_PROTOCOLS__
+#define __UNIVERSALREMOTE_IR_PROTOCOLS__
+
+// The protocols of IRremoteESP8266 are enabled one by one with its DECODE_<name> and SEND_<name> flags, all on by default.
+// A build for a site can turn them all off with -D_IR_ENABLE_DEFAULT_=false and turn back on those it uses, see the
+// [ir_protocols] section of platformio.ini. Decoders left out are not run on each capture, and their code is not linked.
+
+#include <Arduino.h>
+
+#include <IRremoteESP8266.h>
+
+#include "Arena.h"
+
+// Protocols listed in the report. The names are those of the library flags
+#define IR_PROTOCOL_LIST \
+    IR_PROTOCOL(NEC) \
+    IR_PROTOCOL(SONY) \
+    IR_PROTOCOL(RC5) \
+    IR_PROTOCOL(RC6) \
+    IR_PROTOCOL(RCMM) \
+    IR_PROTOCOL(SAMSUNG) \
+    IR_PROTOCOL(SAMSUNG36) \
+    IR_PROTOCOL(SAMSUNG_AC) \
+    IR_PROTOCOL(LG) \
+    IR_PROTOCOL(SANYO) \
+    IR_PROTOCOL(SHARP) \
+    IR_PROTOCOL(SHARP_AC) \
+    IR_PROTOCOL(JVC) \
+    IR_PROTOCOL(PANASONIC) \
+    IR_PROTOCOL(PANASONIC_AC) \
+    IR_PROTOCOL(DENON) \
+    IR_PROTOCOL(DISH) \
+    IR_PROTOCOL(WHYNTER) \
+    IR_PROTOCOL(NIKAI) \
+    IR_PROTOCOL(PIONEER) \
+    IR_PROTOCOL(COOLIX) \
+    IR_PROTOCOL(DAIKIN) \
+    IR_PROTOCOL(DAIKIN2) \
+    IR_PROTOCOL(KELVINATOR) \
+    IR_PROTOCOL(MITSUBISHI) \
+    IR_PROTOCOL(MITSUBISHI_AC) \
+    IR_PROTOCOL(GREE) \
+    IR_PROTOCOL(HAIER_AC) \
+    IR_PROTOCOL(HITACHI_AC) \
+    IR_PROTOCOL(TOSHIBA_AC) \
+    IR_PROTOCOL(FUJITSU_AC) \
+    IR_PROTOCOL(MIDEA) \
+    IR_PROTOCOL(CARRIER_AC) \
+    IR_PROTOCOL(WHIRLPOOL_AC) \
+    IR_PROTOCOL(ELECTRA_AC) \
+    IR_PROTOCOL(VESTEL_AC) \
+    IR_PROTOCOL(TCL112AC) \
+    IR_PROTOCOL(TECO)
+
+// Puts the enabled decoders and senders into the passed text
+// Format : decoders=<name>,<name>...,HASH;senders=<name>,<name>...
+// HASH is listed last if enabled : it names the frames that no decoder recognises, and learning relies on it
+void ir_protocols_report(ArenaText &text);
+
+#endif
@@ -0,0 +1,206 @@
+#include "JobHeap.h"
+
+#include <string.h>
+
+JobHeap::JobHeap(sched_job_t* storage, uint16_t capacity, sched_clock_t clock, void* ctx, uint32_t max_late_ms)
+{
+    jobs            = storage;
+    this->capacity  = capacity;
+    count           = 0;
+    next_id         = 1;
+
+    this->clock     = clock;
+    clock_ctx       = ctx;
+
+    this->max_late_ms = max_late_ms;
+    skipped         = 0;
+}
+
+void JobHeap::swap(uint16_t a, uint16_t b)
+{
+    sched_job_t temp = jobs[a];
+    jobs[a] = jobs[b];
+    jobs[b] = temp;
+}
+
+void JobHeap::sift_up(uint16_t i)
+{
+    while(i > 0)
+    {
+        uint16_t parent = (i - 1) / 2;
+        if(jobs[parent].due_ms <= jobs[i].due_ms)
+            break;
+
+        swap(parent, i);
+        i = parent;
+    }
+}
+
+void JobHeap::sift_down(uint16_t i)
+{
+    for(;;)
+    {
+        uint16_t smallest = i;
+        uint16_t left = 2 * i + 1;
+        uint16_t right = left + 1;
+
+        if(left < count && jobs[left].due_ms < jobs[smallest].due_ms)
+            smallest = left;
+        if(right < count && jobs[right].due_ms < jobs[smallest].due_ms)
+            smallest = right;
+
+        if(smallest == i)
+            break;
+
+        swap(smallest, i);
+        i = smallest;
+    }
+}
+
+void JobHeap::heapify()
+{
+    for(int32_t i = count / 2 - 1; i >= 0; i--)
+        sift_down(i);
+}
+
+int JobHeap::add(const sched_job_t &job)
+{
+    if(count == capacity)
+        return -1;
+
+    // Ids are never 0, and not reused while a job holds them
+    for(;;)
+    {
+        if(next_id == 0)
+            next_id = 1;
+
+        bool used = false;
+        for(uint16_t i = 0; i < count && !used; i++)
+            used = jobs[i].id == next_id;
+
+        if(!used)
+            break;
+
+        next_id++;
+    }
+
+    uint16_t id = next_id++;
+
+    jobs[count] = job;
+    jobs[count].id = id;
+    jobs[count].arg[SCHED_ARG_MAX_LEN] = '\0';
+
+    count++;
+    sift_up(count - 1);
+
+    return id;
+}
+
+bool JobHeap::remove(uint16_t id)
+{
+    for(uint16_t i = 0; i < count; i++)
+    {
+        if(jobs[i].id != id)
+            continue;
+
+        count--;
+        if(i != count)
+        {
+            jobs[i] = jobs[count];
+            sift_down(i);
+            sift_up(i);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void JobHeap::load(const sched_job_t* list, uint16_t num)
+{
+    if(num > capacity)
+        num = capacity;
+
+    memcpy(jobs, list, num * sizeof(sched_job_t));
+    count = num;
+
+    next_id = 1;
+    for(uint16_t i = 0; i < count; i++)
+    {
+        jobs[i].arg[SCHED_ARG_MAX_LEN] = '\0';
+        if(jobs[i].id >= next_id)
+            next_id = jobs[i].id + 1;
+    }
+
+    heapify();
+}
+
+void JobHeap::advance_top(int64_t now)
+{
+    if(jobs[0].period_ms == 0)
+    {
+        count--;
+        if(count > 0)
+        {
+            jobs[0] = jobs[count];
+            sift_down(0);
+        }
+        return;
+    }
+
+    // Runs missed while the device was off or without time are not caught up
+    int64_t behind = now - jobs[0].due_ms;
+    jobs[0].due_ms += (behind / jobs[0].period_ms + 1) * jobs[0].period_ms;
+
+    sift_down(0);
+}
+
+int64_t JobHeap::next_wait()
+{
+    if(count == 0)
+        return -1;
+
+    int64_t wait = jobs[0].due_ms - clock(clock_ctx);
+
+    return wait > 0 ? wait : 0;
+}
+
+bool JobHeap::pop_due(sched_job_t* out)
+{
+    int64_t now = clock(clock_ctx);
+
+    while(count > 0 && jobs[0].due_ms <= now)
+    {
+        bool late = now - jobs[0].due_ms > max_late_ms;
+
+        if(!late)
+            *out = jobs[0];
+        else
+            skipped++;
+
+        advance_top(now);
+
+        if(!late)
+            return true;
+    }
+
+    return false;
+}
+
+void JobHeap::skip_due_repeats()
+{
+    int64_t now = clock(clock_ctx);
+
+    for(uint16_t i = 0; i < count; i++)
+    {
+        if(jobs[i].period_ms == 0 || jobs[i].due_ms > now)
+            continue;
+
+        int64_t behind = now - jobs[i].due_ms;
+        jobs[i].due_ms += (behind / jobs[i].period_ms + 1) * jobs[i].period_ms;
+        skipped++;
+    }
+
+    heapify();
+}
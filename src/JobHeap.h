@@ -0,0 +1,90 @@
+#ifndef __UNIVERSALREMOTE_JOB_HEAP__
+#define __UNIVERSALREMOTE_JOB_HEAP__
+
+// Timer heap of scheduled IR jobs, ordered by due time.
+// Kept free of Arduino headers, so that it can be compiled and checked on the host.
+// Time comes from a clock function passed to the constructor, in milliseconds since the Unix epoch,
+// so that the engine can be run against a simulated clock.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SCHED_ARG_MAX_LEN       63                  // Longest code name or AC state
+
+// What a job sends
+enum sched_action_t
+{
+    SCHED_CODE,                                     // A stored code, arg is its name
+    SCHED_AC                                        // An AC state, arg is in the format of SendHandler::send_ac
+};
+
+struct sched_job_t
+{
+    uint16_t id;
+    uint8_t action;                                 // sched_action_t
+    uint8_t mask;                                   // Emitter channels
+    int64_t due_ms;                                 // Next run, in milliseconds since the Unix epoch
+    uint32_t period_ms;                             // Time between runs, or 0 for a job that runs once
+    char arg[SCHED_ARG_MAX_LEN + 1];
+};
+
+typedef int64_t (*sched_clock_t)(void* ctx);
+
+class JobHeap
+{
+private:
+    sched_job_t* jobs;
+    uint16_t capacity;
+    uint16_t count;
+    uint16_t next_id;
+
+    sched_clock_t clock;
+    void* clock_ctx;
+
+    uint32_t max_late_ms;
+    uint32_t skipped;
+
+    void swap(uint16_t a, uint16_t b);
+    void sift_up(uint16_t i);
+    void sift_down(uint16_t i);
+    void heapify();
+
+    // Moves the job at the top to its next run after now, or removes it if it runs once
+    void advance_top(int64_t now);
+
+public:
+    // @param storage       Array of capacity jobs, holding the heap
+    // @param clock         Returns the current time in milliseconds since the Unix epoch
+    // @param max_late_ms   Jobs found more overdue than this (e.g. after a reboot) are skipped instead of run
+    JobHeap(sched_job_t* storage, uint16_t capacity, sched_clock_t clock, void* ctx, uint32_t max_late_ms);
+
+    // Adds a copy of the job, and assigns it an id. Returns the id, or -1 if the heap is full
+    int add(const sched_job_t &job);
+
+    // Removes the job with the id. Returns false if there is none
+    bool remove(uint16_t id);
+
+    // Replaces the content of the heap with count jobs, keeping their ids. Jobs beyond the capacity are dropped
+    void load(const sched_job_t* list, uint16_t count);
+
+    // Returns the time in milliseconds until the next job is due, 0 if one is due, or -1 if there are no jobs
+    int64_t next_wait();
+
+    // Takes the next job that is due into out, and reschedules it if it repeats.
+    // Returns false if no job is due
+    bool pop_due(sched_job_t* out);
+
+    // Moves repeating jobs that are due to their next run after now, counting them as skipped. For after a reboot,
+    // when the next runs of repeating jobs were not kept and those due may have run already
+    void skip_due_repeats();
+
+    uint16_t size() { return count; }
+
+    // Jobs in heap order, not sorted by due time
+    const sched_job_t* at(uint16_t i) { return &jobs[i]; }
+
+    // Number of runs skipped for being more than max_late_ms overdue
+    uint32_t get_skipped() { return skipped; }
+};
+
+#endif
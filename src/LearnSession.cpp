@@ -0,0 +1,355 @@
+#include "LearnSession.h"
+
+#include "TaskConfig.h"
+#include "IRDenoise.h"
+#include "BinLog.h"
+
+#define TAG "session"
+
+// Compares two timing lists slot by slot, with the tolerance used for denoising
+static bool same_frame(const uint16_t* a, uint16_t a_len, const uint16_t* b, uint16_t b_len)
+{
+    if(a_len != b_len)
+        return false;
+
+    for(uint16_t i = 0; i < a_len; i++)
+    {
+        uint16_t high = a[i] > b[i] ? a[i] : b[i];
+        uint16_t diff = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+
+        if(diff > (uint32_t)high * DENOISE_CLUSTER_PERCENT / 100 + kRawTick)
+            return false;
+    }
+
+    return true;
+}
+
+void LearnSession::learn_task(void* param)
+{
+    LearnSession* session = (LearnSession*)param;
+
+    for(;;)
+    {
+        // Notified by start for each session
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        for(session->current = 0; session->current < session->count && !session->cancelled; session->current++)
+        {
+            learn_button_t* button = &session->buttons[session->current];
+
+            if(session->learn_button(button))
+                session->done_led->blink_once();
+
+            BLOGI("Button %s %s", button->name, button->status == LEARN_OK ? "learned" : "missed");
+
+            vTaskDelay(LEARN_BUTTON_GAP / portTICK_PERIOD_MS);
+        }
+
+        session->running = false;
+    }
+}
+
+bool LearnSession::capture_press(uint16_t* timings, uint16_t &len, learn_button_t* info)
+{
+    decode_results results;
+    uint32_t start = millis();
+
+    // A repeat code without a frame before it belongs to a button held since the last prompt
+    do
+    {
+        uint32_t elapsed = millis() - start;
+        if(elapsed >= LEARN_CAPTURE_TIMEOUT || cancelled)
+            return false;
+
+        if(!receiver->receive(&results, LEARN_CAPTURE_TIMEOUT - elapsed))
+            return false;
+    }
+    while(results.repeat);
+
+    // rawbuf is reused by the next capture, so everything is copied out first
+    ReceiveHandler::to_timings(&results, timings, kCaptureBufferSize, len, info->protocol);
+    info->value = results.value;
+    info->bits = results.bits;
+
+    // Frames following within LEARN_REPEAT_WINDOW come from the button being held
+    info->repeats = 0;
+    info->repeat_code = false;
+
+    while(receiver->receive(&results, LEARN_REPEAT_WINDOW))
+    {
+        if(info->repeats < UINT8_MAX)
+            info->repeats++;
+
+        if(results.repeat)
+            info->repeat_code = true;
+    }
+
+    return true;
+}
+
+bool LearnSession::is_duplicate(const learn_button_t* button, const uint16_t* timings, uint16_t len)
+{
+    for(uint8_t i = 0; i < current; i++)
+    {
+        const learn_button_t* other = &buttons[i];
+
+        if(other->status != LEARN_OK || other->protocol != button->protocol)
+            continue;
+
+        if(button->protocol != decode_type_t::UNKNOWN)
+        {
+            if(other->value == button->value && other->bits == button->bits)
+                return true;
+        }
+        else if(same_frame(other->timings, other->len, timings, len))
+            return true;
+    }
+
+    return false;
+}
+
+bool LearnSession::learn_button(learn_button_t* button)
+{
+    uint16_t* captures[DENOISE_MAX_CAPTURES] = {};
+    uint16_t lengths[DENOISE_MAX_CAPTURES];
+    uint8_t received = 0;
+    uint8_t attempts = 0;
+
+    learn_button_t press;
+
+    while(received < presses && attempts < LEARN_MAX_ATTEMPTS && !cancelled)
+    {
+        if(captures[received] == NULL)
+            captures[received] = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+
+        if(captures[received] == NULL)
+            break;
+
+        prompt_led->start_blinking();
+        bool pressed = capture_press(captures[received], lengths[received], received == 0 ? button : &press);
+        prompt_led->stop_blinking();
+
+        if(!pressed)
+        {
+            attempts++;
+            continue;
+        }
+
+        if(received == 0 && is_duplicate(button, captures[0], lengths[0]))
+        {
+            BLOGI("Button %s matches an earlier button, prompting again", button->name);
+            attempts++;
+            continue;
+        }
+
+        received++;
+    }
+
+    uint16_t* frame = NULL;
+    uint16_t len = 0;
+    int confidence = -1;
+
+    if(received > 0)
+        frame = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+
+    if(frame != NULL)
+    {
+        confidence = denoise_frames(captures, lengths, received, frame, &len);
+
+        // realloc to 0 bytes may free the frame and return NULL, so an empty result is dropped here
+        if(len == 0)
+        {
+            free(frame);
+            frame = NULL;
+            confidence = -1;
+        }
+    }
+
+    if(frame != NULL)
+    {
+        uint16_t* shrunk = (uint16_t*)realloc(frame, len * sizeof(uint16_t));
+        if(shrunk != NULL)
+            frame = shrunk;
+
+        if(store && codes->save(button->name, frame, len) != ESP_OK)
+            BLOGI("Could not store %s", button->name);
+    }
+
+    for(uint8_t i = 0; i < DENOISE_MAX_CAPTURES; i++)
+        free(captures[i]);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    button->timings = frame;
+    button->len = len;
+    button->confidence = confidence < 0 ? 0 : confidence;
+    button->status = frame != NULL ? LEARN_OK : LEARN_MISSED;
+
+    xSemaphoreGive(lock);
+
+    return frame != NULL;
+}
+
+void LearnSession::clear()
+{
+    if(buttons != NULL)
+    {
+        for(uint8_t i = 0; i < count; i++)
+            free(buttons[i].timings);
+
+        free(buttons);
+    }
+
+    buttons = NULL;
+    count = 0;
+    current = 0;
+}
+
+LearnSession::LearnSession(ReceiveHandler* recv, CodeStore* store, LedHandler* prompt, LedHandler* done)
+{
+    receiver    = recv;
+    codes       = store;
+    prompt_led  = prompt;
+    done_led    = done;
+
+    lock        = static_mutex_create(lock_storage);
+
+    learnTask_h = NULL;
+
+    running     = false;
+    cancelled   = false;
+    presses     = 1;
+    this->store = false;
+
+    buttons     = NULL;
+    count       = 0;
+    current     = 0;
+}
+
+esp_err_t LearnSession::start(const char* names, uint8_t presses, bool save)
+{
+    if(running)
+        return ESP_ERR_INVALID_STATE;
+
+    learn_button_t* list = (learn_button_t*)calloc(LEARN_MAX_BUTTONS, sizeof(learn_button_t));
+    if(list == NULL)
+        return ESP_ERR_NO_MEM;
+
+    uint8_t num = 0;
+    const char* name = names;
+
+    while(*name != '\0')
+    {
+        const char* end = strchr(name, '$');
+        size_t len = end != NULL ? end - name : strlen(name);
+
+        if(len == 0 || len > CODE_NAME_MAX_LEN || num == LEARN_MAX_BUTTONS)
+        {
+            free(list);
+            return ESP_FAIL;
+        }
+
+        memcpy(list[num].name, name, len);
+        list[num].name[len] = '\0';
+        list[num].status = LEARN_PENDING;
+        list[num].protocol = decode_type_t::UNKNOWN;
+        num++;
+
+        if(end == NULL)
+            break;
+
+        name = end + 1;
+    }
+
+    if(num == 0)
+    {
+        free(list);
+        return ESP_FAIL;
+    }
+
+    if(presses == 0)
+        presses = 1;
+    if(presses > DENOISE_MAX_CAPTURES)
+        presses = DENOISE_MAX_CAPTURES;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    // Checked again under the lock, as another request may have started a session since
+    if(running)
+    {
+        xSemaphoreGive(lock);
+        free(list);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    clear();
+    buttons = list;
+    count = num;
+
+    this->presses   = presses;
+    store           = save;
+    cancelled       = false;
+    running         = true;
+
+    // The task is created with the first session, and waits for the next one after each
+    if(learnTask_h == NULL)
+        learnTask_h = static_task_create(task_storage, learn_task, "learn session", this, SERVER_TASK_PRIO, SERVER_TASK_CORE);
+
+    if(learnTask_h == NULL)
+    {
+        clear();
+        running = false;
+        xSemaphoreGive(lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    xTaskNotifyGive(learnTask_h);
+    xSemaphoreGive(lock);
+
+    BLOGI("Learning %d buttons, %d presses each", num, presses);
+
+    return ESP_OK;
+}
+
+void LearnSession::cancel()
+{
+    cancelled = true;
+}
+
+void LearnSession::get_report(String &str)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    const char* state;
+    if(running)
+        state = "running";
+    else if(count == 0)
+        state = "idle";
+    else if(cancelled)
+        state = "cancelled";
+    else
+        state = "done";
+
+    str = String(state) + ";" + String(current) + ";" + String(count) + "\n";
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        learn_button_t* button = &buttons[i];
+
+        str += String(button->name) + ";";
+
+        if(button->status != LEARN_OK)
+        {
+            str += button->status == LEARN_PENDING ? "pending\n" : "missed\n";
+            continue;
+        }
+
+        str += "ok;" + uint64ToString(button->value, 16) + ";" + String(button->bits) + ";";
+        str += String(button->repeats) + ";" + String(button->repeat_code ? 1 : 0) + ";";
+        str += String(button->confidence) + ";";
+        ReceiveHandler::format_raw(str, button->protocol, button->timings, button->len);
+        str += "\n";
+    }
+
+    xSemaphoreGive(lock);
+}
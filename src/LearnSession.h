@@ -0,0 +1,102 @@
+#ifndef __UNIVERSALREMOTE_LEARN_SESSION__
+#define __UNIVERSALREMOTE_LEARN_SESSION__
+
+#include <Arduino.h>
+
+#include "IRHandlers.h"
+#include "IOHandlers.h"
+#include "CodeStore.h"
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
+#define LEARN_MAX_BUTTONS       64
+#define LEARN_MAX_ATTEMPTS      3                   // Times a button is prompted before it is skipped
+#define LEARN_CAPTURE_TIMEOUT   10000               // Time to wait for each press, in milliseconds
+#define LEARN_REPEAT_WINDOW     300                 // A frame arriving within this time of the previous one is a repeat
+#define LEARN_BUTTON_GAP        1000                // Pause between buttons, so that the prompt change can be seen
+
+enum learn_status_t
+{
+    LEARN_PENDING,                                  // Not reached yet
+    LEARN_OK,                                       // Captured
+    LEARN_MISSED                                    // No press, or only duplicates of other buttons, after LEARN_MAX_ATTEMPTS
+};
+
+struct learn_button_t
+{
+    char name[CODE_NAME_MAX_LEN + 1];
+    learn_status_t status;
+
+    decode_type_t protocol;
+    uint64_t value;                                 // Decoded value, for known protocols
+    uint16_t bits;
+
+    uint8_t repeats;                                // Frames received while the button was held
+    bool repeat_code;                               // The repeats were protocol repeat codes rather than full frames
+    uint8_t confidence;                             // From denoise_frames
+
+    uint16_t* timings;
+    uint16_t len;
+};
+
+// Learns a list of buttons one after another in the background, so that a whole remote
+// can be captured with one request. While waiting for a button the IR LED blinks, and the
+// WiFi LED blinks once when it has been captured.
+// - Frames received while the button is held are counted as repeats, not as new presses
+// - A press that matches a button already learned in the session is ignored and the button is prompted again
+class LearnSession
+{
+private:
+    ReceiveHandler* receiver;
+    CodeStore* codes;
+    LedHandler* prompt_led;
+    LedHandler* done_led;
+
+    TaskHandle_t learnTask_h;
+    static_task_t<LEARN_TASK_STACK> task_storage;
+    SemaphoreHandle_t lock;                         // Guards buttons against the report
+    StaticSemaphore_t lock_storage;
+
+    volatile bool running;
+    volatile bool cancelled;
+    uint8_t presses;                                // Presses captured and combined per button
+    bool store;                                     // Save each button in the code store
+
+    learn_button_t* buttons;
+    uint8_t count;
+    volatile uint8_t current;
+
+    static void learn_task(void* param);
+
+    // Captures one button. Returns false if it was missed
+    bool learn_button(learn_button_t* button);
+
+    // Waits for a press and the repeats following it, and puts the decoded value and repeat info into info.
+    // Returns false if there was no press
+    bool capture_press(uint16_t* timings, uint16_t &len, learn_button_t* info);
+
+    // Returns true if the capture matches a button learned earlier in the session
+    bool is_duplicate(const learn_button_t* button, const uint16_t* timings, uint16_t len);
+
+    void clear();
+
+public:
+    LearnSession(ReceiveHandler* recv, CodeStore* store, LedHandler* prompt, LedHandler* done);
+
+    // Starts learning the buttons in names, each followed by '$' as in CodeStore::list.
+    // Each button is pressed presses times (up to DENOISE_MAX_CAPTURES), and stored in the code store if save is set.
+    // Returns ESP_ERR_INVALID_STATE if a session is running, ESP_FAIL if a name is invalid,
+    // and ESP_ERR_NO_MEM if the session cannot be allocated
+    esp_err_t start(const char* names, uint8_t presses, bool save);
+
+    // Stops the session after the current capture
+    void cancel();
+
+    // Puts the state and the buttons learned so far into the passed string
+    // Format : <idle|running|done|cancelled>;<index of current button>;<number of buttons>
+    // followed by a line for each button, where the fields after the status are only present for learned buttons
+    // <name>;<pending|ok|missed>;<value in hex>;<bits>;<repeats>;<1 if repeat codes>;<confidence>;<format of ReceiveHandler::get_raw>
+    void get_report(String &str);
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include "MqttHandler.h"
+
+#include "TaskConfig.h"
+#include "BinLog.h"
+
+#define TAG "mqtt"
+
+esp_err_t MqttHandler::event_handler(esp_mqtt_event_handle_t event)
+{
+    MqttHandler* mqtt = (MqttHandler*)event->user_context;
+
+    switch(event->event_id)
+    {
+    case MQTT_EVENT_CONNECTED:
+    {
+        BLOGI("Connected");
+
+        char topic[MQTT_TOPIC_MAX_LEN];
+        snprintf(topic, sizeof(topic), "%scmd/#", mqtt->base);
+        esp_mqtt_client_subscribe(mqtt->client, topic, 1);
+
+        esp_mqtt_client_publish(mqtt->client, mqtt->status_topic, "online", 0, 1, 1);
+
+        mqtt->connected = true;
+        xTaskNotifyGive(mqtt->publishTask_h);
+        break;
+    }
+
+    case MQTT_EVENT_DISCONNECTED:
+        BLOGI("Disconnected");
+        mqtt->connected = false;
+        break;
+
+    case MQTT_EVENT_DATA:
+        mqtt->take_command(event);
+        break;
+
+    default:
+        break;
+    }
+
+    return ESP_OK;
+}
+
+void MqttHandler::take_command(esp_mqtt_event_handle_t event)
+{
+    size_t base_len = strlen(base);
+
+    // Messages larger than MQTT_BUFFER_SIZE arrive in pieces, and are not supported
+    if(event->current_data_offset != 0 || event->data_len != event->total_data_len)
+        return;
+
+    if(event->topic_len <= (int)base_len + 4 || event->topic_len >= MQTT_TOPIC_MAX_LEN ||
+       strncmp(event->topic, base, base_len) != 0 || strncmp(event->topic + base_len, "cmd/", 4) != 0)
+        return;
+
+    // The event points into the received packet. With QoS 1 and 2, the 16 bit packet id sits between the topic and the
+    // payload. The client does not pass on the DUP flag, so a redelivery is told by its packet id being the last one,
+    // with the same topic and payload
+    const uint8_t* packet_id = (const uint8_t*)event->topic + event->topic_len;
+    if(event->data == (const char*)packet_id + 2)
+    {
+        uint16_t id = (packet_id[0] << 8) | packet_id[1];
+
+        // FNV-1a over the topic and the payload
+        uint32_t hash = 2166136261u;
+        for(int i = 0; i < event->topic_len; i++)
+            hash = (hash ^ (uint8_t)event->topic[i]) * 16777619u;
+        for(int i = 0; i < event->data_len; i++)
+            hash = (hash ^ (uint8_t)event->data[i]) * 16777619u;
+
+        if(id == last_packet_id && hash == last_hash)
+        {
+            BLOGI("Dropped redelivered command %d", id);
+            duplicates++;
+            return;
+        }
+
+        last_packet_id = id;
+        last_hash = hash;
+    }
+
+    received++;
+
+    size_t type_len = event->topic_len - base_len - 4;
+
+    mqtt_cmd_t cmd;
+    cmd.type = (char*)malloc(type_len + 1);
+    cmd.payload = (char*)malloc(event->data_len + 1);
+
+    if(cmd.type == NULL || cmd.payload == NULL)
+    {
+        free(cmd.type);
+        free(cmd.payload);
+        dropped++;
+        return;
+    }
+
+    memcpy(cmd.type, event->topic + base_len + 4, type_len);
+    cmd.type[type_len] = '\0';
+    memcpy(cmd.payload, event->data, event->data_len);
+    cmd.payload[event->data_len] = '\0';
+
+    if(xQueueSend(commands, &cmd, 0) != pdTRUE)
+    {
+        publish_result(cmd.type, "Busy");
+        free(cmd.type);
+        free(cmd.payload);
+        dropped++;
+    }
+}
+
+// Runs the commands taken by the event handler, off the task of the MQTT client
+void MqttHandler::command_task(void* param)
+{
+    MqttHandler* mqtt = (MqttHandler*)param;
+    mqtt_cmd_t cmd;
+
+    for(;;)
+    {
+        xQueueReceive(mqtt->commands, &cmd, portMAX_DELAY);
+
+        mqtt->run_command(cmd.type, cmd.payload);
+
+        free(cmd.type);
+        free(cmd.payload);
+    }
+}
+
+void MqttHandler::publish_result(const char* name, const char* result)
+{
+    char topic[MQTT_TOPIC_MAX_LEN];
+    snprintf(topic, sizeof(topic), "%sresult", base);
+
+    String message = String(name) + ":" + result;
+    publish(topic, message.c_str(), message.length(), 1, false);
+}
+
+void MqttHandler::run_command(const char* type, const char* payload)
+{
+    char name[16];
+    uint8_t mask = 1;
+
+    // Optional channel selection after the command type
+    const char* channels = strchr(type, '/');
+    size_t len = channels != NULL ? channels - type : strlen(type);
+    if(len >= sizeof(name))
+        return;
+
+    memcpy(name, type, len);
+    name[len] = '\0';
+
+    if(channels != NULL)
+        mask = emitters->parse_mask(channels + 1);
+
+    esp_err_t ret = ESP_FAIL;
+
+    if(mask == 0)
+        ret = ESP_ERR_INVALID_ARG;
+    else if(strcmp(name, "raw") == 0)
+        ret = emitters->submit_raw(mask, payload);
+    else if(strcmp(name, "ac") == 0)
+        ret = emitters->submit_ac(mask, payload);
+    else if(strcmp(name, "code") == 0)
+    {
+        uint16_t* timings = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+        uint16_t count;
+
+        if(timings == NULL)
+            ret = ESP_ERR_NO_MEM;
+        else if(codes->load(payload, timings, kCaptureBufferSize, count) != ESP_OK)
+            ret = ESP_ERR_NOT_FOUND;
+        else
+            ret = emitters->submit_timings(mask, timings, count, kRawCarrierKhz);
+
+        free(timings);
+    }
+    else
+        return;
+
+    // Same responses as the http server
+    const char* result;
+    if(ret == ESP_OK)
+        result = "Success";
+    else if(ret == ESP_ERR_INVALID_ARG)
+        result = "Invalid channel";
+    else if(ret == ESP_ERR_NOT_FOUND)
+        result = "Not found";
+    else if(ret == ESP_ERR_TIMEOUT || ret == ESP_ERR_NO_MEM)
+        result = "Busy";
+    else
+        result = "Invalid format";
+
+    publish_result(name, result);
+}
+
+// Publishes the outbox while connected
+void MqttHandler::publish_task(void* param)
+{
+    MqttHandler* mqtt = (MqttHandler*)param;
+    mqtt_msg_t msg;
+
+    for(;;)
+    {
+        if(!mqtt->connected)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Taken off the outbox while it is published, so that publish cannot drop it as the oldest and free it
+        if(xQueueReceive(mqtt->outbox, &msg, portMAX_DELAY) != pdTRUE)
+            continue;
+
+        // Put back in front if the connection dropped meanwhile, unless newer messages have filled the outbox
+        if(esp_mqtt_client_publish(mqtt->client, msg.topic, msg.payload, msg.len, msg.qos, msg.retain) < 0)
+        {
+            mqtt->connected = false;
+
+            if(xQueueSendToFront(mqtt->outbox, &msg, 0) != pdTRUE)
+            {
+                free(msg.topic);
+                free(msg.payload);
+                mqtt->dropped++;
+            }
+            continue;
+        }
+
+        free(msg.topic);
+        free(msg.payload);
+
+        mqtt->published++;
+    }
+}
+
+void MqttHandler::publish(const char* topic, const char* payload, uint16_t len, uint8_t qos, bool retain)
+{
+    mqtt_msg_t msg;
+    msg.topic = strdup(topic);
+    msg.payload = (char*)malloc(len);
+    msg.len = len;
+    msg.qos = qos;
+    msg.retain = retain;
+
+    if(msg.topic == NULL || msg.payload == NULL)
+    {
+        free(msg.topic);
+        free(msg.payload);
+        dropped++;
+        return;
+    }
+
+    memcpy(msg.payload, payload, len);
+
+    while(xQueueSend(outbox, &msg, 0) != pdTRUE)
+    {
+        mqtt_msg_t oldest;
+        if(xQueueReceive(outbox, &oldest, 0) == pdTRUE)
+        {
+            free(oldest.topic);
+            free(oldest.payload);
+            dropped++;
+        }
+    }
+}
+
+// Publishes each frame received, in the format of GET "/"
+void MqttHandler::on_capture(const decode_results *results, int64_t received_us, void* ctx)
+{
+    MqttHandler* mqtt = (MqttHandler*)ctx;
+
+    uint16_t* timings = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+    if(timings == NULL)
+        return;
+
+    uint16_t len;
+    decode_type_t protocol;
+    ReceiveHandler::to_timings(results, timings, kCaptureBufferSize, len, protocol);
+
+    String message;
+    ReceiveHandler::format_raw(message, protocol, timings, len);
+
+    free(timings);
+
+    char topic[MQTT_TOPIC_MAX_LEN];
+    snprintf(topic, sizeof(topic), "%scapture", mqtt->base);
+
+    mqtt->publish(topic, message.c_str(), message.length(), 0, false);
+}
+
+MqttHandler::MqttHandler(ReceiveHandler* recv, EmitterChannels* send, CodeStore* store)
+{
+    receiver    = recv;
+    emitters    = send;
+    codes       = store;
+
+    client      = NULL;
+    outbox      = NULL;
+    publishTask_h = NULL;
+    connected   = false;
+
+    commands    = NULL;
+    commandTask_h = NULL;
+    last_packet_id = 0;
+    last_hash   = 0;
+
+    received    = 0;
+    published   = 0;
+    dropped     = 0;
+    duplicates  = 0;
+}
+
+esp_err_t MqttHandler::start(const char* uri, const char* hostname)
+{
+    if(client != NULL || uri[0] == '\0')
+        return ESP_FAIL;
+
+    snprintf(base, sizeof(base), "%s/%s/", MQTT_TOPIC_ROOT, hostname);
+    snprintf(status_topic, sizeof(status_topic), "%sstatus", base);
+
+    // Kept from an earlier attempt whose client could not be made, as their storage is in use
+    if(publishTask_h == NULL)
+    {
+        outbox = static_queue_create(outbox_storage);
+        publishTask_h = static_task_create(publish_task_storage, publish_task, "MQTT publish", this, SERVER_TASK_PRIO, SERVER_TASK_CORE);
+
+        commands = static_queue_create(commands_storage);
+        commandTask_h = static_task_create(command_task_storage, command_task, "MQTT commands", this, SERVER_TASK_PRIO, SERVER_TASK_CORE);
+    }
+
+    esp_mqtt_client_config_t config = {};
+    config.uri = uri;
+    config.client_id = hostname;
+    config.event_handle = event_handler;
+    config.user_context = this;
+    config.keepalive = MQTT_KEEPALIVE;
+    config.buffer_size = MQTT_BUFFER_SIZE;
+    config.lwt_topic = status_topic;
+    config.lwt_msg = "offline";
+    config.lwt_qos = 1;
+    config.lwt_retain = 1;
+    config.task_prio = SERVER_TASK_PRIO;
+
+    client = esp_mqtt_client_init(&config);
+    if(client == NULL)
+        return ESP_FAIL;
+
+    // The broker URI may hold a user name and password
+    const char* host = strchr(uri, '@');
+    BLOGI("Connecting to %s as %s", host != NULL ? host + 1 : uri, hostname);
+
+    receiver->add_listener(on_capture, this);
+
+    return esp_mqtt_client_start(client);
+}
+
+void MqttHandler::get_status(ArenaText &text)
+{
+    text.addf("connected=%d,received=%u,published=%u,dropped=%u,outbox=%u,duplicates=%u", connected ? 1 : 0, received,
+              published, dropped, outbox != NULL ? (unsigned)uxQueueMessagesWaiting(outbox) : 0, duplicates);
+}
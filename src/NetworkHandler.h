@@ -10,23 +10,101 @@
 
 #include <IRHandlers.h>
 #include <IOHandlers.h>
+#include <IRChannels.h>
+#include <Benchmark.h>
+#include <CodeStore.h>
+#include <LearnSession.h>
+#include <Scheduler.h>
+#include <RuleEngine.h>
+#include <Repeater.h>
+#include <MqttHandler.h>
+#include <CorpusRecorder.h>
+#include <RequestWorkers.h>
+#include <UdpCommands.h>
 
 // NVS namespace, ssid and password keys
 #define NVS_NAMESPACE           "wifiConfig"
 #define NVS_SSID_KEY            "ssid"
 #define NVS_PASSWORD_KEY        "password"
 #define NVS_HOSTNAME_KEY        "hostname"
+#define NVS_MQTT_KEY            "mqtt"
 
 // http server url's
+#define HTTP_MAX_URI_HANDLERS   48
 #define HTTP_RAW_SEND_URI       "/"
 #define HTTP_GET_URI            "/"
 #define HTTP_AC_SEND_URI        "/ac"
 #define HTTP_WIFI_SCAN_URI      "/scan"
 #define HTTP_WIFI_CONFIG_URI    "/wificonfig"
+#define HTTP_WIFI_STATUS_URI    "/wifistatus"
+#define HTTP_CHANNELS_URI       "/channels"
+#define HTTP_BENCH_URI          "/bench"
+#define HTTP_LEARN_URI          "/learn"
+#define HTTP_CODES_URI          "/codes"
+#define HTTP_CODE_URI           "/code"
+#define HTTP_CODE_SEND_URI      "/code/send"
+#define HTTP_CODE_DELETE_URI    "/code/delete"
+#define HTTP_PACKED_URI         "/packed"
+#define HTTP_PRONTO_URI         "/pronto"
+#define HTTP_SESSION_URI        "/session"
+#define HTTP_SESSION_CANCEL_URI "/session/cancel"
+#define HTTP_SCHEDULE_URI       "/schedule"
+#define HTTP_SCHEDULE_DELETE_URI "/schedule/delete"
+#define HTTP_RULES_URI          "/rules"
+#define HTTP_RULES_DELETE_URI   "/rules/delete"
+#define HTTP_REPEATER_URI       "/repeater"
+#define HTTP_MQTT_URI           "/mqtt"
+#define HTTP_CORPUS_URI         "/corpus"
+#define HTTP_CORPUS_STOP_URI    "/corpus/stop"
+#define HTTP_HEAP_URI           "/heap"
+#define HTTP_WORKERS_URI        "/workers"
+#define HTTP_UDP_URI            "/udp"
+#define HTTP_PROTOCOLS_URI      "/protocols"
+#define HTTP_TASKS_URI          "/tasks"
+
+// mDNS service advertising the UDP command port
+#define MDNS_UDP_SERVICE        "_irremote"
+#define MDNS_UDP_PROTO          "_udp"
+
+// Maximum length of Pronto hex content, 5 characters per word
+#define PRONTO_MAX_STR_LEN      (5 * (kCaptureBufferSize + 5))
 
 // wifi IP address in configuration phase
 #define WIFI_CONFIG_IP          "192.168.1.1"
 #define WIFI_TIMEOUT            10
+#define WIFI_AP_GRACE_PER       5000                // Time for which the AP is kept up after provisioning, so that clients can read the status
+
+// Maximum lengths of the provisioning record fields (excluding null termination)
+#define WIFI_SSID_MAX_LEN       32
+#define WIFI_PASSWORD_MAX_LEN   64
+#define WIFI_HOSTNAME_MAX_LEN   63
+
+// Endpoints run on the request workers, with the requests of each that can be queued or running at once.
+// Captures wait for the receiver in turn anyway, and all of them together get WORKER_LONG_LIMIT,
+// so that GET "/scan" always finds a worker.
+enum worker_endpoint_id_t
+{
+    WORKER_GET_RAW,
+    WORKER_LEARN,
+    WORKER_PACKED_GET,
+    WORKER_PRONTO_GET,
+    WORKER_SCAN
+};
+
+#define WORKER_GET_RAW_LIMIT    WORKER_LONG_LIMIT
+#define WORKER_LEARN_LIMIT      1
+#define WORKER_PACKED_GET_LIMIT 1
+#define WORKER_PRONTO_GET_LIMIT 1
+#define WORKER_SCAN_LIMIT       1
+
+// States of the background provisioning, reported by HTTP_WIFI_STATUS_URI
+enum prov_state_t
+{
+    PROV_IDLE,                                      // No configuration received yet
+    PROV_CONNECTING,                                // Trying to connect with the received configuration
+    PROV_CONNECTED,                                 // Connected, configuration saved and station mode started
+    PROV_FAILED                                     // Could not connect. A new configuration can be sent
+};
 
 class WiFiHandler
 {
@@ -34,26 +112,126 @@ private:
     static nvs_handle nvs_wifi;
     
     static esp_err_t http_get_handler(httpd_req_t* req);
+    static esp_err_t http_learn_handler(httpd_req_t* req);
     static esp_err_t http_post_handler(httpd_req_t *req);
     static esp_err_t http_ac_post_handler(httpd_req_t *req);
 
+    static esp_err_t http_channels_get_handler(httpd_req_t *req);
+    static esp_err_t http_channels_post_handler(httpd_req_t *req);
+
+    static esp_err_t http_codes_handler(httpd_req_t *req);
+    static esp_err_t http_code_get_handler(httpd_req_t *req);
+    static esp_err_t http_code_post_handler(httpd_req_t *req);
+    static esp_err_t http_code_send_handler(httpd_req_t *req);
+    static esp_err_t http_code_delete_handler(httpd_req_t *req);
+
+    static esp_err_t http_packed_get_handler(httpd_req_t *req);
+    static esp_err_t http_packed_post_handler(httpd_req_t *req);
+
+    static esp_err_t http_pronto_get_handler(httpd_req_t *req);
+    static esp_err_t http_pronto_post_handler(httpd_req_t *req);
+
+    static esp_err_t http_session_get_handler(httpd_req_t *req);
+    static esp_err_t http_session_post_handler(httpd_req_t *req);
+    static esp_err_t http_session_cancel_handler(httpd_req_t *req);
+
+    static esp_err_t http_schedule_get_handler(httpd_req_t *req);
+    static esp_err_t http_schedule_post_handler(httpd_req_t *req);
+    static esp_err_t http_schedule_delete_handler(httpd_req_t *req);
+
+    static esp_err_t http_rules_get_handler(httpd_req_t *req);
+    static esp_err_t http_rules_post_handler(httpd_req_t *req);
+    static esp_err_t http_rules_delete_handler(httpd_req_t *req);
+
+    static esp_err_t http_repeater_get_handler(httpd_req_t *req);
+    static esp_err_t http_repeater_post_handler(httpd_req_t *req);
+
+    static esp_err_t http_mqtt_handler(httpd_req_t *req);
+
+    static esp_err_t http_corpus_get_handler(httpd_req_t *req);
+    static esp_err_t http_corpus_post_handler(httpd_req_t *req);
+    static esp_err_t http_corpus_stop_handler(httpd_req_t *req);
+
+    static esp_err_t http_heap_handler(httpd_req_t *req);
+    static esp_err_t http_workers_handler(httpd_req_t *req);
+
+    static esp_err_t http_udp_get_handler(httpd_req_t *req);
+    static esp_err_t http_udp_post_handler(httpd_req_t *req);
+
+    static esp_err_t http_protocols_handler(httpd_req_t *req);
+
+    static esp_err_t http_tasks_handler(httpd_req_t *req);
+
+    // Slow requests, run on the request workers
+    static const char* worker_get_raw(Arena &arena, uint32_t arg, const void* data, size_t &len);
+    static const char* worker_learn(Arena &arena, uint32_t arg, const void* data, size_t &len);
+    static const char* worker_packed_get(Arena &arena, uint32_t arg, const void* data, size_t &len);
+    static const char* worker_pronto_get(Arena &arena, uint32_t arg, const void* data, size_t &len);
+    static const char* worker_scan(Arena &arena, uint32_t arg, const void* data, size_t &len);
+
+    static esp_err_t http_bench_get_handler(httpd_req_t *req);
+    static esp_err_t http_bench_post_handler(httpd_req_t *req);
+
     static esp_err_t http_scan_handler(httpd_req_t *req);
     static esp_err_t http_config_handler(httpd_req_t *req);
+    static esp_err_t http_status_handler(httpd_req_t *req);
 
     static esp_err_t config_network(const char* str);
+    static void provision_task(void* param);
+    static void wifi_event_handler(WiFiEvent_t event, WiFiEventInfo_t info);
+
+    static uint8_t get_channel_mask(httpd_req_t *req);
+
+    static esp_err_t start_server();
+    static void register_ir_uris();
     static esp_err_t connect_to_network(const char* ssid,const char* password);
     static esp_err_t start_mdns(const char* hostname);
+    static void update_mdns_udp();
+
+    static bool mode;
 
-    bool mode;
+    static httpd_handle_t server;
+
+    static volatile prov_state_t prov_state;
+    static volatile uint32_t prov_attempt;          // Counts the attempts started by config_network
+    static TaskHandle_t provTask_h;
+    static static_task_t<PROV_TASK_STACK> prov_task_storage;
+    static char prov_ssid[WIFI_SSID_MAX_LEN + 1];
+    static char prov_password[WIFI_PASSWORD_MAX_LEN + 1];
+    static char prov_hostname[WIFI_HOSTNAME_MAX_LEN + 1];
+    static char prov_mqtt[MQTT_URI_MAX_LEN + 1];
 
     static LedHandler *WiFiled;
     static LedHandler *IRled;
 
-    static SendHandler *sender;
+    static EmitterChannels *emitters;
     static ReceiveHandler *receiver;
 
+    static CodeStore *codes;
+
+    static LearnSession *session;
+
+    static Scheduler *scheduler;
+
+    static RuleEngine *rules;
+
+    static Repeater *repeater;
+
+    static MqttHandler *mqtt;
+
+    static CorpusRecorder *corpus;
+
+    static RequestWorkers *workers;
+
+    static UdpCommands *udp;
+
+    static IRBenchmark *benchmark;
+
 public:
-    WiFiHandler(LedHandler *wifi, LedHandler *ir, SendHandler *send, ReceiveHandler *recv);
+    // @param bench   Registers the benchmark URIs if not NULL
+    WiFiHandler(LedHandler *wifi, LedHandler *ir, EmitterChannels *send, ReceiveHandler *recv, CodeStore *store,
+                LearnSession *learn, Scheduler *sched, RuleEngine *rule_engine, Repeater *relay, MqttHandler *broker,
+                CorpusRecorder *recorder, RequestWorkers *pool, UdpCommands *fast_path, IRBenchmark *bench = NULL);
     
     bool is_configured();
 
@@ -1,160 +1,1016 @@
 #include "Arduino.h"
 #include "WiFi.h"
 #include "ESPmDNS.h"
+#include "mdns.h"
 
 #include "NetworkHandler.h"
 
 #include "nvs_flash.h"
 
-// Handler function for http get requests for raw messages
+#include "TaskConfig.h"
+#include "IRCompress.h"
+#include "Pronto.h"
+#include "RequestArena.h"
+#include "IRProtocols.h"
+#include "StaticTasks.h"
+#include "BinLog.h"
+
+#define TAG "wifi"
+
+bool WiFiHandler::mode                          = false;
+httpd_handle_t WiFiHandler::server              = NULL;
+volatile prov_state_t WiFiHandler::prov_state   = PROV_IDLE;
+volatile uint32_t WiFiHandler::prov_attempt     = 0;
+TaskHandle_t WiFiHandler::provTask_h            = NULL;
+static_task_t<PROV_TASK_STACK> WiFiHandler::prov_task_storage;
+char WiFiHandler::prov_ssid[WIFI_SSID_MAX_LEN + 1];
+char WiFiHandler::prov_password[WIFI_PASSWORD_MAX_LEN + 1];
+char WiFiHandler::prov_hostname[WIFI_HOSTNAME_MAX_LEN + 1];
+char WiFiHandler::prov_mqtt[MQTT_URI_MAX_LEN + 1];
+
+// Gets the value of a query parameter. Returns ESP_ERR_NOT_FOUND if it is not present
+static esp_err_t get_query_value(httpd_req_t *req, const char* key, char* value, size_t size)
+{
+    char query[128];
+
+    if(httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK)
+        return ESP_ERR_NOT_FOUND;
+
+    return httpd_query_key_value(query, key, value, size);
+}
+
+static_assert(sizeof(capture_params_t) <= WORKER_DATA_SIZE, "Capture parameters are passed to the request workers");
+
+// Gets the capture parameters from the query. Parameters that are not present keep their defaults,
+// and values out of their limits are clamped :
+// timeout (ms), buffer (entries), min (entries of the smallest frame), gap (ms), adaptive (0/1),
+// protocol (name as in the captures), frames (1 or 2)
+static void get_capture_params(httpd_req_t *req, capture_params_t &params)
+{
+    char value[32];
+
+    ReceiveHandler::default_params(params);
+
+    if(get_query_value(req, "timeout", value, sizeof(value)) == ESP_OK)
+        params.timeout_ms = strtoul(value, NULL, 10);
+    if(get_query_value(req, "buffer", value, sizeof(value)) == ESP_OK)
+        params.buffer_size = atoi(value);
+    if(get_query_value(req, "min", value, sizeof(value)) == ESP_OK)
+        params.min_unknown = atoi(value);
+    if(get_query_value(req, "gap", value, sizeof(value)) == ESP_OK)
+        params.gap_ms = constrain(atoi(value), 0, UINT8_MAX);
+    if(get_query_value(req, "adaptive", value, sizeof(value)) == ESP_OK)
+        params.adaptive = atoi(value) != 0;
+    if(get_query_value(req, "protocol", value, sizeof(value)) == ESP_OK)
+        params.protocol = strToDecodeType(value);
+    if(get_query_value(req, "frames", value, sizeof(value)) == ESP_OK)
+        params.frames = constrain(atoi(value), 0, UINT8_MAX);
+
+    ReceiveHandler::clamp_params(params);
+}
+
+// Handler function for http get requests for raw messages. The capture is set by the query, see get_capture_params
 esp_err_t WiFiHandler::http_get_handler(httpd_req_t* req)
 {
     WiFiled->blink_once();
 
-    String resp;
+	BLOGD("Got a get request");
+
+    capture_params_t params;
+    get_capture_params(req, params);
+
+    workers->submit(req, WORKER_GET_RAW, 0, &params, sizeof(params));
+
+	return ESP_OK;
+}
+
+// Captures a message for GET "/". Runs on a request worker
+const char* WiFiHandler::worker_get_raw(Arena &arena, uint32_t arg, const void* data, size_t &len)
+{
+    char* resp = NULL;
+
+    IRled->start_blinking();
+    
+    esp_err_t ret = receiver->get_raw(arena, resp, *(const capture_params_t*)data);
+
+    IRled->stop_blinking();
+
+    if(ret != ESP_OK)
+        resp = (char*)"-1";
+
+    BLOGD("Sending response, %u bytes", strlen(resp));
+
+    len = strlen(resp);
+
+    return resp;
+}
+
+// Handler function for http get requests for learning a button from several captures.
+// The number of captures is given by the "n" query parameter, and each capture is set as for GET "/"
+esp_err_t WiFiHandler::http_learn_handler(httpd_req_t* req)
+{
+    WiFiled->blink_once();
+
+    char value[8];
+    uint8_t count = 3;
+
+    if(get_query_value(req, "n", value, sizeof(value)) == ESP_OK)
+        count = atoi(value);
+
+    capture_params_t params;
+    get_capture_params(req, params);
+
+    workers->submit(req, WORKER_LEARN, count, &params, sizeof(params));
+
+    return ESP_OK;
+}
+
+// Captures a button arg times for GET "/learn". Runs on a request worker
+const char* WiFiHandler::worker_learn(Arena &arena, uint32_t arg, const void* data, size_t &len)
+{
+    char* resp = NULL;
+
+    IRled->start_blinking();
+
+    esp_err_t ret = receiver->learn(arena, resp, arg, *(const capture_params_t*)data);
+
+    IRled->stop_blinking();
+
+    if(ret != ESP_OK)
+        resp = (char*)"-1";
+
+    BLOGD("Sending response, %u bytes", strlen(resp));
+
+    len = strlen(resp);
+
+    return resp;
+}
+
+// Receives the request content into the buffer and null terminates it. Content longer than the buffer is truncated.
+// Returns the length received, or -1 if the connection failed, in which case the handler should return ESP_FAIL
+static int read_content(httpd_req_t *req, char* content, size_t size)
+{
+    size_t recv_size = req->content_len;
+    if(recv_size > size - 1) recv_size = size - 1;
+
+    size_t received = 0;
+
+    // The content may arrive in several parts
+    while(received < recv_size)
+    {
+        int ret = httpd_req_recv(req, content + received, recv_size - received);
+
+        if (ret <= 0) 
+        {
+            // Send a request timed out error code (408) if connection timedout
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+                httpd_resp_send_408(req);
+            return -1;
+        }
+
+        received += ret;
+    }
+
+    if(received == 0)
+        return -1;
+
+    content[received] = '\0';
+
+    return received;
+}
+
+// Receives the request content into a buffer from the arena, sized to the content but no more than max_size
+// with the null termination. Returns NULL with received set to -1 if the connection failed, in which case
+// the handler should return ESP_FAIL, or to 0 if the arena is full, in which case "Busy" has been sent.
+static char* read_content(httpd_req_t *req, Arena* arena, size_t max_size, int &received)
+{
+    size_t size = req->content_len + 1 < max_size ? req->content_len + 1 : max_size;
+    char* content = arena != NULL ? arena->alloc_array<char>(size) : NULL;
+
+    received = 0;
+
+    if(content == NULL)
+    {
+        httpd_resp_send(req, "Busy", strlen("Busy"));
+        return NULL;
+    }
+
+    received = read_content(req, content, size);
+
+    return received < 0 ? NULL : content;
+}
+
+// Sends the text that fill puts together in an arena, or "Busy" if all the arenas are in use.
+// Responses longer than an arena are cut, with a warning
+template<typename F> static esp_err_t send_text(httpd_req_t *req, F fill)
+{
+    RequestArena arena;
+
+    if(arena.get() == NULL)
+    {
+        httpd_resp_send(req, "Busy", strlen("Busy"));
+        return ESP_OK;
+    }
+
+    ArenaText text(*arena.get());
+    fill(text);
+
+    if(text.is_cut())
+        BLOGW("Response cut at %u bytes", (unsigned)text.length());
+
+    httpd_resp_send(req, text.c_str(), text.length());
+
+    return ESP_OK;
+}
+
+// Gets the channels selected by the "ch" query parameter. Channel 0 is used if there is none.
+// Returns 0 if the selection is invalid
+uint8_t WiFiHandler::get_channel_mask(httpd_req_t *req)
+{
+    char value[32];
+
+    if(get_query_value(req, "ch", value, sizeof(value)) != ESP_OK)
+        return 1;
+
+    return emitters->parse_mask(value);
+}
+
+// Sends the response for a message queued on the emitter channels
+static void send_submit_response(httpd_req_t *req, esp_err_t ret)
+{
+    const char* resp;
+
+    if(ret == ESP_FAIL)
+        resp = "Invalid format";
+    else if(ret == ESP_ERR_TIMEOUT || ret == ESP_ERR_NO_MEM)
+        resp = "Busy";
+    else
+        resp = "Success";
+
+    BLOGD("Sending response : %s", resp);
+    
+    httpd_resp_send(req, resp, strlen(resp));
+}
+
+// Handler function for http post messages for raw messages
+esp_err_t WiFiHandler::http_post_handler(httpd_req_t *req)
+{
+    WiFiled->blink_once();
+    
+    RequestArena arena;
+    int received;
+
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
+    
+    BLOGD("Got a post request to /, %d bytes", received);
+
+    uint8_t mask = get_channel_mask(req);
+    if(mask == 0)
+    {
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+        return ESP_OK;
+    }
+
+    IRled->blink_once();
+    
+    send_submit_response(req, emitters->submit_raw(mask, content));
+
+    return ESP_OK;
+}
+
+// Handler function for http post message type, for AC messages
+esp_err_t WiFiHandler::http_ac_post_handler(httpd_req_t *req)
+{
+    WiFiled->blink_once();
+    
+    RequestArena arena;
+    int received;
+
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
+    
+    BLOGD("Got a post request to /ac, %d bytes", received);
+
+    uint8_t mask = get_channel_mask(req);
+    if(mask == 0)
+    {
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+        return ESP_OK;
+    }
+
+    IRled->blink_once();
+
+    send_submit_response(req, emitters->submit_ac(mask, content));
+
+    return ESP_OK;
+}
+
+// Returns the emitter channel statistics
+// Format : <channel>,<pin>,<enabled>,<queue depth>,<sent>,<failed>,<dropped>,<average transmit time in us> per line
+esp_err_t WiFiHandler::http_channels_get_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { emitters->get_stats(text); });
+}
+
+// Sets the emitter pins
+// Format : <pin of channel 0>,<pin of channel 1>,...
+esp_err_t WiFiHandler::http_channels_post_handler(httpd_req_t *req)
+{
+    RequestArena arena;
+    int received;
+
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
+
+    const char* resp = (emitters->configure(content) == ESP_OK) ? "Success" : "Invalid format";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Returns the result of the last benchmark run
+// Format : frames=<sent>,received=<received>;emit_us=<p50>,<p99>,<max>;capture_us=<p50>,<p99>,<max>
+esp_err_t WiFiHandler::http_bench_get_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { benchmark->get_report(text); });
+}
+
+// Starts a benchmark run. The number of frames is given by the "n" query parameter
+esp_err_t WiFiHandler::http_bench_post_handler(httpd_req_t *req)
+{
+    char value[8];
+    uint16_t frames = 20;
+
+    if(get_query_value(req, "n", value, sizeof(value)) == ESP_OK)
+        frames = atoi(value);
+
+    const char* resp = (benchmark->start(frames) == ESP_OK) ? "Started" : "Busy";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Returns the state of the learning session and the buttons learned so far. Built on the heap, as the raw frames of
+// LEARN_MAX_BUTTONS buttons do not fit in an arena
+esp_err_t WiFiHandler::http_session_get_handler(httpd_req_t *req)
+{
+    String response;
+
+    session->get_report(response);
+
+    httpd_resp_send(req, response.c_str(), response.length());
+
+    return ESP_OK;
+}
+
+// Starts a learning session for the button names in the content, each followed by '$'.
+// The "n" query parameter sets the presses per button, and "store=1" saves the buttons in the code store
+esp_err_t WiFiHandler::http_session_post_handler(httpd_req_t *req)
+{
+    WiFiled->blink_once();
+
+    RequestArena arena;
+    int received;
+
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
+
+    char value[8];
+    uint8_t presses = 1;
+    bool store = false;
+
+    if(get_query_value(req, "n", value, sizeof(value)) == ESP_OK)
+        presses = atoi(value);
+
+    if(get_query_value(req, "store", value, sizeof(value)) == ESP_OK)
+        store = atoi(value) > 0;
+
+    esp_err_t ret = session->start(content, presses, store);
+
+    const char* resp;
+    if(ret == ESP_OK)
+        resp = "Started";
+    else if(ret == ESP_ERR_INVALID_STATE || ret == ESP_ERR_NO_MEM)
+        resp = "Busy";
+    else
+        resp = "Invalid format";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Stops the learning session after the current capture
+esp_err_t WiFiHandler::http_session_cancel_handler(httpd_req_t *req)
+{
+    session->cancel();
+
+    httpd_resp_send(req, "Success", strlen("Success"));
+
+    return ESP_OK;
+}
+
+// Returns the clock state and the scheduled jobs
+esp_err_t WiFiHandler::http_schedule_get_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { scheduler->list(text); });
+}
+
+// Adds a scheduled job for the channels given by "ch", and returns its id
+// Format : <first run in seconds since the Unix epoch>,<period in seconds, 0 to run once>,<code|ac>,<code name or AC state>
+esp_err_t WiFiHandler::http_schedule_post_handler(httpd_req_t *req)
+{
+    RequestArena arena;
+    int received;
+
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
+
+    uint8_t mask = get_channel_mask(req);
+    if(mask == 0)
+    {
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+        return ESP_OK;
+    }
+
+    int id = scheduler->add(mask, content);
+
+    char response[16];
+    if(id < 0)
+        strcpy(response, "Invalid format");
+    else
+        snprintf(response, sizeof(response), "%d", id);
+
+    httpd_resp_send(req, response, strlen(response));
+
+    return ESP_OK;
+}
+
+// Removes the scheduled job given by the "id" query parameter
+esp_err_t WiFiHandler::http_schedule_delete_handler(httpd_req_t *req)
+{
+    char value[8];
+
+    const char* resp = "Not found";
+
+    if(get_query_value(req, "id", value, sizeof(value)) == ESP_OK && scheduler->remove(atoi(value)) == ESP_OK)
+        resp = "Success";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Returns the rules and their statistics
+esp_err_t WiFiHandler::http_rules_get_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { rules->list(text); });
+}
+
+// Adds a rule whose actions are sent on the channels given by "ch", and returns its id
+// Format : <protocol>,<value in hex>,<bits>;<action>;<action>..., each action code:<stored code name> or ac:<AC state>
+esp_err_t WiFiHandler::http_rules_post_handler(httpd_req_t *req)
+{
+    RequestArena arena;
+    int received;
+
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
+
+    uint8_t mask = get_channel_mask(req);
+    if(mask == 0)
+    {
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+        return ESP_OK;
+    }
+
+    uint16_t id;
+    esp_err_t ret = rules->add(mask, content, id);
+
+    char response[16];
+    if(ret == ESP_OK)
+        snprintf(response, sizeof(response), "%u", id);
+    else if(ret == ESP_ERR_NOT_FOUND)
+        strcpy(response, "Not found");
+    else if(ret == ESP_ERR_NO_MEM)
+        strcpy(response, "Busy");
+    else
+        strcpy(response, "Invalid format");
+
+    httpd_resp_send(req, response, strlen(response));
+
+    return ESP_OK;
+}
+
+// Removes the rule given by the "id" query parameter
+esp_err_t WiFiHandler::http_rules_delete_handler(httpd_req_t *req)
+{
+    char value[8];
+
+    const char* resp = "Not found";
+
+    if(get_query_value(req, "id", value, sizeof(value)) == ESP_OK && rules->remove(atoi(value)) == ESP_OK)
+        resp = "Success";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Returns the repeater settings and statistics
+esp_err_t WiFiHandler::http_repeater_get_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { repeater->get_report(text); });
+}
+
+// Turns the repeater on with "enable=1" or off with "enable=0". Frames are repeated on the channels given by "ch",
+// with the carrier given by "khz" (in kHz, or in Hz if above 1000)
+esp_err_t WiFiHandler::http_repeater_post_handler(httpd_req_t *req)
+{
+    char value[12];
+    bool enable = true;
+    uint32_t hz = kRawCarrierKhz * 1000;
+
+    if(get_query_value(req, "enable", value, sizeof(value)) == ESP_OK)
+        enable = atoi(value) > 0;
+
+    // As in the UDP commands, values below 1000 are in kHz. Out of range values are rejected by configure
+    if(get_query_value(req, "khz", value, sizeof(value)) == ESP_OK)
+    {
+        char* end;
+        unsigned long khz = strtoul(value, &end, 10);
+
+        hz = (end == value || *end != '\0' || khz > kMaxCarrierHz) ? 0 : (khz < 1000 ? khz * 1000 : khz);
+    }
+
+    uint8_t mask = get_channel_mask(req);
+    if(mask == 0)
+    {
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+        return ESP_OK;
+    }
+
+    esp_err_t ret = repeater->configure(enable, mask, hz);
+
+    const char* resp;
+    if(ret == ESP_OK)
+        resp = "Success";
+    else if(ret == ESP_ERR_NO_MEM)
+        resp = "Busy";
+    else
+        resp = "Invalid format";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Returns the MQTT connection state and statistics
+// Format : connected=<0|1>,received=<n>,published=<n>,dropped=<n>,outbox=<n>
+esp_err_t WiFiHandler::http_mqtt_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { mqtt->get_status(text); });
+}
+
+// Returns the recorded corpus as a binary file, in the format of src/Corpus.h, or "running" while recording
+esp_err_t WiFiHandler::http_corpus_get_handler(httpd_req_t *req)
+{
+    size_t size;
+    const uint8_t* data = corpus->get(size);
+
+    if(data == NULL)
+    {
+        const char* resp = corpus->is_recording() ? "running" : "Not found";
+        httpd_resp_send(req, resp, strlen(resp));
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_send(req, (const char*)data, size);
+
+    return ESP_OK;
+}
+
+// Starts recording the number of frames given by the "n" query parameter
+esp_err_t WiFiHandler::http_corpus_post_handler(httpd_req_t *req)
+{
+    char value[8];
+    uint16_t frames = 50;
+
+    if(get_query_value(req, "n", value, sizeof(value)) == ESP_OK)
+        frames = atoi(value);
+
+    const char* resp = (corpus->start(frames) == ESP_OK) ? "Started" : "Busy";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Stops recording, keeping the frames recorded so far
+esp_err_t WiFiHandler::http_corpus_stop_handler(httpd_req_t *req)
+{
+    corpus->stop();
+
+    httpd_resp_send(req, "Success", strlen("Success"));
+
+    return ESP_OK;
+}
+
+// Returns the heap fragmentation and request arena statistics
+// Format : free=<bytes>,min_free=<bytes>,largest=<bytes>,frag=<percent>;arenas=<in use>/<count>,size=<bytes>,peak=<bytes>,requests=<n>,exhausted=<n>
+esp_err_t WiFiHandler::http_heap_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { RequestArena::get_report(text); });
+}
+
+// Returns the IR protocols enabled in this build and the decode statistics
+// Format : decoders=<names>;senders=<names>;decoded=<frames>;decode_us=<average>;gaps=<protocol>:<ms>,...
+esp_err_t WiFiHandler::http_protocols_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text)
+    {
+        ir_protocols_report(text);
+        text.add(";");
+        receiver->get_report(text);
+    });
+}
+
+// Returns the request worker statistics, a line per endpoint
+// Format : <name>,<active>,<limit>,<peak>,<accepted>,<rejected>,<completed>,<average queue wait in us>,<average run time in us>
+esp_err_t WiFiHandler::http_workers_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { workers->get_report(text); });
+}
+
+// Returns the stack size of the long-lived tasks and the least free stack each has had since boot, a line per task
+// Format : <name>,<stack size>,<least free stack>[,low]
+esp_err_t WiFiHandler::http_tasks_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { static_tasks_report(text); });
+}
+
+// Returns the UDP command settings and statistics
+// Format : enabled=<0|1>,port=<port>,next_seq=<n>;received=<n>,accepted=<n>,bad_mac=<n>,invalid=<n>,duplicate=<n>,stale=<n>;latency_us=<last>,<max>
+esp_err_t WiFiHandler::http_udp_get_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { udp->get_report(text); });
+}
+
+// Turns the UDP commands on with "enable=1" or off with "enable=0", on the port given by "port".
+// The content, if any, is the new shared key in hex
+esp_err_t WiFiHandler::http_udp_post_handler(httpd_req_t *req)
+{
+    char value[8];
+    bool enable = true;
+    uint16_t port = UDP_DEFAULT_PORT;
+
+    if(get_query_value(req, "enable", value, sizeof(value)) == ESP_OK)
+        enable = atoi(value) > 0;
+
+    if(get_query_value(req, "port", value, sizeof(value)) == ESP_OK)
+        port = atoi(value);
+
+    char key[2 * UDP_KEY_MAX_LEN + 1];
+    bool has_key = req->content_len > 0;
+
+    if(has_key && read_content(req, key, sizeof(key)) < 0)
+        return ESP_FAIL;
+
+    const char* resp;
+
+    // A longer key would have been truncated
+    if(req->content_len >= sizeof(key) || udp->configure(enable, port, has_key ? key : NULL) != ESP_OK)
+        resp = "Invalid format";
+    else
+        resp = "Success";
+
+    update_mdns_udp();
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Returns the names of the stored codes, each followed by '$'
+esp_err_t WiFiHandler::http_codes_handler(httpd_req_t *req)
+{
+    return send_text(req, [](ArenaText &text) { codes->list(text); });
+}
+
+// Returns the stored code given by the "name" query parameter, in the format of POST "/"
+esp_err_t WiFiHandler::http_code_get_handler(httpd_req_t *req)
+{
+    RequestArena arena;
+
+    char name[CODE_NAME_MAX_LEN + 1];
+    uint16_t* timings = arena.get() != NULL ? arena.get()->alloc_array<uint16_t>(kCaptureBufferSize) : NULL;
+    uint16_t len;
+
+    const char* response;
+
+    if(timings == NULL)
+        response = "Busy";
+    else if(get_query_value(req, "name", name, sizeof(name)) != ESP_OK ||
+            codes->load(name, timings, kCaptureBufferSize, len) != ESP_OK)
+        response = "Not found";
+    else
+    {
+        // Formatted as a capture, without the protocol
+        char* text = ReceiveHandler::format_raw(*arena.get(), decode_type_t::UNKNOWN, timings, len);
+        response = text != NULL ? strchr(text, ';') + 1 : "Busy";
+    }
+
+    httpd_resp_send(req, response, strlen(response));
+
+    return ESP_OK;
+}
+
+// Stores the raw message in the content under the name given by the "name" query parameter.
+// The content has the format of POST "/"
+esp_err_t WiFiHandler::http_code_post_handler(httpd_req_t *req)
+{
+    RequestArena arena;
+    int received;
+
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
+
+    char name[CODE_NAME_MAX_LEN + 1];
+    uint16_t* timings = arena.get()->alloc_array<uint16_t>(kCaptureBufferSize);
+    uint16_t len;
+
+    const char* resp;
+
+    if(timings == NULL)
+        resp = "Busy";
+    else if(get_query_value(req, "name", name, sizeof(name)) != ESP_OK)
+        resp = "Invalid name";
+    else if(SendHandler::parse_raw(content, timings, kCaptureBufferSize, len) != ESP_OK)
+        resp = "Invalid format";
+    else if(codes->save(name, timings, len) != ESP_OK)
+        resp = "Invalid name";
+    else
+        resp = "Success";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Sends the stored code given by the "name" query parameter, on the channels given by "ch"
+esp_err_t WiFiHandler::http_code_send_handler(httpd_req_t *req)
+{
+    WiFiled->blink_once();
+
+    RequestArena arena;
+
+    char name[CODE_NAME_MAX_LEN + 1];
+    uint16_t* timings = arena.get() != NULL ? arena.get()->alloc_array<uint16_t>(kCaptureBufferSize) : NULL;
+    uint16_t len;
+
+    uint8_t mask = get_channel_mask(req);
+
+    if(timings == NULL)
+        send_submit_response(req, ESP_ERR_NO_MEM);
+    else if(mask == 0)
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+    else if(get_query_value(req, "name", name, sizeof(name)) != ESP_OK ||
+            codes->load(name, timings, kCaptureBufferSize, len) != ESP_OK)
+        httpd_resp_send(req, "Not found", strlen("Not found"));
+    else
+    {
+        IRled->blink_once();
+        send_submit_response(req, emitters->submit_timings(mask, timings, len, kRawCarrierKhz));
+    }
+
+    return ESP_OK;
+}
+
+// Deletes the stored code given by the "name" query parameter
+esp_err_t WiFiHandler::http_code_delete_handler(httpd_req_t *req)
+{
+    char name[CODE_NAME_MAX_LEN + 1];
+
+    const char* resp = "Not found";
+
+    if(get_query_value(req, "name", name, sizeof(name)) == ESP_OK && codes->remove(name) == ESP_OK)
+        resp = "Success";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Captures a message and returns it compressed with irpack_encode, as binary content. The capture is set as for GET "/"
+esp_err_t WiFiHandler::http_packed_get_handler(httpd_req_t *req)
+{
+    WiFiled->blink_once();
+
+    capture_params_t params;
+    get_capture_params(req, params);
+
+    workers->submit(req, WORKER_PACKED_GET, 0, &params, sizeof(params));
+
+    return ESP_OK;
+}
+
+// Captures a message for GET "/packed". Runs on a request worker
+const char* WiFiHandler::worker_packed_get(Arena &arena, uint32_t arg, const void* data, size_t &len)
+{
+    uint16_t* timings = arena.alloc_array<uint16_t>(kCaptureBufferSize);
+    uint8_t* packed = arena.alloc_array<uint8_t>(CODE_MAX_PACKED_SIZE);
+    uint16_t count;
+    decode_type_t protocol;
+
+    // An empty response means that nothing was received
+    len = 0;
+
+    IRled->start_blinking();
+
+    if(timings != NULL && packed != NULL &&
+       receiver->capture_timings(timings, kCaptureBufferSize, count, protocol, *(const capture_params_t*)data) == ESP_OK)
+        len = irpack_encode(timings, count, packed, CODE_MAX_PACKED_SIZE);
+
+    IRled->stop_blinking();
+
+    return (const char*)packed;
+}
+
+// Sends a message compressed with irpack_encode, given as binary content, on the channels given by "ch"
+esp_err_t WiFiHandler::http_packed_post_handler(httpd_req_t *req)
+{
+    WiFiled->blink_once();
+
+    RequestArena arena;
+    int size;
 
-	ESP_LOGI(TAG, " Got a get request.");
+    char* content = read_content(req, arena.get(), CODE_MAX_PACKED_SIZE, size);
+    if(content == NULL)
+        return size < 0 ? ESP_FAIL : ESP_OK;
 
-    IRled->start_blinking();
-    
-    esp_err_t ret = receiver->get_raw(resp);
+    uint8_t mask = get_channel_mask(req);
+    if(mask == 0)
+    {
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+        return ESP_OK;
+    }
 
-    IRled->stop_blinking();
+    uint16_t* timings = arena.get()->alloc_array<uint16_t>(kCaptureBufferSize);
+    if(timings == NULL)
+    {
+        send_submit_response(req, ESP_ERR_NO_MEM);
+        return ESP_OK;
+    }
 
-    if(ret == ESP_FAIL)
-        resp = "-1";
+    int len = irpack_decode((const uint8_t*)content, size, timings, kCaptureBufferSize);
 
-    ESP_LOGI(TAG, "Sending response :%s", resp.c_str());
+    IRled->blink_once();
 
-	httpd_resp_send(req, resp.c_str(), resp.length());
+    send_submit_response(req, len > 0 ? emitters->submit_timings(mask, timings, len, kRawCarrierKhz) : ESP_FAIL);
 
-	return ESP_OK;
+    return ESP_OK;
 }
 
-// Handler function for http post messages for raw messages
-esp_err_t WiFiHandler::http_post_handler(httpd_req_t *req)
+// Captures a message and returns it as Pronto hex. The carrier cannot be measured by the receiver, so kRawCarrierKhz is used.
+// The capture is set as for GET "/"
+esp_err_t WiFiHandler::http_pronto_get_handler(httpd_req_t *req)
 {
     WiFiled->blink_once();
-    
-    /* Destination buffer for content of HTTP POST request.
-     * httpd_req_recv() accepts char* only, but content could
-     * as well be any binary data (needs type casting).
-     * In case of string data, null termination will be absent, and
-     * content length would give length of string */
-    char content[MAX_STR_LEN];
-
-    /* Truncate if content length larger than the buffer */
-    size_t recv_size = req->content_len;
-    if(recv_size < sizeof(content)) recv_size = sizeof(content);
 
-    int ret = httpd_req_recv(req, content, recv_size); 
+    capture_params_t params;
+    get_capture_params(req, params);
 
-    if (ret <= 0) {  /* 0 return value indicates connection closed */
-        /* Check if timeout occurred */
-        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-            /* In case of timeout one can choose to retry calling
-             * httpd_req_recv(), but to keep it simple, here we
-             * respond with an HTTP 408 (Request Timeout) error */
-            httpd_resp_send_408(req);
-        }
-        /* In case of error, returning ESP_FAIL will
-         * ensure that the underlying socket is closed */
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "Got a post request to / :%s", content);
+    workers->submit(req, WORKER_PRONTO_GET, 0, &params, sizeof(params));
 
-    IRled->blink_once();
-    
-    esp_err_t str_ret = sender->send_raw(content);
-    
-    char resp[100];
-    
-    // Send response to client
-    if(str_ret == ESP_FAIL)
-        strcpy(resp, "Invalid format");
-    else
-        strcpy(resp, "Success");
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "Sending response :%s", resp);
-    
-    httpd_resp_send(req, resp, strlen(resp));
+// Captures a message for GET "/pronto". Runs on a request worker
+const char* WiFiHandler::worker_pronto_get(Arena &arena, uint32_t arg, const void* data, size_t &len)
+{
+    uint16_t* timings = arena.alloc_array<uint16_t>(kCaptureBufferSize);
+    char* pronto = arena.alloc_array<char>(PRONTO_MAX_STR_LEN);
+    uint16_t count;
+    decode_type_t protocol;
 
-    return ESP_OK;
+    int size = -1;
+
+    IRled->start_blinking();
+
+    if(timings != NULL && pronto != NULL &&
+       receiver->capture_timings(timings, kCaptureBufferSize, count, protocol, *(const capture_params_t*)data) == ESP_OK)
+        size = timings_to_pronto(timings, count, kRawCarrierKhz * 1000, pronto, PRONTO_MAX_STR_LEN);
+
+    IRled->stop_blinking();
+
+    if(size < 0)
+    {
+        len = 2;
+        return "-1";
+    }
+
+    len = size;
+
+    return pronto;
 }
 
-// Handler function for http post message type, for AC messages
-esp_err_t WiFiHandler::http_ac_post_handler(httpd_req_t *req)
+// Sends a message given as Pronto hex, on the channels given by "ch". 
+// The "repeat" query parameter sets the number of times the repeat sequence is sent
+esp_err_t WiFiHandler::http_pronto_post_handler(httpd_req_t *req)
 {
     WiFiled->blink_once();
-    
-    char content[MAX_STR_LEN];
 
-    size_t recv_size = req->content_len;
-    if(recv_size < sizeof(content)) recv_size = sizeof(content);
+    RequestArena arena;
+    int received;
 
-    esp_err_t ret = httpd_req_recv(req, content, recv_size);
+    char* content = read_content(req, arena.get(), PRONTO_MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
 
-    if (ret <= 0) 
+    uint16_t* timings = arena.get()->alloc_array<uint16_t>(kCaptureBufferSize);
+    if(timings == NULL)
     {
-        // Send a request timed out error code (408) if connection timedout
-        if (ret == HTTPD_SOCK_ERR_TIMEOUT)
-            httpd_resp_send_408(req);
-        // To close the socket, return ESP_FAIL
-        return ESP_FAIL;
+        send_submit_response(req, ESP_ERR_NO_MEM);
+        return ESP_OK;
     }
-    
-    ESP_LOGI(TAG, "Got a post request to /ac :%s", content);
 
-    IRled->blink_once();
+    char value[8];
+    uint16_t repeats = 0;
+    if(get_query_value(req, "repeat", value, sizeof(value)) == ESP_OK)
+        repeats = atoi(value);
 
-    esp_err_t str_ret = sender->send_ac(content);
-    
-    char resp[100];
-    
-    // Send response to client
-    if(str_ret == ESP_FAIL)
-        strcpy(resp, "Invalid format");
-    else
-        strcpy(resp, "Success");
+    uint8_t mask = get_channel_mask(req);
+    uint32_t freq_hz;
+    int len = pronto_to_timings(content, repeats, timings, kCaptureBufferSize, &freq_hz);
 
-    ESP_LOGI(TAG, "Sending response :%s", resp);
-    
-    httpd_resp_send(req, resp, strlen(resp));
+    // Below 1000, the frequency would be taken as kHz
+    if(len > 0 && (freq_hz < kMinCarrierHz || freq_hz > kMaxCarrierHz))
+        len = -1;
+
+    if(mask == 0)
+        httpd_resp_send(req, "Invalid channel", strlen("Invalid channel"));
+    else
+    {
+        IRled->blink_once();
+        send_submit_response(req, len > 0 ? emitters->submit_timings(mask, timings, len, freq_hz) : ESP_FAIL);
+    }
 
     return ESP_OK;
 }
 
 // Scans for available wifi networks and 
 esp_err_t WiFiHandler::http_scan_handler(httpd_req_t *req)
+{
+    workers->submit(req, WORKER_SCAN, 0);
+
+    return ESP_OK;
+}
+
+// Scans for networks for GET "/scan". Runs on a request worker
+const char* WiFiHandler::worker_scan(Arena &arena, uint32_t arg, const void* data, size_t &len)
 {
     WiFiled->start_blinking();
 
     int n = WiFi.scanNetworks();
         if (n == 0) {
-        ESP_LOGI(TAG, "no networks found");
+        BLOGI("no networks found");
     } else {
-        ESP_LOGI(TAG, "%d", n);
-        ESP_LOGI(TAG, " networks found");
+        BLOGI("%d networks found", n);
         for (int i = 0; i < n; ++i) {
             // Print SSID and RSSI for each network found
-            ESP_LOGI(TAG, "%d : %s", i, WiFi.SSID(i));
+            BLOGD("%d : %s", i, WiFi.SSID(i).c_str());
             delay(10);
         }
     }
 
     WiFiled->stop_blinking();
     
-    String response;
-    response.reserve(MAX_STR_LEN);
+    char* response = arena.alloc_array<char>(MAX_STR_LEN);
+    len = 0;
 
+    if(response == NULL)
+        return "";
+
+    // Networks that do not fit are left out
     for(int i = 0; i < n; ++i) {
-        response += WiFi.SSID(i) + "$";
+        int written = snprintf(response + len, MAX_STR_LEN - len, "%s$", WiFi.SSID(i).c_str());
+        if(written < 0 || len + written >= MAX_STR_LEN)
+            break;
+        len += written;
     }
-    
-    httpd_resp_send(req, response.c_str(), response.length());
 
-    return ESP_OK;
+    return response;
 }
 
 // For configuring the device
@@ -164,110 +1020,201 @@ esp_err_t WiFiHandler::http_config_handler(httpd_req_t *req)
 {
     WiFiled->blink_once();
     
-    char content[MAX_STR_LEN];
+    RequestArena arena;
+    int received;
 
-    /* Truncate if content length larger than the buffer */
-    size_t recv_size = req->content_len;
-    if(recv_size < sizeof(content)) recv_size = sizeof(content);
-
-    int ret = httpd_req_recv(req, content, recv_size); 
-        if (ret <= 0) {  /* 0 return value indicates connection closed */
-        /* Check if timeout occurred */
-        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-            /* In case of timeout one can choose to retry calling
-             * httpd_req_recv(), but to keep it simple, here we
-             * respond with an HTTP 408 (Request Timeout) error */
-            httpd_resp_send_408(req);
-        }
-        /* In case of error, returning ESP_FAIL will
-         * ensure that the underlying socket is closed */
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "Got a post request to /ac :%s", content);
-    
-    std::string response = "Got request";
+    char* content = read_content(req, arena.get(), MAX_STR_LEN, received);
+    if(content == NULL)
+        return received < 0 ? ESP_FAIL : ESP_OK;
 
-    httpd_resp_send(req, response.c_str(), response.length());
+    BLOGI("Got a post request to /wificonfig, %d bytes", received);
+
+    esp_err_t str_ret = config_network(content);
+
+    const char* resp;
+
+    if(str_ret == ESP_ERR_INVALID_STATE)
+        resp = "Busy";
+    else if(str_ret != ESP_OK)
+        resp = "Invalid format";
+    else
+        resp = "Got request";
+
+    httpd_resp_send(req, resp, strlen(resp));
+
+    return ESP_OK;
+}
+
+// Reports the state of the background provisioning
+// Response : "idle", "connecting", "connected" or "failed"
+esp_err_t WiFiHandler::http_status_handler(httpd_req_t *req)
+{
+    const char* resp;
 
-    config_network(content);
+    switch(prov_state)
+    {
+    case PROV_CONNECTING:   resp = "connecting";    break;
+    case PROV_CONNECTED:    resp = "connected";     break;
+    case PROV_FAILED:       resp = "failed";        break;
+    default:                resp = "idle";          break;
+    }
+
+    httpd_resp_send(req, resp, strlen(resp));
 
     return ESP_OK;
 }
 
+// Copies the field ending at the next '$' into dest. Returns pointer after the '$', or NULL if malformed
+static const char* read_config_field(const char* str, char* dest, size_t max_len)
+{
+    const char* end = strchr(str, '$');
+
+    if(end == NULL || (size_t)(end - str) > max_len)
+        return NULL;
+
+    memcpy(dest, str, end - str);
+    dest[end - str] = '\0';
+
+    return end + 1;
+}
+
+// Parses the configuration and starts connecting in the background. 
+// The result is committed by provision_task once the connection attempt finishes.
+// Returns ESP_ERR_INVALID_STATE if an attempt is already running and ESP_FAIL if the format is invalid
 esp_err_t WiFiHandler::config_network(const char* str)
 {
-    WiFiled->blink_once();
-    
-    std::string ssid;
-    std::string hostname;
-    std::string password;
+    if(prov_state == PROV_CONNECTING || prov_state == PROV_CONNECTED)
+        return ESP_ERR_INVALID_STATE;
 
-    std::string content;
+    const char* next = str;
+
+    if((next = read_config_field(next, prov_hostname, WIFI_HOSTNAME_MAX_LEN)) == NULL)
+        return ESP_FAIL;
+    if((next = read_config_field(next, prov_ssid, WIFI_SSID_MAX_LEN)) == NULL)
+        return ESP_FAIL;
+    if((next = read_config_field(next, prov_password, WIFI_PASSWORD_MAX_LEN)) == NULL)
+        return ESP_FAIL;
 
-    content = str;
+    // The MQTT broker is optional
+    prov_mqtt[0] = '\0';
+    if(*next != '\0' && read_config_field(next, prov_mqtt, MQTT_URI_MAX_LEN) == NULL)
+        return ESP_FAIL;
 
-    int previdx = 0;
-    int curridx = 0;
+    if(prov_ssid[0] == '\0')
+        return ESP_FAIL;
 
-    ESP_LOGI(TAG, "%s", content.c_str());
+    BLOGI("Provisioning %s on %s", prov_hostname, prov_ssid);
 
-    curridx = content.find('$', previdx);
-    hostname = content.substr(previdx, (curridx-previdx));
-    previdx = curridx + 1;
+    prov_state = PROV_CONNECTING;
+    prov_attempt++;
 
-    curridx = content.find('$', previdx);
-    ssid = content.substr(previdx, (curridx-previdx));
-    previdx = curridx + 1;
-    
-    curridx = content.find('$', previdx);
-    password = content.substr(previdx, (curridx-previdx));
-    previdx = curridx + 1;
+    WiFiled->start_blinking();
 
-    WiFi.softAPdisconnect();
-    WiFi.mode(WIFI_STA);
+    // Keep the access point up, so that the status can still be queried
+    WiFi.mode(WIFI_AP_STA);
     WiFi.disconnect();
+    WiFi.begin(prov_ssid, prov_password);
+
+    xTaskNotifyGive(provTask_h);
 
-    WiFi.begin(ssid.c_str(), password.c_str());
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "%s|%s|%s", hostname.c_str(), ssid.c_str(), password.c_str());
+// Tracks the station connection during provisioning
+void WiFiHandler::wifi_event_handler(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+    if(prov_state != PROV_CONNECTING)
+        return;
 
-    long now = millis();
+    if(event == SYSTEM_EVENT_STA_GOT_IP)
+    {
+        prov_state = PROV_CONNECTED;
+        xTaskNotifyGive(provTask_h);
+    }
+    else if(event == SYSTEM_EVENT_STA_DISCONNECTED)
+    {
+        uint8_t reason = info.disconnected.reason;
 
-    WiFiled->start_blinking();
-    
-    while(WiFi.status() != WL_CONNECTED && (millis() - now < WIFI_TIMEOUT*1000))
-    {   
-        if(WiFi.status() == WL_NO_SSID_AVAIL)
+        // Other reasons may be transient, they are left to the timeout
+        if(reason == WIFI_REASON_NO_AP_FOUND || reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_HANDSHAKE_TIMEOUT)
         {
-            ESP_LOGI(TAG, "Connection failed");
-            return ESP_FAIL;
+            BLOGI("Connection failed, reason %d", reason);
+            prov_state = PROV_FAILED;
+            xTaskNotifyGive(provTask_h);
         }
-        vTaskDelay(500 / portTICK_PERIOD_MS);
     }
+}
 
-    WiFiled->stop_blinking();
+// Waits for a configuration, then for the result of the connection attempt. 
+// On success, the configuration is saved and the device switches to station mode without restarting.
+void WiFiHandler::provision_task(void* param)
+{
+    uint32_t handled = 0;
 
-    if(WiFi.status() == WL_CONNECTED)
+    for(;;)
     {
-        ESP_LOGI(TAG, "Connected successfully");
+        // Wait for config_network to start an attempt. The states are checked rather than the notifications,
+        // as wifi_event_handler may have notified the result before this task got to run
+        while(prov_attempt == handled)
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        handled = prov_attempt;
+
+        // Wait for wifi_event_handler, or time out
+        TickType_t start = xTaskGetTickCount();
+        TickType_t timeout = WIFI_TIMEOUT * 1000 / portTICK_PERIOD_MS;
+
+        while(prov_state == PROV_CONNECTING)
+        {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if(elapsed >= timeout)
+                break;
+
+            ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+        }
+
+        WiFiled->stop_blinking();
 
-        nvs_set_str(nvs_wifi, NVS_HOSTNAME_KEY, hostname.c_str());
+        if(prov_state != PROV_CONNECTED)
+        {
+            BLOGI("Connection failed");
 
-        nvs_set_str(nvs_wifi, NVS_SSID_KEY, ssid.c_str());
+            prov_state = PROV_FAILED;
+            WiFi.disconnect();
+            WiFi.mode(WIFI_AP);
+            continue;
+        }
 
-        nvs_set_str(nvs_wifi, NVS_PASSWORD_KEY, password.c_str());
+        BLOGI("Connected successfully");
 
+        nvs_set_str(nvs_wifi, NVS_HOSTNAME_KEY, prov_hostname);
+        nvs_set_str(nvs_wifi, NVS_SSID_KEY, prov_ssid);
+        nvs_set_str(nvs_wifi, NVS_PASSWORD_KEY, prov_password);
+        nvs_set_str(nvs_wifi, NVS_MQTT_KEY, prov_mqtt);
         nvs_commit(nvs_wifi);
-        esp_restart();
-        return ESP_OK;
+
+        mode = true;
+
+        httpd_unregister_uri_handler(server, HTTP_WIFI_CONFIG_URI, HTTP_POST);
+        register_ir_uris();
+        start_mdns(prov_hostname);
+
+        if(prov_mqtt[0] != '\0')
+            mqtt->start(prov_mqtt, prov_hostname);
+
+        // Let the client read the status over the access point before it goes down
+        vTaskDelay(WIFI_AP_GRACE_PER / portTICK_PERIOD_MS);
+
+        WiFi.softAPdisconnect(true);
+        WiFi.mode(WIFI_STA);
+
+        BLOGI("Switched to station mode");
+        break;
     }
-    else
-    {
-        ESP_LOGI(TAG, "Connection failed");
-        esp_restart();
-        return ESP_FAIL;
-    }    
+
+    // The storage of the task is static, so it is not deleted but left suspended, and stays listed by GET "/tasks"
+    for(;;)
+        vTaskSuspend(NULL);
 }
 
 esp_err_t WiFiHandler::connect_to_network(const char* ssid ,const char* password)
@@ -298,17 +1245,349 @@ esp_err_t WiFiHandler::start_mdns(const char* hostname)
 
     MDNS.addServiceTxt("http", "tcp", "test", "100");
 
+    update_mdns_udp();
+
     Serial.println("Done");
 
     return ESP_OK;
 }
 
-WiFiHandler::WiFiHandler(LedHandler *wifi, LedHandler *ir, SendHandler *send, ReceiveHandler *recv)
+// Advertises the UDP command port while UDP commands are on. Does nothing if mDNS has not been started
+void WiFiHandler::update_mdns_udp()
+{
+    if(!udp->is_enabled())
+    {
+        mdns_service_remove(MDNS_UDP_SERVICE, MDNS_UDP_PROTO);
+        return;
+    }
+
+    if(mdns_service_port_set(MDNS_UDP_SERVICE, MDNS_UDP_PROTO, udp->get_port()) != ESP_OK)
+        mdns_service_add(NULL, MDNS_UDP_SERVICE, MDNS_UDP_PROTO, udp->get_port(), NULL, 0);
+}
+
+// Starts the http server with the wifi scan URI, which is available in both modes
+esp_err_t WiFiHandler::start_server()
+{
+    httpd_uri_t uri_scan;
+    uri_scan.handler = &http_scan_handler;
+    uri_scan.method  = HTTP_GET;
+    uri_scan.uri = HTTP_WIFI_SCAN_URI;
+    uri_scan.user_ctx = NULL;
+
+    /* Generate default configuration */
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.core_id = SERVER_TASK_CORE;
+    config.task_priority = SERVER_TASK_PRIO;
+    config.max_uri_handlers = HTTP_MAX_URI_HANDLERS;
+
+    /* Start the http server */
+    if (httpd_start(&server, &config) != ESP_OK)
+        return ESP_FAIL;
+
+    httpd_register_uri_handler(server, &uri_scan);
+
+    return ESP_OK;
+}
+
+// Registers the URIs for sending and receiving IR messages, available once connected to a network
+void WiFiHandler::register_ir_uris()
+{
+	httpd_uri_t uri_get;
+    uri_get.handler = &http_get_handler;
+    uri_get.method  = HTTP_GET;
+    uri_get.uri = HTTP_GET_URI;
+    uri_get.user_ctx = NULL;
+
+	httpd_uri_t uri_post;
+    uri_post.handler = &http_post_handler;
+    uri_post.method  = HTTP_POST;
+    uri_post.uri = HTTP_RAW_SEND_URI;
+    uri_post.user_ctx = NULL;
+
+    httpd_uri_t uri_ac_post;
+    uri_ac_post.handler = &http_ac_post_handler;
+    uri_ac_post.method  = HTTP_POST;
+    uri_ac_post.uri = HTTP_AC_SEND_URI;
+    uri_ac_post.user_ctx = NULL;
+
+    httpd_uri_t uri_channels_get;
+    uri_channels_get.handler = &http_channels_get_handler;
+    uri_channels_get.method  = HTTP_GET;
+    uri_channels_get.uri = HTTP_CHANNELS_URI;
+    uri_channels_get.user_ctx = NULL;
+
+    httpd_uri_t uri_channels_post;
+    uri_channels_post.handler = &http_channels_post_handler;
+    uri_channels_post.method  = HTTP_POST;
+    uri_channels_post.uri = HTTP_CHANNELS_URI;
+    uri_channels_post.user_ctx = NULL;
+
+    httpd_register_uri_handler(server, &uri_get);
+    httpd_register_uri_handler(server, &uri_post);
+    httpd_register_uri_handler(server, &uri_ac_post);
+    httpd_uri_t uri_learn;
+    uri_learn.handler = &http_learn_handler;
+    uri_learn.method  = HTTP_GET;
+    uri_learn.uri = HTTP_LEARN_URI;
+    uri_learn.user_ctx = NULL;
+
+    httpd_uri_t uri_codes;
+    uri_codes.handler = &http_codes_handler;
+    uri_codes.method  = HTTP_GET;
+    uri_codes.uri = HTTP_CODES_URI;
+    uri_codes.user_ctx = NULL;
+
+    httpd_uri_t uri_code_get;
+    uri_code_get.handler = &http_code_get_handler;
+    uri_code_get.method  = HTTP_GET;
+    uri_code_get.uri = HTTP_CODE_URI;
+    uri_code_get.user_ctx = NULL;
+
+    httpd_uri_t uri_code_post;
+    uri_code_post.handler = &http_code_post_handler;
+    uri_code_post.method  = HTTP_POST;
+    uri_code_post.uri = HTTP_CODE_URI;
+    uri_code_post.user_ctx = NULL;
+
+    httpd_uri_t uri_code_send;
+    uri_code_send.handler = &http_code_send_handler;
+    uri_code_send.method  = HTTP_POST;
+    uri_code_send.uri = HTTP_CODE_SEND_URI;
+    uri_code_send.user_ctx = NULL;
+
+    httpd_uri_t uri_code_delete;
+    uri_code_delete.handler = &http_code_delete_handler;
+    uri_code_delete.method  = HTTP_POST;
+    uri_code_delete.uri = HTTP_CODE_DELETE_URI;
+    uri_code_delete.user_ctx = NULL;
+
+    httpd_uri_t uri_packed_get;
+    uri_packed_get.handler = &http_packed_get_handler;
+    uri_packed_get.method  = HTTP_GET;
+    uri_packed_get.uri = HTTP_PACKED_URI;
+    uri_packed_get.user_ctx = NULL;
+
+    httpd_uri_t uri_packed_post;
+    uri_packed_post.handler = &http_packed_post_handler;
+    uri_packed_post.method  = HTTP_POST;
+    uri_packed_post.uri = HTTP_PACKED_URI;
+    uri_packed_post.user_ctx = NULL;
+
+    httpd_uri_t uri_pronto_get;
+    uri_pronto_get.handler = &http_pronto_get_handler;
+    uri_pronto_get.method  = HTTP_GET;
+    uri_pronto_get.uri = HTTP_PRONTO_URI;
+    uri_pronto_get.user_ctx = NULL;
+
+    httpd_uri_t uri_pronto_post;
+    uri_pronto_post.handler = &http_pronto_post_handler;
+    uri_pronto_post.method  = HTTP_POST;
+    uri_pronto_post.uri = HTTP_PRONTO_URI;
+    uri_pronto_post.user_ctx = NULL;
+
+    httpd_uri_t uri_session_get;
+    uri_session_get.handler = &http_session_get_handler;
+    uri_session_get.method  = HTTP_GET;
+    uri_session_get.uri = HTTP_SESSION_URI;
+    uri_session_get.user_ctx = NULL;
+
+    httpd_uri_t uri_session_post;
+    uri_session_post.handler = &http_session_post_handler;
+    uri_session_post.method  = HTTP_POST;
+    uri_session_post.uri = HTTP_SESSION_URI;
+    uri_session_post.user_ctx = NULL;
+
+    httpd_uri_t uri_session_cancel;
+    uri_session_cancel.handler = &http_session_cancel_handler;
+    uri_session_cancel.method  = HTTP_POST;
+    uri_session_cancel.uri = HTTP_SESSION_CANCEL_URI;
+    uri_session_cancel.user_ctx = NULL;
+
+    httpd_uri_t uri_schedule_get;
+    uri_schedule_get.handler = &http_schedule_get_handler;
+    uri_schedule_get.method  = HTTP_GET;
+    uri_schedule_get.uri = HTTP_SCHEDULE_URI;
+    uri_schedule_get.user_ctx = NULL;
+
+    httpd_uri_t uri_schedule_post;
+    uri_schedule_post.handler = &http_schedule_post_handler;
+    uri_schedule_post.method  = HTTP_POST;
+    uri_schedule_post.uri = HTTP_SCHEDULE_URI;
+    uri_schedule_post.user_ctx = NULL;
+
+    httpd_uri_t uri_schedule_delete;
+    uri_schedule_delete.handler = &http_schedule_delete_handler;
+    uri_schedule_delete.method  = HTTP_POST;
+    uri_schedule_delete.uri = HTTP_SCHEDULE_DELETE_URI;
+    uri_schedule_delete.user_ctx = NULL;
+
+    httpd_uri_t uri_rules_get;
+    uri_rules_get.handler = &http_rules_get_handler;
+    uri_rules_get.method  = HTTP_GET;
+    uri_rules_get.uri = HTTP_RULES_URI;
+    uri_rules_get.user_ctx = NULL;
+
+    httpd_uri_t uri_rules_post;
+    uri_rules_post.handler = &http_rules_post_handler;
+    uri_rules_post.method  = HTTP_POST;
+    uri_rules_post.uri = HTTP_RULES_URI;
+    uri_rules_post.user_ctx = NULL;
+
+    httpd_uri_t uri_rules_delete;
+    uri_rules_delete.handler = &http_rules_delete_handler;
+    uri_rules_delete.method  = HTTP_POST;
+    uri_rules_delete.uri = HTTP_RULES_DELETE_URI;
+    uri_rules_delete.user_ctx = NULL;
+
+    httpd_uri_t uri_repeater_get;
+    uri_repeater_get.handler = &http_repeater_get_handler;
+    uri_repeater_get.method  = HTTP_GET;
+    uri_repeater_get.uri = HTTP_REPEATER_URI;
+    uri_repeater_get.user_ctx = NULL;
+
+    httpd_uri_t uri_repeater_post;
+    uri_repeater_post.handler = &http_repeater_post_handler;
+    uri_repeater_post.method  = HTTP_POST;
+    uri_repeater_post.uri = HTTP_REPEATER_URI;
+    uri_repeater_post.user_ctx = NULL;
+
+    httpd_uri_t uri_mqtt;
+    uri_mqtt.handler = &http_mqtt_handler;
+    uri_mqtt.method  = HTTP_GET;
+    uri_mqtt.uri = HTTP_MQTT_URI;
+    uri_mqtt.user_ctx = NULL;
+
+    httpd_uri_t uri_corpus_get;
+    uri_corpus_get.handler = &http_corpus_get_handler;
+    uri_corpus_get.method  = HTTP_GET;
+    uri_corpus_get.uri = HTTP_CORPUS_URI;
+    uri_corpus_get.user_ctx = NULL;
+
+    httpd_uri_t uri_corpus_post;
+    uri_corpus_post.handler = &http_corpus_post_handler;
+    uri_corpus_post.method  = HTTP_POST;
+    uri_corpus_post.uri = HTTP_CORPUS_URI;
+    uri_corpus_post.user_ctx = NULL;
+
+    httpd_uri_t uri_corpus_stop;
+    uri_corpus_stop.handler = &http_corpus_stop_handler;
+    uri_corpus_stop.method  = HTTP_POST;
+    uri_corpus_stop.uri = HTTP_CORPUS_STOP_URI;
+    uri_corpus_stop.user_ctx = NULL;
+
+    httpd_uri_t uri_heap;
+    uri_heap.handler = &http_heap_handler;
+    uri_heap.method  = HTTP_GET;
+    uri_heap.uri = HTTP_HEAP_URI;
+    uri_heap.user_ctx = NULL;
+
+    httpd_uri_t uri_workers;
+    uri_workers.handler = &http_workers_handler;
+    uri_workers.method  = HTTP_GET;
+    uri_workers.uri = HTTP_WORKERS_URI;
+    uri_workers.user_ctx = NULL;
+
+    httpd_uri_t uri_udp_get;
+    uri_udp_get.handler = &http_udp_get_handler;
+    uri_udp_get.method  = HTTP_GET;
+    uri_udp_get.uri = HTTP_UDP_URI;
+    uri_udp_get.user_ctx = NULL;
+
+    httpd_uri_t uri_udp_post;
+    uri_udp_post.handler = &http_udp_post_handler;
+    uri_udp_post.method  = HTTP_POST;
+    uri_udp_post.uri = HTTP_UDP_URI;
+    uri_udp_post.user_ctx = NULL;
+
+    httpd_uri_t uri_protocols;
+    uri_protocols.handler = &http_protocols_handler;
+    uri_protocols.method  = HTTP_GET;
+    uri_protocols.uri = HTTP_PROTOCOLS_URI;
+    uri_protocols.user_ctx = NULL;
+
+    httpd_uri_t uri_tasks;
+    uri_tasks.handler = &http_tasks_handler;
+    uri_tasks.method  = HTTP_GET;
+    uri_tasks.uri = HTTP_TASKS_URI;
+    uri_tasks.user_ctx = NULL;
+
+    httpd_register_uri_handler(server, &uri_channels_get);
+    httpd_register_uri_handler(server, &uri_channels_post);
+    httpd_register_uri_handler(server, &uri_learn);
+    httpd_register_uri_handler(server, &uri_codes);
+    httpd_register_uri_handler(server, &uri_code_get);
+    httpd_register_uri_handler(server, &uri_code_post);
+    httpd_register_uri_handler(server, &uri_code_send);
+    httpd_register_uri_handler(server, &uri_code_delete);
+    httpd_register_uri_handler(server, &uri_packed_get);
+    httpd_register_uri_handler(server, &uri_packed_post);
+    httpd_register_uri_handler(server, &uri_pronto_get);
+    httpd_register_uri_handler(server, &uri_pronto_post);
+    httpd_register_uri_handler(server, &uri_session_get);
+    httpd_register_uri_handler(server, &uri_session_post);
+    httpd_register_uri_handler(server, &uri_session_cancel);
+    httpd_register_uri_handler(server, &uri_schedule_get);
+    httpd_register_uri_handler(server, &uri_schedule_post);
+    httpd_register_uri_handler(server, &uri_schedule_delete);
+    httpd_register_uri_handler(server, &uri_rules_get);
+    httpd_register_uri_handler(server, &uri_rules_post);
+    httpd_register_uri_handler(server, &uri_rules_delete);
+    httpd_register_uri_handler(server, &uri_repeater_get);
+    httpd_register_uri_handler(server, &uri_repeater_post);
+    httpd_register_uri_handler(server, &uri_mqtt);
+    httpd_register_uri_handler(server, &uri_corpus_get);
+    httpd_register_uri_handler(server, &uri_corpus_post);
+    httpd_register_uri_handler(server, &uri_corpus_stop);
+    httpd_register_uri_handler(server, &uri_heap);
+    httpd_register_uri_handler(server, &uri_workers);
+    httpd_register_uri_handler(server, &uri_udp_get);
+    httpd_register_uri_handler(server, &uri_udp_post);
+    httpd_register_uri_handler(server, &uri_protocols);
+    httpd_register_uri_handler(server, &uri_tasks);
+
+    if(benchmark != NULL)
+    {
+        httpd_uri_t uri_bench_get;
+        uri_bench_get.handler = &http_bench_get_handler;
+        uri_bench_get.method  = HTTP_GET;
+        uri_bench_get.uri = HTTP_BENCH_URI;
+        uri_bench_get.user_ctx = NULL;
+
+        httpd_uri_t uri_bench_post;
+        uri_bench_post.handler = &http_bench_post_handler;
+        uri_bench_post.method  = HTTP_POST;
+        uri_bench_post.uri = HTTP_BENCH_URI;
+        uri_bench_post.user_ctx = NULL;
+
+        httpd_register_uri_handler(server, &uri_bench_get);
+        httpd_register_uri_handler(server, &uri_bench_post);
+    }
+}
+
+WiFiHandler::WiFiHandler(LedHandler *wifi, LedHandler *ir, EmitterChannels *send, ReceiveHandler *recv, CodeStore *store,
+                         LearnSession *learn, Scheduler *sched, RuleEngine *rule_engine, Repeater *relay, MqttHandler *broker,
+                         CorpusRecorder *recorder, RequestWorkers *pool, UdpCommands *fast_path, IRBenchmark *bench)
 {
     WiFiled     = wifi;
     IRled       = ir;
-    sender      = send;
+    emitters    = send;
     receiver    = recv;
+    codes       = store;
+    session     = learn;
+    scheduler   = sched;
+    rules       = rule_engine;
+    repeater    = relay;
+    mqtt        = broker;
+    corpus      = recorder;
+    workers     = pool;
+    udp         = fast_path;
+    benchmark   = bench;
+
+    workers->add_endpoint(WORKER_GET_RAW, "get", worker_get_raw, "text/plain", WORKER_GET_RAW_LIMIT, true);
+    workers->add_endpoint(WORKER_LEARN, "learn", worker_learn, "text/plain", WORKER_LEARN_LIMIT, true);
+    workers->add_endpoint(WORKER_PACKED_GET, "packed", worker_packed_get, "application/octet-stream", WORKER_PACKED_GET_LIMIT, true);
+    workers->add_endpoint(WORKER_PRONTO_GET, "pronto", worker_pronto_get, "text/plain", WORKER_PRONTO_GET_LIMIT, true);
+    workers->add_endpoint(WORKER_SCAN, "scan", worker_scan, "text/plain", WORKER_SCAN_LIMIT);
     
     nvs_flash_init();
     
@@ -316,7 +1595,7 @@ WiFiHandler::WiFiHandler(LedHandler *wifi, LedHandler *ir, SendHandler *send, Re
     
     mode = !(nvs_get_str(nvs_wifi, NVS_SSID_KEY, NULL, NULL) == ESP_ERR_NVS_NOT_FOUND);
 
-    ESP_LOGI("t", "Setup wifi handler. Wifi %s configured", mode?"is":"not");
+    BLOGI("Setup wifi handler. Wifi %s configured", mode?"is":"not");
 }
 
 bool WiFiHandler::is_configured()
@@ -339,7 +1618,7 @@ esp_err_t WiFiHandler::start_configure(const char* ap_ssid, const char* ap_passw
 
     WiFiled->start_blinking();
 
-    ESP_LOGI(TAG, "Configuration not done. Configuration mode activated");
+    BLOGI("Configuration not done. Configuration mode activated");
     
     WiFi.softAP(ap_ssid, ap_password);
     
@@ -347,11 +1626,8 @@ esp_err_t WiFiHandler::start_configure(const char* ap_ssid, const char* ap_passw
     Serial.print("AP IP address: ");
     Serial.println(myIP);
 
-        httpd_uri_t uri_scan;
-    uri_scan.handler = &http_scan_handler;
-    uri_scan.method  = HTTP_GET;
-    uri_scan.uri = HTTP_WIFI_SCAN_URI;
-    uri_scan.user_ctx = NULL;
+    if(start_server() != ESP_OK)
+        return ESP_FAIL;
 
     httpd_uri_t uri_config;
     uri_config.handler = &http_config_handler;
@@ -359,15 +1635,18 @@ esp_err_t WiFiHandler::start_configure(const char* ap_ssid, const char* ap_passw
     uri_config.uri = HTTP_WIFI_CONFIG_URI;
     uri_config.user_ctx = NULL;
 
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    httpd_uri_t uri_status;
+    uri_status.handler = &http_status_handler;
+    uri_status.method  = HTTP_GET;
+    uri_status.uri = HTTP_WIFI_STATUS_URI;
+    uri_status.user_ctx = NULL;
 
-    httpd_handle_t server = NULL;
+    httpd_register_uri_handler(server, &uri_config);
+    httpd_register_uri_handler(server, &uri_status);
 
-    if (httpd_start(&server, &config) == ESP_OK) {
-        /* Register URI handlers */
-        httpd_register_uri_handler(server, &uri_scan);
-        httpd_register_uri_handler(server, &uri_config);        
-    }
+    WiFi.onEvent(wifi_event_handler);
+
+    provTask_h = static_task_create(prov_task_storage, provision_task, "provisioning", NULL, SERVER_TASK_PRIO, SERVER_TASK_CORE);
 
     WiFiled->stop_blinking();
 
@@ -402,54 +1681,23 @@ esp_err_t WiFiHandler::auto_connect()
     hostname = (char*)malloc(hostname_len);
     nvs_get_str(nvs_wifi, NVS_HOSTNAME_KEY, hostname, &hostname_len);
 
-    ESP_LOGI(TAG, "Configuration detected : hostename-%s,SSID-%s,password-%s", hostname, ssid, password);
+    BLOGI("Configuration detected : hostname %s, SSID %s", hostname, ssid);
 
     connect_to_network(ssid, password);
 
-	httpd_uri_t uri_get;
-    uri_get.handler = &http_get_handler;
-    uri_get.method  = HTTP_GET;
-    uri_get.uri = HTTP_GET_URI;
-    uri_get.user_ctx = NULL;
-
-	httpd_uri_t uri_post;
-    uri_post.handler = &http_post_handler;
-    uri_post.method  = HTTP_POST;
-    uri_post.uri = HTTP_RAW_SEND_URI;
-    uri_post.user_ctx = NULL;
-
-    httpd_uri_t uri_ac_post;
-    uri_ac_post.handler = &http_ac_post_handler;
-    uri_ac_post.method  = HTTP_POST;
-    uri_ac_post.uri = HTTP_AC_SEND_URI;
-    uri_ac_post.user_ctx = NULL;
-
-    httpd_uri_t uri_scan;
-    uri_scan.handler = &http_scan_handler;
-    uri_scan.method  = HTTP_GET;
-    uri_scan.uri = HTTP_WIFI_SCAN_URI;
-    uri_scan.user_ctx = NULL;
-
-    /* Generate default configuration */
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-
-    /* Empty handle to esp_http_server */
-    httpd_handle_t server = NULL;
-
-    /* Start the http server */
-    if (httpd_start(&server, &config) == ESP_OK) {
-        /* Register URI handlers */
-        httpd_register_uri_handler(server, &uri_get);
-        httpd_register_uri_handler(server, &uri_post);
-        httpd_register_uri_handler(server, &uri_ac_post);    
-        httpd_register_uri_handler(server, &uri_scan);    
-    }
+    start_server();
+    register_ir_uris();
 
     start_mdns(hostname);
 
+    // Configurations saved before MQTT support have no broker
+    size_t mqtt_len = sizeof(prov_mqtt);
+    if(nvs_get_str(nvs_wifi, NVS_MQTT_KEY, prov_mqtt, &mqtt_len) == ESP_OK && prov_mqtt[0] != '\0')
+        mqtt->start(prov_mqtt, hostname);
+
     WiFiled->stop_blinking();
 
-    ESP_LOGI("t", "OK");
+    BLOGI("Connected to the configured network");
 
     return ESP_OK;
 }
@@ -458,44 +1706,8 @@ esp_err_t WiFiHandler::force_connect(const char* ssid, const char* password, con
 {
     connect_to_network(ssid, password);
 
-    httpd_uri_t uri_get;
-    uri_get.handler = &http_get_handler;
-    uri_get.method  = HTTP_GET;
-    uri_get.uri = HTTP_GET_URI;
-    uri_get.user_ctx = NULL;
-
-	httpd_uri_t uri_post;
-    uri_post.handler = &http_post_handler;
-    uri_post.method  = HTTP_POST;
-    uri_post.uri = HTTP_RAW_SEND_URI;
-    uri_post.user_ctx = NULL;
-
-    httpd_uri_t uri_ac_post;
-    uri_ac_post.handler = &http_ac_post_handler;
-    uri_ac_post.method  = HTTP_POST;
-    uri_ac_post.uri = HTTP_AC_SEND_URI;
-    uri_ac_post.user_ctx = NULL;
-
-    httpd_uri_t uri_scan;
-    uri_scan.handler = &http_scan_handler;
-    uri_scan.method  = HTTP_GET;
-    uri_scan.uri = HTTP_WIFI_SCAN_URI;
-    uri_scan.user_ctx = NULL;
-
-    /* Generate default configuration */
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-
-    /* Empty handle to esp_http_server */
-    httpd_handle_t server = NULL;
-
-    /* Start the http server */
-    if (httpd_start(&server, &config) == ESP_OK) {
-        /* Register URI handlers */
-        httpd_register_uri_handler(server, &uri_get);
-        httpd_register_uri_handler(server, &uri_post);
-        httpd_register_uri_handler(server, &uri_ac_post);    
-        httpd_register_uri_handler(server, &uri_scan);    
-    }
+    start_server();
+    register_ir_uris();
 
     start_mdns(hostname);
 
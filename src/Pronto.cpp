@@ -0,0 +1,201 @@
+#include "Pronto.h"
+
+// Reads the next hex word, skipping whitespace. Returns false if there is none or it is invalid
+static bool read_word(const char** str, uint16_t* word)
+{
+    const char* p = *str;
+
+    while(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ',')
+        p++;
+
+    uint32_t value = 0;
+    uint8_t digits = 0;
+
+    for(;; p++, digits++)
+    {
+        char c = *p;
+        uint8_t nibble;
+
+        if(c >= '0' && c <= '9')
+            nibble = c - '0';
+        else if(c >= 'a' && c <= 'f')
+            nibble = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            nibble = c - 'A' + 10;
+        else
+            break;
+
+        value = (value << 4) | nibble;
+    }
+
+    if(digits == 0 || digits > 4)
+        return false;
+
+    *word = value;
+    *str = p;
+
+    return true;
+}
+
+// Appends a duration, splitting it if it does not fit 16 bits
+static bool put_duration(uint32_t usecs, uint16_t* timings, uint16_t max_len, uint16_t* len)
+{
+    for(; usecs > UINT16_MAX; usecs -= UINT16_MAX)
+    {
+        if(*len + 2 > max_len)
+            return false;
+
+        timings[(*len)++] = UINT16_MAX;
+        timings[(*len)++] = 0;
+    }
+
+    if(*len == max_len)
+        return false;
+
+    timings[(*len)++] = usecs;
+
+    return true;
+}
+
+// Converts pairs of durations in carrier cycles, read from str, to microseconds
+static bool put_pairs(const char* str, uint16_t pairs, uint16_t code, uint16_t* timings, uint16_t max_len, uint16_t* len)
+{
+    for(uint32_t i = 0; i < 2u * pairs; i++)
+    {
+        uint16_t cycles;
+        if(!read_word(&str, &cycles))
+            return false;
+
+        uint64_t usecs = ((uint64_t)cycles * code * 1000000 + PRONTO_CLOCK_HZ / 2) / PRONTO_CLOCK_HZ;
+
+        if(!put_duration(usecs, timings, max_len, len))
+            return false;
+    }
+
+    return true;
+}
+
+// Skips words in the string
+static bool skip_words(const char** str, uint32_t count)
+{
+    uint16_t word;
+
+    for(uint32_t i = 0; i < count; i++)
+        if(!read_word(str, &word))
+            return false;
+
+    return true;
+}
+
+int pronto_to_timings(const char* str, uint16_t repeats, uint16_t* timings, uint16_t max_len, uint32_t* freq_hz)
+{
+    uint16_t type, code, once, repeat;
+
+    if(!read_word(&str, &type) || !read_word(&str, &code) || !read_word(&str, &once) || !read_word(&str, &repeat))
+        return -1;
+
+    if(type != 0x0000 || code == 0 || (once == 0 && repeat == 0))
+        return -1;
+
+    const char* once_str = str;
+    const char* repeat_str = str;
+    if(!skip_words(&repeat_str, 2u * once))
+        return -1;
+
+    uint16_t len = 0;
+
+    if(!put_pairs(once_str, once, code, timings, max_len, &len))
+        return -1;
+
+    if(once == 0 && repeats == 0)
+        repeats = 1;
+
+    if(repeat != 0)
+        for(uint16_t i = 0; i < repeats; i++)
+            if(!put_pairs(repeat_str, repeat, code, timings, max_len, &len))
+                return -1;
+
+    *freq_hz = (PRONTO_CLOCK_HZ + code / 2) / code;
+
+    return len;
+}
+
+// Writes a hex word followed by a space
+static bool write_word(uint16_t word, char* out, size_t out_size, size_t* pos)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    if(*pos + 5 >= out_size)
+        return false;
+
+    out[(*pos)++] = hex[(word >> 12) & 0xF];
+    out[(*pos)++] = hex[(word >> 8) & 0xF];
+    out[(*pos)++] = hex[(word >> 4) & 0xF];
+    out[(*pos)++] = hex[word & 0xF];
+    out[(*pos)++] = ' ';
+
+    return true;
+}
+
+static bool write_duration(uint32_t usecs, uint16_t code, char* out, size_t out_size, size_t* pos)
+{
+    uint64_t cycles = ((uint64_t)usecs * PRONTO_CLOCK_HZ + (uint64_t)code * 500000) / ((uint64_t)code * 1000000);
+
+    if(cycles == 0)
+        cycles = 1;
+    if(cycles > UINT16_MAX)
+        cycles = UINT16_MAX;
+
+    return write_word(cycles, out, out_size, pos);
+}
+
+int timings_to_pronto(const uint16_t* timings, uint16_t len, uint32_t freq_hz, char* out, size_t out_size)
+{
+    if(freq_hz == 0 || out_size == 0)
+        return -1;
+
+    uint32_t code = (PRONTO_CLOCK_HZ + freq_hz / 2) / freq_hz;
+    if(code == 0 || code > UINT16_MAX)
+        return -1;
+
+    // Count durations after merging zero length entries
+    uint16_t count = 0;
+    for(uint16_t i = 0; i < len; i++)
+        if(timings[i] != 0 || i == 0 || i + 1 == len)
+            count++;
+        else
+            count--;
+
+    bool trailing_gap = (count % 2) != 0;
+    uint16_t pairs = (count + 1) / 2;
+
+    size_t pos = 0;
+
+    if(!write_word(0x0000, out, out_size, &pos) || !write_word(code, out, out_size, &pos) ||
+       !write_word(pairs, out, out_size, &pos) || !write_word(0x0000, out, out_size, &pos))
+        return -1;
+
+    for(uint16_t i = 0; i < len; i++)
+    {
+        uint32_t usecs = timings[i];
+
+        while(i + 2 < len && timings[i + 1] == 0)
+        {
+            usecs += timings[i + 2];
+            i += 2;
+        }
+
+        if(!write_duration(usecs, code, out, out_size, &pos))
+            return -1;
+    }
+
+    if(trailing_gap && !write_duration(PRONTO_TRAILING_GAP, code, out, out_size, &pos))
+        return -1;
+
+    // Replace the last space
+    if(pos > 0)
+        pos--;
+    out[pos] = '\0';
+
+    return pos;
+}
@@ -0,0 +1,31 @@
+#ifndef __UNIVERSALREMOTE_PRONTO__
+#define __UNIVERSALREMOTE_PRONTO__
+
+// Conversion between Pronto hex and timing lists. Does not allocate memory.
+// Kept free of Arduino headers, so that it can be compiled and checked on the host.
+//
+// Only learned (modulated) codes are supported. Their format is a list of 4 digit hex words :
+// - 0000               : learned code
+// - frequency code     : carrier period in units of 0.241246 us
+// - once pairs         : number of mark/space pairs sent once
+// - repeat pairs       : number of mark/space pairs sent for every repeat
+// - durations          : the once pairs, then the repeat pairs, in carrier cycles
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PRONTO_CLOCK_HZ         4145146             // 1 / 0.241246 us
+#define PRONTO_TRAILING_GAP     40000               // Space added in microseconds when a timing list ends with a mark
+
+// Converts Pronto hex to a timing list in microseconds, starting with a mark. The once sequence is followed by
+// the repeat sequence repeats times. If there is no once sequence, the repeat sequence is sent at least once.
+// Durations that do not fit 16 bits are split with a zero length entry in between, as done for captures.
+// Returns the number of timings and sets freq_hz, or returns -1 if the format is invalid or max_len is not enough.
+int pronto_to_timings(const char* str, uint16_t repeats, uint16_t* timings, uint16_t max_len, uint32_t* freq_hz);
+
+// Converts a timing list in microseconds, starting with a mark, to Pronto hex with everything in the once sequence.
+// Zero length entries are merged with their neighbours.
+// Returns the length of the string written to out, or -1 if out_size is not enough or freq_hz has no frequency code.
+int timings_to_pronto(const uint16_t* timings, uint16_t len, uint32_t freq_hz, char* out, size_t out_size);
+
+#endif
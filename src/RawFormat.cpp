@@ -0,0 +1,85 @@
+#include "RawFormat.h"
+
+uint16_t rawbuf_to_timings(const volatile uint16_t* rawbuf, uint16_t rawlen, uint16_t tick_us,
+                           uint16_t* timings, uint16_t max_len)
+{
+    uint16_t len = 0;
+
+    for(uint16_t i = 1; i < rawlen; i++)
+    {
+        uint32_t usecs;
+
+        // Here, if a time cannot be shown as single 16 bit integer, it will be split into multiple parts.
+        for(usecs = (uint32_t)rawbuf[i] * tick_us; usecs > UINT16_MAX; usecs -= UINT16_MAX)
+        {
+            if(len + 2 > max_len)
+                return len;
+
+            timings[len++] = UINT16_MAX;
+            timings[len++] = 0;
+        }
+
+        if(len == max_len)
+            return len;
+
+        timings[len++] = usecs;
+    }
+
+    return len;
+}
+
+size_t raw_format_size(uint16_t len)
+{
+    // "-1;" or a protocol number, the count and ':', and up to 5 digits and ',' per entry
+    return 4 + 6 + 6 * (size_t)len + 1;
+}
+
+// Writes the number in decimal, and returns the number of digits
+static size_t write_u16(char* out, uint16_t value)
+{
+    char digits[5];
+    size_t n = 0;
+
+    do
+    {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    }
+    while(value > 0);
+
+    for(size_t i = 0; i < n; i++)
+        out[i] = digits[n - 1 - i];
+
+    return n;
+}
+
+size_t format_raw_timings(char* out, size_t out_size, int protocol, const uint16_t* timings, uint16_t len)
+{
+    if(out_size < raw_format_size(len) || protocol > 999)
+        return 0;
+
+    size_t pos = 0;
+
+    if(protocol < 0)
+    {
+        out[pos++] = '-';
+        out[pos++] = '1';
+    }
+    else
+        pos += write_u16(out + pos, protocol);
+
+    out[pos++] = ';';
+
+    pos += write_u16(out + pos, len);
+    out[pos++] = ':';
+
+    for(uint16_t i = 0; i < len; i++)
+    {
+        pos += write_u16(out + pos, timings[i]);
+        out[pos++] = ',';            // ',' not needed on the last one
+    }
+
+    out[pos] = '\0';
+
+    return pos;
+}
@@ -0,0 +1,24 @@
+#ifndef __UNIVERSALREMOTE_RAW_FORMAT__
+#define __UNIVERSALREMOTE_RAW_FORMAT__
+
+// Conversion of IRrecv captures to timing lists, and the text format of raw messages.
+// Kept free of Arduino headers, so that the host replay tool runs the same code as the device.
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Converts rawbuf entries 1 to rawlen - 1 (in ticks of tick_us) to a timing list in microseconds.
+// Durations that do not fit 16 bits are split with a zero length entry in between.
+// Entries beyond max_len are dropped. Returns the number of timings written.
+uint16_t rawbuf_to_timings(const volatile uint16_t* rawbuf, uint16_t rawlen, uint16_t tick_us,
+                           uint16_t* timings, uint16_t max_len);
+
+// Returns the buffer size needed by format_raw_timings for len timings, including the null termination
+size_t raw_format_size(uint16_t len);
+
+// Writes the timing list in the format returned by GET "/", and null terminates it
+// Format : <protocol detected, -1 if unknown>;<number of raw timing entries>:<timing data seperated by comma>
+// Returns the length written, or 0 if out_size is not enough
+size_t format_raw_timings(char* out, size_t out_size, int protocol, const uint16_t* timings, uint16_t len);
+
+#endif
@@ -0,0 +1,143 @@
+#include "Repeater.h"
+#include "BinLog.h"
+
+#define TAG "repeater"
+
+bool Repeater::is_echo(const decode_results *results, int64_t received_us, uint16_t len)
+{
+    // The end of a frame is detected after a gap of kTimeout
+    int64_t earliest = echo_end_us - REPEATER_ECHO_GUARD * 1000;
+    int64_t latest = echo_end_us + (kTimeout + REPEATER_ECHO_GUARD) * 1000;
+
+    if(echo_start_us == 0 || received_us < earliest || received_us > latest)
+        return false;
+
+    if(results->decode_type != echo_protocol)
+        return false;
+
+    if(echo_protocol != decode_type_t::UNKNOWN)
+        return results->value == echo_value;
+
+    // Unknown frames may lose or gain an edge on the way back
+    return abs((int)len - (int)echo_len) <= 2;
+}
+
+// Sends each received frame on again, unless it is the echo of the last one sent
+void Repeater::on_capture(const decode_results *results, int64_t received_us, void* ctx)
+{
+    Repeater* repeater = (Repeater*)ctx;
+
+    if(!repeater->config.enabled || repeater->timings == NULL)
+        return;
+
+    uint16_t len;
+    decode_type_t protocol;
+    ReceiveHandler::to_timings(results, repeater->timings, kCaptureBufferSize, len, protocol);
+
+    if(repeater->is_echo(results, received_us, len))
+    {
+        repeater->suppressed++;
+        return;
+    }
+
+    esp_err_t ret = repeater->emitters->submit_timings(repeater->config.mask, repeater->timings, len, repeater->config.hz);
+
+    // The channel tasks have a higher priority than the capture task, so the frame starts going out when queued
+    int64_t now = esp_timer_get_time();
+
+    if(ret != ESP_OK)
+    {
+        repeater->failed++;
+        return;
+    }
+
+    uint32_t duration = 0;
+    for(uint16_t i = 0; i < len; i++)
+        duration += repeater->timings[i];
+
+    repeater->echo_start_us = now;
+    repeater->echo_end_us = now + duration;
+    repeater->echo_protocol = results->decode_type;
+    repeater->echo_value = results->value;
+    repeater->echo_len = len;
+
+    repeater->last_latency_us = now - received_us;
+    if(repeater->last_latency_us > repeater->max_latency_us)
+        repeater->max_latency_us = repeater->last_latency_us;
+    repeater->total_latency_us += repeater->last_latency_us;
+    repeater->repeated++;
+}
+
+Repeater::Repeater(ReceiveHandler* recv, EmitterChannels* send)
+{
+    receiver    = recv;
+    emitters    = send;
+
+    config.enabled  = false;
+    config.mask     = 1;
+    config.hz       = kRawCarrierKhz * 1000;
+
+    timings         = NULL;
+    echo_start_us   = 0;
+    echo_end_us     = 0;
+
+    repeated        = 0;
+    suppressed      = 0;
+    failed          = 0;
+    last_latency_us = 0;
+    max_latency_us  = 0;
+    total_latency_us = 0;
+}
+
+esp_err_t Repeater::begin()
+{
+    esp_err_t ret = nvs_open(NVS_IR_NAMESPACE, NVS_READWRITE, &nvs_ir);
+    if(ret != ESP_OK)
+        return ret;
+
+    repeater_config_t saved;
+    size_t size = sizeof(saved);
+
+    // Settings saved when the carrier was kept in 16 bits have another size, and are dropped
+    if(nvs_get_blob(nvs_ir, NVS_REPEATER_KEY, &saved, &size) == ESP_OK && size == sizeof(saved) && saved.enabled)
+        return configure(true, saved.mask, saved.hz);
+
+    return ESP_OK;
+}
+
+esp_err_t Repeater::configure(bool enabled, uint8_t mask, uint32_t hz)
+{
+    if(enabled && (mask == 0 || hz < kMinCarrierHz || hz > kMaxCarrierHz))
+        return ESP_FAIL;
+
+    if(enabled && timings == NULL)
+    {
+        timings = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+        if(timings == NULL)
+            return ESP_ERR_NO_MEM;
+    }
+
+    bool was_enabled = config.enabled;
+
+    config.mask = mask;
+    config.hz = hz;
+    config.enabled = enabled;
+
+    if(enabled && !was_enabled)
+        receiver->add_listener(on_capture, this);
+    else if(!enabled && was_enabled)
+        receiver->remove_listener(on_capture, this);
+
+    BLOGI("Repeater %s, mask %d, carrier %u Hz", enabled ? "on" : "off", mask, hz);
+
+    nvs_set_blob(nvs_ir, NVS_REPEATER_KEY, &config, sizeof(config));
+
+    return nvs_commit(nvs_ir);
+}
+
+void Repeater::get_report(ArenaText &text)
+{
+    text.addf("enabled=%d,mask=%d,hz=%u;repeated=%u,suppressed=%u,failed=%u;latency_us=%u,%u,%u",
+              config.enabled ? 1 : 0, config.mask, config.hz, repeated, suppressed, failed,
+              last_latency_us, max_latency_us, repeated ? (uint32_t)(total_latency_us / repeated) : 0);
+}
@@ -0,0 +1,76 @@
+#ifndef __UNIVERSALREMOTE_REPEATER__
+#define __UNIVERSALREMOTE_REPEATER__
+
+#include <Arduino.h>
+
+#include <nvs.h>
+
+#include "IRHandlers.h"
+#include "IRChannels.h"
+#include "Arena.h"
+
+// NVS key for the repeater settings, in the emitter namespace
+#define NVS_REPEATER_KEY        "repeater"
+
+#define REPEATER_ECHO_GUARD     20                  // Margin in milliseconds around the expected end of an echo
+
+// Saved repeater settings
+struct repeater_config_t
+{
+    bool enabled;
+    uint8_t mask;                                   // Emitter channels
+    uint32_t hz;                                    // Carrier, in Hz
+};
+
+// Re-emits every received frame on the selected emitter channels, as a relay for equipment out of sight.
+// Frames go from the capture task straight to the channel queues as timing lists.
+// The receiver usually sees the retransmission as well, so a frame that matches the last one sent and ends
+// when its retransmission would end is taken as an echo and dropped.
+class Repeater
+{
+private:
+    ReceiveHandler* receiver;
+    EmitterChannels* emitters;
+
+    repeater_config_t config;
+    nvs_handle nvs_ir;
+
+    uint16_t* timings;
+
+    // Last frame sent, for echo suppression
+    int64_t echo_start_us;
+    int64_t echo_end_us;
+    decode_type_t echo_protocol;
+    uint64_t echo_value;
+    uint16_t echo_len;
+
+    // Statistics
+    uint32_t repeated;
+    uint32_t suppressed;
+    uint32_t failed;
+    uint32_t last_latency_us;                       // From the end of the received frame to the retransmission being queued
+    uint32_t max_latency_us;
+    uint64_t total_latency_us;
+
+    static void on_capture(const decode_results *results, int64_t received_us, void* ctx);
+
+    bool is_echo(const decode_results *results, int64_t received_us, uint16_t len);
+
+public:
+    Repeater(ReceiveHandler* recv, EmitterChannels* send);
+
+    // Loads the settings from NVS, and starts repeating if enabled. Must be called after EmitterChannels::begin
+    esp_err_t begin();
+
+    // Turns the repeater on or off, and saves the settings
+    // @param mask  Emitter channels to repeat on
+    // @param hz    Carrier frequency in Hz, from kMinCarrierHz to kMaxCarrierHz
+    // Returns ESP_FAIL if the mask is empty or the carrier out of range
+    esp_err_t configure(bool enabled, uint8_t mask, uint32_t hz);
+
+    // Puts the settings and statistics into the passed string
+    // Format : enabled=<0|1>,mask=<channel mask>,hz=<carrier>;repeated=<n>,suppressed=<n>,failed=<n>;latency_us=<last>,<max>,<average>
+    void get_report(ArenaText &text);
+};
+
+#endif
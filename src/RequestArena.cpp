@@ -0,0 +1,85 @@
+#include "RequestArena.h"
+
+#include <esp_heap_caps.h>
+
+static uint8_t pool_buffers[ARENA_POOL_COUNT][ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+static Arena pool[ARENA_POOL_COUNT];
+static bool pool_used[ARENA_POOL_COUNT];
+static bool pool_ready = false;
+
+static uint32_t requests = 0;
+static uint32_t exhausted = 0;
+
+static portMUX_TYPE pool_mux = portMUX_INITIALIZER_UNLOCKED;
+
+RequestArena::RequestArena()
+{
+    arena = NULL;
+
+    portENTER_CRITICAL(&pool_mux);
+
+    if(!pool_ready)
+    {
+        for(int i = 0; i < ARENA_POOL_COUNT; i++)
+            pool[i].init(pool_buffers[i], ARENA_SIZE);
+        pool_ready = true;
+    }
+
+    for(int i = 0; i < ARENA_POOL_COUNT; i++)
+    {
+        if(!pool_used[i])
+        {
+            pool_used[i] = true;
+            arena = &pool[i];
+            break;
+        }
+    }
+
+    if(arena == NULL)
+        exhausted++;
+    else
+        requests++;
+
+    portEXIT_CRITICAL(&pool_mux);
+}
+
+RequestArena::~RequestArena()
+{
+    if(arena == NULL)
+        return;
+
+    arena->reset();
+
+    portENTER_CRITICAL(&pool_mux);
+    pool_used[arena - pool] = false;
+    portEXIT_CRITICAL(&pool_mux);
+}
+
+void RequestArena::get_report(ArenaText &text)
+{
+    size_t free_size = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    // Share of the free heap that cannot be allocated in one block
+    uint32_t frag = free_size > 0 ? 100 - (uint64_t)largest * 100 / free_size : 0;
+
+    uint8_t in_use = 0;
+    size_t peak = 0;
+
+    portENTER_CRITICAL(&pool_mux);
+    for(int i = 0; i < ARENA_POOL_COUNT; i++)
+    {
+        if(pool_used[i])
+            in_use++;
+        if(pool[i].get_peak() > peak)
+            peak = pool[i].get_peak();
+    }
+    uint32_t total = requests;
+    uint32_t failed = exhausted;
+    portEXIT_CRITICAL(&pool_mux);
+
+    text.addf("free=%u,min_free=%u,largest=%u,frag=%u;", (unsigned)free_size,
+              (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT), (unsigned)largest, frag);
+    text.addf("arenas=%u/%u,size=%u,peak=%u,requests=%u,exhausted=%u", in_use, ARENA_POOL_COUNT, ARENA_SIZE,
+              (unsigned)peak, total, failed);
+}
@@ -0,0 +1,38 @@
+#ifndef __UNIVERSALREMOTE_REQUEST_ARENA__
+#define __UNIVERSALREMOTE_REQUEST_ARENA__
+
+#include <Arduino.h>
+
+#include "Arena.h"
+
+// The pool is static, so that request parsing and formatting do not use the heap.
+// The http server runs one handler at a time, so it needs one arena, plus one per request worker (WORKER_COUNT).
+// The largest request is a Pronto code of kCaptureBufferSize entries, with its text (PRONTO_MAX_STR_LEN) and timings,
+// about 7.2 kB. Reports are built in the arena as well, except the learning session report, which holds the raw frames
+// of up to LEARN_MAX_BUTTONS buttons and is built on the heap.
+#ifndef ARENA_POOL_COUNT
+#define ARENA_POOL_COUNT        3
+#endif
+#ifndef ARENA_SIZE
+#define ARENA_SIZE              8192
+#endif
+
+// Takes an arena from the pool for the scope of a request, and gives it back reset when it goes out of scope.
+// get() returns NULL if all the arenas are in use.
+class RequestArena
+{
+private:
+    Arena* arena;
+
+public:
+    RequestArena();
+    ~RequestArena();
+
+    Arena* get() { return arena; }
+
+    // Appends the pool and heap statistics to the string
+    // Format : free=<bytes>,min_free=<bytes>,largest=<bytes>,frag=<percent>;arenas=<in use>/<count>,size=<bytes>,peak=<bytes>,requests=<n>,exhausted=<n>
+    static void get_report(ArenaText &text);
+};
+
+#endif
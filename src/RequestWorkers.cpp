@@ -0,0 +1,246 @@
+#include "RequestWorkers.h"
+
+#include "TaskConfig.h"
+#include "BinLog.h"
+
+#define TAG "workers"
+
+// Runs the queued requests, each with its own arena
+void RequestWorkers::worker_task(void* param)
+{
+    RequestWorkers* workers = (RequestWorkers*)param;
+    worker_job_t job;
+
+    for(;;)
+    {
+        xQueueReceive(workers->queue, &job, portMAX_DELAY);
+
+        worker_endpoint_t* endpoint = &workers->endpoints[job.endpoint];
+        int64_t start = esp_timer_get_time();
+
+        {
+            RequestArena arena;
+
+            if(arena.get() == NULL)
+                send_response(job, "text/plain", "Busy", strlen("Busy"));
+            else
+            {
+                size_t len = 0;
+                const char* body = endpoint->handler(*arena.get(), job.arg, job.data, len);
+
+                if(!send_response(job, endpoint->type, body, len))
+                    BLOGW("Client of %s went away", endpoint->name);
+            }
+        }
+
+        int64_t end = esp_timer_get_time();
+
+        portENTER_CRITICAL(&workers->mux);
+        endpoint->active--;
+        if(endpoint->is_long)
+            workers->long_active--;
+        endpoint->completed++;
+        endpoint->wait_us += start - job.queued_us;
+        endpoint->run_us += end - start;
+        portEXIT_CRITICAL(&workers->mux);
+    }
+}
+
+bool RequestWorkers::send_response(worker_job_t &job, const char* type, const char* body, size_t len)
+{
+    worker_response_t response = {&job, type, body, len, xTaskGetCurrentTaskHandle(), false};
+
+    // The body is in the arena of the worker, which is kept until the server task is done with it.
+    // Work queued on the server is always run, even when it stops
+    if(httpd_queue_work(job.server, send_work, &response) != ESP_OK)
+        return false;
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return response.sent;
+}
+
+void RequestWorkers::send_work(void* arg)
+{
+    worker_response_t* response = (worker_response_t*)arg;
+    const worker_job_t* job = response->job;
+
+    // The socket may have been closed by the client, and its number given to another connection since
+    if(httpd_sess_get_ctx(job->server, job->sockfd) == job->session)
+    {
+        char header[128];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                                  response->type, (unsigned)response->len);
+
+        const char* parts[2] = {header, response->body};
+        size_t lengths[2] = {(size_t)header_len, response->len};
+
+        response->sent = true;
+
+        for(int i = 0; i < 2 && response->sent; i++)
+        {
+            size_t sent = 0;
+
+            // The socket may take the data in several parts
+            while(sent < lengths[i])
+            {
+                int ret = httpd_socket_send(job->server, job->sockfd, parts[i] + sent, lengths[i] - sent, 0);
+                if(ret <= 0)
+                {
+                    response->sent = false;
+                    break;
+                }
+
+                sent += ret;
+            }
+        }
+
+        // The response has no keep-alive, so that the server does not wait for another request on the socket
+        httpd_sess_trigger_close(job->server, job->sockfd);
+    }
+
+    xTaskNotifyGive(response->worker);
+}
+
+// A client that sends another request before getting the response has its connection closed,
+// as both would be answered out of order
+int RequestWorkers::detached_recv(httpd_handle_t server, int sockfd, char* buf, size_t buf_len, int flags)
+{
+    return 0;
+}
+
+void RequestWorkers::session_closed(void* ctx)
+{
+}
+
+RequestWorkers::RequestWorkers()
+{
+    memset(endpoints, 0, sizeof(endpoints));
+
+    queue = NULL;
+    for(int i = 0; i < WORKER_COUNT; i++)
+        workerTasks_h[i] = NULL;
+
+    long_active = 0;
+    next_session = 0;
+
+    mux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+esp_err_t RequestWorkers::begin()
+{
+    queue = static_queue_create(queue_storage);
+    if(queue == NULL)
+        return ESP_ERR_NO_MEM;
+
+    for(int i = 0; i < WORKER_COUNT; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "http worker %d", i);
+
+        workerTasks_h[i] = static_task_create(worker_task_storage[i], worker_task, name, this, SERVER_TASK_PRIO, SERVER_TASK_CORE);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t RequestWorkers::add_endpoint(uint8_t id, const char* name, worker_handler_t handler, const char* type, uint8_t max_active,
+                                       bool is_long)
+{
+    if(id >= WORKER_MAX_ENDPOINTS || handler == NULL)
+        return ESP_FAIL;
+
+    worker_endpoint_t* endpoint = &endpoints[id];
+
+    endpoint->name          = name;
+    endpoint->handler       = handler;
+    endpoint->type          = type;
+    endpoint->max_active    = max_active;
+    endpoint->is_long       = is_long;
+
+    return ESP_OK;
+}
+
+esp_err_t RequestWorkers::submit(httpd_req_t *req, uint8_t id, uint32_t arg, const void* data, size_t data_len)
+{
+    worker_endpoint_t* endpoint = &endpoints[id];
+    bool accepted = false;
+
+    portENTER_CRITICAL(&mux);
+    if(queue != NULL && endpoint->handler != NULL && endpoint->active < endpoint->max_active && data_len <= WORKER_DATA_SIZE &&
+       (!endpoint->is_long || long_active < WORKER_LONG_LIMIT))
+    {
+        endpoint->active++;
+        if(endpoint->is_long)
+            long_active++;
+        accepted = true;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    // The session gets a token of its own, which the server task checks before writing the response.
+    // Tokens are only made here, on the server task
+    if(++next_session == 0)
+        next_session = 1;
+
+    void* session = (void*)(uintptr_t)next_session;
+
+    worker_job_t job = {id, req->handle, httpd_req_to_sockfd(req), session, arg, esp_timer_get_time()};
+    if(data_len > 0)
+        memcpy(job.data, data, data_len);
+
+    if(accepted && xQueueSend(queue, &job, 0) != pdTRUE)
+    {
+        portENTER_CRITICAL(&mux);
+        endpoint->active--;
+        if(endpoint->is_long)
+            long_active--;
+        portEXIT_CRITICAL(&mux);
+
+        accepted = false;
+    }
+
+    portENTER_CRITICAL(&mux);
+    if(accepted)
+    {
+        endpoint->accepted++;
+        if(endpoint->active > endpoint->peak)
+            endpoint->peak = endpoint->active;
+    }
+    else
+        endpoint->rejected++;
+    portEXIT_CRITICAL(&mux);
+
+    if(!accepted)
+    {
+        httpd_resp_send(req, "Busy", strlen("Busy"));
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The server keeps the context of the request for the session once the handler returns
+    req->sess_ctx = session;
+    req->free_ctx = session_closed;
+
+    httpd_sess_set_recv_override(req->handle, job.sockfd, detached_recv);
+
+    return ESP_OK;
+}
+
+void RequestWorkers::get_report(ArenaText &text)
+{
+    for(int i = 0; i < WORKER_MAX_ENDPOINTS; i++)
+    {
+        portENTER_CRITICAL(&mux);
+        worker_endpoint_t endpoint = endpoints[i];
+        portEXIT_CRITICAL(&mux);
+
+        if(endpoint.handler == NULL)
+            continue;
+
+        uint32_t wait = endpoint.completed > 0 ? endpoint.wait_us / endpoint.completed : 0;
+        uint32_t run = endpoint.completed > 0 ? endpoint.run_us / endpoint.completed : 0;
+
+        text.addf("%s,%u,%u,%u,%u,%u,%u,%u,%u\n", endpoint.name, endpoint.active, endpoint.max_active, endpoint.peak,
+                  endpoint.accepted, endpoint.rejected, endpoint.completed, wait, run);
+    }
+}
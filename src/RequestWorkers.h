@@ -0,0 +1,119 @@
+#ifndef __UNIVERSALREMOTE_REQUEST_WORKERS__
+#define __UNIVERSALREMOTE_REQUEST_WORKERS__
+
+#include <Arduino.h>
+
+#include <esp_http_server.h>
+
+#include "RequestArena.h"
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
+#define WORKER_COUNT            2
+#define WORKER_QUEUE_LEN        8
+#define WORKER_MAX_ENDPOINTS    8
+#define WORKER_DATA_SIZE        24                  // Bytes of parameters that a request can pass to its worker
+#define WORKER_LONG_LIMIT       (WORKER_COUNT - 1)  // Long requests queued or running at once, so that a worker is left for the others
+
+// Produces the response of an offloaded request, allocated from the arena, and sets len to its length.
+// arg and data are set by the http handler from the request, which is not available anymore.
+// data points to a copy of the parameters passed to submit, and is only valid during the call.
+typedef const char* (*worker_handler_t)(Arena &arena, uint32_t arg, const void* data, size_t &len);
+
+struct worker_endpoint_t
+{
+    const char* name;
+    worker_handler_t handler;
+    const char* type;                               // Content type of the response
+    uint8_t max_active;                             // Requests queued or running at once, beyond which "Busy" is sent
+    bool is_long;                                   // Holds a worker for seconds, such as a capture, see WORKER_LONG_LIMIT
+
+    uint8_t active;
+    uint8_t peak;
+    uint32_t accepted;
+    uint32_t rejected;
+    uint32_t completed;
+    int64_t wait_us;                                // Total time spent in the queue
+    int64_t run_us;                                 // Total time spent in the handler
+};
+
+struct worker_job_t
+{
+    uint8_t endpoint;
+    httpd_handle_t server;
+    int sockfd;
+    void* session;                                  // Context given to the session by submit, see session_open
+    uint32_t arg;
+    int64_t queued_us;
+    uint8_t data[WORKER_DATA_SIZE];
+};
+
+// Response of a job, written to the socket by the server task
+struct worker_response_t
+{
+    const worker_job_t* job;
+    const char* type;
+    const char* body;
+    size_t len;
+    TaskHandle_t worker;                            // Notified once the response has been sent or dropped
+    bool sent;
+};
+
+// Takes slow requests (captures, scans) off the http server task, which runs every handler in turn, so that
+// the other requests are not held up by them. The http handler hands the socket over with submit and returns
+// without responding, and the server reads no more requests from it. A worker then runs the endpoint handler,
+// and has the server task write the response and close the connection, if the client is still connected.
+class RequestWorkers
+{
+private:
+    worker_endpoint_t endpoints[WORKER_MAX_ENDPOINTS];
+
+    QueueHandle_t queue;
+    TaskHandle_t workerTasks_h[WORKER_COUNT];
+    static_queue_t<worker_job_t, WORKER_QUEUE_LEN> queue_storage;
+    static_task_t<WORKER_TASK_STACK> worker_task_storage[WORKER_COUNT];
+
+    uint8_t long_active;                            // Requests of the long endpoints queued or running
+    uint32_t next_session;
+
+    portMUX_TYPE mux;
+
+    static void worker_task(void* param);
+
+    // Has the server task send the response, and waits until it has. Returns false if the client went away
+    static bool send_response(worker_job_t &job, const char* type, const char* body, size_t len);
+
+    // Runs on the server task. Writes the status line, headers and body to the socket and closes the connection,
+    // if the socket is still the session of the job
+    static void send_work(void* arg);
+
+    // Receive function of the sessions handed over to a worker
+    static int detached_recv(httpd_handle_t server, int sockfd, char* buf, size_t buf_len, int flags);
+
+    // Session contexts are tokens, which are not freed
+    static void session_closed(void* ctx);
+
+public:
+    RequestWorkers();
+
+    // Creates the queue and the worker tasks
+    esp_err_t begin();
+
+    // Sets up endpoint id, which is a number below WORKER_MAX_ENDPOINTS chosen by the caller.
+    // Requests of the long endpoints share WORKER_LONG_LIMIT workers, on top of their own limit
+    esp_err_t add_endpoint(uint8_t id, const char* name, worker_handler_t handler, const char* type, uint8_t max_active,
+                           bool is_long = false);
+
+    // Queues the request for endpoint id, with data_len bytes of data (up to WORKER_DATA_SIZE) for the handler.
+    // The request content has to be read before.
+    // If ESP_OK is returned, the http handler has to return ESP_OK without responding.
+    // Otherwise "Busy" has been sent, as the endpoint is at its limit or the queue is full.
+    // Runs on the server task, as it sets the session context of the request.
+    esp_err_t submit(httpd_req_t *req, uint8_t id, uint32_t arg, const void* data = NULL, size_t data_len = 0);
+
+    // Appends a line per endpoint to the string
+    // Format : <name>,<active>,<limit>,<peak>,<accepted>,<rejected>,<completed>,<average queue wait in us>,<average run time in us>
+    void get_report(ArenaText &text);
+};
+
+#endif
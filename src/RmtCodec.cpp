@@ -0,0 +1,123 @@
+#include "RmtCodec.h"
+
+// Number of half items needed for a duration
+static inline uint32_t rmt_pieces(uint32_t ticks)
+{
+    return (ticks + RMT_MAX_DURATION - 1) / RMT_MAX_DURATION;
+}
+
+// Converts microseconds to ticks, rounding to the nearest tick
+static inline uint32_t rmt_ticks(uint16_t usecs, uint8_t tick_us)
+{
+    return ((uint32_t)usecs + tick_us / 2) / tick_us;
+}
+
+size_t rmt_items_needed(const uint16_t* timings, uint16_t len, uint8_t tick_us)
+{
+    uint32_t halves = 0;
+
+    for(uint16_t i = 0; i < len; i++)
+        halves += rmt_pieces(rmt_ticks(timings[i], tick_us));
+
+    return (halves + 1) / 2;
+}
+
+size_t rmt_encode_timings(const uint16_t* timings, uint16_t len, uint8_t tick_us, rmt_code_item_t* items, size_t max_items)
+{
+    size_t count = 0;
+    bool half = false;
+
+    for(uint16_t i = 0; i < len; i++)
+    {
+        uint32_t level = (i % 2 == 0) ? 1 : 0;
+        uint32_t ticks = rmt_ticks(timings[i], tick_us);
+
+        while(ticks > 0)
+        {
+            uint32_t piece = ticks > RMT_MAX_DURATION ? RMT_MAX_DURATION : ticks;
+            ticks -= piece;
+
+            if(!half)
+            {
+                if(count == max_items)
+                    return 0;
+
+                items[count].duration0 = piece;
+                items[count].level0 = level;
+                half = true;
+            }
+            else
+            {
+                items[count].duration1 = piece;
+                items[count].level1 = level;
+                count++;
+                half = false;
+            }
+        }
+    }
+
+    // A zero duration ends the transmission
+    if(half)
+    {
+        items[count].duration1 = 0;
+        items[count].level1 = 0;
+        count++;
+    }
+
+    return count;
+}
+
+uint16_t rmt_decode_items(const rmt_code_item_t* items, size_t count, uint8_t mark_level,
+                          uint16_t* rawbuf, uint16_t bufsize, bool* overflow)
+{
+    uint16_t rawlen = 1;
+    uint32_t current = 0;
+    bool is_mark = false;
+
+    *overflow = false;
+
+    if(bufsize == 0)
+        return 0;
+
+    rawbuf[0] = 0;
+
+    for(size_t i = 0; i < 2 * count; i++)
+    {
+        uint32_t duration = (i % 2 == 0) ? items[i / 2].duration0 : items[i / 2].duration1;
+        uint32_t level = (i % 2 == 0) ? items[i / 2].level0 : items[i / 2].level1;
+
+        if(duration == 0)
+            break;
+
+        bool mark = (level == mark_level);
+
+        // The frame starts at the first mark
+        if(rawlen == 1 && current == 0 && !mark)
+            continue;
+
+        if(current != 0 && mark != is_mark)
+        {
+            if(rawlen == bufsize)
+            {
+                *overflow = true;
+                return rawlen;
+            }
+
+            rawbuf[rawlen++] = current > UINT16_MAX ? UINT16_MAX : current;
+            current = 0;
+        }
+
+        is_mark = mark;
+        current += duration;
+    }
+
+    if(current != 0)
+    {
+        if(rawlen == bufsize)
+            *overflow = true;
+        else
+            rawbuf[rawlen++] = current > UINT16_MAX ? UINT16_MAX : current;
+    }
+
+    return rawlen;
+}
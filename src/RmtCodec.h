@@ -0,0 +1,42 @@
+#ifndef __UNIVERSALREMOTE_RMT_CODEC__
+#define __UNIVERSALREMOTE_RMT_CODEC__
+
+// Conversion between raw IR timing lists and RMT peripheral items.
+// Kept free of Arduino and ESP-IDF headers, so that it can be compiled and checked on the host.
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Largest duration (in ticks) that fits in one half of an RMT item
+#define RMT_MAX_DURATION    32767
+
+// Same layout as rmt_item32_t of the ESP-IDF RMT driver
+typedef struct
+{
+    uint32_t duration0 : 15;
+    uint32_t level0 : 1;
+    uint32_t duration1 : 15;
+    uint32_t level1 : 1;
+} rmt_code_item_t;
+
+// Returns the number of items rmt_encode_timings will produce for the timing list
+// @param timings   Mark and space durations in microseconds, starting with a mark
+// @param len       Number of entries in timings
+// @param tick_us   Duration of one RMT tick in microseconds
+size_t rmt_items_needed(const uint16_t* timings, uint16_t len, uint8_t tick_us);
+
+// Converts a timing list to RMT items. Marks are encoded with level 1 and spaces with level 0.
+// Durations longer than RMT_MAX_DURATION are split, and zero length entries are skipped.
+// Returns the number of items written, or 0 if max_items is not enough.
+size_t rmt_encode_timings(const uint16_t* timings, uint16_t len, uint8_t tick_us, rmt_code_item_t* items, size_t max_items);
+
+// Converts RMT items received from an IR receiver to the rawbuf layout used by IRrecv. 
+// rawbuf[0] is set to 0 as the gap before the frame is unknown, and the frame starts at rawbuf[1].
+// Durations are kept in RMT ticks, so the RMT tick should be set to kRawTick.
+// Leading spaces are skipped, pieces with the same level are merged and a zero duration ends the frame.
+// Returns the number of entries used in rawbuf (rawlen), and sets overflow if the frame was truncated.
+// @param mark_level    Level of the receiver output during a mark (0 for active low receivers)
+uint16_t rmt_decode_items(const rmt_code_item_t* items, size_t count, uint8_t mark_level,
+                          uint16_t* rawbuf, uint16_t bufsize, bool* overflow);
+
+#endif
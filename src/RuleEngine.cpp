@@ -0,0 +1,369 @@
+#include "RuleEngine.h"
+#include "BinLog.h"
+
+#define TAG "rules"
+
+// Protocol number used in rules, as in the output of ReceiveHandler::get_raw
+static int16_t rule_protocol(decode_type_t type)
+{
+    if(type == decode_type_t::UNKNOWN || type > decode_type_t::kLastDecodeType)
+        return -1;
+
+    return type;
+}
+
+uint32_t RuleEngine::hash(int16_t protocol, uint64_t value, uint16_t bits)
+{
+    // The bit count of unknown frames depends on their length, which the timing hash already covers
+    if(protocol < 0)
+        bits = 0;
+
+    uint32_t h = (uint32_t)value ^ (uint32_t)(value >> 32);
+    h ^= ((uint32_t)(uint16_t)protocol << 16) | bits;
+
+    // Finalizer of MurmurHash3, so that nearby values spread over the table
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+ir_rule_t* RuleEngine::find(int16_t protocol, uint64_t value, uint16_t bits)
+{
+    uint32_t slot = hash(protocol, value, bits) & (RULES_HASH_SIZE - 1);
+
+    // Linear probing. The table is never full, so an empty slot ends the search
+    while(table[slot] != 0)
+    {
+        ir_rule_t* rule = &rules[table[slot] - 1];
+
+        if(rule->def.protocol == protocol && rule->def.value == value && (protocol < 0 || rule->def.bits == bits))
+            return rule;
+
+        slot = (slot + 1) & (RULES_HASH_SIZE - 1);
+    }
+
+    return NULL;
+}
+
+// Looks up the frame and queues the actions of the matching rule
+void RuleEngine::on_capture(const decode_results *results, int64_t received_us, void* ctx)
+{
+    RuleEngine* engine = (RuleEngine*)ctx;
+
+    // Repeat codes carry no value
+    if(results->repeat)
+        return;
+
+    xSemaphoreTake(engine->lock, portMAX_DELAY);
+
+    ir_rule_t* rule = engine->find(rule_protocol(results->decode_type), results->value, results->bits);
+
+    if(rule != NULL)
+    {
+        for(uint8_t i = 0; i < rule->action_count; i++)
+        {
+            rule_action_t* action = &rule->actions[i];
+
+            if(action->type == RULE_CODE)
+                engine->emitters->submit_timings(rule->def.mask, action->timings, action->len, kRawCarrierKhz);
+            else
+                engine->emitters->submit_ac(rule->def.mask, action->state);
+
+            if(i == 0)
+            {
+                rule->last_latency_us = esp_timer_get_time() - received_us;
+                if(rule->last_latency_us > rule->max_latency_us)
+                    rule->max_latency_us = rule->last_latency_us;
+            }
+        }
+
+        rule->hits++;
+    }
+
+    xSemaphoreGive(engine->lock);
+}
+
+esp_err_t RuleEngine::prepare(ir_rule_t* rule)
+{
+    rule->action_count = 0;
+    rule->hits = 0;
+    rule->last_latency_us = 0;
+    rule->max_latency_us = 0;
+
+    uint16_t* timings = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+    if(timings == NULL)
+        return ESP_ERR_NO_MEM;
+
+    esp_err_t ret = ESP_OK;
+    const char* next = rule->def.actions;
+
+    while(*next != '\0' && ret == ESP_OK)
+    {
+        const char* end = strchr(next, ';');
+        size_t len = end != NULL ? end - next : strlen(next);
+
+        char item[RULE_ACTIONS_MAX_LEN + 1];
+        memcpy(item, next, len);
+        item[len] = '\0';
+
+        next += end != NULL ? len + 1 : len;
+
+        if(rule->action_count == RULE_MAX_ACTIONS)
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+
+        rule_action_t* action = &rule->actions[rule->action_count];
+        action->timings = NULL;
+        action->state = NULL;
+
+        if(strncmp(item, "code:", 5) == 0)
+        {
+            uint16_t count;
+
+            ret = codes->load(item + 5, timings, kCaptureBufferSize, count);
+            if(ret != ESP_OK)
+                break;
+
+            action->type = RULE_CODE;
+            action->len = count;
+            action->timings = (uint16_t*)malloc(count * sizeof(uint16_t));
+            if(action->timings == NULL)
+            {
+                ret = ESP_ERR_NO_MEM;
+                break;
+            }
+            memcpy(action->timings, timings, count * sizeof(uint16_t));
+        }
+        else if(strncmp(item, "ac:", 3) == 0 && strchr(item, ',') != NULL)
+        {
+            action->type = RULE_AC;
+            action->state = strdup(item + 3);
+            if(action->state == NULL)
+            {
+                ret = ESP_ERR_NO_MEM;
+                break;
+            }
+        }
+        else
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+
+        rule->action_count++;
+    }
+
+    free(timings);
+
+    if(ret == ESP_OK && rule->action_count == 0)
+        ret = ESP_FAIL;
+
+    if(ret != ESP_OK)
+        release(rule);
+
+    return ret;
+}
+
+void RuleEngine::release(ir_rule_t* rule)
+{
+    for(uint8_t i = 0; i < rule->action_count; i++)
+    {
+        free(rule->actions[i].timings);
+        free(rule->actions[i].state);
+    }
+
+    rule->action_count = 0;
+}
+
+void RuleEngine::update()
+{
+    memset(table, 0, sizeof(table));
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        uint32_t slot = hash(rules[i].def.protocol, rules[i].def.value, rules[i].def.bits) & (RULES_HASH_SIZE - 1);
+
+        while(table[slot] != 0)
+            slot = (slot + 1) & (RULES_HASH_SIZE - 1);
+
+        table[slot] = i + 1;
+    }
+
+    ir_rule_def_t* defs = (ir_rule_def_t*)malloc(RULES_MAX * sizeof(ir_rule_def_t));
+    if(defs == NULL)
+        return;
+
+    for(uint8_t i = 0; i < count; i++)
+        defs[i] = rules[i].def;
+
+    nvs_set_blob(nvs_rules, NVS_RULES_KEY, defs, count * sizeof(ir_rule_def_t));
+    nvs_commit(nvs_rules);
+
+    free(defs);
+}
+
+RuleEngine::RuleEngine(ReceiveHandler* recv, EmitterChannels* send, CodeStore* store)
+{
+    receiver    = recv;
+    emitters    = send;
+    codes       = store;
+
+    count       = 0;
+    next_id     = 1;
+    memset(table, 0, sizeof(table));
+
+    lock        = static_mutex_create(lock_storage);
+}
+
+esp_err_t RuleEngine::begin()
+{
+    esp_err_t ret = nvs_open(NVS_RULES_NAMESPACE, NVS_READWRITE, &nvs_rules);
+    if(ret != ESP_OK)
+        return ret;
+
+    ir_rule_def_t* defs = (ir_rule_def_t*)malloc(RULES_MAX * sizeof(ir_rule_def_t));
+    size_t size = RULES_MAX * sizeof(ir_rule_def_t);
+
+    if(defs != NULL && nvs_get_blob(nvs_rules, NVS_RULES_KEY, defs, &size) == ESP_OK && size % sizeof(ir_rule_def_t) == 0)
+    {
+        for(uint8_t i = 0; i < size / sizeof(ir_rule_def_t); i++)
+        {
+            rules[count].def = defs[i];
+            rules[count].def.actions[RULE_ACTIONS_MAX_LEN] = '\0';
+
+            if(defs[i].id >= next_id)
+                next_id = defs[i].id + 1;
+
+            // Rules whose codes have been deleted are dropped
+            if(prepare(&rules[count]) == ESP_OK)
+                count++;
+            else
+                BLOGI("Dropped rule %d", defs[i].id);
+        }
+    }
+
+    free(defs);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    update();
+    xSemaphoreGive(lock);
+
+    BLOGI("Loaded %d rules", count);
+
+    if(count > 0)
+        receiver->add_listener(on_capture, this);
+
+    return ESP_OK;
+}
+
+esp_err_t RuleEngine::add(uint8_t mask, const char* str, uint16_t &id)
+{
+    ir_rule_t rule = {};
+    char* end;
+
+    long protocol = strtol(str, &end, 10);
+    if(end == str || *end != ',' || protocol < -1 || protocol > decode_type_t::kLastDecodeType)
+        return ESP_FAIL;
+
+    const char* field = end + 1;
+    rule.def.value = strtoull(field, &end, 16);
+    if(end == field || *end != ',')
+        return ESP_FAIL;
+
+    field = end + 1;
+    rule.def.bits = strtoul(field, &end, 10);
+    if(end == field || *end != ';' || strlen(end + 1) > RULE_ACTIONS_MAX_LEN)
+        return ESP_FAIL;
+
+    rule.def.protocol = protocol;
+    rule.def.mask = mask;
+    strcpy(rule.def.actions, end + 1);
+
+    // Stored codes are loaded outside of the lock, so that the capture task is not held up
+    esp_err_t ret = prepare(&rule);
+    if(ret != ESP_OK)
+        return ret;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    if(count == RULES_MAX || find(rule.def.protocol, rule.def.value, rule.def.bits) != NULL)
+        ret = ESP_FAIL;
+    else
+    {
+        rule.def.id = next_id++;
+        rules[count++] = rule;
+        update();
+    }
+
+    xSemaphoreGive(lock);
+
+    if(ret != ESP_OK)
+    {
+        release(&rule);
+        return ret;
+    }
+
+    id = rule.def.id;
+
+    if(count == 1)
+        receiver->add_listener(on_capture, this);
+
+    return ESP_OK;
+}
+
+esp_err_t RuleEngine::remove(uint16_t id)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(rules[i].def.id != id)
+            continue;
+
+        release(&rules[i]);
+        rules[i] = rules[--count];
+        update();
+
+        ret = ESP_OK;
+        break;
+    }
+
+    xSemaphoreGive(lock);
+
+    if(ret == ESP_OK && count == 0)
+        receiver->remove_listener(on_capture, this);
+
+    return ret;
+}
+
+void RuleEngine::list(ArenaText &text)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        ir_rule_t* rule = &rules[i];
+
+        // Upper case hex without leading zeros, as uint64ToString writes it
+        uint32_t high = rule->def.value >> 32;
+        uint32_t low = rule->def.value;
+
+        text.addf("%d,%d,", rule->def.id, rule->def.protocol);
+        if(high != 0)
+            text.addf("%X%08X", high, low);
+        else
+            text.addf("%X", low);
+        text.addf(",%d,%d,%u,%u,%u;%s\n", rule->def.bits, rule->def.mask, rule->hits, rule->last_latency_us,
+                  rule->max_latency_us, rule->def.actions);
+    }
+
+    xSemaphoreGive(lock);
+}
@@ -0,0 +1,117 @@
+#ifndef __UNIVERSALREMOTE_RULE_ENGINE__
+#define __UNIVERSALREMOTE_RULE_ENGINE__
+
+#include <Arduino.h>
+
+#include <nvs.h>
+
+#include "IRHandlers.h"
+#include "IRChannels.h"
+#include "CodeStore.h"
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
+// NVS namespace and key for the rule list
+#define NVS_RULES_NAMESPACE     "irRules"
+#define NVS_RULES_KEY           "rules"
+
+#define RULES_MAX               16
+#define RULES_HASH_SIZE         32                  // Power of two, at least twice RULES_MAX
+#define RULE_MAX_ACTIONS        4
+#define RULE_ACTIONS_MAX_LEN    191
+
+enum rule_action_type_t
+{
+    RULE_CODE,                                      // Send a stored code
+    RULE_AC                                         // Send an AC state
+};
+
+// A rule as given by the client, and stored in NVS
+struct ir_rule_def_t
+{
+    uint16_t id;
+    int16_t protocol;                               // decode_type_t, -1 for unknown
+    uint16_t bits;
+    uint8_t mask;                                   // Emitter channels for the actions
+    uint64_t value;                                 // Decoded value, or the timing hash of IRrecv for unknown protocols
+    char actions[RULE_ACTIONS_MAX_LEN + 1];
+};
+
+// An action ready to be queued, with the stored code already loaded
+struct rule_action_t
+{
+    rule_action_type_t type;
+    uint16_t* timings;                              // For RULE_CODE
+    uint16_t len;
+    char* state;                                    // For RULE_AC
+};
+
+struct ir_rule_t
+{
+    ir_rule_def_t def;
+
+    rule_action_t actions[RULE_MAX_ACTIONS];
+    uint8_t action_count;
+
+    // Statistics
+    uint32_t hits;
+    uint32_t last_latency_us;                       // From the end of the frame to the first action being queued
+    uint32_t max_latency_us;
+};
+
+// Sends codes or AC states when a given code is received, so that a remote can drive other devices.
+// Frames are matched by protocol and value, or for unknown protocols by the timing hash computed by IRrecv,
+// which tolerates small timing differences. The rules are looked up in a hash table from the capture task,
+// and the actions are queued from there, with stored codes loaded in advance.
+class RuleEngine
+{
+private:
+    ReceiveHandler* receiver;
+    EmitterChannels* emitters;
+    CodeStore* codes;
+
+    ir_rule_t rules[RULES_MAX];
+    uint8_t count;
+    uint8_t table[RULES_HASH_SIZE];                 // Index + 1 of the rule in each slot, 0 if empty
+    uint16_t next_id;
+
+    nvs_handle nvs_rules;
+    SemaphoreHandle_t lock;                         // Guards the rules against the capture task
+    StaticSemaphore_t lock_storage;
+
+    static void on_capture(const decode_results *results, int64_t received_us, void* ctx);
+
+    static uint32_t hash(int16_t protocol, uint64_t value, uint16_t bits);
+
+    // Returns the rule matching the frame, or NULL. Called with the lock held
+    ir_rule_t* find(int16_t protocol, uint64_t value, uint16_t bits);
+
+    // Parses the actions of the rule and loads its stored codes
+    esp_err_t prepare(ir_rule_t* rule);
+    static void release(ir_rule_t* rule);
+
+    // Rebuilds the hash table and writes the rules to NVS. Called with the lock held
+    void update();
+
+public:
+    RuleEngine(ReceiveHandler* recv, EmitterChannels* send, CodeStore* store);
+
+    // Loads the rules from NVS, and starts listening if there are any. Must be called after nvs_flash_init
+    esp_err_t begin();
+
+    // Parses and adds a rule for the channels in mask, and sets id to its id. Returns ESP_ERR_NOT_FOUND if a stored code
+    // does not exist, or ESP_FAIL if the format is invalid, the trigger is already used or the list is full
+    // Format : <protocol>,<value in hex>,<bits>;<action>;<action>... with up to RULE_MAX_ACTIONS actions,
+    // each code:<stored code name> or ac:<AC state>
+    // Sample : 3,20DF10EF,32;code:amp_power;ac:10,1,0,1,25,1,2,4,2,1,0,1,1,0,0,1,-1,-1
+    esp_err_t add(uint8_t mask, const char* str, uint16_t &id);
+
+    // Removes a rule. Returns ESP_ERR_NOT_FOUND if there is none with the id
+    esp_err_t remove(uint16_t id);
+
+    // Puts the rules and their statistics into the passed string, one line per rule
+    // Format : <id>,<protocol>,<value in hex>,<bits>,<channel mask>,<hits>,<last latency in us>,<max latency in us>;<actions>
+    void list(ArenaText &text);
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "Scheduler.h"
+
+#include <sys/time.h>
+
+#include "TaskConfig.h"
+#include "BinLog.h"
+
+#define TAG "sched"
+
+int64_t Scheduler::clock(void* ctx)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+bool Scheduler::time_valid()
+{
+    return time(NULL) > SCHED_MIN_VALID_TIME;
+}
+
+// Sleeps until the next job is due, or the job list changes, and runs the jobs that are due
+void Scheduler::sched_task(void* param)
+{
+    Scheduler* sched = (Scheduler*)param;
+    bool synced = false;
+
+    for(;;)
+    {
+        TickType_t wait;
+
+        if(!time_valid())
+            wait = SCHED_SYNC_CHECK_PER / portTICK_PERIOD_MS;
+        else
+        {
+            xSemaphoreTake(sched->lock, portMAX_DELAY);
+            int64_t wait_ms = sched->heap.next_wait();
+            xSemaphoreGive(sched->lock);
+
+            if(wait_ms < 0 || wait_ms > SCHED_MAX_SLEEP)
+                wait_ms = SCHED_MAX_SLEEP;
+
+            // Rounded up, so that the job is due on waking
+            wait = (wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+        }
+
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        if(!time_valid())
+            continue;
+
+        // The saved next runs of repeating jobs are those of the last change to the list, so a job due now
+        // may have run before the reboot
+        if(!synced)
+        {
+            xSemaphoreTake(sched->lock, portMAX_DELAY);
+            sched->heap.skip_due_repeats();
+            xSemaphoreGive(sched->lock);
+
+            synced = true;
+        }
+
+        for(;;)
+        {
+            sched_job_t job;
+
+            // Repeating jobs stay in the list, which is saved when a job that runs once is done or skipped
+            xSemaphoreTake(sched->lock, portMAX_DELAY);
+            uint16_t count = sched->heap.size();
+            bool due = sched->heap.pop_due(&job);
+            if(sched->heap.size() != count)
+                sched->save();
+            xSemaphoreGive(sched->lock);
+
+            if(!due)
+                break;
+
+            if(sched->run(job) == ESP_OK)
+                sched->executed++;
+            else
+                sched->failed++;
+
+            BLOGI("Ran job %d : %s", job.id, job.arg);
+        }
+    }
+}
+
+esp_err_t Scheduler::run(const sched_job_t &job)
+{
+    if(job.action == SCHED_AC)
+        return emitters->submit_ac(job.mask, job.arg);
+
+    uint16_t* timings = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+    uint16_t len;
+
+    if(timings == NULL)
+        return ESP_ERR_NO_MEM;
+
+    esp_err_t ret = codes->load(job.arg, timings, kCaptureBufferSize, len);
+    if(ret == ESP_OK)
+        ret = emitters->submit_timings(job.mask, timings, len, kRawCarrierKhz);
+
+    free(timings);
+
+    return ret;
+}
+
+void Scheduler::save()
+{
+    nvs_set_blob(nvs_sched, NVS_SCHED_JOBS_KEY, jobs, heap.size() * sizeof(sched_job_t));
+    nvs_commit(nvs_sched);
+}
+
+Scheduler::Scheduler(EmitterChannels* send, CodeStore* store) : heap(jobs, SCHED_MAX_JOBS, clock, NULL, SCHED_MAX_LATE)
+{
+    emitters    = send;
+    codes       = store;
+
+    lock        = static_mutex_create(lock_storage);
+    schedTask_h = NULL;
+
+    executed    = 0;
+    failed      = 0;
+}
+
+esp_err_t Scheduler::begin()
+{
+    esp_err_t ret = nvs_open(NVS_SCHED_NAMESPACE, NVS_READWRITE, &nvs_sched);
+    if(ret != ESP_OK)
+        return ret;
+
+    sched_job_t* saved = (sched_job_t*)malloc(sizeof(jobs));
+    size_t size = sizeof(jobs);
+
+    if(saved != NULL && nvs_get_blob(nvs_sched, NVS_SCHED_JOBS_KEY, saved, &size) == ESP_OK && size % sizeof(sched_job_t) == 0)
+    {
+        heap.load(saved, size / sizeof(sched_job_t));
+        BLOGI("Loaded %d jobs", heap.size());
+    }
+
+    free(saved);
+
+    // Time is synced in the background once a network is connected
+    configTime(0, 0, SCHED_NTP_SERVER);
+
+    schedTask_h = static_task_create(sched_task_storage, sched_task, "scheduler", this, SCHED_TASK_PRIO, SCHED_TASK_CORE);
+
+    return ESP_OK;
+}
+
+int Scheduler::add(uint8_t mask, const char* str)
+{
+    sched_job_t job = {};
+    char* end;
+
+    long long first = strtoll(str, &end, 10);
+    if(end == str || *end != ',' || first <= 0)
+        return -1;
+
+    const char* field = end + 1;
+    unsigned long period = strtoul(field, &end, 10);
+    if(end == field || *end != ',' || period > UINT32_MAX / 1000)
+        return -1;
+
+    const char* type = end + 1;
+    if(strncmp(type, "code,", 5) == 0)
+        job.action = SCHED_CODE;
+    else if(strncmp(type, "ac,", 3) == 0)
+        job.action = SCHED_AC;
+    else
+        return -1;
+
+    const char* arg = strchr(type, ',') + 1;
+    size_t len = strlen(arg);
+    if(len == 0 || len > SCHED_ARG_MAX_LEN)
+        return -1;
+
+    memcpy(job.arg, arg, len + 1);
+    job.mask = mask;
+    job.due_ms = (int64_t)first * 1000;
+    job.period_ms = period * 1000;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int id = heap.add(job);
+    if(id >= 0)
+        save();
+    xSemaphoreGive(lock);
+
+    if(id >= 0 && schedTask_h != NULL)
+        xTaskNotifyGive(schedTask_h);
+
+    return id;
+}
+
+esp_err_t Scheduler::remove(uint16_t id)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool found = heap.remove(id);
+    if(found)
+        save();
+    xSemaphoreGive(lock);
+
+    if(!found)
+        return ESP_ERR_NOT_FOUND;
+
+    if(schedTask_h != NULL)
+        xTaskNotifyGive(schedTask_h);
+
+    return ESP_OK;
+}
+
+void Scheduler::list(ArenaText &text)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    text.addf("time=%u,executed=%u,failed=%u,skipped=%u\n", time_valid() ? (uint32_t)time(NULL) : 0, executed, failed,
+              heap.get_skipped());
+
+    for(uint16_t i = 0; i < heap.size(); i++)
+    {
+        const sched_job_t* job = heap.at(i);
+
+        text.addf("%d,%u,%u,%s,%d,%s\n", job->id, (uint32_t)(job->due_ms / 1000), job->period_ms / 1000,
+                  job->action == SCHED_AC ? "ac" : "code", job->mask, job->arg);
+    }
+
+    xSemaphoreGive(lock);
+}
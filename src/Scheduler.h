@@ -0,0 +1,81 @@
+#ifndef __UNIVERSALREMOTE_SCHEDULER__
+#define __UNIVERSALREMOTE_SCHEDULER__
+
+#include <Arduino.h>
+
+#include <nvs.h>
+
+#include "JobHeap.h"
+#include "IRChannels.h"
+#include "CodeStore.h"
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
+// NVS namespace and key for the job list
+#define NVS_SCHED_NAMESPACE     "irSched"
+#define NVS_SCHED_JOBS_KEY      "jobs"
+
+#define SCHED_MAX_JOBS          32
+#define SCHED_MAX_LATE          300000              // Jobs more overdue than this (in milliseconds) are skipped
+#define SCHED_NTP_SERVER        "pool.ntp.org"
+#define SCHED_MIN_VALID_TIME    1577836800          // 2020-01-01. Earlier clock values mean time has not been synced
+#define SCHED_SYNC_CHECK_PER    1000                // Time between checks while waiting for the first sync
+#define SCHED_MAX_SLEEP         3600000             // Longest sleep, so that clock corrections by SNTP are picked up
+
+// Sends stored codes and AC states at set times, without a server.
+// Time comes from SNTP, and jobs are kept in NVS across reboots. The task sleeps until the next job is due,
+// and is woken early when the job list changes.
+// The list is written to NVS when jobs are added or removed and when a job that runs once is done, not on every
+// run, to spare the flash. After a reboot, repeating jobs that are due are moved to their next run without running.
+class Scheduler
+{
+private:
+    EmitterChannels* emitters;
+    CodeStore* codes;
+
+    sched_job_t jobs[SCHED_MAX_JOBS];
+    JobHeap heap;
+
+    nvs_handle nvs_sched;
+    SemaphoreHandle_t lock;                         // Guards the heap
+    TaskHandle_t schedTask_h;
+    StaticSemaphore_t lock_storage;
+    static_task_t<SCHED_TASK_STACK> sched_task_storage;
+
+    volatile uint32_t executed;
+    volatile uint32_t failed;
+
+    static int64_t clock(void* ctx);
+    static void sched_task(void* param);
+
+    // Queues the job on its emitter channels
+    esp_err_t run(const sched_job_t &job);
+
+    // Writes the job list to NVS. Called with the lock held
+    void save();
+
+public:
+    Scheduler(EmitterChannels* send, CodeStore* store);
+
+    // Loads the jobs from NVS, starts SNTP and the scheduler task. Must be called after nvs_flash_init
+    esp_err_t begin();
+
+    // Returns true once the clock has been set by SNTP
+    static bool time_valid();
+
+    // Parses and adds a job for the channels in mask. Returns the job id, or -1 if the format is invalid or the list is full
+    // Format : <first run in seconds since the Unix epoch>,<period in seconds, 0 to run once>,<code|ac>,<code name or AC state>
+    // Sample : 1700000000,86400,ac,10,1,0,1,25,1,2,4,2,1,0,1,1,0,0,1,-1,-1
+    int add(uint8_t mask, const char* str);
+
+    // Removes a job. Returns ESP_ERR_NOT_FOUND if there is none with the id
+    esp_err_t remove(uint16_t id);
+
+    // Puts the clock state and the jobs into the passed string
+    // Format : time=<seconds since the Unix epoch, 0 if not synced>,executed=<n>,failed=<n>,skipped=<n>
+    // followed by a line per job
+    // <id>,<next run>,<period>,<code|ac>,<channel mask>,<code name or AC state>
+    void list(ArenaText &text);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "StaticTasks.h"
+
+#include "TaskConfig.h"
+#include "BinLog.h"
+
+#define TAG "tasks"
+
+// The storage of the tasks is reserved whatever the framework, so falling back to the heap would take the RAM twice
+// and leave it out of the build report
+#if !configSUPPORT_STATIC_ALLOCATION
+#error "Static allocation is needed, set CONFIG_SUPPORT_STATIC_ALLOCATION in the framework configuration"
+#endif
+
+struct static_task_record_t
+{
+    TaskHandle_t handle;
+    uint32_t stack_size;
+};
+
+static static_task_record_t tasks[STATIC_TASKS_MAX];
+static volatile uint8_t task_count = 0;
+static portMUX_TYPE tasks_mux = portMUX_INITIALIZER_UNLOCKED;
+
+TaskHandle_t static_task_create(TaskFunction_t function, const char* name, uint32_t stack_size, StackType_t* stack,
+                                StaticTask_t* tcb, void* param, UBaseType_t priority, BaseType_t core)
+{
+    TaskHandle_t handle = xTaskCreateStaticPinnedToCore(function, name, stack_size, param, priority, stack, tcb, core);
+
+    if(handle == NULL)
+    {
+        BLOGE("Could not create task %s", name);
+        return NULL;
+    }
+
+    portENTER_CRITICAL(&tasks_mux);
+    if(task_count < STATIC_TASKS_MAX)
+    {
+        tasks[task_count].handle = handle;
+        tasks[task_count].stack_size = stack_size;
+        task_count++;
+    }
+    portEXIT_CRITICAL(&tasks_mux);
+
+    return handle;
+}
+
+QueueHandle_t static_queue_create(UBaseType_t length, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* queue)
+{
+    return xQueueCreateStatic(length, item_size, storage, queue);
+}
+
+SemaphoreHandle_t static_mutex_create(StaticSemaphore_t &mutex)
+{
+    return xSemaphoreCreateMutexStatic(&mutex);
+}
+
+SemaphoreHandle_t static_binary_create(StaticSemaphore_t &semaphore)
+{
+    return xSemaphoreCreateBinaryStatic(&semaphore);
+}
+
+void static_tasks_report(ArenaText &text)
+{
+    uint8_t count = task_count;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        // In bytes on the ESP32, like the stack size
+        uint32_t least_free = uxTaskGetStackHighWaterMark(tasks[i].handle);
+
+        text.addf("%s,%u,%u%s\n", pcTaskGetTaskName(tasks[i].handle), tasks[i].stack_size,
+                  least_free, least_free < TASK_STACK_MARGIN ? ",low" : "");
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef __UNIVERSALREMOTE_STATIC_TASKS__
+#define __UNIVERSALREMOTE_STATIC_TASKS__
+
+// Stacks, control blocks and queue storage of the long-lived tasks, allocated at build time. They cannot fail or
+// fragment the heap that the WiFi stack allocates from, and they show in the static RAM of the build report
+// (tools/size_budget.py), which fails the build when a new feature would take too much of it.
+// The tasks created here are listed by GET "/tasks" with the least free stack each has had since boot.
+// Tasks are not deleted, as their storage is never freed : those that do work now and then (provisioning,
+// learning sessions, benchmarks) wait for it instead.
+
+#include <Arduino.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+#include "Arena.h"
+
+#define STATIC_TASKS_MAX        24                  // Tasks listed by the report
+
+// Stack and control block of a task
+template<uint32_t stack_size> struct static_task_t
+{
+    StackType_t stack[stack_size / sizeof(StackType_t)];
+    StaticTask_t tcb;
+};
+
+// Storage of a queue of length items of type T
+template<typename T, UBaseType_t length> struct static_queue_t
+{
+    uint8_t storage[length * sizeof(T)];
+    StaticQueue_t queue;
+};
+
+// Creates a task in the passed storage and adds it to the report. Returns NULL on failure
+TaskHandle_t static_task_create(TaskFunction_t function, const char* name, uint32_t stack_size, StackType_t* stack,
+                                StaticTask_t* tcb, void* param, UBaseType_t priority, BaseType_t core);
+
+template<uint32_t stack_size> TaskHandle_t static_task_create(static_task_t<stack_size> &task, TaskFunction_t function,
+                                                              const char* name, void* param, UBaseType_t priority, BaseType_t core)
+{
+    return static_task_create(function, name, stack_size, task.stack, &task.tcb, param, priority, core);
+}
+
+QueueHandle_t static_queue_create(UBaseType_t length, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* queue);
+
+template<typename T, UBaseType_t length> QueueHandle_t static_queue_create(static_queue_t<T, length> &queue)
+{
+    return static_queue_create(length, sizeof(T), queue.storage, &queue.queue);
+}
+
+SemaphoreHandle_t static_mutex_create(StaticSemaphore_t &mutex);
+SemaphoreHandle_t static_binary_create(StaticSemaphore_t &semaphore);
+
+// Puts a line per task into the passed string. Tasks with less than TASK_STACK_MARGIN free are flagged
+// Format : <name>,<stack size>,<least free stack>[,low]
+void static_tasks_report(ArenaText &text);
+
+#endif
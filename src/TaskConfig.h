@@ -0,0 +1,125 @@
+#ifndef __UNIVERSALREMOTE_TASK_CONFIG__
+#define __UNIVERSALREMOTE_TASK_CONFIG__
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Core affinity, priority and stack size of the tasks. Each can be overridden with a build flag in platformio.ini.
+// The WiFi and lwIP tasks run on core 0, so the IR tasks are kept on core 1 at a priority
+// above everything else there, and the http server stays next to the network stack.
+// Stack sizes are in bytes. All the tasks of the firmware get their stacks at build time (see StaticTasks.h), so the
+// sizes count against the RAM budget of the build. GET "/tasks" reports the least free stack of each since boot :
+// a size should leave at least TASK_STACK_MARGIN free after a run under load.
+//
+// Most stack used, in bytes, measured with GET "/tasks" on the host build (http-host, x86-64, gcc 12 -O2) after 60 s
+// of tools/http_load.py -c 16 -m raw=8,ac=4,get=2,scan=1, with a scheduled AC job every second :
+//   IR channel     3448 of 4096    IRac and IRsend are stand-ins on the host, so the device needs more
+//   IR capture      744 of 4096
+//   scheduler       792 of 4096
+//   http workers   2504 of 4096
+// The host ABI and libc do not use the stack as the device does, so these are estimates only. The sizes have not been
+// measured on the device yet : that is still to be done under the same load, with a learning session and a benchmark
+// run, for all the tasks listed by GET "/tasks". The MQTT tasks, UDP commands, provisioning, logging, the LEDs and the
+// reset button are not in the host build, and their sizes are the defaults they had on the heap.
+
+// IR transmit (one task per emitter channel)
+#ifndef IR_SEND_TASK_CORE
+#define IR_SEND_TASK_CORE       1
+#endif
+#ifndef IR_SEND_TASK_PRIO
+#define IR_SEND_TASK_PRIO       10
+#endif
+#ifndef IR_SEND_TASK_STACK
+#define IR_SEND_TASK_STACK      4096                // IRac builds the state of the AC protocol on the stack
+#endif
+
+// IR capture. The receive interrupt is allocated from this task, so it runs on the same core
+#ifndef IR_RECV_TASK_CORE
+#define IR_RECV_TASK_CORE       1
+#endif
+#ifndef IR_RECV_TASK_PRIO
+#define IR_RECV_TASK_PRIO       9
+#endif
+#ifndef IR_RECV_TASK_STACK
+#define IR_RECV_TASK_STACK      4096
+#endif
+
+// LED blinking
+#ifndef LED_TASK_CORE
+#define LED_TASK_CORE           tskNO_AFFINITY
+#endif
+#ifndef LED_TASK_PRIO
+#define LED_TASK_PRIO           2
+#endif
+#ifndef LED_TASK_STACK
+#define LED_TASK_STACK          1536
+#endif
+
+// Reset button
+#ifndef RESET_TASK_CORE
+#define RESET_TASK_CORE         tskNO_AFFINITY
+#endif
+#ifndef RESET_TASK_PRIO
+#define RESET_TASK_PRIO         1
+#endif
+#ifndef RESET_TASK_STACK
+#define RESET_TASK_STACK        2048                // Prints with Serial.printf
+#endif
+
+// Scheduled jobs
+#ifndef SCHED_TASK_CORE
+#define SCHED_TASK_CORE         tskNO_AFFINITY
+#endif
+#ifndef SCHED_TASK_PRIO
+#define SCHED_TASK_PRIO         4
+#endif
+#ifndef SCHED_TASK_STACK
+#define SCHED_TASK_STACK        4096
+#endif
+
+// UDP commands. Above the http server, so that commands are queued without waiting for http requests
+#ifndef UDP_TASK_CORE
+#define UDP_TASK_CORE           0
+#endif
+#ifndef UDP_TASK_PRIO
+#define UDP_TASK_PRIO           6
+#endif
+#ifndef UDP_TASK_STACK
+#define UDP_TASK_STACK          4096
+#endif
+
+// Printing of the deferred log records, below everything that logs
+#ifndef LOG_TASK_CORE
+#define LOG_TASK_CORE           tskNO_AFFINITY
+#endif
+#ifndef LOG_TASK_PRIO
+#define LOG_TASK_PRIO           1
+#endif
+#ifndef LOG_TASK_STACK
+#define LOG_TASK_STACK          4096                // printf, with a record and its base64 line
+#endif
+
+// http server, and the tasks doing work for it (provisioning, learning sessions, benchmark)
+#ifndef SERVER_TASK_CORE
+#define SERVER_TASK_CORE        0
+#endif
+#ifndef SERVER_TASK_PRIO
+#define SERVER_TASK_PRIO        5
+#endif
+#ifndef WORKER_TASK_STACK
+#define WORKER_TASK_STACK       4096                // Request workers, MQTT publishing and MQTT commands
+#endif
+#ifndef PROV_TASK_STACK
+#define PROV_TASK_STACK         4096                // Saves the settings, starts mDNS and MQTT once connected
+#endif
+#ifndef LEARN_TASK_STACK
+#define LEARN_TASK_STACK        4096                // Captures go to the heap, decode_results and the denoiser stay here
+#endif
+#ifndef BENCH_TASK_STACK
+#define BENCH_TASK_STACK        4096                // Only built with IR_BENCHMARK
+#endif
+
+// Free stack below which GET "/tasks" flags a task
+#define TASK_STACK_MARGIN       512
+
+#endif
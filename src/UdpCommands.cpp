@@ -0,0 +1,322 @@
+#include "UdpCommands.h"
+
+#include <lwip/sockets.h>
+#include <mbedtls/md.h>
+
+#include "TaskConfig.h"
+#include "IRCompress.h"
+#include "BinLog.h"
+
+#define TAG "udp"
+
+static uint16_t get_u16(const uint8_t* in)
+{
+    return in[0] | (in[1] << 8);
+}
+
+// Converts hex to bytes. Returns the number of bytes, or 0 if the string is not valid hex or too long
+static size_t parse_hex(const char* hex, uint8_t* out, size_t max_len)
+{
+    size_t len = strlen(hex);
+    if(len == 0 || len % 2 != 0 || len / 2 > max_len)
+        return 0;
+
+    for(size_t i = 0; i < len / 2; i++)
+    {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+        char* end;
+
+        out[i] = strtoul(byte, &end, 16);
+        if(*end != '\0')
+            return 0;
+    }
+
+    return len / 2;
+}
+
+// Receives the datagrams, and answers those that ask for an ack. The socket is opened again when the settings change
+void UdpCommands::udp_task(void* param)
+{
+    UdpCommands* udp = (UdpCommands*)param;
+
+    for(;;)
+    {
+        if(!udp->config.enabled)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        uint32_t generation = udp->generation;
+
+        int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(udp->config.port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        if(sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+        {
+            BLOGE("Could not listen on port %d", udp->config.port);
+            if(sock >= 0)
+                close(sock);
+
+            // Tried again when the settings change
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Wakes up every second to see if the settings changed
+        struct timeval timeout = {1, 0};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        BLOGI("Listening on port %d", udp->config.port);
+
+        while(udp->config.enabled && udp->generation == generation)
+        {
+            struct sockaddr_in source;
+            socklen_t source_len = sizeof(source);
+
+            int size = recvfrom(sock, udp->packet, sizeof(udp->packet), 0, (struct sockaddr*)&source, &source_len);
+            if(size <= 0)
+                continue;
+
+            int64_t start = esp_timer_get_time();
+
+            udp_frame_t frame;
+            bool authentic = false;
+            udp_status_t status = udp->handle(udp->packet, size, frame, authentic);
+
+            uint32_t latency = esp_timer_get_time() - start;
+            udp->last_latency_us = latency;
+            if(latency > udp->max_latency_us)
+                udp->max_latency_us = latency;
+
+            // Forged or malformed datagrams get no answer
+            if(!authentic || !(frame.flags & UDP_FLAG_ACK))
+                continue;
+
+            uint8_t ack[UDP_HEADER_SIZE + UDP_ACK_PAYLOAD_SIZE + UDP_MAC_SIZE];
+            size_t len = udp_write_ack(ack, &frame, status, udp->window.next());
+            udp->compute_mac(ack, len, ack + len);
+
+            sendto(sock, ack, len + UDP_MAC_SIZE, 0, (struct sockaddr*)&source, source_len);
+        }
+
+        close(sock);
+    }
+}
+
+void UdpCommands::compute_mac(const uint8_t* data, size_t len, uint8_t* mac)
+{
+    uint8_t full[32];
+
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), config.key, config.key_len, data, len, full);
+
+    memcpy(mac, full, UDP_MAC_SIZE);
+}
+
+udp_status_t UdpCommands::handle(const uint8_t* data, size_t size, udp_frame_t &frame, bool &authentic)
+{
+    received++;
+
+    if(!udp_parse(data, size, &frame))
+    {
+        rejected_format++;
+        return UDP_STATUS_INVALID;
+    }
+
+    uint8_t mac[UDP_MAC_SIZE];
+    compute_mac(data, size - UDP_MAC_SIZE, mac);
+
+    if(!udp_mac_equal(mac, data + size - UDP_MAC_SIZE, UDP_MAC_SIZE))
+    {
+        rejected_mac++;
+        return UDP_STATUS_INVALID;
+    }
+
+    authentic = true;
+
+    udp_status_t status = window.check(frame.seq);
+
+    if(status == UDP_STATUS_DUPLICATE)
+    {
+        duplicates++;
+        return status;
+    }
+
+    if(status == UDP_STATUS_STALE)
+    {
+        stale++;
+        return status;
+    }
+
+    // Saves a new floor before going past the saved one, so that no accepted number can be accepted again after a reboot
+    if(frame.seq >= seq_limit)
+    {
+        seq_limit = frame.seq + UDP_SEQ_RESERVE;
+        nvs_set_u32(nvs_ir, NVS_UDP_SEQ_KEY, seq_limit);
+        nvs_commit(nvs_ir);
+    }
+
+    accepted++;
+
+    return execute(frame);
+}
+
+udp_status_t UdpCommands::execute(const udp_frame_t &frame)
+{
+    uint8_t mask = frame.mask != 0 ? frame.mask : 1;
+    esp_err_t ret;
+
+    switch(frame.type)
+    {
+    case UDP_CMD_RAW:
+    {
+        if(frame.len < 4 || frame.len % 2 != 0 || (frame.len - 2) / 2 > kCaptureBufferSize)
+            return UDP_STATUS_INVALID;
+
+        uint16_t len = (frame.len - 2) / 2;
+
+        uint16_t khz = get_u16(frame.payload);
+        uint32_t hz = khz < 1000 ? khz * 1000 : khz;
+        if(hz < kMinCarrierHz || hz > kMaxCarrierHz)
+            return UDP_STATUS_INVALID;
+
+        for(uint16_t i = 0; i < len; i++)
+            timings[i] = get_u16(frame.payload + 2 + 2 * i);
+
+        ret = emitters->submit_timings(mask, timings, len, khz);
+        break;
+    }
+    case UDP_CMD_AC:
+        memcpy(text, frame.payload, frame.len);
+        text[frame.len] = '\0';
+
+        ret = emitters->submit_ac(mask, text);
+        break;
+
+    case UDP_CMD_CODE:
+    {
+        uint16_t len;
+
+        if(frame.len > CODE_NAME_MAX_LEN)
+            return UDP_STATUS_NOT_FOUND;
+
+        memcpy(text, frame.payload, frame.len);
+        text[frame.len] = '\0';
+
+        if(codes->load(text, timings, kCaptureBufferSize, len) != ESP_OK)
+            return UDP_STATUS_NOT_FOUND;
+
+        ret = emitters->submit_timings(mask, timings, len, kRawCarrierKhz);
+        break;
+    }
+    case UDP_CMD_PACKED:
+    {
+        int len = irpack_decode(frame.payload, frame.len, timings, kCaptureBufferSize);
+        if(len <= 0)
+            return UDP_STATUS_INVALID;
+
+        ret = emitters->submit_timings(mask, timings, len, kRawCarrierKhz);
+        break;
+    }
+    default:
+        return UDP_STATUS_INVALID;
+    }
+
+    if(ret == ESP_FAIL)
+        return UDP_STATUS_INVALID;
+    if(ret != ESP_OK)
+        return UDP_STATUS_BUSY;
+
+    return UDP_STATUS_OK;
+}
+
+UdpCommands::UdpCommands(EmitterChannels* send, CodeStore* store)
+{
+    emitters = send;
+    codes = store;
+
+    config.enabled = false;
+    config.port = UDP_DEFAULT_PORT;
+    config.key_len = 0;
+
+    udpTask_h = NULL;
+    generation = 0;
+    seq_limit = 0;
+
+    received = 0;
+    accepted = 0;
+    rejected_mac = 0;
+    rejected_format = 0;
+    duplicates = 0;
+    stale = 0;
+    last_latency_us = 0;
+    max_latency_us = 0;
+}
+
+esp_err_t UdpCommands::begin()
+{
+    esp_err_t ret = nvs_open(NVS_IR_NAMESPACE, NVS_READWRITE, &nvs_ir);
+    if(ret != ESP_OK)
+        return ret;
+
+    udp_config_t saved;
+    size_t size = sizeof(saved);
+
+    if(nvs_get_blob(nvs_ir, NVS_UDP_KEY, &saved, &size) == ESP_OK && size == sizeof(saved))
+        config = saved;
+
+    // Everything up to the saved floor may have been accepted before the reboot
+    nvs_get_u32(nvs_ir, NVS_UDP_SEQ_KEY, &seq_limit);
+    window.reset(seq_limit);
+
+    udpTask_h = static_task_create(udp_task_storage, udp_task, "UDP commands", this, UDP_TASK_PRIO, UDP_TASK_CORE);
+
+    return ESP_OK;
+}
+
+esp_err_t UdpCommands::configure(bool enabled, uint16_t port, const char* key_hex)
+{
+    uint8_t key[UDP_KEY_MAX_LEN];
+    size_t key_len = config.key_len;
+
+    if(key_hex != NULL)
+    {
+        key_len = parse_hex(key_hex, key, sizeof(key));
+        if(key_len < UDP_KEY_MIN_LEN)
+            return ESP_FAIL;
+    }
+
+    if(enabled && key_len < UDP_KEY_MIN_LEN)
+        return ESP_FAIL;
+
+    if(key_hex != NULL)
+    {
+        memcpy(config.key, key, key_len);
+        config.key_len = key_len;
+    }
+
+    config.port = port != 0 ? port : UDP_DEFAULT_PORT;
+    config.enabled = enabled;
+
+    generation++;
+    if(udpTask_h != NULL)
+        xTaskNotifyGive(udpTask_h);
+
+    BLOGI("UDP commands %s, port %d", enabled ? "on" : "off", config.port);
+
+    nvs_set_blob(nvs_ir, NVS_UDP_KEY, &config, sizeof(config));
+
+    return nvs_commit(nvs_ir);
+}
+
+void UdpCommands::get_report(ArenaText &text)
+{
+    text.addf("enabled=%d,port=%u,next_seq=%u;", config.enabled, config.port, window.next());
+    text.addf("received=%u,accepted=%u,bad_mac=%u,invalid=%u,duplicate=%u,stale=%u;", received, accepted, rejected_mac,
+              rejected_format, duplicates, stale);
+    text.addf("latency_us=%u,%u", last_latency_us, max_latency_us);
+}
@@ -0,0 +1,95 @@
+#ifndef __UNIVERSALREMOTE_UDP_COMMANDS__
+#define __UNIVERSALREMOTE_UDP_COMMANDS__
+
+#include <Arduino.h>
+
+#include <nvs.h>
+
+#include "IRHandlers.h"
+#include "IRChannels.h"
+#include "CodeStore.h"
+#include "UdpFrame.h"
+#include "TaskConfig.h"
+#include "StaticTasks.h"
+
+// NVS keys for the UDP settings and the sequence number floor, in the emitter namespace
+#define NVS_UDP_KEY             "udp"
+#define NVS_UDP_SEQ_KEY         "udpSeq"
+
+#define UDP_DEFAULT_PORT        4210
+#define UDP_KEY_MIN_LEN         16
+#define UDP_KEY_MAX_LEN         32
+#define UDP_SEQ_RESERVE         1024                // Sequence numbers accepted between two saves of the floor
+
+// Saved UDP settings
+struct udp_config_t
+{
+    bool enabled;
+    uint16_t port;
+    uint8_t key_len;
+    uint8_t key[UDP_KEY_MAX_LEN];
+};
+
+// Listens for commands in single datagrams, in the format of UdpFrame.h, for clients such as volume knobs that
+// need lower latency than a http request. Commands are authenticated with a shared key, each is accepted once
+// and in order, and they are queued on the emitter channels like those of the http server.
+// The sequence numbers accepted are saved in blocks of UDP_SEQ_RESERVE, so that those used before a reboot
+// are refused after it. The acks tell clients the next number accepted.
+class UdpCommands
+{
+private:
+    EmitterChannels* emitters;
+    CodeStore* codes;
+
+    udp_config_t config;
+    nvs_handle nvs_ir;
+
+    TaskHandle_t udpTask_h;
+    static_task_t<UDP_TASK_STACK> udp_task_storage;
+    volatile uint32_t generation;                   // Changed by configure, so that the task opens a new socket
+
+    UdpReplayWindow window;
+    uint32_t seq_limit;                             // Saved floor for the next boot
+
+    uint8_t packet[UDP_MAX_DATAGRAM];
+    char text[UDP_MAX_DATAGRAM];
+    uint16_t timings[kCaptureBufferSize];
+
+    // Statistics
+    uint32_t received;
+    uint32_t accepted;
+    uint32_t rejected_mac;
+    uint32_t rejected_format;
+    uint32_t duplicates;
+    uint32_t stale;
+    uint32_t last_latency_us;                       // From the datagram being read to the command being queued
+    uint32_t max_latency_us;
+
+    static void udp_task(void* param);
+
+    void compute_mac(const uint8_t* data, size_t len, uint8_t* mac);
+
+    // Checks and runs a command. Returns the status for the ack
+    udp_status_t handle(const uint8_t* data, size_t size, udp_frame_t &frame, bool &authentic);
+
+    udp_status_t execute(const udp_frame_t &frame);
+
+public:
+    UdpCommands(EmitterChannels* send, CodeStore* store);
+
+    // Loads the settings from NVS, and starts listening if enabled. Must be called after EmitterChannels::begin
+    esp_err_t begin();
+
+    // Turns the listener on or off, and saves the settings.
+    // @param key_hex   Shared key in hex, UDP_KEY_MIN_LEN to UDP_KEY_MAX_LEN bytes. The saved key is kept if NULL
+    esp_err_t configure(bool enabled, uint16_t port, const char* key_hex);
+
+    bool is_enabled() { return config.enabled; }
+    uint16_t get_port() { return config.port; }
+
+    // Puts the settings and statistics into the passed string. The key is not included
+    // Format : enabled=<0|1>,port=<port>,next_seq=<n>;received=<n>,accepted=<n>,bad_mac=<n>,invalid=<n>,duplicate=<n>,stale=<n>;latency_us=<last>,<max>
+    void get_report(ArenaText &text);
+};
+
+#endif
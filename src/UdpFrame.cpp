@@ -0,0 +1,98 @@
+#include "UdpFrame.h"
+
+#include <string.h>
+
+static uint16_t get_u16(const uint8_t* in)
+{
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t* in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static void put_u16(uint8_t* out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void put_u32(uint8_t* out, uint32_t value)
+{
+    for(int i = 0; i < 4; i++)
+        out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+bool udp_parse(const uint8_t* data, size_t size, udp_frame_t* frame)
+{
+    if(size < UDP_HEADER_SIZE + UDP_MAC_SIZE || size > UDP_MAX_DATAGRAM)
+        return false;
+
+    if(memcmp(data, UDP_MAGIC, 2) != 0 || data[2] != UDP_VERSION)
+        return false;
+
+    frame->flags    = data[3];
+    frame->type     = data[4];
+    frame->mask     = data[5];
+    frame->seq      = get_u32(data + 6);
+    frame->len      = get_u16(data + 10);
+    frame->payload  = data + UDP_HEADER_SIZE;
+
+    return UDP_HEADER_SIZE + (size_t)frame->len + UDP_MAC_SIZE == size;
+}
+
+size_t udp_write_ack(uint8_t* out, const udp_frame_t* frame, udp_status_t status, uint32_t next_seq)
+{
+    memcpy(out, UDP_MAGIC, 2);
+    out[2] = UDP_VERSION;
+    out[3] = UDP_FLAG_ACK;
+    out[4] = frame->type;
+    out[5] = frame->mask;
+    put_u32(out + 6, frame->seq);
+    put_u16(out + 10, UDP_ACK_PAYLOAD_SIZE);
+
+    out[UDP_HEADER_SIZE] = status;
+    put_u32(out + UDP_HEADER_SIZE + 1, next_seq);
+
+    return UDP_HEADER_SIZE + UDP_ACK_PAYLOAD_SIZE;
+}
+
+bool udp_mac_equal(const uint8_t* a, const uint8_t* b, size_t len)
+{
+    uint8_t diff = 0;
+
+    for(size_t i = 0; i < len; i++)
+        diff |= a[i] ^ b[i];
+
+    return diff == 0;
+}
+
+void UdpReplayWindow::reset(uint32_t floor)
+{
+    highest = floor;
+
+    // Nothing accepted yet, so the floor and everything below it are stale
+    seen = 0;
+}
+
+udp_status_t UdpReplayWindow::check(uint32_t seq)
+{
+    if(seq > highest)
+    {
+        uint32_t shift = seq - highest;
+
+        seen = shift >= UDP_REPLAY_WINDOW ? 0 : seen << shift;
+        seen |= 1;
+        highest = seq;
+
+        return UDP_STATUS_OK;
+    }
+
+    uint32_t age = highest - seq;
+
+    if(age < UDP_REPLAY_WINDOW && (seen & ((uint64_t)1 << age)))
+        return UDP_STATUS_DUPLICATE;
+
+    return UDP_STATUS_STALE;
+}
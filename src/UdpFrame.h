@@ -0,0 +1,101 @@
+#ifndef __UNIVERSALREMOTE_UDP_FRAME__
+#define __UNIVERSALREMOTE_UDP_FRAME__
+
+// Datagram format of the UDP command protocol, and its replay protection. The MAC itself is computed by the caller.
+// Kept free of Arduino headers, so that it can be compiled and checked on the host.
+//
+// Format, little endian :
+// - 2 bytes        : UDP_MAGIC
+// - byte 2         : UDP_VERSION
+// - byte 3         : flags, UDP_FLAG_*
+// - byte 4         : command type, udp_cmd_type_t
+// - byte 5         : emitter channel mask, 0 for channel 0
+// - 4 bytes        : sequence number, increasing by at least 1 with each command
+// - 2 bytes        : payload length
+// - payload
+// - UDP_MAC_SIZE   : HMAC-SHA256 of everything before, with the shared key, truncated
+//
+// Payloads :
+// - UDP_CMD_RAW    : carrier (2 bytes, in kHz or in Hz if above 1000, 10 to 500 kHz), then the timings in microseconds (2 bytes each)
+// - UDP_CMD_AC     : AC state, in the text format of POST "/ac"
+// - UDP_CMD_CODE   : name of a stored code
+// - UDP_CMD_PACKED : frame compressed with irpack_encode
+// - acks           : udp_status_t (1 byte), then the lowest sequence number the device accepts next (4 bytes)
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define UDP_MAGIC               "IR"
+#define UDP_VERSION             1
+#define UDP_HEADER_SIZE         12
+#define UDP_MAC_SIZE            16
+#define UDP_ACK_PAYLOAD_SIZE    5
+#define UDP_MAX_DATAGRAM        1400
+
+#define UDP_FLAG_ACK            0x01                // In a command : ack requested. In a reply : this is an ack
+
+#define UDP_REPLAY_WINDOW       64                  // Sequence numbers told apart as duplicates rather than stale
+
+enum udp_cmd_type_t
+{
+    UDP_CMD_RAW     = 1,
+    UDP_CMD_AC      = 2,
+    UDP_CMD_CODE    = 3,
+    UDP_CMD_PACKED  = 4
+};
+
+enum udp_status_t
+{
+    UDP_STATUS_OK           = 0,                    // Queued for transmission
+    UDP_STATUS_INVALID      = 1,                    // Invalid payload or channel
+    UDP_STATUS_BUSY         = 2,                    // Channel queue full
+    UDP_STATUS_NOT_FOUND    = 3,                    // No stored code with the name
+    UDP_STATUS_DUPLICATE    = 4,                    // Already received, not sent again
+    UDP_STATUS_STALE        = 5                     // Older than the last command accepted, dropped
+};
+
+struct udp_frame_t
+{
+    uint8_t flags;
+    uint8_t type;
+    uint8_t mask;
+    uint32_t seq;
+    const uint8_t* payload;
+    uint16_t len;
+};
+
+// Checks the framing of a datagram and fills frame. The MAC covers the first size - UDP_MAC_SIZE bytes,
+// and is at data + size - UDP_MAC_SIZE. Returns false if the datagram is malformed
+bool udp_parse(const uint8_t* data, size_t size, udp_frame_t* frame);
+
+// Writes an ack for the command, without its MAC, into out, which must hold UDP_HEADER_SIZE + UDP_ACK_PAYLOAD_SIZE bytes.
+// Returns the length written
+size_t udp_write_ack(uint8_t* out, const udp_frame_t* frame, udp_status_t status, uint32_t next_seq);
+
+// Compares MACs in constant time
+bool udp_mac_equal(const uint8_t* a, const uint8_t* b, size_t len);
+
+// Accepts each sequence number once, in increasing order, so that a command captured on the network cannot be
+// replayed, and a command delayed behind a later one is not sent after it.
+// Sequence numbers up to and including floor are refused, so that the device can refuse the numbers used
+// before a reboot, by saving a floor above them.
+class UdpReplayWindow
+{
+private:
+    uint32_t highest;
+    uint64_t seen;                                  // Bit n is set if highest - n was accepted
+
+public:
+    UdpReplayWindow() { reset(0); }
+
+    void reset(uint32_t floor);
+
+    // Returns UDP_STATUS_OK and records seq if it is new, UDP_STATUS_DUPLICATE if it was accepted before,
+    // or UDP_STATUS_STALE if it is older than the last one accepted
+    udp_status_t check(uint32_t seq);
+
+    // Lowest sequence number accepted next
+    uint32_t next() { return highest + 1; }
+};
+
+#endif
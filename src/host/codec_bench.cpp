@@ -0,0 +1,278 @@
+// Runs the frames of a capture corpus recorded with POST "/corpus" through the conversions of the send path,
+// and reports their throughput. Runs on the host, built with the "codec-bench" environment in platformio.ini.
+// Usage : codec_bench <corpus file> [number of passes]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../Corpus.h"
+#include "../RawFormat.h"
+#include "../RmtCodec.h"
+#include "../IRCompress.h"
+#include "../Pronto.h"
+
+// Same as kCaptureBufferSize in IRConfig.h, which needs the IR library
+#define BENCH_MAX_RAWLEN    1024
+
+struct frame_t
+{
+    std::vector<uint16_t> timings;
+};
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+static void print_rate(const char* name, uint64_t frames, uint64_t timings, uint64_t ns)
+{
+    printf("%-20s %10.3f us/frame %10.2f ns/timing %12.0f frames/s\n", name, ns / 1000.0 / frames,
+           (double)ns / timings, frames / (ns / 1e9));
+}
+
+// rmt_encode_timings as in SendHandler::transmit, and rmt_decode_items of the items as the RMT receiver would read them
+static void bench_rmt(const std::vector<frame_t> &frames, uint64_t timings, int passes)
+{
+    size_t max_items = 0;
+    for(const frame_t &frame : frames)
+    {
+        size_t count = rmt_items_needed(frame.timings.data(), frame.timings.size(), 1);
+        if(count > max_items)
+            max_items = count;
+    }
+
+    std::vector<rmt_code_item_t> items(max_items);
+    std::vector<uint16_t> rawbuf(2 * max_items + 1);
+    uint64_t encode_ns = 0, decode_ns = 0, mismatches = 0;
+
+    for(int pass = 0; pass < passes; pass++)
+    {
+        for(const frame_t &frame : frames)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            size_t count = rmt_encode_timings(frame.timings.data(), frame.timings.size(), 1, items.data(), max_items);
+
+            auto encode_end = std::chrono::steady_clock::now();
+
+            bool overflow;
+            uint16_t rawlen = rmt_decode_items(items.data(), count, 1, rawbuf.data(), rawbuf.size(), &overflow);
+
+            auto decode_end = std::chrono::steady_clock::now();
+
+            encode_ns += elapsed_ns(start, encode_end);
+            decode_ns += elapsed_ns(encode_end, decode_end);
+
+            if(count == 0 || overflow || rawlen < 2)
+                mismatches++;
+        }
+    }
+
+    printf("\nRMT items, 1 us ticks\n");
+    print_rate("encode", frames.size() * passes, timings * passes, encode_ns);
+    print_rate("decode", frames.size() * passes, timings * passes, decode_ns);
+    if(mismatches > 0)
+        printf("%llu frames could not be converted\n", (unsigned long long)mismatches);
+}
+
+// irpack_encode as GET "/packed" and the code store write frames, and irpack_decode as POST "/packed" reads them back
+static void bench_irpack(const std::vector<frame_t> &frames, uint64_t timings, int passes)
+{
+    std::vector<uint8_t> packed(4 * BENCH_MAX_RAWLEN + 1024);
+    std::vector<uint16_t> decoded(BENCH_MAX_RAWLEN);
+    std::vector<char> text(raw_format_size(BENCH_MAX_RAWLEN));
+    uint64_t encode_ns = 0, decode_ns = 0, packed_bytes = 0, text_bytes = 0, failures = 0;
+    double worst_error = 0;
+
+    for(int pass = 0; pass < passes; pass++)
+    {
+        for(const frame_t &frame : frames)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            size_t size = irpack_encode(frame.timings.data(), frame.timings.size(), packed.data(), packed.size());
+
+            auto encode_end = std::chrono::steady_clock::now();
+
+            int len = irpack_decode(packed.data(), size, decoded.data(), decoded.size());
+
+            auto decode_end = std::chrono::steady_clock::now();
+
+            encode_ns += elapsed_ns(start, encode_end);
+            decode_ns += elapsed_ns(encode_end, decode_end);
+
+            if(pass > 0)
+                continue;
+
+            if(size == 0 || len != (int)frame.timings.size())
+            {
+                failures++;
+                continue;
+            }
+
+            packed_bytes += size;
+            text_bytes += format_raw_timings(text.data(), text.size(), -1, frame.timings.data(), frame.timings.size());
+
+            for(int i = 0; i < len; i++)
+            {
+                if(frame.timings[i] == 0)
+                    continue;
+
+                double error = abs((int)decoded[i] - frame.timings[i]) * 100.0 / frame.timings[i];
+                if(error > worst_error)
+                    worst_error = error;
+            }
+        }
+    }
+
+    printf("\nirpack\n");
+    print_rate("encode", frames.size() * passes, timings * passes, encode_ns);
+    print_rate("decode", frames.size() * passes, timings * passes, decode_ns);
+    printf("%.1f bytes per frame, %.2f bytes per timing : %.1f times smaller than 16 bit timings, %.1f than text\n",
+           (double)packed_bytes / frames.size(), (double)packed_bytes / timings,
+           timings * 2.0 / packed_bytes, (double)text_bytes / packed_bytes);
+    printf("largest decode error %.1f %%, %d %% at most\n", worst_error, IRPACK_CLUSTER_PERCENT);
+    if(failures > 0)
+        printf("%llu frames could not be encoded\n", (unsigned long long)failures);
+}
+
+// timings_to_pronto as GET "/pronto" formats captures, and pronto_to_timings as POST "/pronto" reads them back,
+// on a 38 kHz carrier and on the 455 kHz carrier of B&O remotes, where rounding to carrier cycles loses the least
+static void bench_pronto(const std::vector<frame_t> &frames, uint64_t timings, int passes, uint32_t freq_hz)
+{
+    // 5 characters per word, with the header and a trailing gap
+    std::vector<char> text(5 * (BENCH_MAX_RAWLEN + 6));
+    std::vector<uint16_t> decoded(2 * BENCH_MAX_RAWLEN);
+    uint64_t format_ns = 0, parse_ns = 0, text_bytes = 0, failures = 0;
+    uint32_t worst_error = 0;
+
+    for(int pass = 0; pass < passes; pass++)
+    {
+        for(const frame_t &frame : frames)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            int size = timings_to_pronto(frame.timings.data(), frame.timings.size(), freq_hz, text.data(), text.size());
+
+            auto format_end = std::chrono::steady_clock::now();
+
+            uint32_t parsed_hz;
+            int len = size < 0 ? -1 : pronto_to_timings(text.data(), 0, decoded.data(), decoded.size(), &parsed_hz);
+
+            auto parse_end = std::chrono::steady_clock::now();
+
+            format_ns += elapsed_ns(start, format_end);
+            parse_ns += elapsed_ns(format_end, parse_end);
+
+            if(pass > 0)
+                continue;
+
+            // Lists ending with a mark get a trailing gap, and only lists of the same length are compared entry by entry
+            if(len < (int)frame.timings.size())
+            {
+                failures++;
+                continue;
+            }
+
+            text_bytes += size;
+
+            if(len != (int)frame.timings.size())
+                continue;
+
+            for(int i = 0; i < len; i++)
+            {
+                uint32_t error = abs((int)decoded[i] - frame.timings[i]);
+                if(error > worst_error)
+                    worst_error = error;
+            }
+        }
+    }
+
+    printf("\nPronto hex, %u Hz\n", freq_hz);
+    print_rate("format", frames.size() * passes, timings * passes, format_ns);
+    print_rate("parse", frames.size() * passes, timings * passes, parse_ns);
+    printf("%.1f bytes per frame, largest difference %u us\n", (double)text_bytes / frames.size(), worst_error);
+    if(failures > 0)
+        printf("%llu frames could not be converted\n", (unsigned long long)failures);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage : %s <corpus file> [number of passes]\n", argv[0]);
+        return 1;
+    }
+
+    int passes = argc > 2 ? atoi(argv[2]) : 1;
+    if(passes < 1)
+        passes = 1;
+
+    FILE* file = fopen(argv[1], "rb");
+    if(file == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size_t size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    std::vector<uint8_t> data(size);
+    if(fread(data.data(), 1, size, file) != size)
+    {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        return 1;
+    }
+    fclose(file);
+
+    uint8_t tick_us;
+    size_t pos = corpus_read_header(data.data(), size, &tick_us);
+    if(pos == 0)
+    {
+        fprintf(stderr, "%s is not a corpus\n", argv[1]);
+        return 1;
+    }
+
+    // Frames as timing lists in microseconds, as the send path gets them
+    std::vector<frame_t> frames;
+    uint16_t rawbuf[BENCH_MAX_RAWLEN];
+    uint16_t timings[BENCH_MAX_RAWLEN];
+    uint64_t total_timings = 0;
+    int rawlen;
+
+    while((rawlen = corpus_next(data.data(), size, &pos, rawbuf, BENCH_MAX_RAWLEN)) > 0)
+    {
+        uint16_t len = rawbuf_to_timings(rawbuf, rawlen, tick_us, timings, BENCH_MAX_RAWLEN);
+        if(len == 0)
+            continue;
+
+        frames.push_back(frame_t{std::vector<uint16_t>(timings, timings + len)});
+        total_timings += len;
+    }
+
+    if(rawlen < 0)
+    {
+        fprintf(stderr, "Corpus is truncated or has frames longer than %d entries\n", BENCH_MAX_RAWLEN);
+        return 1;
+    }
+
+    if(frames.empty())
+    {
+        printf("No frames\n");
+        return 0;
+    }
+
+    printf("%zu frames, %.1f timings per frame, %d passes\n", frames.size(), (double)total_timings / frames.size(), passes);
+
+    bench_rmt(frames, total_timings, passes);
+    bench_irpack(frames, total_timings, passes);
+    bench_pronto(frames, total_timings, passes, 38000);
+    bench_pronto(frames, total_timings, passes, 455000);
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Arduino core, esp_timer and heap statistics on the host
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include <stdarg.h>
+#include <malloc.h>
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+static const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+unsigned long millis()
+{
+    return esp_timer_get_time() / 1000;
+}
+
+unsigned long micros()
+{
+    return esp_timer_get_time();
+}
+
+void delay(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static std::string to_base(unsigned long long value, unsigned char base, bool negative)
+{
+    if(base < 2 || base > 36)
+        base = 10;
+
+    char buffer[72];
+    int pos = sizeof(buffer);
+    buffer[--pos] = '\0';
+
+    do
+    {
+        int digit = value % base;
+        buffer[--pos] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    }
+    while(value > 0);
+
+    if(negative)
+        buffer[--pos] = '-';
+
+    return std::string(buffer + pos);
+}
+
+// As in the Arduino core, negative numbers are only signed in base 10
+static std::string signed_to_base(long long value, unsigned char base)
+{
+    if(base == 10 && value < 0)
+        return to_base(-(unsigned long long)value, base, true);
+
+    return to_base((unsigned long long)value, base, false);
+}
+
+String::String(unsigned char value, unsigned char base) : str(to_base(value, base, false)) {}
+String::String(int value, unsigned char base) : str(signed_to_base(value, base)) {}
+String::String(unsigned int value, unsigned char base) : str(to_base(value, base, false)) {}
+String::String(long value, unsigned char base) : str(signed_to_base(value, base)) {}
+String::String(unsigned long value, unsigned char base) : str(to_base(value, base, false)) {}
+String::String(long long value, unsigned char base) : str(signed_to_base(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : str(to_base(value, base, false)) {}
+
+String::String(double value, unsigned char decimals)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    str = buffer;
+}
+
+int String::indexOf(const String &other, unsigned int from) const
+{
+    size_t pos = str.find(other.str, from);
+
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int begin, unsigned int end) const
+{
+    if(begin > str.length())
+        return String();
+
+    if(end > str.length())
+        end = str.length();
+
+    return begin < end ? String(str.substr(begin, end - begin)) : String();
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if(index < str.length())
+        str.erase(index, count);
+}
+
+String IPAddress::toString() const
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+
+    return String(buffer);
+}
+
+void HardwareSerial::print(const char* str)
+{
+    fputs(str, stdout);
+    fflush(stdout);
+}
+
+int HardwareSerial::printf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int ret = vprintf(format, args);
+    va_end(args);
+
+    fflush(stdout);
+
+    return ret;
+}
+
+// What malloc holds without using it. There is no fixed heap on the host, so there is no minimum
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    struct mallinfo2 info = mallinfo2();
+
+    return info.fordblks;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    struct mallinfo2 info = mallinfo2();
+
+    // The top chunk is the largest block that malloc can hand out without asking the system for more
+    return info.keepcost;
+}
@@ -0,0 +1,342 @@
+// FreeRTOS tasks, queues and critical sections on POSIX threads
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Threads get at least this much stack, as host code and libc use more than the device
+#define HOST_TASK_MIN_STACK     (256 * 1024)
+
+// Stacks are filled with this byte when the task is created, and the high water mark is where it was overwritten
+#define HOST_STACK_PAINT        0xA5
+
+struct host_task_t
+{
+    TaskFunction_t function;
+    void* param;
+    std::string name;
+    uint32_t stack_size;
+    uint8_t* stack;                                 // Lowest address of the thread stack, which grows down
+    size_t stack_bytes;
+    uint8_t* stack_base;                            // Frame of the thread entry, below the TLS glibc puts on top
+
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications;
+};
+
+struct host_queue_t
+{
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+};
+
+// Task of the calling thread. Threads not started by xTaskCreate get one when they first need it
+static thread_local host_task_t* current_task = NULL;
+
+static std::chrono::steady_clock::time_point deadline(TickType_t ticks)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks * portTICK_PERIOD_MS);
+}
+
+// Waits on the condition until ready returns true, for up to ticks. Returns the last result of ready
+template<typename Ready> static bool wait_for(std::condition_variable &condition, std::unique_lock<std::mutex> &lock,
+                                              TickType_t ticks, Ready ready)
+{
+    if(ticks == portMAX_DELAY)
+    {
+        condition.wait(lock, ready);
+        return true;
+    }
+
+    return condition.wait_until(lock, deadline(ticks), ready);
+}
+
+static void* task_entry(void* param)
+{
+    host_task_t* task = (host_task_t*)param;
+    task->stack_base = (uint8_t*)__builtin_frame_address(0);
+    current_task = task;
+
+    pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+
+    task->function(task->param);
+
+    // A FreeRTOS task must not return, but the thread can end cleanly
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_size, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core)
+{
+    host_task_t* task = new host_task_t();
+    task->function = function;
+    task->param = param;
+    task->name = name != NULL ? name : "";
+    task->stack_size = stack_size;
+    task->notifications = 0;
+
+    // The stack is kept with the task structure when the thread ends
+    task->stack_bytes = stack_size > HOST_TASK_MIN_STACK ? stack_size : HOST_TASK_MIN_STACK;
+    if(posix_memalign((void**)&task->stack, 64, task->stack_bytes) != 0)
+    {
+        delete task;
+        return pdFAIL;
+    }
+    memset(task->stack, HOST_STACK_PAINT, task->stack_bytes);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstack(&attr, task->stack, task->stack_bytes);
+
+    pthread_t thread;
+    int ret = pthread_create(&thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+
+    if(ret != 0)
+    {
+        free(task->stack);
+        delete task;
+        return pdFAIL;
+    }
+
+    if(handle != NULL)
+        *handle = task;
+
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_size, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle)
+{
+    return xTaskCreatePinnedToCore(function, name, stack_size, param, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_size, void* param,
+                                           UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb,
+                                           BaseType_t core)
+{
+    TaskHandle_t handle = NULL;
+    xTaskCreatePinnedToCore(function, name, stack_size, param, priority, &handle, core);
+
+    return handle;
+}
+
+// Bytes the task would have had left of the stack size it asked for, from the deepest the host stack has been used.
+// Host code does not use the stack as the device does, so this is an estimate for the device
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    task = task != NULL ? task : xTaskGetCurrentTaskHandle();
+    if(task->stack_base == NULL)
+        return task->stack_size;
+
+    uint8_t* deepest = task->stack;
+    while(deepest < task->stack_base && *deepest == HOST_STACK_PAINT)
+        deepest++;
+
+    size_t used = task->stack_base - deepest;
+
+    return used < task->stack_size ? task->stack_size - used : 0;
+}
+
+const char* pcTaskGetTaskName(TaskHandle_t task)
+{
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->name.c_str();
+}
+
+// The task structure is kept, as other tasks may still hold its handle
+void vTaskDelete(TaskHandle_t task)
+{
+    if(task == NULL || task == current_task)
+        pthread_exit(NULL);
+}
+
+void vTaskSuspend(TaskHandle_t task)
+{
+    if(task == NULL || task == current_task)
+        std::this_thread::sleep_for(std::chrono::hours(24));
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()
+           / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    if(current_task == NULL)
+    {
+        current_task = new host_task_t();
+        current_task->stack_size = 0;
+        current_task->stack = NULL;
+        current_task->stack_bytes = 0;
+        current_task->stack_base = NULL;
+        current_task->notifications = 0;
+    }
+
+    return current_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+
+    task->notified.notify_one();
+
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    host_task_t* task = xTaskGetCurrentTaskHandle();
+
+    std::unique_lock<std::mutex> lock(task->lock);
+    wait_for(task->notified, lock, ticks, [task] { return task->notifications > 0; });
+
+    uint32_t count = task->notifications;
+    if(count > 0)
+        task->notifications = clear ? 0 : count - 1;
+
+    return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    if(length == 0)
+        return NULL;
+
+    host_queue_t* queue = new host_queue_t();
+    queue->length = length;
+    queue->item_size = item_size;
+
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* queue)
+{
+    return xQueueCreate(length, item_size);
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(queue->lock);
+
+    if(!wait_for(queue->not_full, lock, ticks, [queue] { return queue->items.size() < queue->length; }))
+        return pdFALSE;
+
+    const uint8_t* bytes = (const uint8_t*)item;
+    queue->items.emplace_back(bytes, bytes + (item != NULL ? queue->item_size : 0));
+
+    lock.unlock();
+    queue->not_empty.notify_one();
+
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    return xQueueSend(queue, item, ticks);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(queue->lock);
+
+    if(!wait_for(queue->not_empty, lock, ticks, [queue] { return !queue->items.empty(); }))
+        return pdFALSE;
+
+    if(item != NULL)
+        memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+
+    lock.unlock();
+    queue->not_full.notify_one();
+
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> guard(queue->lock);
+
+    return queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> guard(queue->lock);
+
+    return queue->length - queue->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+    xSemaphoreGive(mutex);
+
+    return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* semaphore)
+{
+    return xSemaphoreCreateBinary();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* semaphore)
+{
+    return xSemaphoreCreateMutex();
+}
+
+// Spins like the ESP32 port. Critical sections are short, but the owner may be preempted on the host,
+// so the waiting thread yields rather than burning its time slice
+void vPortEnterCritical(portMUX_TYPE* mux)
+{
+    while(__atomic_exchange_n(&mux->owner, 1, __ATOMIC_ACQUIRE) != 0)
+        sched_yield();
+}
+
+void vPortExitCritical(portMUX_TYPE* mux)
+{
+    __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,751 @@
+// esp_http_server on POSIX sockets. See src/host/http/include/esp_http_server.h
+
+#include <esp_http_server.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define HTTPD_RECV_CHUNK        1024
+
+uint16_t httpd_host_port = 8080;
+
+struct host_session_t
+{
+    int fd;
+    std::string input;                              // Received and not parsed yet
+    void* ctx;
+    void (*free_ctx)(void* ctx);
+    httpd_recv_func_t recv_fn;                      // NULL for recv
+};
+
+struct host_work_t
+{
+    httpd_work_fn_t work;
+    void* arg;
+};
+
+struct host_handler_t
+{
+    std::string uri;
+    httpd_uri_t def;
+};
+
+struct host_server_t
+{
+    httpd_config_t config;
+    int listen_fd;
+    int wake_fds[2];                                // Written to wake the server thread up
+    volatile bool running;
+    TaskHandle_t task_h;
+
+    std::mutex lock;                                // Guards the fields below, which other threads use
+    std::vector<host_handler_t> handlers;
+    std::vector<host_session_t*> sessions;
+    std::vector<int> closing;                       // Sockets for which httpd_sess_trigger_close was called
+    std::vector<host_work_t> work;                  // Queued with httpd_queue_work
+};
+
+// State of a request, in httpd_req_t::aux
+struct host_request_t
+{
+    host_server_t* server;
+    host_session_t* session;
+    size_t remaining;                               // Content not read by the handler yet
+    std::string status;
+    std::string type;
+};
+
+static void wake(host_server_t* server)
+{
+    char byte = 0;
+    (void)!write(server->wake_fds[1], &byte, 1);
+}
+
+static void set_timeouts(int fd, const httpd_config_t &config)
+{
+    struct timeval recv_timeout = {config.recv_wait_timeout, 0};
+    struct timeval send_timeout = {config.send_wait_timeout, 0};
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+}
+
+static int send_all(int fd, const char* buf, size_t len)
+{
+    size_t sent = 0;
+
+    while(sent < len)
+    {
+        ssize_t ret = send(fd, buf + sent, len - sent, MSG_NOSIGNAL);
+
+        if(ret < 0 && errno == EINTR)
+            continue;
+        if(ret < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+
+        sent += ret;
+    }
+
+    return sent;
+}
+
+// Sends a whole response with the status and type of the request
+static esp_err_t send_response(httpd_req_t* req, const char* status, const char* type, const char* body, size_t len)
+{
+    host_request_t* request = (host_request_t*)req->aux;
+
+    char header[256];
+    int header_len = snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n\r\n",
+                              status, type, (unsigned)len);
+
+    if(send_all(request->session->fd, header, header_len) < 0 || send_all(request->session->fd, body, len) < 0)
+        return ESP_ERR_HTTPD_RESP_SEND;
+
+    return ESP_OK;
+}
+
+static void free_session_ctx(host_session_t* session)
+{
+    if(session->ctx == NULL)
+        return;
+
+    if(session->free_ctx != NULL)
+        session->free_ctx(session->ctx);
+    else
+        free(session->ctx);
+}
+
+// Sends an error response outside of a handler
+static void send_error(host_session_t* session, const char* status, const char* message)
+{
+    char response[256];
+    int len = snprintf(response, sizeof(response), "HTTP/1.1 %s\r\nContent-Type: text/html\r\nContent-Length: %u\r\n\r\n%s",
+                       status, (unsigned)strlen(message), message);
+
+    send_all(session->fd, response, len);
+}
+
+// Receives into the session input. Returns false if the connection is closed or failed
+static bool receive_input(host_server_t* server, host_session_t* session)
+{
+    char chunk[HTTPD_RECV_CHUNK];
+    ssize_t ret;
+
+    if(session->recv_fn != NULL)
+        ret = session->recv_fn(server, session->fd, chunk, sizeof(chunk), 0);
+    else
+    {
+        do
+            ret = recv(session->fd, chunk, sizeof(chunk), 0);
+        while(ret < 0 && errno == EINTR);
+    }
+
+    if(ret <= 0)
+        return false;
+
+    session->input.append(chunk, ret);
+
+    return true;
+}
+
+static int parse_method(const std::string &method)
+{
+    static const char* const names[] = {"DELETE", "GET", "HEAD", "POST", "PUT"};
+
+    for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        if(method == names[i])
+            return i;
+
+    return -1;
+}
+
+// Looks for the handler of the path, without the query. Sets uri_known if the path has a handler for another method
+static const host_handler_t* find_handler(host_server_t* server, const char* uri, int method, bool &uri_known)
+{
+    size_t path_len = strcspn(uri, "?");
+    uri_known = false;
+
+    for(const host_handler_t &handler : server->handlers)
+    {
+        if(handler.uri.length() != path_len || strncmp(handler.uri.c_str(), uri, path_len) != 0)
+            continue;
+
+        if(handler.def.method == method)
+            return &handler;
+
+        uri_known = true;
+    }
+
+    return NULL;
+}
+
+// Parses and runs the requests that have been received whole on the session.
+// Returns false if the session has to be closed
+static bool run_requests(host_server_t* server, host_session_t* session)
+{
+    for(;;)
+    {
+        size_t header_end = session->input.find("\r\n\r\n");
+
+        if(header_end == std::string::npos)
+        {
+            if(session->input.length() > HTTPD_MAX_REQ_HDR_LEN)
+            {
+                send_error(session, "431 Request Header Fields Too Large", "Header fields are too long for server to interpret");
+                return false;
+            }
+            return true;
+        }
+
+        std::string header = session->input.substr(0, header_end + 2);
+        session->input.erase(0, header_end + 4);
+
+        // Request line
+        size_t method_end = header.find(' ');
+        size_t uri_end = method_end != std::string::npos ? header.find(' ', method_end + 1) : std::string::npos;
+        if(uri_end == std::string::npos)
+        {
+            send_error(session, "400 Bad Request", "Server unable to understand request due to invalid syntax");
+            return false;
+        }
+
+        int method = parse_method(header.substr(0, method_end));
+        std::string uri = header.substr(method_end + 1, uri_end - method_end - 1);
+
+        if(uri.length() > HTTPD_MAX_URI_LEN)
+        {
+            send_error(session, "414 URI Too Long", "URI is too long for server to interpret");
+            return false;
+        }
+
+        // Content length, the only header used by the handlers
+        size_t content_len = 0;
+        for(size_t line = header.find("\r\n"); line != std::string::npos; line = header.find("\r\n", line + 2))
+        {
+            const char* field = header.c_str() + line + 2;
+            if(strncasecmp(field, "Content-Length:", 15) == 0)
+                content_len = strtoul(field + 15, NULL, 10);
+        }
+
+        httpd_req_t req = {};
+        host_request_t request = {server, session, content_len, "200 OK", HTTPD_TYPE_TEXT};
+
+        req.handle      = server;
+        req.method      = method;
+        req.content_len = content_len;
+        req.aux         = &request;
+        req.sess_ctx    = session->ctx;
+        req.free_ctx    = session->free_ctx;
+        strcpy((char*)req.uri, uri.c_str());
+
+        bool uri_known;
+        host_handler_t handler;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> guard(server->lock);
+            const host_handler_t* match = find_handler(server, req.uri, method, uri_known);
+            if(match != NULL)
+            {
+                handler = *match;
+                found = true;
+            }
+        }
+
+        if(!found)
+        {
+            if(uri_known)
+                send_error(session, "405 Method Not Allowed", "Request method for this URI is not allowed");
+            else
+                send_error(session, "404 Not Found", "This URI does not exist");
+            return false;
+        }
+
+        req.user_ctx = handler.def.user_ctx;
+
+        esp_err_t ret = handler.def.handler(&req);
+
+        // As in ESP-IDF, the context set by the handler is kept for the session
+        if(session->ctx != req.sess_ctx)
+        {
+            free_session_ctx(session);
+            session->ctx = req.sess_ctx;
+        }
+        session->free_ctx = req.free_ctx;
+
+        if(ret != ESP_OK)
+            return false;
+
+        // Content left by the handler is dropped, so that the next request starts at its request line
+        while(request.remaining > 0)
+        {
+            if(session->input.empty() && !receive_input(server, session))
+                return false;
+
+            size_t drop = std::min(request.remaining, session->input.length());
+            session->input.erase(0, drop);
+            request.remaining -= drop;
+        }
+
+        // Requests received before the recv override are not parsed either
+        if(session->recv_fn != NULL)
+            return true;
+    }
+}
+
+static void close_session(host_server_t* server, host_session_t* session)
+{
+    {
+        std::lock_guard<std::mutex> guard(server->lock);
+        server->sessions.erase(std::find(server->sessions.begin(), server->sessions.end(), session));
+    }
+
+    free_session_ctx(session);
+    close(session->fd);
+    delete session;
+}
+
+// Waits on the listening socket, the sessions and the wake pipe, and serves them in turn
+static void server_task(void* param)
+{
+    host_server_t* server = (host_server_t*)param;
+
+    while(server->running)
+    {
+        std::vector<host_work_t> work;
+        {
+            std::lock_guard<std::mutex> guard(server->lock);
+            work.swap(server->work);
+        }
+
+        for(const host_work_t &item : work)
+            item.work(item.arg);
+
+        std::vector<host_session_t*> sessions;
+        std::vector<int> closing;
+        {
+            std::lock_guard<std::mutex> guard(server->lock);
+            sessions = server->sessions;
+            closing.swap(server->closing);
+        }
+
+        for(int fd : closing)
+        {
+            for(host_session_t* session : sessions)
+            {
+                if(session->fd == fd)
+                {
+                    close_session(server, session);
+                    sessions.erase(std::find(sessions.begin(), sessions.end(), session));
+                    break;
+                }
+            }
+        }
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(server->wake_fds[0], &fds);
+        int max_fd = server->wake_fds[0];
+
+        // Connections beyond max_open_sockets wait in the backlog
+        if(sessions.size() < server->config.max_open_sockets)
+        {
+            FD_SET(server->listen_fd, &fds);
+            max_fd = std::max(max_fd, server->listen_fd);
+        }
+
+        for(host_session_t* session : sessions)
+        {
+            FD_SET(session->fd, &fds);
+            max_fd = std::max(max_fd, session->fd);
+        }
+
+        if(select(max_fd + 1, &fds, NULL, NULL, NULL) < 0)
+            continue;
+
+        if(FD_ISSET(server->wake_fds[0], &fds))
+        {
+            char bytes[64];
+            (void)!read(server->wake_fds[0], bytes, sizeof(bytes));
+        }
+
+        if(FD_ISSET(server->listen_fd, &fds))
+        {
+            int fd = accept(server->listen_fd, NULL, NULL);
+            if(fd >= 0)
+            {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                set_timeouts(fd, server->config);
+
+                host_session_t* session = new host_session_t();
+                session->fd = fd;
+
+                std::lock_guard<std::mutex> guard(server->lock);
+                server->sessions.push_back(session);
+            }
+        }
+
+        for(host_session_t* session : sessions)
+        {
+            if(!FD_ISSET(session->fd, &fds))
+                continue;
+
+            if(!receive_input(server, session) || !run_requests(server, session))
+                close_session(server, session);
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config)
+{
+    host_server_t* server = new host_server_t();
+    server->config = *config;
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(server->listen_fd < 0 || pipe(server->wake_fds) != 0)
+    {
+        delete server;
+        return ESP_FAIL;
+    }
+
+    fcntl(server->wake_fds[0], F_SETFL, O_NONBLOCK);
+
+    int one = 1;
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(config->server_port);
+
+    if(bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+       listen(server->listen_fd, config->backlog_conn) != 0)
+    {
+        perror("httpd_start");
+        close(server->listen_fd);
+        close(server->wake_fds[0]);
+        close(server->wake_fds[1]);
+        delete server;
+        return ESP_FAIL;
+    }
+
+    server->running = true;
+
+    if(xTaskCreatePinnedToCore(server_task, "httpd", config->stack_size, server, config->task_priority,
+                               &server->task_h, config->core_id) != pdPASS)
+        return ESP_ERR_HTTPD_TASK;
+
+    *handle = server;
+
+    return ESP_OK;
+}
+
+// Stops accepting connections. The server thread ends at its next wake up, and the server is not freed,
+// as workers may still hold its handle
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    host_server_t* server = (host_server_t*)handle;
+
+    if(server == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    server->running = false;
+    wake(server);
+
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler)
+{
+    host_server_t* server = (host_server_t*)handle;
+
+    if(server == NULL || uri_handler == NULL || uri_handler->uri == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(server->lock);
+
+    for(const host_handler_t &handler : server->handlers)
+        if(handler.uri == uri_handler->uri && handler.def.method == uri_handler->method)
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+
+    if(server->handlers.size() >= server->config.max_uri_handlers)
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+
+    host_handler_t handler;
+    handler.uri = uri_handler->uri;
+    handler.def = *uri_handler;
+
+    server->handlers.push_back(handler);
+
+    // The uri pointer is not kept, as the caller may free it
+    server->handlers.back().def.uri = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle, const char* uri, httpd_method_t method)
+{
+    host_server_t* server = (host_server_t*)handle;
+
+    if(server == NULL || uri == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(server->lock);
+
+    for(auto handler = server->handlers.begin(); handler != server->handlers.end(); handler++)
+    {
+        if(handler->uri == uri && handler->def.method == method)
+        {
+            server->handlers.erase(handler);
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_recv(httpd_req_t* req, char* buf, size_t buf_len)
+{
+    host_request_t* request = (host_request_t*)req->aux;
+    host_session_t* session = request->session;
+
+    if(request->remaining == 0)
+        return 0;
+
+    if(session->input.empty())
+    {
+        char chunk[HTTPD_RECV_CHUNK];
+        ssize_t ret;
+
+        do
+            ret = recv(session->fd, chunk, std::min(sizeof(chunk), request->remaining), 0);
+        while(ret < 0 && errno == EINTR);
+
+        if(ret < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+        if(ret == 0)
+            return HTTPD_SOCK_ERR_FAIL;
+
+        session->input.append(chunk, ret);
+    }
+
+    size_t len = std::min(std::min(buf_len, request->remaining), session->input.length());
+
+    memcpy(buf, session->input.data(), len);
+    session->input.erase(0, len);
+    request->remaining -= len;
+
+    return len;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t* req)
+{
+    const char* query = strchr(req->uri, '?');
+
+    return query != NULL ? strlen(query + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buf, size_t buf_len)
+{
+    const char* query = strchr(req->uri, '?');
+
+    if(query == NULL || buf_len == 0)
+        return ESP_ERR_NOT_FOUND;
+
+    query++;
+    size_t len = strlen(query);
+    size_t copy = std::min(len, buf_len - 1);
+
+    memcpy(buf, query, copy);
+    buf[copy] = '\0';
+
+    return copy < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+// As in ESP-IDF, values are not URL decoded
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size)
+{
+    if(qry == NULL || key == NULL || val == NULL || val_size == 0)
+        return ESP_ERR_INVALID_ARG;
+
+    size_t key_len = strlen(key);
+    const char* pair = qry;
+
+    while(pair != NULL && *pair != '\0')
+    {
+        const char* end = strchr(pair, '&');
+        size_t pair_len = end != NULL ? (size_t)(end - pair) : strlen(pair);
+
+        if(pair_len > key_len && strncmp(pair, key, key_len) == 0 && pair[key_len] == '=')
+        {
+            size_t len = pair_len - key_len - 1;
+            size_t copy = std::min(len, val_size - 1);
+
+            memcpy(val, pair + key_len + 1, copy);
+            val[copy] = '\0';
+
+            return copy < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+
+        pair = end != NULL ? end + 1 : NULL;
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status)
+{
+    ((host_request_t*)req->aux)->status = status;
+
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type)
+{
+    ((host_request_t*)req->aux)->type = type;
+
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buf, ssize_t buf_len)
+{
+    host_request_t* request = (host_request_t*)req->aux;
+
+    if(buf == NULL)
+        buf_len = 0;
+    else if(buf_len < 0)
+        buf_len = strlen(buf);
+
+    return send_response(req, request->status.c_str(), request->type.c_str(), buf, buf_len);
+}
+
+esp_err_t httpd_resp_send_404(httpd_req_t* req)
+{
+    const char* message = "This URI does not exist";
+
+    return send_response(req, "404 Not Found", HTTPD_TYPE_TEXT, message, strlen(message));
+}
+
+esp_err_t httpd_resp_send_408(httpd_req_t* req)
+{
+    const char* message = "Server closed this connection";
+
+    return send_response(req, "408 Request Timeout", HTTPD_TYPE_TEXT, message, strlen(message));
+}
+
+esp_err_t httpd_resp_send_500(httpd_req_t* req)
+{
+    const char* message = "Server has encountered an unexpected error";
+
+    return send_response(req, "500 Internal Server Error", HTTPD_TYPE_TEXT, message, strlen(message));
+}
+
+int httpd_req_to_sockfd(httpd_req_t* req)
+{
+    return ((host_request_t*)req->aux)->session->fd;
+}
+
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char* buf, size_t buf_len, int flags)
+{
+    host_server_t* server = (host_server_t*)handle;
+
+    {
+        std::lock_guard<std::mutex> guard(server->lock);
+
+        bool open = false;
+        for(host_session_t* session : server->sessions)
+            open |= session->fd == sockfd;
+
+        if(!open)
+            return HTTPD_SOCK_ERR_INVALID;
+    }
+
+    ssize_t ret;
+    do
+        ret = send(sockfd, buf, buf_len, flags | MSG_NOSIGNAL);
+    while(ret < 0 && errno == EINTR);
+
+    if(ret < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+
+    return ret;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    host_server_t* server = (host_server_t*)handle;
+
+    {
+        std::lock_guard<std::mutex> guard(server->lock);
+        server->closing.push_back(sockfd);
+    }
+
+    wake(server);
+
+    return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void* arg)
+{
+    host_server_t* server = (host_server_t*)handle;
+
+    if(server == NULL || work == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    {
+        std::lock_guard<std::mutex> guard(server->lock);
+        server->work.push_back(host_work_t{work, arg});
+    }
+
+    wake(server);
+
+    return ESP_OK;
+}
+
+static host_session_t* find_session(host_server_t* server, int sockfd)
+{
+    std::lock_guard<std::mutex> guard(server->lock);
+
+    for(host_session_t* session : server->sessions)
+        if(session->fd == sockfd)
+            return session;
+
+    return NULL;
+}
+
+void* httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
+{
+    host_session_t* session = find_session((host_server_t*)handle, sockfd);
+
+    return session != NULL ? session->ctx : NULL;
+}
+
+esp_err_t httpd_sess_set_recv_override(httpd_handle_t handle, int sockfd, httpd_recv_func_t recv_func)
+{
+    host_session_t* session = find_session((host_server_t*)handle, sockfd);
+
+    if(session == NULL)
+        return ESP_ERR_INVALID_ARG;
+
+    session->recv_fn = recv_func;
+
+    return ESP_OK;
+}
@@ -0,0 +1,117 @@
+#ifndef __UNIVERSALREMOTE_HOST_ARDUINO__
+#define __UNIVERSALREMOTE_HOST_ARDUINO__
+
+// The parts of the Arduino core used by the http handlers and the modules built with them on the host.
+// See src/host/http_server.cpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <string>
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#define GPIO_NUM_MAX            40
+#define GPIO_IS_VALID_OUTPUT_GPIO(gpio_num) ((gpio_num) >= 0 && (gpio_num) < 34)   // 34 to 39 are inputs only
+
+#define INPUT                   0x01
+#define OUTPUT                  0x02
+#define LOW                     0x0
+#define HIGH                    0x1
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+
+// Pins do nothing on the host
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) {}
+inline int digitalRead(uint8_t pin) { return LOW; }
+
+// The host clock is already set
+inline void configTime(long gmt_offset_sec, int daylight_offset_sec, const char* server1,
+                       const char* server2 = NULL, const char* server3 = NULL) {}
+
+// Arduino String, on std::string. Numbers are converted as by the Arduino core
+class String
+{
+private:
+    std::string str;
+
+public:
+    String() {}
+    String(const char* value) : str(value != NULL ? value : "") {}
+    String(const std::string &value) : str(value) {}
+    explicit String(char value) : str(1, value) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(double value, unsigned char decimals = 2);
+
+    const char* c_str() const { return str.c_str(); }
+    unsigned int length() const { return str.length(); }
+
+    String& operator+=(const String &other) { str += other.str; return *this; }
+    String& operator+=(const char* other) { str += other; return *this; }
+    String& operator+=(char other) { str += other; return *this; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.str + b.str); }
+
+    bool operator==(const String &other) const { return str == other.str; }
+    bool operator!=(const String &other) const { return str != other.str; }
+
+    char operator[](unsigned int index) const { return index < str.length() ? str[index] : 0; }
+
+    bool startsWith(const String &prefix) const { return str.compare(0, prefix.str.length(), prefix.str) == 0; }
+    int indexOf(const String &other, unsigned int from = 0) const;
+    String substring(unsigned int begin, unsigned int end = (unsigned int)-1) const;
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+};
+
+class IPAddress
+{
+private:
+    uint8_t bytes[4];
+
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : bytes{a, b, c, d} {}
+
+    String toString() const;
+};
+
+// Serial prints to stdout
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud) {}
+
+    void print(const char* str);
+    void print(const String &str) { print(str.c_str()); }
+    void print(const IPAddress &ip) { print(ip.toString()); }
+    void print(long value) { print(String(value)); }
+
+    template<typename T> void println(const T &value) { print(value); print("\n"); }
+    void println() { print("\n"); }
+
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+#endif
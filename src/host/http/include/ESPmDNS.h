@@ -0,0 +1,18 @@
+#ifndef __UNIVERSALREMOTE_HOST_ESPMDNS__
+#define __UNIVERSALREMOTE_HOST_ESPMDNS__
+
+// mDNS is not advertised on the host
+
+#include "Arduino.h"
+
+class MDNSResponder
+{
+public:
+    bool begin(const char* hostname) { return true; }
+    bool addService(const char* service, const char* proto, uint16_t port) { return true; }
+    bool addServiceTxt(const char* service, const char* proto, const char* key, const char* value) { return true; }
+};
+
+extern MDNSResponder MDNS;
+
+#endif
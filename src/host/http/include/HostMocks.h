@@ -0,0 +1,17 @@
+#ifndef __UNIVERSALREMOTE_HOST_MOCKS__
+#define __UNIVERSALREMOTE_HOST_MOCKS__
+
+// Timings of the hardware that the host build stands in for. Set from the command line of src/host/http_server.cpp
+
+#include <stdint.h>
+
+struct host_mock_config_t
+{
+    uint32_t capture_ms;                            // From the receiver being enabled or resumed to the next frame
+    uint32_t ac_ms;                                 // Time taken by IRac to send a message
+    uint32_t scan_ms;                               // Time taken by a WiFi scan
+};
+
+extern host_mock_config_t host_mocks;
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __UNIVERSALREMOTE_HOST_IRAC__
+#define __UNIVERSALREMOTE_HOST_IRAC__
+
+// IRac on the host takes host_mocks.ac_ms to send, and sends nothing. All the protocols listed in IRrecv.h are supported
+
+#include "IRrecv.h"
+
+namespace stdAc
+{
+    enum class opmode_t { kOff = -1, kAuto = 0, kCool = 1, kHeat = 2, kDry = 3, kFan = 4 };
+    enum class fanspeed_t { kAuto = 0, kMin = 1, kLow = 2, kMedium = 3, kHigh = 4, kMax = 5 };
+    enum class swingv_t { kOff = -1, kAuto = 0, kHighest = 1, kHigh = 2, kMiddle = 3, kLow = 4, kLowest = 5 };
+    enum class swingh_t { kOff = -1, kAuto = 0, kLeftMax = 1, kLeft = 2, kMiddle = 3, kRight = 4, kRightMax = 5, kWide = 6 };
+}
+
+class IRac
+{
+public:
+    IRac(uint16_t pin, bool inverted = false, bool use_modulation = true) {}
+
+    static bool isProtocolSupported(decode_type_t protocol) { return protocol > UNUSED && protocol <= kLastDecodeType; }
+
+    bool sendAc(decode_type_t vendor, int16_t model, bool power, stdAc::opmode_t mode, float degrees, bool celsius,
+                stdAc::fanspeed_t fan, stdAc::swingv_t swingv, stdAc::swingh_t swingh, bool quiet, bool turbo,
+                bool econo, bool light, bool filter, bool clean, bool beep, int16_t sleep = -1, int16_t clock = -1);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef __UNIVERSALREMOTE_HOST_IRRECV__
+#define __UNIVERSALREMOTE_HOST_IRRECV__
+
+// The types of IRremoteESP8266 used by the firmware, with only a few protocols listed, with their values in the library.
+// IRrecv stands for the receiver and a remote : host_mocks.capture_ms after the receiver is enabled or resumed,
+// it stops on an NEC frame, as the timer interrupt does on the device. See HostMocks.h
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum decode_type_t
+{
+    UNKNOWN = -1,
+    UNUSED = 0,
+    RC5,
+    RC6,
+    NEC,
+    SONY,
+    PANASONIC,
+    JVC,
+    SAMSUNG,
+    WHYNTER,
+    AIWA_RC_T501,
+    LG,
+    SANYO,
+    MITSUBISHI,
+    DISH,
+    SHARP,
+    COOLIX,
+    DAIKIN,
+    kLastDecodeType = DAIKIN
+};
+
+const uint8_t kTolerance = 25;
+const uint16_t kStateSizeMax = 53;
+const uint8_t kStopState = 5;
+const uint16_t kRawTick = 2;
+const uint8_t kIdleState = 2;
+
+// Capture state shared with the interrupt on the device
+struct irparams_t
+{
+    uint8_t recvpin;
+    uint8_t rcvstate;
+    uint16_t bufsize;
+    uint16_t* rawbuf;
+    uint16_t rawlen;
+    uint8_t overflow;
+    uint8_t timeout;
+    uint32_t timer;
+};
+
+namespace _IRrecv
+{
+    extern volatile irparams_t params;
+    extern irparams_t *params_save;
+}
+
+class decode_results
+{
+public:
+    decode_type_t decode_type;
+    union
+    {
+        struct
+        {
+            uint64_t value;
+            uint32_t address;
+            uint32_t command;
+        };
+        uint8_t state[kStateSizeMax];
+    };
+    uint16_t bits;
+    volatile uint16_t* rawbuf;
+    uint16_t rawlen;
+    bool overflow;
+    bool repeat;
+};
+
+class IRrecv
+{
+public:
+    IRrecv(uint16_t recvpin, uint16_t bufsize = 1024, uint8_t timeout = 15, bool save_buffer = false);
+
+    void enableIRIn(bool pullup = false);
+    void disableIRIn();
+    void resume();
+    bool decode(decode_results* results);
+
+    void setTolerance(uint8_t percent = kTolerance) {}
+    void setUnknownThreshold(uint16_t length) {}
+};
+
+#endif
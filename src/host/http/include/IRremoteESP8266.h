@@ -0,0 +1,85 @@
+#ifndef __UNIVERSALREMOTE_HOST_IRREMOTEESP8266__
+#define __UNIVERSALREMOTE_HOST_IRREMOTEESP8266__
+
+// Protocol flags of IRremoteESP8266. The host build has the protocols listed in IRrecv.h, and HASH
+
+#define DECODE_HASH             true
+
+#define DECODE_NEC              true
+#define SEND_NEC                true
+#define DECODE_SONY             true
+#define SEND_SONY               true
+#define DECODE_RC5              true
+#define SEND_RC5                true
+#define DECODE_RC6              true
+#define SEND_RC6                true
+#define DECODE_RCMM             false
+#define SEND_RCMM               false
+#define DECODE_SAMSUNG          true
+#define SEND_SAMSUNG            true
+#define DECODE_SAMSUNG36        false
+#define SEND_SAMSUNG36          false
+#define DECODE_SAMSUNG_AC       false
+#define SEND_SAMSUNG_AC         false
+#define DECODE_LG               true
+#define SEND_LG                 true
+#define DECODE_SANYO            true
+#define SEND_SANYO              true
+#define DECODE_SHARP            true
+#define SEND_SHARP              true
+#define DECODE_SHARP_AC         false
+#define SEND_SHARP_AC           false
+#define DECODE_JVC              true
+#define SEND_JVC                true
+#define DECODE_PANASONIC        true
+#define SEND_PANASONIC          true
+#define DECODE_PANASONIC_AC     false
+#define SEND_PANASONIC_AC       false
+#define DECODE_DENON            false
+#define SEND_DENON              false
+#define DECODE_DISH             true
+#define SEND_DISH               true
+#define DECODE_WHYNTER          true
+#define SEND_WHYNTER            true
+#define DECODE_NIKAI            false
+#define SEND_NIKAI              false
+#define DECODE_PIONEER          false
+#define SEND_PIONEER            false
+#define DECODE_COOLIX           true
+#define SEND_COOLIX             true
+#define DECODE_DAIKIN           true
+#define SEND_DAIKIN             true
+#define DECODE_DAIKIN2          false
+#define SEND_DAIKIN2            false
+#define DECODE_KELVINATOR       false
+#define SEND_KELVINATOR         false
+#define DECODE_MITSUBISHI       true
+#define SEND_MITSUBISHI         true
+#define DECODE_MITSUBISHI_AC    false
+#define SEND_MITSUBISHI_AC      false
+#define DECODE_GREE             false
+#define SEND_GREE               false
+#define DECODE_HAIER_AC         false
+#define SEND_HAIER_AC           false
+#define DECODE_HITACHI_AC       false
+#define SEND_HITACHI_AC         false
+#define DECODE_TOSHIBA_AC       false
+#define SEND_TOSHIBA_AC         false
+#define DECODE_FUJITSU_AC       false
+#define SEND_FUJITSU_AC         false
+#define DECODE_MIDEA            false
+#define SEND_MIDEA              false
+#define DECODE_CARRIER_AC       false
+#define SEND_CARRIER_AC         false
+#define DECODE_WHIRLPOOL_AC     false
+#define SEND_WHIRLPOOL_AC       false
+#define DECODE_ELECTRA_AC       false
+#define SEND_ELECTRA_AC         false
+#define DECODE_VESTEL_AC        false
+#define SEND_VESTEL_AC          false
+#define DECODE_TCL112AC         false
+#define SEND_TCL112AC           false
+#define DECODE_TECO             false
+#define SEND_TECO               false
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __UNIVERSALREMOTE_HOST_IRSEND__
+#define __UNIVERSALREMOTE_HOST_IRSEND__
+
+// IRsend on the host takes as long as the frame would to send, and sends nothing. See HostMocks.h
+
+#include <stdint.h>
+
+class IRsend
+{
+public:
+    IRsend(uint16_t pin, bool inverted = false, bool use_modulation = true) {}
+
+    void begin() {}
+
+    void sendRaw(const uint16_t buf[], uint16_t len, uint16_t hz);
+};
+
+#endif
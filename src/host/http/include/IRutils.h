@@ -0,0 +1,14 @@
+#ifndef __UNIVERSALREMOTE_HOST_IRUTILS__
+#define __UNIVERSALREMOTE_HOST_IRUTILS__
+
+#include "Arduino.h"
+#include "IRrecv.h"
+
+String typeToString(decode_type_t protocol, bool repeat = false);
+
+// Returns UNKNOWN for names that are not listed in IRrecv.h
+decode_type_t strToDecodeType(const char* str);
+
+String uint64ToString(uint64_t input, uint8_t base = 10);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __UNIVERSALREMOTE_HOST_WIFI__
+#define __UNIVERSALREMOTE_HOST_WIFI__
+
+// WiFi on the host : the station is connected as soon as it is started, and scans return a fixed list of
+// networks after host_mocks.scan_ms, about the time of a scan of all channels on the ESP32
+
+#include "Arduino.h"
+
+typedef enum
+{
+    WIFI_OFF,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+} wifi_mode_t;
+
+typedef enum
+{
+    WL_IDLE_STATUS      = 0,
+    WL_CONNECTED        = 3,
+    WL_DISCONNECTED     = 6
+} wl_status_t;
+
+typedef enum
+{
+    SYSTEM_EVENT_STA_CONNECTED,
+    SYSTEM_EVENT_STA_DISCONNECTED,
+    SYSTEM_EVENT_STA_GOT_IP
+} WiFiEvent_t;
+
+typedef enum
+{
+    WIFI_REASON_AUTH_FAIL           = 202,
+    WIFI_REASON_NO_AP_FOUND         = 201,
+    WIFI_REASON_HANDSHAKE_TIMEOUT   = 204
+} wifi_err_reason_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t reason;
+    } disconnected;
+} WiFiEventInfo_t;
+
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+
+class WiFiClass
+{
+private:
+    wifi_mode_t current_mode;
+    bool connected;
+
+public:
+    WiFiClass() : current_mode(WIFI_OFF), connected(false) {}
+
+    bool mode(wifi_mode_t mode);
+    wl_status_t begin(const char* ssid, const char* password);
+    bool disconnect();
+    wl_status_t status();
+    bool isConnected();
+
+    bool softAP(const char* ssid, const char* password);
+    bool softAPdisconnect(bool wifioff);
+    IPAddress softAPIP();
+
+    void onEvent(WiFiEventFuncCb callback) {}
+
+    int16_t scanNetworks();
+    String SSID(uint8_t index);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef __UNIVERSALREMOTE_HOST_ESP_HEAP_CAPS__
+#define __UNIVERSALREMOTE_HOST_ESP_HEAP_CAPS__
+
+// The host heap has no fixed size, so the heap statistics report what malloc holds in its arenas
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MALLOC_CAP_8BIT         (1 << 2)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef __UNIVERSALREMOTE_HOST_ESP_HTTP_SERVER__
+#define __UNIVERSALREMOTE_HOST_ESP_HTTP_SERVER__
+
+// The esp_http_server API of ESP-IDF 3, on POSIX sockets, so that the http handlers run unchanged on the host.
+// As on the device, one server thread waits on all the sockets with select and runs the handlers in turn,
+// at most max_open_sockets connections are served at once (the others wait in the listen backlog), and
+// connections are kept open between requests until the client closes them or httpd_sess_trigger_close is called.
+// Only the functions used by the firmware are implemented.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+#define HTTPD_MAX_REQ_HDR_LEN   512
+#define HTTPD_MAX_URI_LEN       512
+
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_INVALID  -2
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+
+#define HTTPD_TYPE_TEXT         "text/html"
+
+typedef void* httpd_handle_t;
+
+typedef void (*httpd_work_fn_t)(void* arg);
+typedef int (*httpd_recv_func_t)(httpd_handle_t handle, int sockfd, char* buf, size_t buf_len, int flags);
+
+typedef enum
+{
+    HTTP_DELETE = 0,
+    HTTP_GET    = 1,
+    HTTP_HEAD   = 2,
+    HTTP_POST   = 3,
+    HTTP_PUT    = 4
+} httpd_method_t;
+
+typedef struct httpd_req
+{
+    httpd_handle_t handle;
+    int method;
+    const char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void* aux;                                      // State of the request in the server
+    void* user_ctx;
+    void* sess_ctx;                                 // Kept for the session once the handler returns
+    void (*free_ctx)(void* ctx);                    // Frees sess_ctx when the session closes, free() if NULL
+} httpd_req_t;
+
+typedef struct httpd_uri
+{
+    const char* uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t* req);
+    void* user_ctx;
+} httpd_uri_t;
+
+typedef struct httpd_config
+{
+    unsigned task_priority;
+    size_t stack_size;
+    int core_id;
+    uint16_t server_port;
+    uint16_t ctrl_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t max_resp_headers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;
+    uint16_t recv_wait_timeout;                     // In seconds
+    uint16_t send_wait_timeout;                     // In seconds
+} httpd_config_t;
+
+// Port of the servers started with HTTPD_DEFAULT_CONFIG, as port 80 needs privileges on the host
+extern uint16_t httpd_host_port;
+
+// Same defaults as ESP-IDF, apart from the port
+#define HTTPD_DEFAULT_CONFIG() {            \
+        .task_priority      = 5,            \
+        .stack_size         = 4096,         \
+        .core_id            = 0x7FFFFFFF,   \
+        .server_port        = httpd_host_port, \
+        .ctrl_port          = 32768,        \
+        .max_open_sockets   = 7,            \
+        .max_uri_handlers   = 8,            \
+        .max_resp_headers   = 8,            \
+        .backlog_conn       = 5,            \
+        .lru_purge_enable   = false,        \
+        .recv_wait_timeout  = 5,            \
+        .send_wait_timeout  = 5,            \
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler);
+esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle, const char* uri, httpd_method_t method);
+
+// Reads up to buf_len bytes of the content. Returns the number read, 0 once the whole content has been read,
+// or HTTPD_SOCK_ERR_TIMEOUT / HTTPD_SOCK_ERR_FAIL
+int httpd_req_recv(httpd_req_t* req, char* buf, size_t buf_len);
+
+size_t httpd_req_get_url_query_len(httpd_req_t* req);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size);
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status);
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type);
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_404(httpd_req_t* req);
+esp_err_t httpd_resp_send_408(httpd_req_t* req);
+esp_err_t httpd_resp_send_500(httpd_req_t* req);
+
+int httpd_req_to_sockfd(httpd_req_t* req);
+
+// May be called from any thread, for a socket whose request has been handed over to it
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char* buf, size_t buf_len, int flags);
+
+// Closes the connection from the server thread. May be called from any thread
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+
+// Runs work on the server thread, in the order queued. May be called from any thread
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void* arg);
+
+// Context of the session of the socket, NULL if it is not open. Only called from the server thread
+void* httpd_sess_get_ctx(httpd_handle_t handle, int sockfd);
+
+// Replaces recv for the reads of the next requests of the session. Only called from the server thread
+esp_err_t httpd_sess_set_recv_override(httpd_handle_t handle, int sockfd, httpd_recv_func_t recv_func);
+
+#endif
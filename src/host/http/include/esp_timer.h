@@ -0,0 +1,9 @@
+#ifndef __UNIVERSALREMOTE_HOST_ESP_TIMER__
+#define __UNIVERSALREMOTE_HOST_ESP_TIMER__
+
+#include <stdint.h>
+
+// Microseconds since the program started, from the monotonic clock
+int64_t esp_timer_get_time();
+
+#endif
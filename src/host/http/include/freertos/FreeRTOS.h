@@ -0,0 +1,44 @@
+#ifndef __UNIVERSALREMOTE_HOST_FREERTOS__
+#define __UNIVERSALREMOTE_HOST_FREERTOS__
+
+// FreeRTOS on POSIX threads, for the functions used by the modules built on the host. Ticks are milliseconds,
+// as in the ESP32 Arduino build. Priorities and core affinities are ignored, so tasks only run as they would
+// on the device if they block rather than spin. Critical sections are spin locks, as on the ESP32
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS      1
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+// Static creation is accepted, but the objects are still made on the heap : the storage passed is left unused
+#define configSUPPORT_STATIC_ALLOCATION 1
+
+struct portMUX_TYPE
+{
+    volatile uint32_t owner;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED    {0}
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+
+#define portENTER_CRITICAL(mux)         vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)          vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)      vPortExitCritical(mux)
+
+#endif
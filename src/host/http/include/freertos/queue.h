@@ -0,0 +1,23 @@
+#ifndef __UNIVERSALREMOTE_HOST_FREERTOS_QUEUE__
+#define __UNIVERSALREMOTE_HOST_FREERTOS_QUEUE__
+
+#include "FreeRTOS.h"
+
+typedef struct host_queue_t* QueueHandle_t;
+struct StaticQueue_t
+{
+    void* unused;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* queue);
+void vQueueDelete(QueueHandle_t queue);
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#endif
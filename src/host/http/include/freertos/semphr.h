@@ -0,0 +1,20 @@
+#ifndef __UNIVERSALREMOTE_HOST_FREERTOS_SEMPHR__
+#define __UNIVERSALREMOTE_HOST_FREERTOS_SEMPHR__
+
+// Semaphores are queues of empty items, as in FreeRTOS. Mutexes have no priority inheritance
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* semaphore);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* semaphore);
+
+#define vSemaphoreDelete(sem)           vQueueDelete(sem)
+#define xSemaphoreTake(sem, ticks)      xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)             xQueueSend(sem, NULL, 0)
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __UNIVERSALREMOTE_HOST_FREERTOS_TASK__
+#define __UNIVERSALREMOTE_HOST_FREERTOS_TASK__
+
+#include "FreeRTOS.h"
+
+typedef struct host_task_t* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* param);
+
+typedef uint8_t StackType_t;
+struct StaticTask_t
+{
+    void* unused;
+};
+
+// Runs the task on a detached thread. The stack size is in bytes, as on the ESP32, and is given to the thread
+// with a floor, as host code uses more stack than the device
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stack_size, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t task, const char* name, uint32_t stack_size, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t task, const char* name, uint32_t stack_size, void* param,
+                                           UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb,
+                                           BaseType_t core);
+
+// Stacks are not measured on the host : reports the stack size the task was created with
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+const char* pcTaskGetTaskName(TaskHandle_t task);
+
+// Only NULL, the calling task, can be deleted
+void vTaskDelete(TaskHandle_t task);
+
+// Only NULL, the calling task, can be suspended, and nothing resumes it
+void vTaskSuspend(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#endif
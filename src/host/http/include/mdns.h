@@ -0,0 +1,22 @@
+#ifndef __UNIVERSALREMOTE_HOST_MDNS__
+#define __UNIVERSALREMOTE_HOST_MDNS__
+
+// mDNS is not advertised on the host
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+typedef struct
+{
+    const char* key;
+    const char* value;
+} mdns_txt_item_t;
+
+inline esp_err_t mdns_service_add(const char* instance, const char* service, const char* proto, uint16_t port,
+                                  mdns_txt_item_t* txt, size_t num_items) { return ESP_OK; }
+inline esp_err_t mdns_service_port_set(const char* service, const char* proto, uint16_t port) { return ESP_OK; }
+inline esp_err_t mdns_service_remove(const char* service, const char* proto) { return ESP_OK; }
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __UNIVERSALREMOTE_HOST_MQTT_CLIENT__
+#define __UNIVERSALREMOTE_HOST_MQTT_CLIENT__
+
+// Only the types of the MQTT client, which is mocked on the host
+
+typedef struct esp_mqtt_client* esp_mqtt_client_handle_t;
+typedef struct esp_mqtt_event_t* esp_mqtt_event_handle_t;
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __UNIVERSALREMOTE_HOST_NVS__
+#define __UNIVERSALREMOTE_HOST_NVS__
+
+// NVS kept in memory, and lost when the program exits. Each namespace has its own handle, and writes are
+// visible at once, without nvs_commit
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle;
+typedef nvs_handle nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode;
+
+#define NVS_KEY_NAME_MAX_SIZE   16
+
+esp_err_t nvs_open(const char* name, nvs_open_mode mode, nvs_handle* handle);
+void nvs_close(nvs_handle handle);
+esp_err_t nvs_commit(nvs_handle handle);
+
+// As in ESP-IDF, a NULL out_value sets length to the size needed, null termination included for strings
+esp_err_t nvs_get_str(nvs_handle handle, const char* key, char* out_value, size_t* length);
+esp_err_t nvs_set_str(nvs_handle handle, const char* key, const char* value);
+esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_value, size_t* length);
+esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t length);
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char* key);
+esp_err_t nvs_erase_all(nvs_handle handle);
+
+#endif
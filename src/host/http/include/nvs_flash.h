@@ -0,0 +1,9 @@
+#ifndef __UNIVERSALREMOTE_HOST_NVS_FLASH__
+#define __UNIVERSALREMOTE_HOST_NVS_FLASH__
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase();
+
+#endif
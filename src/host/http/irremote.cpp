@@ -0,0 +1,179 @@
+// IRremoteESP8266 on the host : a receiver that gets an NEC frame at a fixed rate, and senders that take the time
+// of the frames they are given. See HostMocks.h
+
+#include <Arduino.h>
+#include <IRrecv.h>
+#include <IRsend.h>
+#include <IRac.h>
+#include <IRutils.h>
+#include <HostMocks.h>
+
+#include <strings.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+host_mock_config_t host_mocks = {300, 60, 2000};
+
+// NEC frame of address 0x04, command 0x08, in microseconds, starting with the header mark
+static const uint16_t kNecValue[] = {
+    9000, 4500,
+    560, 560, 560, 560, 560, 1690, 560, 560, 560, 560, 560, 560, 560, 560, 560, 560,
+    560, 1690, 560, 1690, 560, 560, 560, 1690, 560, 1690, 560, 1690, 560, 1690, 560, 1690,
+    560, 560, 560, 560, 560, 560, 560, 1690, 560, 560, 560, 560, 560, 560, 560, 560,
+    560, 1690, 560, 1690, 560, 1690, 560, 560, 560, 1690, 560, 1690, 560, 1690, 560, 1690,
+    560
+};
+static const uint16_t kNecLen = sizeof(kNecValue) / sizeof(kNecValue[0]);
+static const uint64_t kNecCode = 0x20DF10EF;
+
+static uint16_t rawbuf[kNecLen + 1];
+static uint16_t rawbuf_save[kNecLen + 1];
+static irparams_t params_save_struct = {0, kStopState, kNecLen + 1, rawbuf_save, 0, 0, 15, 0};
+
+namespace _IRrecv
+{
+    volatile irparams_t params = {0, kIdleState, kNecLen + 1, rawbuf, 0, 0, 15, 0};
+    irparams_t *params_save = &params_save_struct;
+}
+
+static std::mutex remote_lock;
+static std::atomic<bool> remote_enabled(false);
+static std::atomic<int64_t> next_frame_us(0);
+
+// Stands for the timer interrupt : stops the receiver on a frame once it is due
+static void remote_thread()
+{
+    for(;;)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        std::lock_guard<std::mutex> guard(remote_lock);
+
+        if(!remote_enabled || _IRrecv::params.rcvstate == kStopState || esp_timer_get_time() < next_frame_us)
+            continue;
+
+        _IRrecv::params.rawbuf[0] = 20000 / kRawTick;
+        for(uint16_t i = 0; i < kNecLen; i++)
+            _IRrecv::params.rawbuf[i + 1] = kNecValue[i] / kRawTick;
+
+        _IRrecv::params.rawlen = kNecLen + 1;
+        _IRrecv::params.overflow = false;
+        _IRrecv::params.rcvstate = kStopState;
+    }
+}
+
+static void arm()
+{
+    _IRrecv::params.rcvstate = kIdleState;
+    _IRrecv::params.rawlen = 0;
+    next_frame_us = esp_timer_get_time() + host_mocks.capture_ms * 1000LL;
+}
+
+IRrecv::IRrecv(uint16_t recvpin, uint16_t bufsize, uint8_t timeout, bool save_buffer)
+{
+    static std::once_flag started;
+    std::call_once(started, [] { std::thread(remote_thread).detach(); });
+
+    _IRrecv::params.recvpin = recvpin;
+    _IRrecv::params.timeout = timeout;
+}
+
+void IRrecv::enableIRIn(bool pullup)
+{
+    std::lock_guard<std::mutex> guard(remote_lock);
+
+    arm();
+    remote_enabled = true;
+}
+
+void IRrecv::disableIRIn()
+{
+    std::lock_guard<std::mutex> guard(remote_lock);
+
+    remote_enabled = false;
+}
+
+void IRrecv::resume()
+{
+    std::lock_guard<std::mutex> guard(remote_lock);
+
+    arm();
+}
+
+// Decodes the one frame the remote sends
+bool IRrecv::decode(decode_results* results)
+{
+    std::lock_guard<std::mutex> guard(remote_lock);
+
+    if(_IRrecv::params.rcvstate != kStopState)
+        return false;
+
+    for(uint16_t i = 0; i < _IRrecv::params.rawlen; i++)
+        rawbuf_save[i] = _IRrecv::params.rawbuf[i];
+
+    results->rawbuf = rawbuf_save;
+    results->rawlen = _IRrecv::params.rawlen;
+    results->overflow = false;
+    results->repeat = false;
+    results->decode_type = NEC;
+    results->value = kNecCode;
+    results->address = 0x04;
+    results->command = 0x08;
+    results->bits = 32;
+
+    arm();
+
+    return true;
+}
+
+void IRsend::sendRaw(const uint16_t buf[], uint16_t len, uint16_t hz)
+{
+    uint32_t duration_us = 0;
+    for(uint16_t i = 0; i < len; i++)
+        duration_us += buf[i];
+
+    std::this_thread::sleep_for(std::chrono::microseconds(duration_us));
+}
+
+bool IRac::sendAc(decode_type_t vendor, int16_t model, bool power, stdAc::opmode_t mode, float degrees, bool celsius,
+                  stdAc::fanspeed_t fan, stdAc::swingv_t swingv, stdAc::swingh_t swingh, bool quiet, bool turbo,
+                  bool econo, bool light, bool filter, bool clean, bool beep, int16_t sleep, int16_t clock)
+{
+    if(!isProtocolSupported(vendor))
+        return false;
+
+    delay(host_mocks.ac_ms);
+
+    return true;
+}
+
+static const char* const protocol_names[] = {
+    "UNUSED", "RC5", "RC6", "NEC", "SONY", "PANASONIC", "JVC", "SAMSUNG", "WHYNTER", "AIWA_RC_T501", "LG", "SANYO",
+    "MITSUBISHI", "DISH", "SHARP", "COOLIX", "DAIKIN"
+};
+
+String typeToString(decode_type_t protocol, bool repeat)
+{
+    String name = protocol >= UNUSED && protocol <= kLastDecodeType ? protocol_names[protocol] : "UNKNOWN";
+
+    if(repeat)
+        name += " (Repeat)";
+
+    return name;
+}
+
+decode_type_t strToDecodeType(const char* str)
+{
+    for(int i = UNUSED + 1; i <= kLastDecodeType; i++)
+        if(strcasecmp(str, protocol_names[i]) == 0)
+            return (decode_type_t)i;
+
+    return UNKNOWN;
+}
+
+String uint64ToString(uint64_t input, uint8_t base)
+{
+    return String((unsigned long long)input, base);
+}
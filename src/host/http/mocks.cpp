@@ -0,0 +1,70 @@
+// Modules of the firmware that are left out of the host build : the LEDs, and the MQTT and UDP command paths,
+// which do not go through the http server. They report themselves as off.
+
+#include <IOHandlers.h>
+#include <MqttHandler.h>
+#include <UdpCommands.h>
+
+LedHandler::LedHandler(int pin_num, const char* blink_task_name, const char* blink_once_task_name)
+{
+    pin = pin_num;
+    blinkTask_h = NULL;
+    blinkOnceTask_h = NULL;
+}
+
+void LedHandler::start_blinking() {}
+void LedHandler::stop_blinking() {}
+void LedHandler::blink_once() {}
+void LedHandler::on() {}
+void LedHandler::off() {}
+
+MqttHandler::MqttHandler(ReceiveHandler* recv, EmitterChannels* send, CodeStore* store)
+{
+    receiver = recv;
+    emitters = send;
+    codes = store;
+
+    client = NULL;
+    outbox = NULL;
+    publishTask_h = NULL;
+    connected = false;
+
+    received = 0;
+    published = 0;
+    dropped = 0;
+}
+
+esp_err_t MqttHandler::start(const char* uri, const char* hostname)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void MqttHandler::get_status(ArenaText &text)
+{
+    text.add("connected=0,received=0,published=0,dropped=0,outbox=0,duplicates=0");
+}
+
+UdpCommands::UdpCommands(EmitterChannels* send, CodeStore* store)
+{
+    emitters = send;
+    codes = store;
+
+    config.enabled = false;
+    config.port = UDP_DEFAULT_PORT;
+    config.key_len = 0;
+}
+
+esp_err_t UdpCommands::begin()
+{
+    return ESP_OK;
+}
+
+esp_err_t UdpCommands::configure(bool enabled, uint16_t port, const char* key_hex)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void UdpCommands::get_report(ArenaText &text)
+{
+    text.addf("enabled=0,port=%u,next_seq=0;received=0,accepted=0,bad_mac=0,invalid=0,duplicate=0,stale=0;latency_us=0,0", config.port);
+}
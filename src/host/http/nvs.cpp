@@ -0,0 +1,163 @@
+// NVS in memory. Each handle is a namespace, and keys are checked against the limits of the device
+
+#include <nvs.h>
+#include <nvs_flash.h>
+
+#include <string.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> nvs_namespace_t;
+
+static std::mutex nvs_lock;
+static std::vector<std::string> handles;            // Namespace of each handle, minus 1
+static std::map<std::string, nvs_namespace_t> namespaces;
+
+static nvs_namespace_t* get_namespace(nvs_handle handle)
+{
+    if(handle == 0 || handle > handles.size())
+        return NULL;
+
+    return &namespaces[handles[handle - 1]];
+}
+
+static bool valid_key(const char* key)
+{
+    return key != NULL && key[0] != '\0' && strlen(key) < NVS_KEY_NAME_MAX_SIZE;
+}
+
+esp_err_t nvs_flash_init()
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase()
+{
+    std::lock_guard<std::mutex> guard(nvs_lock);
+
+    namespaces.clear();
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode mode, nvs_handle* handle)
+{
+    if(name == NULL || strlen(name) >= NVS_KEY_NAME_MAX_SIZE)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(nvs_lock);
+
+    handles.push_back(name);
+    *handle = handles.size();
+
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    std::lock_guard<std::mutex> guard(nvs_lock);
+
+    return get_namespace(handle) != NULL ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+static esp_err_t get_value(nvs_handle handle, const char* key, void* out_value, size_t* length)
+{
+    std::lock_guard<std::mutex> guard(nvs_lock);
+
+    nvs_namespace_t* entries = get_namespace(handle);
+    if(entries == NULL)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+
+    if(!valid_key(key))
+        return ESP_ERR_INVALID_ARG;
+
+    auto entry = entries->find(key);
+    if(entry == entries->end())
+        return ESP_ERR_NVS_NOT_FOUND;
+
+    size_t size = entry->second.size();
+
+    if(out_value == NULL)
+    {
+        if(length != NULL)
+            *length = size;
+        return ESP_OK;
+    }
+
+    if(length == NULL || *length < size)
+        return ESP_ERR_NVS_INVALID_LENGTH;
+
+    memcpy(out_value, entry->second.data(), size);
+    *length = size;
+
+    return ESP_OK;
+}
+
+static esp_err_t set_value(nvs_handle handle, const char* key, const void* value, size_t length)
+{
+    std::lock_guard<std::mutex> guard(nvs_lock);
+
+    nvs_namespace_t* entries = get_namespace(handle);
+    if(entries == NULL)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+
+    if(!valid_key(key))
+        return ESP_ERR_INVALID_ARG;
+
+    const uint8_t* bytes = (const uint8_t*)value;
+    (*entries)[key].assign(bytes, bytes + length);
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle handle, const char* key, char* out_value, size_t* length)
+{
+    return get_value(handle, key, out_value, length);
+}
+
+// Strings are stored with their null termination, as on the device
+esp_err_t nvs_set_str(nvs_handle handle, const char* key, const char* value)
+{
+    return set_value(handle, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_value, size_t* length)
+{
+    return get_value(handle, key, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t length)
+{
+    return set_value(handle, key, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char* key)
+{
+    std::lock_guard<std::mutex> guard(nvs_lock);
+
+    nvs_namespace_t* entries = get_namespace(handle);
+    if(entries == NULL)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+
+    return entries->erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle handle)
+{
+    std::lock_guard<std::mutex> guard(nvs_lock);
+
+    nvs_namespace_t* entries = get_namespace(handle);
+    if(entries == NULL)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+
+    entries->clear();
+
+    return ESP_OK;
+}
@@ -0,0 +1,70 @@
+// WiFi and mDNS on the host. See src/host/http/include/WiFi.h
+
+#include <WiFi.h>
+#include <ESPmDNS.h>
+#include <HostMocks.h>
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+static const char* const networks[] = {"HomeNetwork", "Neighbour 2.4G", "Guest", "IoT"};
+
+bool WiFiClass::mode(wifi_mode_t mode)
+{
+    current_mode = mode;
+
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* password)
+{
+    connected = true;
+
+    return WL_CONNECTED;
+}
+
+bool WiFiClass::disconnect()
+{
+    connected = false;
+
+    return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+    return connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::isConnected()
+{
+    return connected;
+}
+
+bool WiFiClass::softAP(const char* ssid, const char* password)
+{
+    current_mode = WIFI_AP;
+
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifioff)
+{
+    return true;
+}
+
+IPAddress WiFiClass::softAPIP()
+{
+    return IPAddress(192, 168, 1, 1);
+}
+
+int16_t WiFiClass::scanNetworks()
+{
+    delay(host_mocks.scan_ms);
+
+    return sizeof(networks) / sizeof(networks[0]);
+}
+
+String WiFiClass::SSID(uint8_t index)
+{
+    return index < sizeof(networks) / sizeof(networks[0]) ? networks[index] : "";
+}
@@ -0,0 +1,97 @@
+// Runs the http server of the firmware on the host, for load tests with tools/http_load.py. Built with the "http-host"
+// environment in platformio.ini. The handlers, request workers, emitter channels, capture task and stores are those
+// of the firmware; the IR library, WiFi, NVS, the LEDs, and the MQTT and UDP paths are stood in for, see src/host/http.
+// Usage : http_server [port] [capture ms] [AC send ms] [scan ms]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <Arduino.h>
+#include <esp_http_server.h>
+#include <HostMocks.h>
+
+#include "../IOHandlers.h"
+#include "../IRHandlers.h"
+#include "../IRChannels.h"
+#include "../Benchmark.h"
+#include "../CodeStore.h"
+#include "../LearnSession.h"
+#include "../Scheduler.h"
+#include "../RuleEngine.h"
+#include "../Repeater.h"
+#include "../MqttHandler.h"
+#include "../CorpusRecorder.h"
+#include "../RequestWorkers.h"
+#include "../UdpCommands.h"
+#include "../NetworkHandler.h"
+
+#define IR_RECV_PIN         15
+#define IR_SEND_PIN         14
+
+nvs_handle WiFiHandler::nvs_wifi;
+LedHandler *WiFiHandler::WiFiled        = NULL;
+LedHandler *WiFiHandler::IRled          = NULL;
+EmitterChannels *WiFiHandler::emitters  = NULL;
+ReceiveHandler *WiFiHandler::receiver   = NULL;
+CodeStore *WiFiHandler::codes           = NULL;
+LearnSession *WiFiHandler::session      = NULL;
+Scheduler *WiFiHandler::scheduler       = NULL;
+RuleEngine *WiFiHandler::rules          = NULL;
+Repeater *WiFiHandler::repeater         = NULL;
+MqttHandler *WiFiHandler::mqtt          = NULL;
+CorpusRecorder *WiFiHandler::corpus     = NULL;
+RequestWorkers *WiFiHandler::workers    = NULL;
+UdpCommands *WiFiHandler::udp           = NULL;
+IRBenchmark *WiFiHandler::benchmark     = NULL;
+
+int main(int argc, char** argv)
+{
+    if(argc > 1)
+        httpd_host_port = atoi(argv[1]);
+    if(argc > 2)
+        host_mocks.capture_ms = atoi(argv[2]);
+    if(argc > 3)
+        host_mocks.ac_ms = atoi(argv[3]);
+    if(argc > 4)
+        host_mocks.scan_ms = atoi(argv[4]);
+
+    // Constructed in the same order as the globals of main.cpp
+    static EmitterChannels emitters(IR_SEND_PIN);
+    static ReceiveHandler receiver(IR_RECV_PIN);
+    static CodeStore codes;
+
+    static LedHandler IRled(0, "IR blink", "IR blink once");
+    static LedHandler WiFiled(0, "WiFi blink", "WiFi blink once");
+
+    static LearnSession session(&receiver, &codes, &IRled, &WiFiled);
+    static Scheduler scheduler(&emitters, &codes);
+    static RuleEngine rules(&receiver, &emitters, &codes);
+    static Repeater repeater(&receiver, &emitters);
+    static MqttHandler mqtt(&receiver, &emitters, &codes);
+    static CorpusRecorder corpus(&receiver);
+    static RequestWorkers workers;
+    static UdpCommands udp(&emitters, &codes);
+    static IRBenchmark benchmark(&emitters, &receiver);
+
+    static WiFiHandler networkManager(&WiFiled, &IRled, &emitters, &receiver, &codes, &session, &scheduler, &rules,
+                                      &repeater, &mqtt, &corpus, &workers, &udp, &benchmark);
+
+    emitters.reserve_pin(IR_RECV_PIN);
+    emitters.begin();
+    codes.begin();
+    scheduler.begin();
+    rules.begin();
+    repeater.begin();
+    workers.begin();
+    udp.begin();
+
+    networkManager.force_connect("host", "", "universalremote");
+
+    printf("Listening on http://localhost:%u/ : capture %u ms, AC send %u ms, scan %u ms\n",
+           httpd_host_port, host_mocks.capture_ms, host_mocks.ac_ms, host_mocks.scan_ms);
+    fflush(stdout);
+
+    for(;;)
+        pause();
+}
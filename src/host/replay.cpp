@@ -0,0 +1,160 @@
+// Replays a capture corpus recorded with POST "/corpus" through the decode and formatting steps of GET "/",
+// and reports their throughput. Runs on the host, built with the "replay" environment in platformio.ini.
+// Usage : replay <corpus file> [number of passes]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <map>
+
+#include <IRrecv.h>
+#include <IRutils.h>
+
+#include "../IRConfig.h"
+#include "../Corpus.h"
+#include "../RawFormat.h"
+
+struct protocol_stats_t
+{
+    uint32_t frames;
+    uint64_t decode_ns;
+    uint64_t format_ns;
+    uint64_t bytes;
+};
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage : %s <corpus file> [number of passes]\n", argv[0]);
+        return 1;
+    }
+
+    int passes = argc > 2 ? atoi(argv[2]) : 1;
+    if(passes < 1)
+        passes = 1;
+
+    FILE* file = fopen(argv[1], "rb");
+    if(file == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    size_t size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* data = (uint8_t*)malloc(size);
+    if(data == NULL || fread(data, 1, size, file) != size)
+    {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        return 1;
+    }
+    fclose(file);
+
+    uint8_t tick_us;
+    size_t first = corpus_read_header(data, size, &tick_us);
+    if(first == 0)
+    {
+        fprintf(stderr, "%s is not a corpus\n", argv[1]);
+        return 1;
+    }
+
+    // Same settings as ReceiveHandler
+    IRrecv receiver(0, kCaptureBufferSize, kTimeout, false);
+    receiver.setUnknownThreshold(kMinUnknownSize);
+    receiver.setTolerance(kTolerancePercentage);
+
+    uint16_t* rawbuf = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+    uint16_t* timings = (uint16_t*)malloc(kCaptureBufferSize * sizeof(uint16_t));
+    size_t text_size = raw_format_size(kCaptureBufferSize);
+    char* text = (char*)malloc(text_size);
+
+    std::map<int, protocol_stats_t> stats;
+    protocol_stats_t total = {};
+
+    for(int pass = 0; pass < passes; pass++)
+    {
+        size_t pos = first;
+        int rawlen;
+
+        while((rawlen = corpus_next(data, size, &pos, rawbuf, kCaptureBufferSize)) > 0)
+        {
+            decode_results results;
+            results.rawbuf = rawbuf;
+            results.rawlen = rawlen;
+            results.overflow = false;
+
+            auto start = std::chrono::steady_clock::now();
+
+            bool decoded = receiver.decode(&results);
+
+            auto decode_end = std::chrono::steady_clock::now();
+
+            // As ReceiveHandler::to_timings and ReceiveHandler::format_raw
+            decode_type_t protocol = decoded ? results.decode_type : decode_type_t::UNKNOWN;
+            if(protocol > decode_type_t::kLastDecodeType)
+                protocol = decode_type_t::UNKNOWN;
+
+            uint16_t len = rawbuf_to_timings(results.rawbuf, results.rawlen, tick_us, timings, kCaptureBufferSize);
+            size_t bytes = format_raw_timings(text, text_size, protocol == decode_type_t::UNKNOWN ? -1 : protocol, timings, len);
+
+            auto format_end = std::chrono::steady_clock::now();
+
+            protocol_stats_t &entry = stats[protocol];
+            entry.frames++;
+            entry.decode_ns += elapsed_ns(start, decode_end);
+            entry.format_ns += elapsed_ns(decode_end, format_end);
+            entry.bytes += bytes;
+
+            total.frames++;
+            total.decode_ns += elapsed_ns(start, decode_end);
+            total.format_ns += elapsed_ns(decode_end, format_end);
+            total.bytes += bytes;
+        }
+
+        if(rawlen < 0)
+        {
+            fprintf(stderr, "Corpus is truncated or has frames longer than %d entries\n", kCaptureBufferSize);
+            return 1;
+        }
+    }
+
+    if(total.frames == 0)
+    {
+        printf("No frames\n");
+        return 0;
+    }
+
+    // The time of the whole decode() call is counted against the protocol that matched,
+    // as IRrecv does not report the time taken by each decoder it tries
+    printf("%-20s %8s %12s %12s %10s\n", "protocol", "frames", "decode us", "format us", "bytes");
+    for(auto &item : stats)
+    {
+        protocol_stats_t &entry = item.second;
+        printf("%-20s %8u %12.2f %12.2f %10.1f\n", typeToString((decode_type_t)item.first).c_str(), entry.frames,
+               entry.decode_ns / 1000.0 / entry.frames, entry.format_ns / 1000.0 / entry.frames,
+               (double)entry.bytes / entry.frames);
+    }
+
+    double seconds = (total.decode_ns + total.format_ns) / 1e9;
+
+    printf("\n%u frames in %.3f s, %.0f frames/s\n", total.frames, seconds, total.frames / seconds);
+    printf("decode %.2f us, format %.2f us, output %.1f bytes per frame\n",
+           total.decode_ns / 1000.0 / total.frames, total.format_ns / 1000.0 / total.frames,
+           (double)total.bytes / total.frames);
+
+    free(rawbuf);
+    free(timings);
+    free(text);
+    free(data);
+
+    return 0;
+}
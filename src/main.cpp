@@ -18,7 +18,20 @@
 
 #include "IOHandlers.h"
 #include "IRHandlers.h"
+#include "IRChannels.h"
+#include "Benchmark.h"
+#include "CodeStore.h"
+#include "LearnSession.h"
+#include "Scheduler.h"
+#include "RuleEngine.h"
+#include "Repeater.h"
+#include "MqttHandler.h"
+#include "CorpusRecorder.h"
+#include "RequestWorkers.h"
+#include "UdpCommands.h"
 #include "NetworkHandler.h"
+#include "IRProtocols.h"
+#include "BinLog.h"
 
 // GPIO settings
 #define GPIO_LED_WIFI       4
@@ -57,25 +70,73 @@
 
 #define TAG                     "main"
 
-SendHandler sender(IR_SEND_PIN);
+EmitterChannels emitters(IR_SEND_PIN);
 ReceiveHandler receiver(IR_RECV_PIN);
+CodeStore codes;
 
 LedHandler IRled(GPIO_LED_IR, "IR blink", "IR blink once");
 LedHandler WiFiled(GPIO_LED_WIFI, "WiFi blink", "WiFi blink once");
 
 ResetHandler ResetButton(GPIO_RESET_BUTTON);
 
+LearnSession session(&receiver, &codes, &IRled, &WiFiled);
+Scheduler scheduler(&emitters, &codes);
+RuleEngine rules(&receiver, &emitters, &codes);
+Repeater repeater(&receiver, &emitters);
+MqttHandler mqtt(&receiver, &emitters, &codes);
+CorpusRecorder corpus(&receiver);
+RequestWorkers workers;
+UdpCommands udp(&emitters, &codes);
+
+#ifdef IR_BENCHMARK
+IRBenchmark benchmark(&emitters, &receiver);
+#endif
+
 nvs_handle WiFiHandler::nvs_wifi;
 LedHandler *WiFiHandler::WiFiled        = NULL;
 LedHandler *WiFiHandler::IRled          = NULL;
-SendHandler *WiFiHandler::sender        = NULL;
+EmitterChannels *WiFiHandler::emitters  = NULL;
 ReceiveHandler *WiFiHandler::receiver   = NULL;
+CodeStore *WiFiHandler::codes           = NULL;
+LearnSession *WiFiHandler::session      = NULL;
+Scheduler *WiFiHandler::scheduler       = NULL;
+RuleEngine *WiFiHandler::rules          = NULL;
+Repeater *WiFiHandler::repeater         = NULL;
+MqttHandler *WiFiHandler::mqtt          = NULL;
+CorpusRecorder *WiFiHandler::corpus     = NULL;
+RequestWorkers *WiFiHandler::workers    = NULL;
+UdpCommands *WiFiHandler::udp          = NULL;
+IRBenchmark *WiFiHandler::benchmark     = NULL;
 
 void setup(){
     
     Serial.begin(115200);
+    binlog_begin();
+
+    {
+        RequestArena arena;
+        ArenaText protocols(*arena.get());
+        ir_protocols_report(protocols);
+        BLOGI("IR protocols : %s", protocols.c_str());
+    }
+
+#ifdef IR_BENCHMARK
+    WiFiHandler networkManager(&WiFiled, &IRled, &emitters, &receiver, &codes, &session, &scheduler, &rules, &repeater, &mqtt, &corpus, &workers, &udp, &benchmark);
+#else
+    WiFiHandler networkManager(&WiFiled, &IRled, &emitters, &receiver, &codes, &session, &scheduler, &rules, &repeater, &mqtt, &corpus, &workers, &udp);
+#endif
 
-    WiFiHandler networkManager(&WiFiled, &IRled, &sender, &receiver);
+    emitters.reserve_pin(IR_RECV_PIN);
+    emitters.reserve_pin(GPIO_LED_WIFI);
+    emitters.reserve_pin(GPIO_LED_IR);
+    emitters.reserve_pin(GPIO_RESET_BUTTON);
+    emitters.begin();
+    codes.begin();
+    scheduler.begin();
+    rules.begin();
+    repeater.begin();
+    workers.begin();
+    udp.begin();
 
     if(networkManager.is_configured())
     {
@@ -0,0 +1,278 @@
+// Host tests of the lock-free ring of the binary log, see src/BinLogRing.h, with writers on several threads
+// Run with : pio test -e native -f test_binlog_ring
+
+#include <unity.h>
+
+#include <pthread.h>
+#include <string.h>
+
+#include <atomic>
+#include <vector>
+
+#include "BinLogRing.h"
+
+#define TEST_RING_SIZE      256
+#define TEST_WRITERS        4
+#define TEST_RECORDS        20000
+
+static uint32_t buffer[TEST_RING_SIZE / 4];
+
+void setUp()
+{
+    memset(buffer, 0, sizeof(buffer));
+}
+
+void tearDown() {}
+
+// Record of len bytes (at least 12) from writer, numbered seq, with a checksum in its last word
+static void make_record(uint32_t* record, uint16_t len, uint8_t writer, uint32_t seq)
+{
+    record[0] = len | ((uint32_t)writer << 16);
+    record[1] = seq;
+    for(uint16_t i = 2; i < len / 4; i++)
+        record[i] = seq * 7 + i;
+
+    uint32_t sum = 0;
+    for(uint16_t i = 0; i < len / 4 - 1; i++)
+        sum += record[i];
+    record[len / 4 - 1] = sum;
+}
+
+static bool check_record(const uint32_t* record, size_t len)
+{
+    if(len != (record[0] & BINLOG_RING_LEN_MASK))
+        return false;
+
+    uint32_t sum = 0;
+    for(size_t i = 0; i < len / 4 - 1; i++)
+        sum += record[i];
+
+    return record[len / 4 - 1] == sum;
+}
+
+static void test_records_come_back_in_order()
+{
+    BinLogRing ring(buffer, sizeof(buffer));
+    uint32_t record[16], out[16];
+
+    TEST_ASSERT_EQUAL(0, ring.pop(out, sizeof(out)));
+
+    for(uint32_t seq = 0; seq < 5; seq++)
+    {
+        make_record(record, 12 + 4 * seq, 0, seq);
+        TEST_ASSERT_TRUE(ring.push(record));
+    }
+
+    TEST_ASSERT_EQUAL(12 + 16 + 20 + 24 + 28, ring.get_used());
+
+    for(uint32_t seq = 0; seq < 5; seq++)
+    {
+        TEST_ASSERT_EQUAL(12 + 4 * seq, ring.pop(out, sizeof(out)));
+        TEST_ASSERT_EQUAL(seq, out[1]);
+        TEST_ASSERT_TRUE(check_record(out, 12 + 4 * seq));
+    }
+
+    TEST_ASSERT_EQUAL(0, ring.pop(out, sizeof(out)));
+    TEST_ASSERT_EQUAL(0, ring.get_used());
+    TEST_ASSERT_EQUAL(0, ring.get_dropped());
+}
+
+// Records of lengths that do not divide the ring size end up split over its end, and come back whole
+static void test_wraparound()
+{
+    BinLogRing ring(buffer, sizeof(buffer));
+    uint32_t record[16], out[16];
+
+    for(uint32_t seq = 0; seq < 1000; seq++)
+    {
+        uint16_t len = 12 + 4 * (seq % 9);
+
+        make_record(record, len, 0, seq);
+        TEST_ASSERT_TRUE(ring.push(record));
+
+        // Keeps a few records in the ring, so that the writes and the reads are at different places
+        if(seq < 3)
+            continue;
+
+        size_t read = ring.pop(out, sizeof(out));
+        TEST_ASSERT_EQUAL(12 + 4 * ((seq - 3) % 9), read);
+        TEST_ASSERT_EQUAL(seq - 3, out[1]);
+        TEST_ASSERT_TRUE(check_record(out, read));
+    }
+
+    TEST_ASSERT_EQUAL(0, ring.get_dropped());
+}
+
+// Lengths that are not a multiple of 4 take whole words
+static void test_lengths_are_rounded_to_words()
+{
+    BinLogRing ring(buffer, sizeof(buffer));
+    uint32_t record[4] = {10, 1, 2}, out[4];
+
+    TEST_ASSERT_TRUE(ring.push(record));
+    TEST_ASSERT_EQUAL(12, ring.get_used());
+    TEST_ASSERT_EQUAL(12, ring.pop(out, sizeof(out)));
+    TEST_ASSERT_EQUAL(2, out[2]);
+
+    // A record without a length cannot be told from free space
+    record[0] = 0;
+    TEST_ASSERT_FALSE(ring.push(record));
+    TEST_ASSERT_EQUAL(0, ring.get_used());
+}
+
+// Records that do not fit are dropped whole and counted, and the space freed by the reader is used again
+static void test_full_ring_drops()
+{
+    BinLogRing ring(buffer, sizeof(buffer));
+    uint32_t record[16], out[16];
+    uint32_t pushed = 0;
+
+    make_record(record, 24, 0, 0);
+    while(ring.push(record))
+        pushed++;
+
+    TEST_ASSERT_EQUAL(TEST_RING_SIZE / 24, pushed);
+    TEST_ASSERT_EQUAL(1, ring.get_dropped());
+    TEST_ASSERT_EQUAL(pushed * 24, ring.get_used());
+
+    // A smaller record still fits in what is left
+    make_record(record, TEST_RING_SIZE - pushed * 24, 0, 0);
+    TEST_ASSERT_TRUE(ring.push(record));
+    TEST_ASSERT_EQUAL(TEST_RING_SIZE, ring.get_used());
+
+    make_record(record, 12, 0, 0);
+    TEST_ASSERT_FALSE(ring.push(record));
+    TEST_ASSERT_EQUAL(2, ring.get_dropped());
+
+    TEST_ASSERT_EQUAL(24, ring.pop(out, sizeof(out)));
+    TEST_ASSERT_TRUE(ring.push(record));
+
+    // A record longer than the whole ring never fits, even once it is empty
+    while(ring.pop(out, sizeof(out)) > 0);
+
+    uint32_t large[TEST_RING_SIZE / 4 + 1];
+    make_record(large, sizeof(large), 0, 0);
+    TEST_ASSERT_FALSE(ring.push(large));
+    TEST_ASSERT_EQUAL(0, ring.get_used());
+}
+
+// A record longer than the reader's buffer is taken out of the ring and counted as dropped
+static void test_oversized_record_is_skipped()
+{
+    BinLogRing ring(buffer, sizeof(buffer));
+    uint32_t record[16], out[16];
+
+    make_record(record, 40, 0, 1);
+    ring.push(record);
+    make_record(record, 12, 0, 2);
+    ring.push(record);
+
+    TEST_ASSERT_EQUAL(0, ring.pop(out, 36));
+    TEST_ASSERT_EQUAL(1, ring.get_dropped());
+    TEST_ASSERT_EQUAL(12, ring.pop(out, 36));
+    TEST_ASSERT_EQUAL(2, out[1]);
+}
+
+struct writer_t
+{
+    BinLogRing* ring;
+    uint8_t id;
+    uint32_t pushed;
+};
+
+static std::atomic<int> writers_done;
+
+static void* writer_thread(void* param)
+{
+    writer_t* writer = (writer_t*)param;
+    uint32_t record[16];
+
+    for(uint32_t seq = 0; seq < TEST_RECORDS; seq++)
+    {
+        make_record(record, 12 + 4 * ((seq + writer->id) % 12), writer->id, seq);
+        if(writer->ring->push(record))
+            writer->pushed++;
+    }
+
+    writers_done++;
+
+    return NULL;
+}
+
+// Writers on several threads and a reader at the same time : every record comes back whole or is counted
+// as dropped, and the records of each writer come back in the order they were written
+static void test_concurrent_writers()
+{
+    BinLogRing ring(buffer, sizeof(buffer));
+    writer_t writers[TEST_WRITERS];
+    pthread_t threads[TEST_WRITERS];
+
+    writers_done = 0;
+    for(int i = 0; i < TEST_WRITERS; i++)
+    {
+        writers[i] = {&ring, (uint8_t)i, 0};
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, writer_thread, &writers[i]));
+    }
+
+    std::vector<uint32_t> received(TEST_WRITERS, 0);
+    std::vector<int64_t> last(TEST_WRITERS, -1);
+    uint32_t out[16];
+    uint32_t corrupt = 0, out_of_order = 0;
+
+    for(;;)
+    {
+        // All the records are published once the writers are done, so an empty ring is then the end
+        bool done = writers_done == TEST_WRITERS;
+        size_t len = ring.pop(out, sizeof(out));
+
+        if(len == 0)
+        {
+            if(done)
+                break;
+            continue;
+        }
+
+        uint8_t id = out[0] >> 16;
+        if(id >= TEST_WRITERS || !check_record(out, len))
+        {
+            corrupt++;
+            continue;
+        }
+
+        if((int64_t)out[1] <= last[id])
+            out_of_order++;
+
+        last[id] = out[1];
+        received[id]++;
+    }
+
+    for(int i = 0; i < TEST_WRITERS; i++)
+        pthread_join(threads[i], NULL);
+
+    TEST_ASSERT_EQUAL(0, corrupt);
+    TEST_ASSERT_EQUAL(0, out_of_order);
+    TEST_ASSERT_EQUAL(0, ring.get_used());
+
+    uint32_t pushed = 0;
+    for(int i = 0; i < TEST_WRITERS; i++)
+    {
+        TEST_ASSERT_EQUAL(writers[i].pushed, received[i]);
+        pushed += writers[i].pushed;
+    }
+
+    TEST_ASSERT_EQUAL(TEST_WRITERS * TEST_RECORDS, pushed + ring.get_dropped());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_records_come_back_in_order);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_lengths_are_rounded_to_words);
+    RUN_TEST(test_full_ring_drops);
+    RUN_TEST(test_oversized_record_is_skipped);
+    RUN_TEST(test_concurrent_writers);
+
+    return UNITY_END();
+}
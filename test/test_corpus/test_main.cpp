@@ -0,0 +1,122 @@
+// Host tests of the corpus file format and the conversion of captures read back from it, see src/Corpus.h
+// and src/RawFormat.h. Run with : pio test -e native -f test_corpus
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "Corpus.h"
+#include "RawFormat.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_header()
+{
+    uint8_t data[CORPUS_HEADER_SIZE];
+    uint8_t tick_us = 0;
+
+    TEST_ASSERT_EQUAL(CORPUS_HEADER_SIZE, corpus_write_header(data, 2));
+    TEST_ASSERT_EQUAL(CORPUS_HEADER_SIZE, corpus_read_header(data, sizeof(data), &tick_us));
+    TEST_ASSERT_EQUAL(2, tick_us);
+
+    TEST_ASSERT_EQUAL(0, corpus_read_header(data, sizeof(data) - 1, &tick_us));
+
+    data[4] = CORPUS_VERSION + 1;
+    TEST_ASSERT_EQUAL(0, corpus_read_header(data, sizeof(data), &tick_us));
+
+    corpus_write_header(data, 0);
+    TEST_ASSERT_EQUAL(0, corpus_read_header(data, sizeof(data), &tick_us));
+
+    corpus_write_header(data, 2);
+    data[0] = 'X';
+    TEST_ASSERT_EQUAL(0, corpus_read_header(data, sizeof(data), &tick_us));
+}
+
+// Frames come back as they were recorded, then the end of the data is reported
+static void test_frames_round_trip()
+{
+    const uint16_t first[] = {0, 4500, 2250, 280, 845, 280};
+    const uint16_t second[] = {1234, 1200, 300, 600, 300};
+    uint8_t data[64];
+    uint16_t rawbuf[8];
+    uint8_t tick_us;
+
+    size_t end = corpus_write_header(data, 2);
+    end = corpus_append(data, sizeof(data), end, first, 6);
+    end = corpus_append(data, sizeof(data), end, second, 5);
+    TEST_ASSERT_EQUAL(CORPUS_HEADER_SIZE + 2 + 12 + 2 + 10, end);
+
+    size_t pos = corpus_read_header(data, end, &tick_us);
+
+    TEST_ASSERT_EQUAL(6, corpus_next(data, end, &pos, rawbuf, 8));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(first, rawbuf, 6);
+    TEST_ASSERT_EQUAL(5, corpus_next(data, end, &pos, rawbuf, 8));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(second, rawbuf, 5);
+    TEST_ASSERT_EQUAL(0, corpus_next(data, end, &pos, rawbuf, 8));
+}
+
+static void test_full_buffer()
+{
+    const uint16_t frame[] = {0, 4500, 2250, 280};
+    uint8_t data[CORPUS_HEADER_SIZE + 2 + 8];
+
+    size_t end = corpus_write_header(data, 2);
+    end = corpus_append(data, sizeof(data), end, frame, 4);
+    TEST_ASSERT_EQUAL(sizeof(data), end);
+    TEST_ASSERT_EQUAL(0, corpus_append(data, sizeof(data), end, frame, 1));
+}
+
+static void test_truncated_or_long_frames()
+{
+    const uint16_t frame[] = {0, 4500, 2250, 280};
+    uint8_t data[32];
+    uint16_t rawbuf[8];
+    uint8_t tick_us;
+
+    size_t end = corpus_write_header(data, 2);
+    end = corpus_append(data, sizeof(data), end, frame, 4);
+
+    // Each cut within the frame
+    for(size_t cut = CORPUS_HEADER_SIZE + 1; cut < end; cut++)
+    {
+        size_t pos = corpus_read_header(data, cut, &tick_us);
+        TEST_ASSERT_EQUAL(-1, corpus_next(data, cut, &pos, rawbuf, 8));
+    }
+
+    size_t pos = CORPUS_HEADER_SIZE;
+    TEST_ASSERT_EQUAL(-1, corpus_next(data, end, &pos, rawbuf, 3));
+    TEST_ASSERT_EQUAL(CORPUS_HEADER_SIZE, pos);
+}
+
+// A frame read back goes through the same conversion and text format as GET "/" on the device
+static void test_replayed_frame_format()
+{
+    const uint16_t rawbuf[] = {0, 4500, 2250, 280, 40000};
+    uint16_t timings[8];
+    char text[64];
+
+    uint16_t len = rawbuf_to_timings(rawbuf, 5, 2, timings, 8);
+    TEST_ASSERT_EQUAL(6, len);
+    TEST_ASSERT_EQUAL(UINT16_MAX, timings[3]);
+    TEST_ASSERT_EQUAL(0, timings[4]);
+    TEST_ASSERT_EQUAL(80000 - UINT16_MAX, timings[5]);
+
+    TEST_ASSERT_TRUE(format_raw_timings(text, sizeof(text), -1, timings, 3) > 0);
+    TEST_ASSERT_EQUAL_STRING("-1;3:9000,4500,560,", text);
+
+    TEST_ASSERT_EQUAL(0, format_raw_timings(text, raw_format_size(3) - 1, 3, timings, 3));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_header);
+    RUN_TEST(test_frames_round_trip);
+    RUN_TEST(test_full_buffer);
+    RUN_TEST(test_truncated_or_long_frames);
+    RUN_TEST(test_replayed_frame_format);
+
+    return UNITY_END();
+}
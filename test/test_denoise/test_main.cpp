@@ -0,0 +1,205 @@
+// Host tests of the combination of several captures of a button into one frame, see src/IRDenoise.h
+// Run with : pio test -e native -f test_denoise
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "IRDenoise.h"
+
+#define NEC_LEN         68
+#define NEC_UNIT        562.5
+
+void setUp()
+{
+    srand(1);
+}
+
+void tearDown() {}
+
+// NEC frame as a receiver reads it : marks longer and spaces shorter by skew us, and each duration off by up to
+// jitter us. Returns its length
+static uint16_t nec_capture(uint32_t code, uint16_t* timings, int skew, int jitter)
+{
+    uint16_t len = 0;
+
+    timings[len++] = 16 * NEC_UNIT;
+    timings[len++] = 8 * NEC_UNIT;
+    for(int i = 0; i < 32; i++)
+    {
+        timings[len++] = NEC_UNIT;
+        timings[len++] = ((code >> i) & 1 ? 3 : 1) * NEC_UNIT;
+    }
+    timings[len++] = NEC_UNIT;
+    timings[len++] = 40000;
+
+    for(uint16_t i = 0; i < len; i++)
+    {
+        int offset = (i % 2 == 0 ? skew : -skew) + (jitter > 0 ? rand() % (2 * jitter + 1) - jitter : 0);
+        timings[i] += offset;
+    }
+
+    return len;
+}
+
+static int denoise(uint16_t captures[][2 * NEC_LEN], const uint16_t* lengths, uint8_t count, uint16_t* out, uint16_t* out_len)
+{
+    const uint16_t* pointers[16];
+    for(uint8_t i = 0; i < count; i++)
+        pointers[i] = captures[i];
+
+    return denoise_frames(pointers, lengths, count, out, out_len);
+}
+
+// Captures of the same button with jitter and receiver skew come back as the frame of the remote
+static void test_frame_is_put_on_the_grid()
+{
+    static uint16_t captures[5][2 * NEC_LEN];
+    uint16_t lengths[5], out[2 * NEC_LEN], out_len;
+    uint32_t code = 0x20DF10EF;
+
+    for(int i = 0; i < 5; i++)
+        lengths[i] = nec_capture(code, captures[i], 60, 80);
+
+    int confidence = denoise(captures, lengths, 5, out, &out_len);
+
+    TEST_ASSERT_EQUAL(NEC_LEN, out_len);
+    TEST_ASSERT_TRUE(confidence >= 80);
+
+    // All the marks and the short spaces are one unit, and the long spaces three
+    uint16_t unit = out[2];
+    TEST_ASSERT_INT_WITHIN(15, NEC_UNIT, unit);
+
+    for(int i = 0; i < 32; i++)
+    {
+        TEST_ASSERT_EQUAL(unit, out[2 + 2 * i]);
+        TEST_ASSERT_INT_WITHIN(2, ((code >> i) & 1 ? 3 : 1) * unit, out[3 + 2 * i]);
+    }
+
+    // Multiples are taken of the unit before rounding
+    TEST_ASSERT_INT_WITHIN(8, 16 * unit, out[0]);
+    TEST_ASSERT_INT_WITHIN(4, 8 * unit, out[1]);
+
+    // The gap after the frame is beyond the grid, and keeps its median
+    TEST_ASSERT_INT_WITHIN(80, 40000, out[NEC_LEN - 1]);
+}
+
+// Captures with a repeat are cut to the most common length, and shorter ones are left out, which lowers the confidence
+static void test_captures_are_aligned()
+{
+    static uint16_t captures[4][2 * NEC_LEN];
+    uint16_t lengths[4], out[2 * NEC_LEN], out_len;
+
+    for(int i = 0; i < 4; i++)
+        lengths[i] = nec_capture(0x20DF10EF, captures[i], 0, 0);
+
+    int all = denoise(captures, lengths, 4, out, &out_len);
+    TEST_ASSERT_EQUAL(100, all);
+
+    // A repeat frame after the first capture, and a capture cut short
+    captures[0][NEC_LEN] = 9000;
+    captures[0][NEC_LEN + 1] = 2250;
+    captures[0][NEC_LEN + 2] = 560;
+    lengths[0] = NEC_LEN + 3;
+    lengths[3] = 20;
+
+    int aligned = denoise(captures, lengths, 4, out, &out_len);
+
+    TEST_ASSERT_EQUAL(NEC_LEN, out_len);
+    TEST_ASSERT_EQUAL(all * 3 / 4, aligned);
+}
+
+// Durations that vary more between captures give a lower confidence
+static void test_spread_lowers_confidence()
+{
+    static uint16_t captures[5][2 * NEC_LEN];
+    uint16_t lengths[5], out[2 * NEC_LEN], out_len;
+    int last = 101;
+
+    for(int jitter = 0; jitter <= 200; jitter += 50)
+    {
+        for(int i = 0; i < 5; i++)
+            lengths[i] = nec_capture(0x20DF10EF, captures[i], 0, jitter);
+
+        int confidence = denoise(captures, lengths, 5, out, &out_len);
+
+        TEST_ASSERT_TRUE(confidence >= 0 && confidence <= 100);
+        TEST_ASSERT_TRUE(confidence < last);
+        last = confidence;
+    }
+}
+
+// Zero entries stand for the splits of durations longer than 16 bits, and are kept
+static void test_zero_entries_are_kept()
+{
+    static uint16_t captures[3][2 * NEC_LEN];
+    uint16_t lengths[3], out[2 * NEC_LEN], out_len;
+
+    for(int i = 0; i < 3; i++)
+    {
+        lengths[i] = nec_capture(0x20DF10EF, captures[i], 0, 20);
+        captures[i][lengths[i] - 1] = UINT16_MAX;
+        captures[i][lengths[i]++] = 0;
+        captures[i][lengths[i]++] = 20000;
+    }
+
+    denoise(captures, lengths, 3, out, &out_len);
+
+    TEST_ASSERT_EQUAL(NEC_LEN + 2, out_len);
+    TEST_ASSERT_EQUAL(UINT16_MAX, out[NEC_LEN - 1]);
+    TEST_ASSERT_EQUAL(0, out[NEC_LEN]);
+}
+
+// Frames whose shortest mark and shortest space are not the same unit keep the medians of their clusters
+static void test_frame_without_grid()
+{
+    static uint16_t captures[3][2 * NEC_LEN];
+    uint16_t lengths[3], out[2 * NEC_LEN], out_len;
+    const uint16_t frame[] = {3000, 1100, 400, 2900, 400, 1100, 400, 2900, 400, 1100, 400, 50000};
+
+    for(int i = 0; i < 3; i++)
+    {
+        lengths[i] = sizeof(frame) / sizeof(frame[0]);
+        for(uint16_t j = 0; j < lengths[i]; j++)
+            captures[i][j] = frame[j] + (i - 1) * 10;
+    }
+
+    denoise(captures, lengths, 3, out, &out_len);
+
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(frame, out, lengths[0]);
+}
+
+static void test_no_captures()
+{
+    uint16_t out[4], out_len;
+
+    TEST_ASSERT_EQUAL(-1, denoise_frames(NULL, NULL, 0, out, &out_len));
+}
+
+// Captures beyond DENOISE_MAX_CAPTURES are not used
+static void test_captures_beyond_the_limit()
+{
+    static uint16_t captures[DENOISE_MAX_CAPTURES + 4][2 * NEC_LEN];
+    uint16_t lengths[DENOISE_MAX_CAPTURES + 4], out[2 * NEC_LEN], out_len;
+
+    for(int i = 0; i < DENOISE_MAX_CAPTURES + 4; i++)
+        lengths[i] = i < DENOISE_MAX_CAPTURES ? nec_capture(0x20DF10EF, captures[i], 0, 0) : 0;
+
+    TEST_ASSERT_EQUAL(100, denoise(captures, lengths, DENOISE_MAX_CAPTURES + 4, out, &out_len));
+    TEST_ASSERT_EQUAL(NEC_LEN, out_len);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_frame_is_put_on_the_grid);
+    RUN_TEST(test_captures_are_aligned);
+    RUN_TEST(test_spread_lowers_confidence);
+    RUN_TEST(test_zero_entries_are_kept);
+    RUN_TEST(test_frame_without_grid);
+    RUN_TEST(test_no_captures);
+    RUN_TEST(test_captures_beyond_the_limit);
+
+    return UNITY_END();
+}
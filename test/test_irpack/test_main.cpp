@@ -0,0 +1,163 @@
+// Host tests of the compact encoding of timing lists, see src/IRCompress.h
+// Run with : pio test -e native -f test_irpack
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "IRCompress.h"
+
+void setUp() {}
+void tearDown() {}
+
+static uint16_t nec_frame(uint32_t code, uint16_t* timings)
+{
+    uint16_t len = 0;
+
+    timings[len++] = 9000;
+    timings[len++] = 4500;
+    for(int i = 0; i < 32; i++)
+    {
+        timings[len++] = 560;
+        timings[len++] = (code >> i) & 1 ? 1690 : 560;
+    }
+    timings[len++] = 560;
+
+    return len;
+}
+
+// Frames with a few exact durations come back unchanged
+static void test_round_trip_exact()
+{
+    uint16_t timings[80], decoded[80];
+    uint8_t packed[256];
+
+    uint16_t len = nec_frame(0x20DF10EF, timings);
+    size_t size = irpack_encode(timings, len, packed, sizeof(packed));
+
+    TEST_ASSERT_TRUE(size > 0);
+    TEST_ASSERT_TRUE(size < len * sizeof(uint16_t) / 4);
+    TEST_ASSERT_EQUAL(len, irpack_decode(packed, size, decoded, 80));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(timings, decoded, len);
+}
+
+// Each duration decodes to the symbol of its cluster, within IRPACK_CLUSTER_PERCENT of the captured one
+static void test_round_trip_within_cluster_error()
+{
+    uint16_t timings[600], decoded[600];
+    uint8_t packed[2048];
+    const uint16_t nominal[] = {300, 560, 1690, 2400, 4500, 9000, 40000};
+
+    srand(1);
+    for(int round = 0; round < 500; round++)
+    {
+        uint16_t len = 1 + rand() % 600;
+        for(uint16_t i = 0; i < len; i++)
+        {
+            uint16_t base = nominal[rand() % 7];
+            timings[i] = base + (int)base * (rand() % 21 - 10) / 100;   // Jitter of up to 10 %
+        }
+
+        size_t size = irpack_encode(timings, len, packed, sizeof(packed));
+        TEST_ASSERT_TRUE(size > 0);
+        TEST_ASSERT_EQUAL(len, irpack_decode(packed, size, decoded, 600));
+
+        for(uint16_t i = 0; i < len; i++)
+            TEST_ASSERT_TRUE(abs((int)decoded[i] - timings[i]) * 100 <= timings[i] * IRPACK_CLUSTER_PERCENT);
+    }
+}
+
+// The repeat of a frame is a copy of the first, and costs a few bytes
+static void test_repeat_is_copied()
+{
+    uint16_t timings[160], decoded[160];
+    uint8_t once[256], twice[256];
+
+    uint16_t len = nec_frame(0x20DF10EF, timings);
+    size_t size_once = irpack_encode(timings, len, once, sizeof(once));
+
+    timings[len] = 40000;
+    for(uint16_t i = 0; i < len; i++)
+        timings[len + 1 + i] = timings[i];
+
+    size_t size_twice = irpack_encode(timings, 2 * len + 1, twice, sizeof(twice));
+
+    TEST_ASSERT_TRUE(size_twice <= size_once + 8);
+    TEST_ASSERT_EQUAL(2 * len + 1, irpack_decode(twice, size_twice, decoded, 160));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(timings, decoded, 2 * len + 1);
+}
+
+static void test_empty_frame()
+{
+    uint16_t decoded[1];
+    uint8_t packed[8];
+
+    size_t size = irpack_encode(NULL, 0, packed, sizeof(packed));
+    TEST_ASSERT_EQUAL(4, size);
+    TEST_ASSERT_EQUAL(0, irpack_decode(packed, size, decoded, 1));
+}
+
+static void test_short_output_fails()
+{
+    uint16_t timings[80];
+    uint8_t packed[256];
+
+    uint16_t len = nec_frame(0x20DF10EF, timings);
+    size_t size = irpack_encode(timings, len, packed, sizeof(packed));
+
+    TEST_ASSERT_EQUAL(0, irpack_encode(timings, len, packed, size - 1));
+}
+
+static void test_malformed_input_is_rejected()
+{
+    uint16_t timings[80], decoded[80];
+    uint8_t packed[256];
+
+    uint16_t len = nec_frame(0x20DF10EF, timings);
+    size_t size = irpack_encode(timings, len, packed, sizeof(packed));
+
+    // Every truncation
+    for(size_t cut = 0; cut < size; cut++)
+        TEST_ASSERT_EQUAL(-1, irpack_decode(packed, cut, decoded, 80));
+
+    // More timings than the buffer holds
+    TEST_ASSERT_EQUAL(-1, irpack_decode(packed, size, decoded, len - 1));
+
+    // Unknown version
+    packed[0] = IRPACK_VERSION + 1;
+    TEST_ASSERT_EQUAL(-1, irpack_decode(packed, size, decoded, 80));
+}
+
+// Random bytes must not make the decoder read or write out of bounds
+static void test_random_input_is_safe()
+{
+    uint8_t data[64];
+    uint16_t decoded[32];
+
+    srand(2);
+    for(int round = 0; round < 10000; round++)
+    {
+        size_t size = rand() % sizeof(data);
+        for(size_t i = 0; i < size; i++)
+            data[i] = rand();
+        data[0] = IRPACK_VERSION;
+
+        int len = irpack_decode(data, size, decoded, 32);
+        TEST_ASSERT_TRUE(len >= -1 && len <= 32);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip_exact);
+    RUN_TEST(test_round_trip_within_cluster_error);
+    RUN_TEST(test_repeat_is_copied);
+    RUN_TEST(test_empty_frame);
+    RUN_TEST(test_short_output_fails);
+    RUN_TEST(test_malformed_input_is_rejected);
+    RUN_TEST(test_random_input_is_safe);
+
+    return UNITY_END();
+}
@@ -0,0 +1,278 @@
+// Host tests of the timer heap of the scheduler, see src/JobHeap.h, against a simulated clock
+// Run with : pio test -e native -f test_job_heap
+
+#include <unity.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "JobHeap.h"
+
+#define TEST_JOBS       5000
+#define TEST_MAX_LATE   300000
+#define TEST_START      1700000000000LL
+
+static int64_t sim_now;
+static sched_job_t storage[TEST_JOBS];
+
+static int64_t sim_clock(void* ctx)
+{
+    return *(int64_t*)ctx;
+}
+
+void setUp()
+{
+    sim_now = TEST_START;
+    srand(1);
+}
+
+void tearDown() {}
+
+static sched_job_t make_job(int64_t due_ms, uint32_t period_ms)
+{
+    sched_job_t job = {};
+
+    job.action = SCHED_CODE;
+    job.mask = 1;
+    job.due_ms = due_ms;
+    job.period_ms = period_ms;
+    strcpy(job.arg, "tv_power");
+
+    return job;
+}
+
+// Moves the clock to each due time in turn and takes the jobs, as the scheduler task does
+static std::vector<sched_job_t> run_until(JobHeap &heap, int64_t end)
+{
+    std::vector<sched_job_t> ran;
+    sched_job_t job;
+
+    for(;;)
+    {
+        int64_t wait = heap.next_wait();
+        if(wait < 0 || sim_now + wait > end)
+            break;
+
+        sim_now += wait;
+        while(heap.pop_due(&job))
+            ran.push_back(job);
+    }
+
+    return ran;
+}
+
+static void test_jobs_run_in_due_order()
+{
+    JobHeap heap(storage, TEST_JOBS, sim_clock, &sim_now, TEST_MAX_LATE);
+    std::vector<int> runs(TEST_JOBS + 1, 0);
+
+    for(int i = 0; i < TEST_JOBS; i++)
+        TEST_ASSERT_EQUAL(i + 1, heap.add(make_job(TEST_START + 1000 + rand() % 86400000, 0)));
+
+    TEST_ASSERT_EQUAL(-1, heap.add(make_job(TEST_START, 0)));
+
+    std::vector<sched_job_t> ran = run_until(heap, TEST_START + 86400000 + 1000);
+
+    TEST_ASSERT_EQUAL(TEST_JOBS, ran.size());
+    TEST_ASSERT_EQUAL(0, heap.size());
+    TEST_ASSERT_EQUAL(-1, heap.next_wait());
+    TEST_ASSERT_EQUAL(0, heap.get_skipped());
+
+    for(size_t i = 0; i < ran.size(); i++)
+    {
+        if(i > 0)
+            TEST_ASSERT_TRUE(ran[i - 1].due_ms <= ran[i].due_ms);
+        runs[ran[i].id]++;
+    }
+
+    for(int id = 1; id <= TEST_JOBS; id++)
+        TEST_ASSERT_EQUAL(1, runs[id]);
+}
+
+// Repeating jobs keep their phase, and run once per period
+static void test_repeating_jobs()
+{
+    JobHeap heap(storage, TEST_JOBS, sim_clock, &sim_now, TEST_MAX_LATE);
+    std::vector<int> runs(TEST_JOBS + 1, 0);
+    std::vector<sched_job_t> added(TEST_JOBS + 1);
+
+    for(int i = 0; i < TEST_JOBS; i++)
+    {
+        sched_job_t job = make_job(TEST_START + rand() % 3600000, 60000 * (1 + rand() % 60));
+        int id = heap.add(job);
+        added[id] = job;
+    }
+
+    int64_t end = TEST_START + 6 * 3600000;
+    std::vector<sched_job_t> ran = run_until(heap, end);
+
+    TEST_ASSERT_EQUAL(TEST_JOBS, heap.size());
+
+    for(const sched_job_t &job : ran)
+    {
+        TEST_ASSERT_EQUAL(0, (job.due_ms - added[job.id].due_ms) % job.period_ms);
+        runs[job.id]++;
+    }
+
+    for(int id = 1; id <= TEST_JOBS; id++)
+        TEST_ASSERT_EQUAL((end - added[id].due_ms) / added[id].period_ms + 1, runs[id]);
+}
+
+static void test_removed_jobs_do_not_run()
+{
+    JobHeap heap(storage, TEST_JOBS, sim_clock, &sim_now, TEST_MAX_LATE);
+
+    for(int i = 0; i < TEST_JOBS; i++)
+        heap.add(make_job(TEST_START + 1000 + rand() % 86400000, 0));
+
+    for(int id = 2; id <= TEST_JOBS; id += 2)
+        TEST_ASSERT_TRUE(heap.remove(id));
+
+    TEST_ASSERT_FALSE(heap.remove(2));
+    TEST_ASSERT_EQUAL(TEST_JOBS / 2, heap.size());
+
+    std::vector<sched_job_t> ran = run_until(heap, TEST_START + 86400000 + 1000);
+
+    TEST_ASSERT_EQUAL(TEST_JOBS / 2, ran.size());
+    for(size_t i = 0; i < ran.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(1, ran[i].id % 2);
+        if(i > 0)
+            TEST_ASSERT_TRUE(ran[i - 1].due_ms <= ran[i].due_ms);
+    }
+}
+
+// A list saved in heap order and loaded again runs the same jobs, with the same ids
+static void test_load_keeps_ids_and_order()
+{
+    static sched_job_t saved[TEST_JOBS], reloaded[TEST_JOBS];
+    JobHeap heap(storage, TEST_JOBS, sim_clock, &sim_now, TEST_MAX_LATE);
+
+    for(int i = 0; i < TEST_JOBS - 1; i++)
+        heap.add(make_job(TEST_START + 1000 + rand() % 86400000, 0));
+    heap.remove(100);
+
+    uint16_t count = heap.size();
+    for(uint16_t i = 0; i < count; i++)
+        saved[i] = *heap.at(i);
+
+    // Shuffled, as the order in the list should not matter
+    for(uint16_t i = count - 1; i > 0; i--)
+    {
+        uint16_t j = rand() % (i + 1);
+        sched_job_t temp = saved[i];
+        saved[i] = saved[j];
+        saved[j] = temp;
+    }
+
+    JobHeap other(reloaded, TEST_JOBS, sim_clock, &sim_now, TEST_MAX_LATE);
+    other.load(saved, count);
+
+    TEST_ASSERT_EQUAL(count, other.size());
+    TEST_ASSERT_EQUAL(TEST_JOBS, other.add(make_job(TEST_START + 1000, 0)));
+    TEST_ASSERT_TRUE(other.remove(TEST_JOBS));
+
+    int64_t start = sim_now;
+    std::vector<sched_job_t> expected = run_until(heap, TEST_START + 86400000 + 1000);
+    sim_now = start;
+    std::vector<sched_job_t> ran = run_until(other, TEST_START + 86400000 + 1000);
+
+    TEST_ASSERT_EQUAL(expected.size(), ran.size());
+    for(size_t i = 0; i < ran.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(expected[i].due_ms, ran[i].due_ms);
+        TEST_ASSERT_NOT_EQUAL(100, ran[i].id);
+    }
+}
+
+// Jobs found more than max_late_ms overdue are skipped, and repeating ones move on to their next run
+static void test_late_jobs_are_skipped()
+{
+    JobHeap heap(storage, TEST_JOBS, sim_clock, &sim_now, TEST_MAX_LATE);
+    sched_job_t job;
+
+    heap.add(make_job(TEST_START - TEST_MAX_LATE - 1, 0));
+    heap.add(make_job(TEST_START - TEST_MAX_LATE + 1, 0));
+    int daily = heap.add(make_job(TEST_START - 86400000LL * 3 - TEST_MAX_LATE - 1, 86400000));
+
+    TEST_ASSERT_EQUAL(0, heap.next_wait());
+    TEST_ASSERT_TRUE(heap.pop_due(&job));
+    TEST_ASSERT_EQUAL(TEST_START - TEST_MAX_LATE + 1, job.due_ms);
+    TEST_ASSERT_FALSE(heap.pop_due(&job));
+
+    TEST_ASSERT_EQUAL(2, heap.get_skipped());
+    TEST_ASSERT_EQUAL(1, heap.size());
+    TEST_ASSERT_EQUAL(daily, heap.at(0)->id);
+    TEST_ASSERT_EQUAL(86400000 - TEST_MAX_LATE - 1, heap.next_wait());
+}
+
+// After a reboot, repeating jobs that are due move to their next run, while jobs that run once are kept
+static void test_due_repeats_are_skipped_after_reboot()
+{
+    JobHeap heap(storage, TEST_JOBS, sim_clock, &sim_now, TEST_MAX_LATE);
+    std::vector<int64_t> first(TEST_JOBS + 1);
+
+    for(int i = 0; i < TEST_JOBS; i++)
+    {
+        sched_job_t job = make_job(TEST_START - 3600000 + rand() % 7200000, i % 2 ? 0 : 60000 * (1 + rand() % 60));
+        first[heap.add(job)] = job.due_ms;
+    }
+
+    heap.skip_due_repeats();
+
+    uint32_t repeats_due = 0;
+    for(uint16_t i = 0; i < heap.size(); i++)
+    {
+        const sched_job_t* job = heap.at(i);
+
+        if(job->period_ms == 0)
+        {
+            TEST_ASSERT_EQUAL(first[job->id], job->due_ms);
+            continue;
+        }
+
+        if(first[job->id] > sim_now)
+        {
+            TEST_ASSERT_EQUAL(first[job->id], job->due_ms);
+            continue;
+        }
+
+        repeats_due++;
+
+        TEST_ASSERT_TRUE(job->due_ms > sim_now);
+        TEST_ASSERT_TRUE(job->due_ms <= sim_now + job->period_ms);
+        TEST_ASSERT_EQUAL(0, (job->due_ms - first[job->id]) % job->period_ms);
+    }
+
+    TEST_ASSERT_EQUAL(repeats_due, heap.get_skipped());
+
+    // The heap is still in order, and only jobs that run once are due
+    sched_job_t job;
+    int64_t last = 0;
+    while(heap.pop_due(&job))
+    {
+        TEST_ASSERT_EQUAL(0, job.period_ms);
+        TEST_ASSERT_TRUE(job.due_ms >= last);
+        last = job.due_ms;
+    }
+
+    std::vector<sched_job_t> ran = run_until(heap, TEST_START + 3600000);
+    for(size_t i = 1; i < ran.size(); i++)
+        TEST_ASSERT_TRUE(ran[i - 1].due_ms <= ran[i].due_ms);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_jobs_run_in_due_order);
+    RUN_TEST(test_repeating_jobs);
+    RUN_TEST(test_removed_jobs_do_not_run);
+    RUN_TEST(test_load_keeps_ids_and_order);
+    RUN_TEST(test_late_jobs_are_skipped);
+    RUN_TEST(test_due_repeats_are_skipped_after_reboot);
+
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+// Host tests of the conversion between Pronto hex and timing lists, see src/Pronto.h
+// Run with : pio test -e native -f test_pronto
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "Pronto.h"
+
+void setUp() {}
+void tearDown() {}
+
+// NEC frame of a TV remote, 38 kHz, with the repeat frame in the repeat sequence
+static const char* kNec =
+    "0000 006D 0022 0002 0155 00AA 0015 0015 0015 0015 0015 0040 0015 0015 0015 0015 0015 0015 0015 0015 "
+    "0015 0015 0015 0040 0015 0040 0015 0015 0015 0040 0015 0040 0015 0040 0015 0040 0015 0040 0015 0015 "
+    "0015 0015 0015 0015 0015 0040 0015 0015 0015 0015 0015 0015 0015 0015 0015 0040 0015 0040 0015 0040 "
+    "0015 0015 0015 0040 0015 0040 0015 0040 0015 0040 0015 05ED 0155 0055 0015 0E47";
+
+// Bang & Olufsen style code on a 455 kHz carrier, frequency code 9
+static const char* kBeo =
+    "0000 0009 0006 0000 0619 0619 0619 0C32 0619 1C62 0619 0619 0619 0C32 0619 4F6A";
+
+// Converts to a timing list, and back to Pronto hex with the same frequency
+static void round_trip(const char* pronto, char* out, size_t out_size, uint32_t* freq_hz)
+{
+    uint16_t timings[256];
+
+    int len = pronto_to_timings(pronto, 0, timings, 256, freq_hz);
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_TRUE(timings_to_pronto(timings, len, *freq_hz, out, out_size) > 0);
+}
+
+static void test_round_trip_38khz()
+{
+    char out[1024];
+    uint32_t freq_hz;
+    uint16_t timings[256];
+
+    TEST_ASSERT_EQUAL(68, pronto_to_timings(kNec, 0, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(38029, freq_hz);
+    TEST_ASSERT_EQUAL(8967, timings[0]);
+    TEST_ASSERT_EQUAL(4470, timings[1]);
+
+    // The repeat sequence is left out when converting back
+    const char* once = "0000 006D 0022 0000";
+    round_trip(kNec, out, sizeof(out), &freq_hz);
+
+    TEST_ASSERT_EQUAL_STRING_LEN(once, out, 19);
+    TEST_ASSERT_EQUAL_STRING_LEN(kNec + 19, out + 19, 68 * 5 - 1);
+}
+
+// Carriers above 65.5 kHz need the frequency in 32 bits
+static void test_round_trip_455khz()
+{
+    char out[256];
+    uint32_t freq_hz;
+    uint16_t timings[32];
+
+    TEST_ASSERT_EQUAL(12, pronto_to_timings(kBeo, 0, timings, 32, &freq_hz));
+    TEST_ASSERT_EQUAL(460572, freq_hz);
+    TEST_ASSERT_EQUAL(3389, timings[0]);
+    TEST_ASSERT_EQUAL(44141, timings[11]);
+
+    round_trip(kBeo, out, sizeof(out), &freq_hz);
+    TEST_ASSERT_EQUAL_STRING(kBeo, out);
+}
+
+// Timings come back within half a carrier period at any frequency with a Pronto code
+static void test_timings_round_trip()
+{
+    const uint32_t frequencies[] = {455000, 56000, 40000, 38000, 36000, 33000};
+    uint16_t timings[100], decoded[300];
+    char out[1024];
+    uint32_t freq_hz;
+
+    srand(1);
+    for(int round = 0; round < 600; round++)
+    {
+        uint32_t hz = frequencies[round % 6];
+        uint16_t len = 2 * (1 + rand() % 50);
+
+        for(uint16_t i = 0; i < len; i++)
+            timings[i] = 100 + rand() % 20000;
+
+        TEST_ASSERT_TRUE(timings_to_pronto(timings, len, hz, out, sizeof(out)) > 0);
+        TEST_ASSERT_EQUAL(len, pronto_to_timings(out, 0, decoded, 300, &freq_hz));
+
+        uint32_t code = (PRONTO_CLOCK_HZ + hz / 2) / hz;
+        uint32_t half_period = (code * 1000000u / PRONTO_CLOCK_HZ + 1) / 2 + 1;
+
+        for(uint16_t i = 0; i < len; i++)
+            TEST_ASSERT_TRUE(abs((int)decoded[i] - timings[i]) <= (int)half_period);
+    }
+}
+
+static void test_repeats()
+{
+    uint16_t timings[256];
+    uint32_t freq_hz;
+
+    // The last space of the repeat frame is 96 ms, split in two
+    TEST_ASSERT_EQUAL(68 + 3 * 6, pronto_to_timings(kNec, 3, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(8967, timings[68]);
+    TEST_ASSERT_EQUAL(8967, timings[74]);
+
+    // Without a once sequence, the repeat sequence is sent at least once
+    TEST_ASSERT_EQUAL(4, pronto_to_timings("0000 006D 0000 0002 0155 0055 0015 05ED", 0, timings, 256, &freq_hz));
+}
+
+// A space too long for 16 bits is split with a zero entry, and merged back into one
+static void test_long_space()
+{
+    uint16_t timings[8];
+    char out[64];
+    uint32_t freq_hz;
+
+    TEST_ASSERT_EQUAL(4, pronto_to_timings("0000 006D 0001 0000 0155 0C00", 0, timings, 8, &freq_hz));
+    TEST_ASSERT_EQUAL(UINT16_MAX, timings[1]);
+    TEST_ASSERT_EQUAL(0, timings[2]);
+    TEST_ASSERT_EQUAL(80781 - UINT16_MAX, timings[3]);
+
+    TEST_ASSERT_TRUE(timings_to_pronto(timings, 4, freq_hz, out, sizeof(out)) > 0);
+    TEST_ASSERT_EQUAL_STRING("0000 006D 0001 0000 0155 0C00", out);
+}
+
+static void test_trailing_gap_added()
+{
+    const uint16_t timings[] = {560, 560, 560};
+    char out[64];
+    uint16_t decoded[8];
+    uint32_t freq_hz;
+
+    TEST_ASSERT_TRUE(timings_to_pronto(timings, 3, 38000, out, sizeof(out)) > 0);
+    TEST_ASSERT_EQUAL(4, pronto_to_timings(out, 0, decoded, 8, &freq_hz));
+    TEST_ASSERT_INT_WITHIN(14, PRONTO_TRAILING_GAP, decoded[3]);
+}
+
+static void test_invalid_input_is_rejected()
+{
+    uint16_t timings[256];
+    uint32_t freq_hz;
+
+    TEST_ASSERT_EQUAL(-1, pronto_to_timings("0100 006D 0001 0000 0155 00AA", 0, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(-1, pronto_to_timings("0000 0000 0001 0000 0155 00AA", 0, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(-1, pronto_to_timings("0000 006D 0000 0000", 0, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(-1, pronto_to_timings("0000 006D 0002 0000 0155 00AA", 0, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(-1, pronto_to_timings("0000 006D 0001 0000 0155 000AA", 0, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(-1, pronto_to_timings("0000 006D 0001 0000 0155 zz", 0, timings, 256, &freq_hz));
+    TEST_ASSERT_EQUAL(-1, pronto_to_timings(kNec, 0, timings, 67, &freq_hz));
+}
+
+static void test_unsupported_frequency_is_rejected()
+{
+    const uint16_t timings[] = {560, 560};
+    char out[64];
+
+    // Frequency codes are 16 bits, the lowest carrier is about 63 Hz
+    TEST_ASSERT_EQUAL(-1, timings_to_pronto(timings, 2, 0, out, sizeof(out)));
+    TEST_ASSERT_EQUAL(-1, timings_to_pronto(timings, 2, 60, out, sizeof(out)));
+    TEST_ASSERT_EQUAL(-1, timings_to_pronto(timings, 2, 38000, out, 20));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip_38khz);
+    RUN_TEST(test_round_trip_455khz);
+    RUN_TEST(test_timings_round_trip);
+    RUN_TEST(test_repeats);
+    RUN_TEST(test_long_space);
+    RUN_TEST(test_trailing_gap_added);
+    RUN_TEST(test_invalid_input_is_rejected);
+    RUN_TEST(test_unsupported_frequency_is_rejected);
+
+    return UNITY_END();
+}
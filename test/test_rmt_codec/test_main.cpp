@@ -0,0 +1,209 @@
+// Host tests of the conversion between timing lists and RMT items, see src/RmtCodec.h
+// Run with : pio test -e native -f test_rmt_codec
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "RmtCodec.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Durations of the items in order, with their levels, stopping at the zero duration that ends a transmission
+static size_t flatten(const rmt_code_item_t* items, size_t count, uint32_t* durations, uint8_t* levels)
+{
+    size_t n = 0;
+
+    for(size_t i = 0; i < 2 * count; i++)
+    {
+        uint32_t duration = (i % 2 == 0) ? items[i / 2].duration0 : items[i / 2].duration1;
+        if(duration == 0)
+            break;
+
+        durations[n] = duration;
+        levels[n] = (i % 2 == 0) ? items[i / 2].level0 : items[i / 2].level1;
+        n++;
+    }
+
+    return n;
+}
+
+static void test_marks_and_spaces_alternate()
+{
+    const uint16_t timings[] = {9000, 4500, 560, 1690, 560, 20000};
+    rmt_code_item_t items[8];
+
+    size_t count = rmt_encode_timings(timings, 6, 1, items, 8);
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL(count, rmt_items_needed(timings, 6, 1));
+
+    uint32_t durations[16];
+    uint8_t levels[16];
+    TEST_ASSERT_EQUAL(6, flatten(items, count, durations, levels));
+
+    for(size_t i = 0; i < 6; i++)
+    {
+        TEST_ASSERT_EQUAL(timings[i], durations[i]);
+        TEST_ASSERT_EQUAL(i % 2 == 0 ? 1 : 0, levels[i]);
+    }
+}
+
+// A list ending with a mark leaves half an item, closed with the zero duration that ends the transmission
+static void test_odd_length_ends_with_zero()
+{
+    const uint16_t timings[] = {560, 560, 560};
+    rmt_code_item_t items[4];
+
+    size_t count = rmt_encode_timings(timings, 3, 1, items, 4);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(560, items[1].duration0);
+    TEST_ASSERT_EQUAL(0, items[1].duration1);
+}
+
+static void test_long_durations_are_split()
+{
+    const uint16_t timings[] = {560, 65000};
+    rmt_code_item_t items[4];
+
+    size_t count = rmt_encode_timings(timings, 2, 1, items, 4);
+    TEST_ASSERT_EQUAL(rmt_items_needed(timings, 2, 1), count);
+
+    uint32_t durations[8];
+    uint8_t levels[8];
+    size_t n = flatten(items, count, durations, levels);
+
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL(RMT_MAX_DURATION, durations[1]);
+    TEST_ASSERT_EQUAL(65000 - RMT_MAX_DURATION, durations[2]);
+    TEST_ASSERT_EQUAL(0, levels[1]);
+    TEST_ASSERT_EQUAL(0, levels[2]);
+}
+
+// Zero length entries stand for splits of durations longer than 16 bits, and the two sides are sent as one
+static void test_zero_entries_are_skipped()
+{
+    const uint16_t timings[] = {560, 65535, 0, 10000, 560};
+    rmt_code_item_t items[8];
+
+    size_t count = rmt_encode_timings(timings, 5, 1, items, 8);
+
+    uint32_t durations[16];
+    uint8_t levels[16];
+    size_t n = flatten(items, count, durations, levels);
+
+    uint32_t space = 0;
+    for(size_t i = 1; i + 1 < n; i++)
+    {
+        TEST_ASSERT_EQUAL(0, levels[i]);
+        space += durations[i];
+    }
+
+    TEST_ASSERT_EQUAL(65535 + 10000, space);
+    TEST_ASSERT_EQUAL(1, levels[n - 1]);
+}
+
+static void test_ticks_are_rounded()
+{
+    const uint16_t timings[] = {561, 1689};
+    rmt_code_item_t items[2];
+
+    TEST_ASSERT_EQUAL(1, rmt_encode_timings(timings, 2, 2, items, 2));
+    TEST_ASSERT_EQUAL(281, items[0].duration0);
+    TEST_ASSERT_EQUAL(845, items[0].duration1);
+}
+
+static void test_short_buffer_fails()
+{
+    const uint16_t timings[] = {9000, 4500, 560, 560, 560};
+    rmt_code_item_t items[2];
+
+    TEST_ASSERT_EQUAL(0, rmt_encode_timings(timings, 5, 1, items, 2));
+}
+
+// rmt_items_needed sizes the buffer of the send path, so it has to agree with the encoder on any input
+static void test_items_needed_matches_encoder()
+{
+    uint16_t timings[200];
+    rmt_code_item_t items[400];
+
+    srand(1);
+    for(int round = 0; round < 1000; round++)
+    {
+        uint16_t len = 1 + rand() % 200;
+        for(uint16_t i = 0; i < len; i++)
+            timings[i] = rand() % 8 == 0 ? 0 : rand() % 65536;
+
+        uint8_t tick_us = 1 + rand() % 4;
+        size_t needed = rmt_items_needed(timings, len, tick_us);
+
+        TEST_ASSERT_EQUAL(needed, rmt_encode_timings(timings, len, tick_us, items, needed));
+    }
+}
+
+// Items sent are read back by the receive path as the same frame
+static void test_decode_round_trip()
+{
+    const uint16_t timings[] = {9000, 4500, 560, 1690, 560, 560, 560};
+    rmt_code_item_t items[8];
+    uint16_t rawbuf[16];
+    bool overflow;
+
+    size_t count = rmt_encode_timings(timings, 7, 1, items, 8);
+    uint16_t rawlen = rmt_decode_items(items, count, 1, rawbuf, 16, &overflow);
+
+    TEST_ASSERT_FALSE(overflow);
+    TEST_ASSERT_EQUAL(8, rawlen);
+    TEST_ASSERT_EQUAL(0, rawbuf[0]);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(timings, rawbuf + 1, 7);
+}
+
+static void test_decode_skips_leading_space_and_merges_levels()
+{
+    rmt_code_item_t items[3] = {};
+    items[0].duration0 = 300; items[0].level0 = 1;      // Idle, active low receiver
+    items[0].duration1 = 400; items[0].level1 = 0;
+    items[1].duration0 = 100; items[1].level0 = 0;
+    items[1].duration1 = 200; items[1].level1 = 1;
+    items[2].duration0 = 0;
+
+    uint16_t rawbuf[8];
+    bool overflow;
+    uint16_t rawlen = rmt_decode_items(items, 3, 0, rawbuf, 8, &overflow);
+
+    TEST_ASSERT_EQUAL(3, rawlen);
+    TEST_ASSERT_EQUAL(500, rawbuf[1]);
+    TEST_ASSERT_EQUAL(200, rawbuf[2]);
+}
+
+static void test_decode_flags_overflow()
+{
+    const uint16_t timings[] = {560, 560, 560, 560, 560};
+    rmt_code_item_t items[4];
+    uint16_t rawbuf[3];
+    bool overflow;
+
+    size_t count = rmt_encode_timings(timings, 5, 1, items, 4);
+    uint16_t rawlen = rmt_decode_items(items, count, 1, rawbuf, 3, &overflow);
+
+    TEST_ASSERT_TRUE(overflow);
+    TEST_ASSERT_EQUAL(3, rawlen);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_marks_and_spaces_alternate);
+    RUN_TEST(test_odd_length_ends_with_zero);
+    RUN_TEST(test_long_durations_are_split);
+    RUN_TEST(test_zero_entries_are_skipped);
+    RUN_TEST(test_ticks_are_rounded);
+    RUN_TEST(test_short_buffer_fails);
+    RUN_TEST(test_items_needed_matches_encoder);
+    RUN_TEST(test_decode_round_trip);
+    RUN_TEST(test_decode_skips_leading_space_and_merges_levels);
+    RUN_TEST(test_decode_flags_overflow);
+
+    return UNITY_END();
+}
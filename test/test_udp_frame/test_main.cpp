@@ -0,0 +1,223 @@
+// Host tests of the datagram format of the UDP commands and of their replay protection, see src/UdpFrame.h
+// Run with : pio test -e native -f test_udp_frame
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "UdpFrame.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Datagram with a payload of len bytes and a MAC of zeros. Returns its size
+static size_t make_datagram(uint8_t* out, uint8_t type, uint8_t mask, uint32_t seq, uint16_t len)
+{
+    memcpy(out, UDP_MAGIC, 2);
+    out[2] = UDP_VERSION;
+    out[3] = UDP_FLAG_ACK;
+    out[4] = type;
+    out[5] = mask;
+    for(int i = 0; i < 4; i++)
+        out[6 + i] = (seq >> (8 * i)) & 0xFF;
+    out[10] = len & 0xFF;
+    out[11] = len >> 8;
+
+    for(uint16_t i = 0; i < len; i++)
+        out[UDP_HEADER_SIZE + i] = i;
+    memset(out + UDP_HEADER_SIZE + len, 0, UDP_MAC_SIZE);
+
+    return UDP_HEADER_SIZE + len + UDP_MAC_SIZE;
+}
+
+static void test_parse()
+{
+    uint8_t data[UDP_MAX_DATAGRAM];
+    udp_frame_t frame;
+
+    size_t size = make_datagram(data, UDP_CMD_CODE, 0x05, 0x12345678, 8);
+
+    TEST_ASSERT_TRUE(udp_parse(data, size, &frame));
+    TEST_ASSERT_EQUAL(UDP_FLAG_ACK, frame.flags);
+    TEST_ASSERT_EQUAL(UDP_CMD_CODE, frame.type);
+    TEST_ASSERT_EQUAL(0x05, frame.mask);
+    TEST_ASSERT_EQUAL(0x12345678, frame.seq);
+    TEST_ASSERT_EQUAL(8, frame.len);
+    TEST_ASSERT_TRUE(frame.payload == data + UDP_HEADER_SIZE);
+    TEST_ASSERT_EQUAL(7, frame.payload[7]);
+}
+
+// The payload length has to match the datagram size exactly, and the datagram has to fit in UDP_MAX_DATAGRAM
+static void test_parse_bounds()
+{
+    uint8_t data[UDP_MAX_DATAGRAM + 1];
+    udp_frame_t frame;
+
+    // Empty payload
+    size_t size = make_datagram(data, UDP_CMD_CODE, 0, 1, 0);
+    TEST_ASSERT_EQUAL(UDP_HEADER_SIZE + UDP_MAC_SIZE, size);
+    TEST_ASSERT_TRUE(udp_parse(data, size, &frame));
+
+    // Every truncation
+    for(size_t cut = 0; cut < size; cut++)
+        TEST_ASSERT_FALSE(udp_parse(data, cut, &frame));
+
+    // Largest payload
+    uint16_t largest = UDP_MAX_DATAGRAM - UDP_HEADER_SIZE - UDP_MAC_SIZE;
+    size = make_datagram(data, UDP_CMD_RAW, 0, 1, largest);
+    TEST_ASSERT_EQUAL(UDP_MAX_DATAGRAM, size);
+    TEST_ASSERT_TRUE(udp_parse(data, size, &frame));
+    TEST_ASSERT_EQUAL(largest, frame.len);
+
+    size = make_datagram(data, UDP_CMD_RAW, 0, 1, largest + 1);
+    TEST_ASSERT_FALSE(udp_parse(data, size, &frame));
+
+    // Lengths that do not match the datagram, including one that would wrap around
+    size = make_datagram(data, UDP_CMD_RAW, 0, 1, 100);
+    TEST_ASSERT_FALSE(udp_parse(data, size - 1, &frame));
+    TEST_ASSERT_FALSE(udp_parse(data, size + 1, &frame));
+
+    data[10] = 0xFF;
+    data[11] = 0xFF;
+    TEST_ASSERT_FALSE(udp_parse(data, size, &frame));
+}
+
+static void test_parse_rejects_other_formats()
+{
+    uint8_t data[64];
+    udp_frame_t frame;
+
+    size_t size = make_datagram(data, UDP_CMD_AC, 0, 1, 4);
+
+    data[0] = 'X';
+    TEST_ASSERT_FALSE(udp_parse(data, size, &frame));
+
+    size = make_datagram(data, UDP_CMD_AC, 0, 1, 4);
+    data[2] = UDP_VERSION + 1;
+    TEST_ASSERT_FALSE(udp_parse(data, size, &frame));
+}
+
+// Acks are datagrams of the same format, with the status and the next sequence number as payload
+static void test_ack()
+{
+    uint8_t data[64], ack[UDP_HEADER_SIZE + UDP_ACK_PAYLOAD_SIZE + UDP_MAC_SIZE];
+    udp_frame_t frame, reply;
+
+    udp_parse(data, make_datagram(data, UDP_CMD_PACKED, 0x03, 0xA0B0C0D0, 4), &frame);
+
+    size_t len = udp_write_ack(ack, &frame, UDP_STATUS_BUSY, 0xA0B0C0D1);
+    TEST_ASSERT_EQUAL(UDP_HEADER_SIZE + UDP_ACK_PAYLOAD_SIZE, len);
+
+    memset(ack + len, 0, UDP_MAC_SIZE);
+    TEST_ASSERT_TRUE(udp_parse(ack, len + UDP_MAC_SIZE, &reply));
+
+    TEST_ASSERT_EQUAL(UDP_FLAG_ACK, reply.flags);
+    TEST_ASSERT_EQUAL(UDP_CMD_PACKED, reply.type);
+    TEST_ASSERT_EQUAL(0x03, reply.mask);
+    TEST_ASSERT_EQUAL(0xA0B0C0D0, reply.seq);
+    TEST_ASSERT_EQUAL(UDP_ACK_PAYLOAD_SIZE, reply.len);
+    TEST_ASSERT_EQUAL(UDP_STATUS_BUSY, reply.payload[0]);
+    TEST_ASSERT_EQUAL(0xD1, reply.payload[1]);
+    TEST_ASSERT_EQUAL(0xA0, reply.payload[4]);
+}
+
+static void test_mac_equal()
+{
+    uint8_t a[UDP_MAC_SIZE], b[UDP_MAC_SIZE];
+
+    for(int i = 0; i < UDP_MAC_SIZE; i++)
+        a[i] = b[i] = i * 17;
+
+    TEST_ASSERT_TRUE(udp_mac_equal(a, b, UDP_MAC_SIZE));
+
+    for(int i = 0; i < UDP_MAC_SIZE; i++)
+    {
+        b[i] ^= 0x80;
+        TEST_ASSERT_FALSE(udp_mac_equal(a, b, UDP_MAC_SIZE));
+        b[i] ^= 0x80;
+    }
+}
+
+// Numbers up to and including the floor are refused, the next ones are accepted once each
+static void test_window_floor()
+{
+    UdpReplayWindow window;
+
+    window.reset(100);
+    TEST_ASSERT_EQUAL(101, window.next());
+
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(0));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(99));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(100));
+
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(101));
+    TEST_ASSERT_EQUAL(UDP_STATUS_DUPLICATE, window.check(101));
+    TEST_ASSERT_EQUAL(102, window.next());
+
+    // Gaps are allowed, and the numbers skipped are not accepted afterwards
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(110));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(105));
+    TEST_ASSERT_EQUAL(111, window.next());
+
+    // A new window starts from 0, which is refused
+    UdpReplayWindow fresh;
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, fresh.check(0));
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, fresh.check(1));
+}
+
+// Numbers accepted up to UDP_REPLAY_WINDOW - 1 below the highest are told apart as duplicates, older ones are stale
+static void test_window_edges()
+{
+    UdpReplayWindow window;
+
+    window.reset(1000);
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(1001));
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(1002));
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(1002 + UDP_REPLAY_WINDOW - 1));
+
+    TEST_ASSERT_EQUAL(UDP_STATUS_DUPLICATE, window.check(1002));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(1001));
+
+    // A jump of exactly the window size leaves nothing behind
+    window.reset(2000);
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(2001));
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(2001 + UDP_REPLAY_WINDOW));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(2001));
+    TEST_ASSERT_EQUAL(UDP_STATUS_DUPLICATE, window.check(2001 + UDP_REPLAY_WINDOW));
+
+    // Every number of a full window in a row is remembered
+    window.reset(3000);
+    for(uint32_t seq = 3001; seq <= 3000 + UDP_REPLAY_WINDOW; seq++)
+        TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(seq));
+    for(uint32_t seq = 3001; seq <= 3000 + UDP_REPLAY_WINDOW; seq++)
+        TEST_ASSERT_EQUAL(UDP_STATUS_DUPLICATE, window.check(seq));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(3000));
+}
+
+// The highest sequence number is accepted, and nothing after it
+static void test_window_top()
+{
+    UdpReplayWindow window;
+
+    window.reset(UINT32_MAX - 2);
+    TEST_ASSERT_EQUAL(UDP_STATUS_OK, window.check(UINT32_MAX));
+    TEST_ASSERT_EQUAL(UDP_STATUS_DUPLICATE, window.check(UINT32_MAX));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(UINT32_MAX - 1));
+    TEST_ASSERT_EQUAL(UDP_STATUS_STALE, window.check(0));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_parse);
+    RUN_TEST(test_parse_bounds);
+    RUN_TEST(test_parse_rejects_other_formats);
+    RUN_TEST(test_ack);
+    RUN_TEST(test_mac_equal);
+    RUN_TEST(test_window_floor);
+    RUN_TEST(test_window_edges);
+    RUN_TEST(test_window_top);
+
+    return UNITY_END();
+}
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+# Turns the deferred log records printed by the firmware (see src/BinLog.h) back into text.
+# The format strings are read from the ELF file of the firmware that printed them.
+#
+# Usage : binlog_decode.py <firmware.elf> [log file]
+# e.g.    pio device monitor | tools/binlog_decode.py .pio/build/nodemcu-32s/firmware.elf
+#
+# Lines that are not records are passed through unchanged.
+
+import base64
+import re
+import struct
+import sys
+
+LINE_PREFIX = "~L"
+HEADER_WORDS = 4
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D"}
+
+ARG_NONE, ARG_INT, ARG_UINT, ARG_INT64, ARG_UINT64, ARG_DOUBLE, ARG_STR = range(7)
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# printf conversions, with the flags and width kept and the length modifiers dropped
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t|L)?([diouxXeEfgGcsp%])")
+
+
+class Elf:
+    """Loaded sections of an ELF file, to read strings at their run time address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError("%s is not an ELF file" % path)
+
+        is64 = self.data[4] == 2
+        endian = "<" if self.data[5] == 1 else ">"
+
+        if is64:
+            shoff, = struct.unpack_from(endian + "Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 0x3A)
+            section = endian + "IIQQQQ"
+        else:
+            shoff, = struct.unpack_from(endian + "I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 0x2E)
+            section = endian + "IIIIII"
+
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(section, self.data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size > 0:
+                self.sections.append((addr, offset, size))
+
+    def string(self, addr):
+        for start, offset, size in self.sections:
+            if start <= addr < start + size:
+                begin = offset + addr - start
+                end = self.data.index(b"\0", begin)
+                return self.data[begin:end].decode("utf-8", "replace")
+        return None
+
+
+def read_args(record, count):
+    types = record[HEADER_WORDS * 4:HEADER_WORDS * 4 + count]
+    pos = HEADER_WORDS * 4 + ((count + 3) & ~3)
+    args = []
+
+    for t in types:
+        if t == ARG_NONE:
+            args.append(None)
+            continue
+
+        if t == ARG_INT:
+            value, = struct.unpack_from("<i", record, pos)
+            size = 4
+        elif t == ARG_UINT:
+            value, = struct.unpack_from("<I", record, pos)
+            size = 4
+        elif t == ARG_INT64:
+            value, = struct.unpack_from("<q", record, pos)
+            size = 8
+        elif t == ARG_UINT64:
+            value, = struct.unpack_from("<Q", record, pos)
+            size = 8
+        elif t == ARG_DOUBLE:
+            value, = struct.unpack_from("<d", record, pos)
+            size = 8
+        elif t == ARG_STR:
+            length = record[pos]
+            value = record[pos + 1:pos + 1 + length].decode("utf-8", "replace")
+            size = 1 + length
+        else:
+            raise ValueError("unknown argument type %d" % t)
+
+        args.append(value)
+        pos += (size + 3) & ~3
+
+    return args
+
+
+def format_message(fmt, args):
+    args = iter(args)
+
+    def convert(match):
+        spec, _, conv = match.groups()
+        if conv == "%":
+            return "%"
+
+        value = next(args, None)
+        if value is None:
+            return "<?>"
+        if conv == "p":
+            return "0x%08x" % value
+        if conv == "u":
+            conv = "d"
+        if conv in "cdiouxX" and isinstance(value, float):
+            value = int(value)
+        if conv == "c" and isinstance(value, int):
+            value = chr(value & 0xFF)
+
+        try:
+            return ("%" + spec + conv) % value
+        except (TypeError, ValueError):
+            return str(value)
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode_line(elf, line):
+    record = base64.b64decode(line[len(LINE_PREFIX):])
+    header, fmt_addr, time_ms, suppressed = struct.unpack_from("<IIII", record)
+
+    level = LEVELS.get((header >> 16) & 0x7, "?")
+    count = (header >> 19) & 0x1F
+
+    fmt = elf.string(fmt_addr)
+    if fmt is None:
+        return "%s (%d) <unknown format 0x%08x, built from another ELF?>" % (level, time_ms, fmt_addr)
+
+    text = "%s (%d) %s" % (level, time_ms, format_message(fmt, read_args(record, count)))
+    if suppressed & 0xFFFF:
+        text += " [%d similar left out]" % (suppressed & 0xFFFF)
+
+    return text
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write("Usage : %s <firmware.elf> [log file]\n" % sys.argv[0])
+        return 1
+
+    elf = Elf(sys.argv[1])
+    source = open(sys.argv[2], errors="replace") if len(sys.argv) > 2 else sys.stdin
+
+    for line in source:
+        line = line.rstrip("\r\n")
+
+        if not line.startswith(LINE_PREFIX):
+            print(line)
+            continue
+
+        try:
+            print(decode_line(elf, line))
+        except (ValueError, struct.error) as e:
+            print(line + "    <could not decode : %s>" % e)
+
+        sys.stdout.flush()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
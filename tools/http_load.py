@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# Load test of the http server : concurrent clients send a mix of raw sends, AC sends, captures and scans for a while,
+# then the throughput and latency percentiles are reported for each type of request.
+# Runs against the firmware, or against the host build of its server (src/host/http_server.cpp).
+#
+# Usage : http_load.py [-d seconds] [-c clients] [-m raw=8,ac=4,get=2,scan=1] [host:port]
+# e.g.    .pio/build/http-host/program 8080 & tools/http_load.py -d 30 -c 16 localhost:8080
+#
+# Each client keeps its connection open between requests, as browsers and home automation clients do.
+# "Busy" responses are counted apart from errors : they are the server shedding load, not failing.
+
+import argparse
+import http.client
+import random
+import threading
+import time
+
+RAW_FRAME = "68:9000,4500," + ",".join(["560,560", "560,1690"] * 16) + ",560,40000"
+AC_MESSAGE = "3,0,1,1,25,1,2,4,2,1,0,1,1,0,0,1,-1,-1"
+
+# Type : method, path, body
+REQUESTS = {
+    "raw": ("POST", "/", RAW_FRAME),
+    "ac": ("POST", "/ac", AC_MESSAGE),
+    "get": ("GET", "/?timeout=2000", None),
+    "scan": ("GET", "/scan", None),
+}
+
+
+class Stats:
+    """Outcomes and latencies of one type of request."""
+
+    def __init__(self):
+        self.latencies = []
+        self.busy = 0
+        self.errors = 0
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    index = min(len(values) - 1, int(fraction * len(values)))
+    return values[index]
+
+
+def parse_mix(text):
+    mix = {}
+    for item in text.split(","):
+        name, _, weight = item.partition("=")
+        if name not in REQUESTS:
+            raise argparse.ArgumentTypeError("unknown request type %s" % name)
+        mix[name] = int(weight)
+    return mix
+
+
+def client(host, port, mix, deadline, stats, lock):
+    names = list(mix.keys())
+    weights = list(mix.values())
+    conn = http.client.HTTPConnection(host, port, timeout=30)
+
+    while time.monotonic() < deadline:
+        name = random.choices(names, weights)[0]
+        method, path, body = REQUESTS[name]
+
+        start = time.monotonic()
+        try:
+            conn.request(method, path, body)
+            response = conn.getresponse()
+            text = response.read().decode(errors="replace")
+            ok = response.status == 200
+            busy = text == "Busy"
+            if response.getheader("Connection", "").lower() == "close" or response.will_close:
+                conn.close()
+        except (OSError, http.client.HTTPException):
+            ok = False
+            busy = False
+            conn.close()
+        elapsed = time.monotonic() - start
+
+        with lock:
+            entry = stats[name]
+            if not ok:
+                entry.errors += 1
+            elif busy:
+                entry.busy += 1
+            else:
+                entry.latencies.append(elapsed)
+
+    conn.close()
+
+
+def report(name, entry, duration):
+    latencies = sorted(entry.latencies)
+    print("%-6s %8d %7d %7d %9.1f %9.1f %9.1f %9.1f" % (
+        name, len(latencies), entry.busy, entry.errors, len(latencies) / duration,
+        percentile(latencies, 0.5) * 1000, percentile(latencies, 0.99) * 1000, percentile(latencies, 0.999) * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load test of the http server")
+    parser.add_argument("address", nargs="?", default="localhost:8080", help="host:port of the server")
+    parser.add_argument("-d", "--duration", type=float, default=10, help="length of the test in seconds")
+    parser.add_argument("-c", "--clients", type=int, default=8, help="number of concurrent clients")
+    parser.add_argument("-m", "--mix", type=parse_mix, default=parse_mix("raw=8,ac=4,get=2,scan=1"),
+                        help="weights of the request types")
+    args = parser.parse_args()
+
+    host, _, port = args.address.partition(":")
+    stats = {name: Stats() for name in args.mix}
+    lock = threading.Lock()
+
+    deadline = time.monotonic() + args.duration
+    threads = [threading.Thread(target=client, args=(host, int(port or 80), args.mix, deadline, stats, lock))
+               for _ in range(args.clients)]
+
+    start = time.monotonic()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    duration = time.monotonic() - start
+
+    total = Stats()
+    for entry in stats.values():
+        total.latencies += entry.latencies
+        total.busy += entry.busy
+        total.errors += entry.errors
+
+    print("%d clients, %.1f s" % (args.clients, duration))
+    print("%-6s %8s %7s %7s %9s %9s %9s %9s" % ("type", "ok", "busy", "errors", "req/s", "p50 ms", "p99 ms", "p999 ms"))
+    for name, entry in stats.items():
+        report(name, entry, duration)
+    report("all", total, duration)
+
+
+if __name__ == "__main__":
+    main()
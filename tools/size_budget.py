@@ -0,0 +1,222 @@
+# Reports the static RAM, flash, largest stack frame and deepest call chain of each module of the firmware after it is
+# linked, and fails the build when the totals go over the budgets set in platformio.ini. Run by PlatformIO, see
+# extra_scripts.
+#
+# Budgets, in bytes, 0 or left out to skip the check :
+#   custom_ram_budget         : static DRAM of the firmware, initialized data and bss, including task stacks
+#   custom_flash_budget       : size of the image, checked against the app partition
+#   custom_stack_frame_budget : largest stack frame of a single function of this firmware
+#   custom_stack_budget       : stack of the deepest call chain starting in a function of this firmware
+#
+# Stack frames come from gcc -fstack-usage, and the calls between functions from the disassembly of the linked
+# firmware. The stack of a module is the largest sum of frames along a chain of calls from one of its functions.
+# It is a lower bound : calls through pointers (callx), frames of the framework and libraries, which are built without
+# -fstack-usage, and the frames of interrupts are not counted, and recursion is only followed once. GET "/tasks" shows
+# the stack the tasks really use.
+
+import os
+import re
+import subprocess
+
+Import("env", "projenv")
+
+# Only the sources of the firmware write .su files next to their objects
+projenv.Append(CCFLAGS=["-fstack-usage"])
+
+# Sections of object files by prefix
+MODULE_RAM_SECTIONS = (".data", ".bss", ".dram", ".noinit", ".sbss", ".sdata")
+MODULE_FLASH_SECTIONS = (".text", ".literal", ".rodata", ".data", ".iram", ".dram", ".sdata")
+
+# Sections of the linked firmware
+ELF_RAM_SECTIONS = (".dram0.data", ".dram0.bss", ".noinit")
+ELF_NOT_FLASH_SECTIONS = (".dram0.bss", ".noinit", ".rtc.bss", ".rtc_noinit")
+
+
+def read_sections(size_tool, path):
+    """Returns (name, size, address) of each section of an object or ELF file."""
+    output = subprocess.check_output([size_tool, "-A", path]).decode(errors="replace")
+    sections = []
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[0].startswith(".") and fields[1].isdigit():
+            sections.append((fields[0], int(fields[1]), int(fields[2])))
+    return sections
+
+
+def largest_frame(su_path):
+    """Returns the largest stack frame in a .su file and the function it belongs to."""
+    frame, function = 0, ""
+    if not os.path.exists(su_path):
+        return frame, function
+    with open(su_path) as su:
+        for line in su:
+            # <file>:<line>:<column>:<function>\t<bytes>\t<static|dynamic|dynamic,bounded>
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) >= 2 and fields[1].isdigit() and int(fields[1]) > frame:
+                frame, function = int(fields[1]), fields[0].split(":", 3)[-1]
+    return frame, function
+
+
+def read_frames(su_path):
+    """Returns the stack frame of each function in a .su file, by name."""
+    frames = {}
+    if not os.path.exists(su_path):
+        return frames
+    with open(su_path) as su:
+        for line in su:
+            # <file>:<line>:<column>:<function>\t<bytes>\t<static|dynamic|dynamic,bounded>
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) >= 2 and fields[1].isdigit():
+                name = function_key(fields[0].split(":", 3)[-1])
+                frames[name] = max(frames.get(name, 0), int(fields[1]))
+    return frames
+
+
+def function_key(name):
+    """Returns the qualified name of a function without its return type, parameters or clone suffix, so that the
+    names gcc writes in .su files match those objdump prints. Overloads share a key, and the largest frame."""
+    name = name.split(" [clone", 1)[0]
+    depth = 0
+    start = 0
+    for i, char in enumerate(name):
+        if char == "<":
+            depth += 1
+        elif char == ">":
+            depth -= 1
+        elif char == " " and depth == 0:
+            start = i + 1
+        elif char == "(" and depth == 0 and i > 0:
+            name = name[start:i]
+            break
+    return re.sub(r"\.(constprop|isra|part|cold)\.\d+$", "", name.strip())
+
+
+# Function headers and direct calls in objdump -d -C output : "400d1234 <name>:" and "call8  400d5678 <name>"
+FUNCTION_LINE = re.compile(r"^[0-9a-f]+ <(.+)>:$")
+CALL_LINE = re.compile(r"\tcall(?:q|0|4|8|12)?\s+[0-9a-f]+ <(.+)>\s*$")
+
+
+def read_calls(objdump_tool, elf):
+    """Returns the functions each function of the firmware calls directly, by key."""
+    output = subprocess.check_output([objdump_tool, "-d", "-C", elf]).decode(errors="replace")
+    calls = {}
+    caller = None
+    for line in output.splitlines():
+        match = FUNCTION_LINE.match(line)
+        if match:
+            caller = calls.setdefault(function_key(match.group(1)), set())
+            continue
+        match = CALL_LINE.search(line)
+        if match and caller is not None:
+            callee = match.group(1)
+            # Calls into the middle of a function are branches within it
+            if "+0x" not in callee:
+                caller.add(function_key(callee))
+    return calls
+
+
+def deepest_chain(function, frames, calls, memo, visiting):
+    """Returns the largest sum of frames along a chain of calls from function, and that chain."""
+    if function in memo:
+        return memo[function]
+    if function in visiting:
+        return 0, []
+    visiting.add(function)
+    below, chain = 0, []
+    for callee in calls.get(function, ()):
+        depth, callee_chain = deepest_chain(callee, frames, calls, memo, visiting)
+        if depth > below:
+            below, chain = depth, callee_chain
+    visiting.discard(function)
+    memo[function] = (frames.get(function, 0) + below, [function] + chain)
+    return memo[function]
+
+
+def module_report(size_tool, build_dir):
+    modules = []
+    for root, _, files in os.walk(os.path.join(build_dir, "src")):
+        for name in sorted(files):
+            if not name.endswith(".o"):
+                continue
+            path = os.path.join(root, name)
+            ram = flash = 0
+            for section, size, _ in read_sections(size_tool, path):
+                if section.startswith(MODULE_RAM_SECTIONS):
+                    ram += size
+                if section.startswith(MODULE_FLASH_SECTIONS):
+                    flash += size
+            frame, function = largest_frame(path[:-len(".o")] + ".su")
+            modules.append([os.path.relpath(path, build_dir)[:-len(".o")], ram, flash, frame, function,
+                            read_frames(path[:-len(".o")] + ".su")])
+    return modules
+
+
+def module_stacks(modules, calls):
+    """Appends the deepest call chain from the functions of each module to its report."""
+    frames = {}
+    for module in modules:
+        for name, frame in module[5].items():
+            frames[name] = max(frames.get(name, 0), frame)
+    memo = {}
+    for module in modules:
+        stack, chain = 0, []
+        for name in module[5]:
+            depth, function_chain = deepest_chain(name, frames, calls, memo, set())
+            if depth > stack:
+                stack, chain = depth, function_chain
+        module.extend([stack, chain])
+
+
+def budget(name):
+    return int(env.GetProjectOption(name, "0") or 0)
+
+
+def check(label, value, limit):
+    if limit == 0:
+        print("%-18s %8d" % (label, value))
+        return True
+    print("%-18s %8d of %8d (%d%%)%s" % (label, value, limit, value * 100 // limit, "" if value <= limit else " OVER BUDGET"))
+    return value <= limit
+
+
+def size_budget(target, source, env):
+    size_tool = env.subst("$SIZETOOL")
+    build_dir = env.subst("$BUILD_DIR")
+    elf = str(target[0])
+
+    # The objdump of the toolchain sits next to its compiler
+    objdump_tool = re.sub(r"g(cc|\+\+)$", "objdump", env.subst("$CC"))
+
+    modules = module_report(size_tool, build_dir)
+    module_stacks(modules, read_calls(objdump_tool, elf))
+    modules.sort(key=lambda module: module[1] + module[2], reverse=True)
+
+    print("%-32s %8s %8s %8s %8s  %s" % ("module", "RAM", "flash", "frame", "stack", "largest frame in"))
+    for path, ram, flash, frame, function, _, stack, _ in modules:
+        print("%-32s %8d %8d %8d %8d  %s" % (path, ram, flash, frame, stack, function))
+
+    deepest = max(modules, key=lambda module: module[6]) if modules else None
+    if deepest is not None and deepest[6] > 0:
+        print("Deepest call chain, from %s : %s" % (deepest[0], " > ".join(deepest[7])))
+
+    ram = flash = 0
+    for section, size, address in read_sections(size_tool, elf):
+        if section.startswith(ELF_RAM_SECTIONS):
+            ram += size
+        if address != 0 and not section.startswith(ELF_NOT_FLASH_SECTIONS):
+            flash += size
+    frame = max([module[3] for module in modules] or [0])
+    stack = deepest[6] if deepest is not None else 0
+
+    ok = check("static RAM", ram, budget("custom_ram_budget"))
+    ok = check("flash", flash, budget("custom_flash_budget")) and ok
+    ok = check("largest frame", frame, budget("custom_stack_frame_budget")) and ok
+    ok = check("deepest stack", stack, budget("custom_stack_budget")) and ok
+
+    if not ok:
+        print("Size budget exceeded, see the budgets in platformio.ini")
+        return 1
+    return 0
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_budget)